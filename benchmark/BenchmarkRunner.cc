@@ -0,0 +1,286 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "BenchmarkRunner.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <libArrayToolbox/ATBTiming.hh>
+#include <libBaseFunctions/BaseEnvironment.hh>
+
+namespace benchmark
+{
+
+  Benchmark::Benchmark(std::string const &name, atb::BlitzIndexT maxSize)
+          : _name(name), _maxSize(maxSize)
+  {}
+
+  Benchmark::~Benchmark()
+  {}
+
+  std::string const &Benchmark::name() const
+  {
+    return _name;
+  }
+
+  atb::BlitzIndexT Benchmark::maxSize() const
+  {
+    return _maxSize;
+  }
+
+  void Benchmark::tearDown()
+  {}
+
+  double Benchmark::itemsPerRun(atb::BlitzIndexT size) const
+  {
+    return static_cast<double>(size) * static_cast<double>(size) *
+        static_cast<double>(size);
+  }
+
+  BenchmarkRunner::BenchmarkRunner()
+          : _minTimeSeconds(1.0), _minIterations(3), _maxIterations(1000)
+  {
+    _sizes.push_back(64);
+    _sizes.push_back(128);
+    _sizes.push_back(256);
+    _sizes.push_back(512);
+    _nThreads.push_back(1);
+#ifdef _OPENMP
+    if (omp_get_max_threads() > 1) _nThreads.push_back(omp_get_max_threads());
+#endif
+  }
+
+  BenchmarkRunner::~BenchmarkRunner()
+  {
+    for (size_t i = 0; i < _benchmarks.size(); ++i) delete _benchmarks[i];
+  }
+
+  void BenchmarkRunner::add(Benchmark *benchmark)
+  {
+    _benchmarks.push_back(benchmark);
+  }
+
+  void BenchmarkRunner::setSizes(std::vector<atb::BlitzIndexT> const &sizes)
+  {
+    _sizes = sizes;
+  }
+
+  void BenchmarkRunner::setThreadCounts(std::vector<int> const &nThreads)
+  {
+    _nThreads = nThreads;
+  }
+
+  void BenchmarkRunner::setMinTime(double minTimeSeconds)
+  {
+    _minTimeSeconds = minTimeSeconds;
+  }
+
+  void BenchmarkRunner::setMinIterations(int minIterations)
+  {
+    _minIterations = std::max(1, minIterations);
+  }
+
+  void BenchmarkRunner::setMaxIterations(int maxIterations)
+  {
+    _maxIterations = std::max(1, maxIterations);
+  }
+
+  void BenchmarkRunner::setFilter(std::string const &filter)
+  {
+    _filter = filter;
+  }
+
+  void BenchmarkRunner::listBenchmarks(std::ostream &out) const
+  {
+    for (size_t i = 0; i < _benchmarks.size(); ++i)
+        out << _benchmarks[i]->name() << " (sizes up to "
+            << _benchmarks[i]->maxSize() << ")" << std::endl;
+  }
+
+  void BenchmarkRunner::run(std::ostream &log)
+  {
+    log << std::left << std::setw(40) << "Benchmark" << std::right
+        << std::setw(8) << "Iter" << std::setw(14) << "Mean [ms]"
+        << std::setw(14) << "Min [ms]" << std::setw(14) << "StdDev [ms]"
+        << std::setw(14) << "CPU [ms]" << std::setw(14) << "Items/s"
+        << std::endl;
+
+    for (size_t b = 0; b < _benchmarks.size(); ++b)
+    {
+      Benchmark &benchmark = *_benchmarks[b];
+      if (benchmark.name().find(_filter) == std::string::npos) continue;
+      for (size_t s = 0; s < _sizes.size(); ++s)
+      {
+        if (_sizes[s] > benchmark.maxSize()) continue;
+        try
+        {
+          benchmark.setUp(_sizes[s]);
+          for (size_t t = 0; t < _nThreads.size(); ++t)
+          {
+            BenchmarkResult result = _measure(
+                benchmark, _sizes[s], _nThreads[t]);
+            std::stringstream runName;
+            runName << result.name << "/" << result.size << "/threads:"
+                    << result.nThreads;
+            log << std::left << std::setw(40) << runName.str() << std::right
+                << std::setw(8) << result.iterations << std::fixed
+                << std::setprecision(3)
+                << std::setw(14) << result.meanMs
+                << std::setw(14) << result.minMs
+                << std::setw(14) << result.stddevMs
+                << std::setw(14) << result.cpuMs
+                << std::scientific << std::setprecision(3)
+                << std::setw(14) << result.itemsPerSecond << std::endl;
+            log.unsetf(std::ios_base::floatfield);
+            _results.push_back(result);
+          }
+          benchmark.tearDown();
+        }
+        catch (std::exception &e)
+        {
+          log << benchmark.name() << "/" << _sizes[s] << " failed: "
+              << e.what() << std::endl;
+          benchmark.tearDown();
+        }
+      }
+    }
+  }
+
+  std::vector<BenchmarkResult> const &BenchmarkRunner::results() const
+  {
+    return _results;
+  }
+
+  void BenchmarkRunner::writeJson(std::ostream &out) const
+  {
+    int nCpus = 1;
+#ifdef _OPENMP
+    nCpus = omp_get_num_procs();
+#endif
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << atb::MyDateTime::prettyDate() << "\",\n"
+        << "    \"host_name\": \"" << BaseEnvironment::HostName() << "\",\n"
+        << "    \"executable\": \"iRoCSBenchmark\",\n"
+        << "    \"num_cpus\": " << nCpus << ",\n"
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n  \"benchmarks\": [";
+    out << std::setprecision(std::numeric_limits<double>::digits10);
+    for (size_t i = 0; i < _results.size(); ++i)
+    {
+      BenchmarkResult const &result = _results[i];
+      std::stringstream runName;
+      runName << result.name << "/" << result.size << "/threads:"
+              << result.nThreads;
+      out << ((i == 0) ? "\n" : ",\n")
+          << "    {\n"
+          << "      \"name\": \"" << runName.str() << "\",\n"
+          << "      \"run_name\": \"" << runName.str() << "\",\n"
+          << "      \"run_type\": \"iteration\",\n"
+          << "      \"iterations\": " << result.iterations << ",\n"
+          << "      \"real_time\": " << result.meanMs << ",\n"
+          << "      \"cpu_time\": " << result.cpuMs << ",\n"
+          << "      \"time_unit\": \"ms\",\n"
+          << "      \"size\": " << result.size << ",\n"
+          << "      \"threads\": " << result.nThreads << ",\n"
+          << "      \"min_time_ms\": " << result.minMs << ",\n"
+          << "      \"max_time_ms\": " << result.maxMs << ",\n"
+          << "      \"stddev_time_ms\": " << result.stddevMs << ",\n"
+          << "      \"items_per_second\": " << result.itemsPerSecond << "\n"
+          << "    }";
+    }
+    out << "\n  ]\n}" << std::endl;
+  }
+
+  BenchmarkResult BenchmarkRunner::_measure(
+      Benchmark &benchmark, atb::BlitzIndexT size, int nThreads)
+  {
+#ifdef _OPENMP
+    int previousNThreads = omp_get_max_threads();
+    omp_set_num_threads(nThreads);
+#else
+    nThreads = 1;
+#endif
+
+    // Warm-up
+    benchmark.run();
+
+    std::vector<double> timesMs;
+    double totalSeconds = 0.0;
+    std::clock_t cpuStart = std::clock();
+    while (static_cast<int>(timesMs.size()) < _maxIterations &&
+           (totalSeconds < _minTimeSeconds ||
+            static_cast<int>(timesMs.size()) < _minIterations))
+    {
+      long long start = atb::MyDateTime::time_us();
+      benchmark.run();
+      long long elapsed = atb::MyDateTime::time_us() - start;
+      timesMs.push_back(1.0e-3 * static_cast<double>(elapsed));
+      totalSeconds += 1.0e-6 * static_cast<double>(elapsed);
+    }
+    std::clock_t cpuEnd = std::clock();
+
+    BenchmarkResult result;
+    result.name = benchmark.name();
+    result.size = size;
+    result.nThreads = nThreads;
+    result.iterations = static_cast<int>(timesMs.size());
+    double sum = 0.0, sumSquares = 0.0;
+    result.minMs = std::numeric_limits<double>::infinity();
+    result.maxMs = 0.0;
+    for (size_t i = 0; i < timesMs.size(); ++i)
+    {
+      sum += timesMs[i];
+      sumSquares += timesMs[i] * timesMs[i];
+      result.minMs = std::min(result.minMs, timesMs[i]);
+      result.maxMs = std::max(result.maxMs, timesMs[i]);
+    }
+    double n = static_cast<double>(timesMs.size());
+    result.meanMs = sum / n;
+    result.stddevMs = (timesMs.size() > 1) ?
+        std::sqrt(std::max(0.0, (sumSquares - sum * sum / n) / (n - 1.0))) :
+        0.0;
+    result.cpuMs = 1000.0 * static_cast<double>(cpuEnd - cpuStart) /
+        static_cast<double>(CLOCKS_PER_SEC) / n;
+    result.itemsPerSecond = (result.meanMs > 0.0) ?
+        benchmark.itemsPerRun(size) / (1.0e-3 * result.meanMs) : 0.0;
+
+#ifdef _OPENMP
+    omp_set_num_threads(previousNThreads);
+#endif
+    return result;
+  }
+
+}
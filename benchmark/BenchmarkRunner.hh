@@ -0,0 +1,196 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef BENCHMARKRUNNER_HH
+#define BENCHMARKRUNNER_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <libArrayToolbox/TypeTraits.hh>
+
+namespace benchmark
+{
+
+/*======================================================================*/
+/*!
+ *  \class Benchmark BenchmarkRunner.hh "BenchmarkRunner.hh"
+ *  \brief Base class of all benchmarks.
+ *
+ *  A benchmark is parametrized by the side length of the cubic volume it
+ *  operates on. setUp() prepares the input for one size and is not timed,
+ *  run() is the timed operation and is called repeatedly with the same
+ *  input.
+ */
+/*======================================================================*/
+  class Benchmark
+  {
+
+  public:
+
+    Benchmark(std::string const &name, atb::BlitzIndexT maxSize = 512);
+
+    virtual ~Benchmark();
+
+    std::string const &name() const;
+
+/*======================================================================*/
+/*!
+ *   Sizes above this value are skipped, because the benchmark would not
+ *   fit into memory or take unreasonably long.
+ */
+/*======================================================================*/
+    atb::BlitzIndexT maxSize() const;
+
+    virtual void setUp(atb::BlitzIndexT size) = 0;
+
+    virtual void run() = 0;
+
+    virtual void tearDown();
+
+/*======================================================================*/
+/*!
+ *   The number of items processed by one call to run() used to report
+ *   the throughput. Defaults to the number of voxels.
+ */
+/*======================================================================*/
+    virtual double itemsPerRun(atb::BlitzIndexT size) const;
+
+  private:
+
+    std::string _name;
+    atb::BlitzIndexT _maxSize;
+
+  };
+
+/*======================================================================*/
+/*!
+ *  \struct BenchmarkResult BenchmarkRunner.hh "BenchmarkRunner.hh"
+ *  \brief Timing statistics of one benchmark, size and thread count.
+ *
+ *  All times are per call of Benchmark::run() in milliseconds. The CPU
+ *  time is summed over all threads.
+ */
+/*======================================================================*/
+  struct BenchmarkResult
+  {
+    std::string name;
+    atb::BlitzIndexT size;
+    int nThreads;
+    int iterations;
+    double meanMs;
+    double minMs;
+    double maxMs;
+    double stddevMs;
+    double cpuMs;
+    double itemsPerSecond;
+  };
+
+/*======================================================================*/
+/*!
+ *  \class BenchmarkRunner BenchmarkRunner.hh "BenchmarkRunner.hh"
+ *  \brief Runs all registered benchmarks for all requested volume sizes
+ *    and thread counts.
+ *
+ *  Every combination is run once untimed to warm up caches and the FFTW
+ *  planner and is then repeated until both the minimum time and the
+ *  minimum number of iterations are reached.
+ */
+/*======================================================================*/
+  class BenchmarkRunner
+  {
+
+  public:
+
+    BenchmarkRunner();
+
+    ~BenchmarkRunner();
+
+/*======================================================================*/
+/*!
+ *   Register a benchmark. The runner takes ownership.
+ */
+/*======================================================================*/
+    void add(Benchmark *benchmark);
+
+    void setSizes(std::vector<atb::BlitzIndexT> const &sizes);
+
+    void setThreadCounts(std::vector<int> const &nThreads);
+
+    void setMinTime(double minTimeSeconds);
+
+    void setMinIterations(int minIterations);
+
+    void setMaxIterations(int maxIterations);
+
+/*======================================================================*/
+/*!
+ *   Only run benchmarks whose name contains the given string.
+ */
+/*======================================================================*/
+    void setFilter(std::string const &filter);
+
+    void listBenchmarks(std::ostream &out) const;
+
+/*======================================================================*/
+/*!
+ *   Run the benchmarks and print a result table row for every finished
+ *   combination to the given stream.
+ */
+/*======================================================================*/
+    void run(std::ostream &log = std::cout);
+
+    std::vector<BenchmarkResult> const &results() const;
+
+/*======================================================================*/
+/*!
+ *   Write the results in the JSON layout of Google Benchmark, so that
+ *   its comparison and tracking tools can consume them. Run names have
+ *   the form "<benchmark>/<size>/threads:<n>".
+ */
+/*======================================================================*/
+    void writeJson(std::ostream &out) const;
+
+  private:
+
+    BenchmarkResult _measure(
+        Benchmark &benchmark, atb::BlitzIndexT size, int nThreads);
+
+    std::vector<Benchmark*> _benchmarks;
+    std::vector<atb::BlitzIndexT> _sizes;
+    std::vector<int> _nThreads;
+    double _minTimeSeconds;
+    int _minIterations;
+    int _maxIterations;
+    std::string _filter;
+    std::vector<BenchmarkResult> _results;
+
+  };
+
+}
+
+#endif
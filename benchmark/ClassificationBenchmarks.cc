@@ -0,0 +1,253 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+
+#include "Benchmarks.hh"
+#include "SyntheticData.hh"
+
+#include <libsvmtl/BasicFV.hh>
+#include <libsvmtl/DirectAccessor.hh>
+#include <libsvmtl/TwoClassSVMc.hh>
+#include <libsvmtl/Kernel_RBF.hh>
+#include <libsvmtl/Model.hh>
+
+#include <libArrayToolbox/algo/lBlitzRandomForest.hh>
+
+namespace benchmark
+{
+
+  static int const nFeatures = 27;
+  static atb::BlitzIndexT const testStridePx = 4;
+
+/*======================================================================*/
+/*!
+ *   Sample training vectors from a 64^3 synthetic volume on a regular grid
+ *   and at all blob centers. Samples closer than 2 micrometers to a blob
+ *   center are positives, all others are negatives.
+ */
+/*======================================================================*/
+  static void sampleTrainingSet(
+      blitz::Array<float,2> &features, blitz::Array<int,1> &labels)
+  {
+    atb::Array<float,3> volume;
+    std::vector< blitz::TinyVector<double,3> > centersUm;
+    syntheticNuclei(volume, 64, &centersUm, 2);
+
+    std::vector< blitz::TinyVector<atb::BlitzIndexT,3> > positions;
+    for (size_t i = 0; i < centersUm.size(); ++i)
+        positions.push_back(
+            blitz::TinyVector<atb::BlitzIndexT,3>(
+                centersUm[i] / volume.elementSizeUm() + 0.5));
+    for (atb::BlitzIndexT z = 3; z < volume.extent(0); z += 6)
+        for (atb::BlitzIndexT y = 3; y < volume.extent(1); y += 6)
+            for (atb::BlitzIndexT x = 3; x < volume.extent(2); x += 6)
+                positions.push_back(
+                    blitz::TinyVector<atb::BlitzIndexT,3>(z, y, x));
+
+    features.resize(static_cast<atb::BlitzIndexT>(positions.size()), nFeatures);
+    labels.resize(static_cast<atb::BlitzIndexT>(positions.size()));
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+      neighborhoodFeatures(
+          volume, positions[i], &features(static_cast<atb::BlitzIndexT>(i), 0));
+      blitz::TinyVector<double,3> posUm(
+          blitz::TinyVector<double,3>(positions[i]) * volume.elementSizeUm());
+      labels(static_cast<atb::BlitzIndexT>(i)) = 0;
+      for (size_t j = 0; j < centersUm.size(); ++j)
+      {
+        blitz::TinyVector<double,3> dUm(posUm - centersUm[j]);
+        if (blitz::dot(dUm, dUm) < 4.0)
+        {
+          labels(static_cast<atb::BlitzIndexT>(i)) = 1;
+          break;
+        }
+      }
+    }
+  }
+
+/*======================================================================*/
+/*!
+ *   Extract one feature vector per voxel on a grid with testStridePx
+ *   spacing. The feature matrix is row-major with nFeatures columns.
+ */
+/*======================================================================*/
+  static void sampleTestSet(
+      atb::BlitzIndexT size, blitz::Array<float,2> &features)
+  {
+    atb::Array<float,3> volume;
+    syntheticNuclei(volume, size);
+    atb::BlitzIndexT n = size / testStridePx;
+    features.resize(n * n * n, nFeatures);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (atb::BlitzIndexT i = 0; i < n * n * n; ++i)
+    {
+      blitz::TinyVector<atb::BlitzIndexT,3> pos(
+          (i / (n * n)) * testStridePx, ((i / n) % n) * testStridePx,
+          (i % n) * testStridePx);
+      neighborhoodFeatures(volume, pos, &features(i, 0));
+    }
+  }
+
+  class ClassificationBenchmark : public Benchmark
+  {
+
+  public:
+
+    ClassificationBenchmark(std::string const &name, atb::BlitzIndexT maxSize)
+            : Benchmark(name, maxSize)
+    {}
+
+    double itemsPerRun(atb::BlitzIndexT size) const
+    {
+      double n = static_cast<double>(size / testStridePx);
+      return n * n * n;
+    }
+
+  };
+
+  class SVMClassificationBenchmark : public ClassificationBenchmark
+  {
+
+  public:
+
+    SVMClassificationBenchmark()
+            : ClassificationBenchmark("SVMClassification", 256), _trained(false)
+    {}
+
+    void setUp(atb::BlitzIndexT size)
+    {
+      if (!_trained) _train();
+      blitz::Array<float,2> features;
+      sampleTestSet(size, features);
+      _testVectors.clear();
+      _testVectors.reserve(features.extent(0));
+      for (atb::BlitzIndexT i = 0; i < features.extent(0); ++i)
+          _testVectors.push_back(
+              svt::BasicFV(
+                  std::vector<double>(
+                      features.data() + i * nFeatures,
+                      features.data() + (i + 1) * nFeatures)));
+    }
+
+    void run()
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(_testVectors.size());
+           ++i)
+          _testVectors[i].setLabel(_svm.classify(_testVectors[i], _model));
+    }
+
+    void tearDown()
+    {
+      _testVectors.clear();
+    }
+
+  private:
+
+    void _train()
+    {
+      blitz::Array<float,2> features;
+      blitz::Array<int,1> labels;
+      sampleTrainingSet(features, labels);
+      std::vector<svt::BasicFV> trainVectors;
+      for (atb::BlitzIndexT i = 0; i < labels.extent(0); ++i)
+          trainVectors.push_back(
+              svt::BasicFV(
+                  std::vector<double>(
+                      features.data() + i * nFeatures,
+                      features.data() + (i + 1) * nFeatures),
+                  (labels(i) == 1) ? 1 : -1, static_cast<int>(i)));
+      _svm.kernel().setGamma(0.1);
+      _svm.setCost(10.0);
+      _svm.updateKernelCache(
+          trainVectors.begin(), trainVectors.end(), svt::DirectAccessor());
+      _svm.train(trainVectors.begin(), trainVectors.end(), _model);
+      _svm.clearKernelCache();
+      _trained = true;
+    }
+
+    svt::TwoClassSVMc<svt::Kernel_RBF> _svm;
+    svt::Model<svt::BasicFV> _model;
+    std::vector<svt::BasicFV> _testVectors;
+    bool _trained;
+
+  };
+
+  class RandomForestClassificationBenchmark : public ClassificationBenchmark
+  {
+
+  public:
+
+    RandomForestClassificationBenchmark()
+            : ClassificationBenchmark("RandomForestClassification", 512),
+              _forest(100), _trained(false)
+    {}
+
+    void setUp(atb::BlitzIndexT size)
+    {
+      if (!_trained)
+      {
+        blitz::Array<float,2> features;
+        blitz::Array<int,1> labels;
+        sampleTrainingSet(features, labels);
+        trainRFSimple(_forest, features, labels);
+        _trained = true;
+      }
+      sampleTestSet(size, _features);
+      _labels.resize(_features.extent(0));
+    }
+
+    void run()
+    {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (atb::BlitzIndexT i = 0; i < _features.extent(0); ++i)
+          _labels(i) = _forest.predict(&_features(i, 0));
+    }
+
+    void tearDown()
+    {
+      _features.free();
+      _labels.free();
+    }
+
+  private:
+
+    lRandomForest _forest;
+    blitz::Array<float,2> _features;
+    blitz::Array<int,1> _labels;
+    bool _trained;
+
+  };
+
+  void registerClassificationBenchmarks(BenchmarkRunner &runner)
+  {
+    runner.add(new SVMClassificationBenchmark());
+    runner.add(new RandomForestClassificationBenchmark());
+  }
+
+}
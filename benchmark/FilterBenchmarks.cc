@@ -0,0 +1,242 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+
+#include "Benchmarks.hh"
+#include "SyntheticData.hh"
+
+#include <libArrayToolbox/ATBDataSynthesis.hh>
+#include <libArrayToolbox/ATBMorphology.hh>
+#include <libArrayToolbox/GaussianFilter.hh>
+#include <libArrayToolbox/SeparableConvolutionFilter.hh>
+#include <libArrayToolbox/MedianFilter.hh>
+#include <libArrayToolbox/FastConvolutionFilter.hh>
+#include <libArrayToolbox/HoughTransform.hh>
+
+namespace benchmark
+{
+
+  class VolumeBenchmark : public Benchmark
+  {
+
+  public:
+
+    VolumeBenchmark(std::string const &name, atb::BlitzIndexT maxSize = 512)
+            : Benchmark(name, maxSize)
+    {}
+
+    virtual void setUp(atb::BlitzIndexT size)
+    {
+      syntheticNuclei(_data, size);
+      _result.setElementSizeUm(_data.elementSizeUm());
+    }
+
+    virtual void tearDown()
+    {
+      _data.free();
+      _result.free();
+    }
+
+  protected:
+
+    atb::Array<float,3> _data, _result;
+
+  };
+
+  class GaussianFilterBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    GaussianFilterBenchmark()
+            : VolumeBenchmark("GaussianFilter")
+    {}
+
+    void run()
+    {
+      atb::GaussianFilter<float,3>::apply(
+          _data, _result, blitz::TinyVector<double,3>(2.0));
+    }
+
+  };
+
+  class SeparableConvolutionFilterBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    SeparableConvolutionFilterBenchmark()
+            : VolumeBenchmark("SeparableConvolutionFilter"), _kernel(7)
+    {
+      // Binomial kernel of length 7
+      _kernel = 1.0f, 6.0f, 15.0f, 20.0f, 15.0f, 6.0f, 1.0f;
+      _kernel /= 64.0f;
+    }
+
+    void run()
+    {
+      blitz::TinyVector<blitz::Array<float,1>*,3> kernels;
+      for (int d = 0; d < 3; ++d) kernels(d) = &_kernel;
+      atb::SeparableConvolutionFilter<float,3>::apply(
+          _data, _result, kernels);
+    }
+
+  private:
+
+    blitz::Array<float,1> _kernel;
+
+  };
+
+  class MedianFilterBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    MedianFilterBenchmark()
+            : VolumeBenchmark("MedianFilter", 256)
+    {}
+
+    void run()
+    {
+      atb::MedianFilter<float,3>::apply(
+          _data, _result, blitz::TinyVector<atb::BlitzIndexT,3>(3));
+    }
+
+  };
+
+  class FastConvolutionFilterBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    FastConvolutionFilterBenchmark()
+            : VolumeBenchmark("FastConvolutionFilter", 256)
+    {}
+
+    void setUp(atb::BlitzIndexT size)
+    {
+      VolumeBenchmark::setUp(size);
+      _kernel.setElementSizeUm(_data.elementSizeUm());
+      atb::gaussian(_kernel, blitz::TinyVector<double,3>(2.0), atb::NORMALIZE);
+    }
+
+    void run()
+    {
+      atb::FastConvolutionFilter<float,3>::apply(_data, _result, _kernel);
+    }
+
+  private:
+
+    atb::Array<float,3> _kernel;
+
+  };
+
+  class HoughTransformBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    HoughTransformBenchmark()
+            : VolumeBenchmark("HoughTransform", 256)
+    {}
+
+    void run()
+    {
+      atb::houghTransform(
+          _data, _result, _radiusUm, blitz::TinyVector<double,2>(2.0, 4.0),
+          0.5, 0.01);
+    }
+
+  private:
+
+    atb::Array<float,3> _radiusUm;
+
+  };
+
+  class ConnectedComponentLabellingBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    ConnectedComponentLabellingBenchmark()
+            : VolumeBenchmark("ConnectedComponentLabelling")
+    {}
+
+    void setUp(atb::BlitzIndexT size)
+    {
+      VolumeBenchmark::setUp(size);
+      _mask.resize(_data.shape());
+      _mask = _data > 0.3f;
+    }
+
+    void run()
+    {
+      atb::connectedComponentLabelling(_mask, _labels, atb::COMPLEX_NHOOD);
+    }
+
+    void tearDown()
+    {
+      VolumeBenchmark::tearDown();
+      _mask.free();
+      _labels.free();
+    }
+
+  private:
+
+    blitz::Array<bool,3> _mask;
+    blitz::Array<atb::BlitzIndexT,3> _labels;
+
+  };
+
+  class RescaleBenchmark : public VolumeBenchmark
+  {
+
+  public:
+
+    RescaleBenchmark()
+            : VolumeBenchmark("Rescale", 256)
+    {}
+
+    // The input is rescaled in place, so the timed region includes copying
+    // it into the working array
+    void run()
+    {
+      _result.resize(_data.shape());
+      _result = _data;
+      _result.setElementSizeUm(_data.elementSizeUm());
+      _result.rescale(blitz::TinyVector<double,3>(1.0));
+    }
+
+  };
+
+  void registerFilterBenchmarks(BenchmarkRunner &runner)
+  {
+    runner.add(new GaussianFilterBenchmark());
+    runner.add(new SeparableConvolutionFilterBenchmark());
+    runner.add(new MedianFilterBenchmark());
+    runner.add(new FastConvolutionFilterBenchmark());
+    runner.add(new HoughTransformBenchmark());
+    runner.add(new ConnectedComponentLabellingBenchmark());
+    runner.add(new RescaleBenchmark());
+  }
+
+}
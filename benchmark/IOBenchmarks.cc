@@ -0,0 +1,117 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+
+#include "Benchmarks.hh"
+#include "SyntheticData.hh"
+
+#include <libBlitzHdf5/BlitzHdf5Light.hh>
+#include <libBaseFunctions/BaseEnvironment.hh>
+#include <libBaseFunctions/BaseFile.hh>
+
+namespace benchmark
+{
+
+  class Hdf5Benchmark : public Benchmark
+  {
+
+  public:
+
+    Hdf5Benchmark(std::string const &name)
+            : Benchmark(name)
+    {}
+
+    virtual void setUp(atb::BlitzIndexT size)
+    {
+      syntheticNuclei(_data, size);
+      _fileName = BaseFile::FindUniqueUnexistingName(
+          BaseEnvironment::UserTempDirectory() + "/iRoCSBenchmark-XXXXXX.h5",
+          'X');
+      BlitzH5File outFile(_fileName, BlitzH5File::Replace);
+      outFile.writeDataset(_data, "/volume");
+    }
+
+    virtual void tearDown()
+    {
+      _data.free();
+      if (_fileName != "") BaseFile::Remove(_fileName);
+      _fileName = "";
+    }
+
+  protected:
+
+    atb::Array<float,3> _data;
+    std::string _fileName;
+
+  };
+
+  class Hdf5WriteBenchmark : public Hdf5Benchmark
+  {
+
+  public:
+
+    Hdf5WriteBenchmark()
+            : Hdf5Benchmark("Hdf5Write")
+    {}
+
+    void run()
+    {
+      BlitzH5File outFile(_fileName, BlitzH5File::Replace);
+      outFile.writeDataset(_data, "/volume", 1);
+    }
+
+  };
+
+  class Hdf5ReadBenchmark : public Hdf5Benchmark
+  {
+
+  public:
+
+    Hdf5ReadBenchmark()
+            : Hdf5Benchmark("Hdf5Read")
+    {}
+
+    void run()
+    {
+      BlitzH5File inFile(_fileName);
+      inFile.readDataset(_result, "/volume");
+    }
+
+    void tearDown()
+    {
+      Hdf5Benchmark::tearDown();
+      _result.free();
+    }
+
+  private:
+
+    blitz::Array<float,3> _result;
+
+  };
+
+  void registerIOBenchmarks(BenchmarkRunner &runner)
+  {
+    runner.add(new Hdf5WriteBenchmark());
+    runner.add(new Hdf5ReadBenchmark());
+  }
+
+}
@@ -0,0 +1,126 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "SyntheticData.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace benchmark
+{
+
+  // Park-Miller minimal standard generator. std::rand() is not used,
+  // because other library code reseeds it and the benchmark input must
+  // not change between runs.
+  static double uniformRandom(double &state)
+  {
+    state = std::fmod(16807.0 * state, 2147483647.0);
+    return state / 2147483647.0;
+  }
+
+  blitz::TinyVector<double,3> syntheticElementSizeUm()
+  {
+    return blitz::TinyVector<double,3>(1.0, 0.5, 0.5);
+  }
+
+  void syntheticNuclei(
+      atb::Array<float,3> &volume, atb::BlitzIndexT size,
+      std::vector< blitz::TinyVector<double,3> > *centersUm,
+      unsigned int seed)
+  {
+    double state = static_cast<double>(seed % 2147483646u + 1u);
+
+    volume.setElementSizeUm(syntheticElementSizeUm());
+    volume.resize(size, size, size);
+    for (size_t i = 0; i < volume.size(); ++i)
+        volume.data()[i] = static_cast<float>(0.1 * uniformRandom(state));
+
+    blitz::TinyVector<double,3> sigmaUm(2.0, 2.0, 2.0);
+    blitz::TinyVector<atb::BlitzIndexT,3> radiusPx(
+        blitz::TinyVector<atb::BlitzIndexT,3>(
+            3.0 * sigmaUm / volume.elementSizeUm()) + 1);
+
+    size_t nBlobs = std::max(
+        static_cast<size_t>(1), volume.size() / static_cast<size_t>(4096));
+    if (centersUm != NULL) centersUm->clear();
+    for (size_t n = 0; n < nBlobs; ++n)
+    {
+      blitz::TinyVector<double,3> centerPx;
+      for (int d = 0; d < 3; ++d)
+          centerPx(d) = uniformRandom(state) * static_cast<double>(size - 1);
+      float amplitude = static_cast<float>(0.5 + 0.5 * uniformRandom(state));
+      if (centersUm != NULL)
+          centersUm->push_back(centerPx * volume.elementSizeUm());
+
+      blitz::TinyVector<atb::BlitzIndexT,3> lb, ub;
+      for (int d = 0; d < 3; ++d)
+      {
+        lb(d) = std::max(
+            static_cast<atb::BlitzIndexT>(0),
+            static_cast<atb::BlitzIndexT>(centerPx(d)) - radiusPx(d));
+        ub(d) = std::min(
+            size - 1, static_cast<atb::BlitzIndexT>(centerPx(d)) + radiusPx(d));
+      }
+      for (atb::BlitzIndexT z = lb(0); z <= ub(0); ++z)
+      {
+        for (atb::BlitzIndexT y = lb(1); y <= ub(1); ++y)
+        {
+          for (atb::BlitzIndexT x = lb(2); x <= ub(2); ++x)
+          {
+            blitz::TinyVector<double,3> dUm(
+                (blitz::TinyVector<double,3>(z, y, x) - centerPx) *
+                volume.elementSizeUm() / sigmaUm);
+            volume(z, y, x) += amplitude * static_cast<float>(
+                std::exp(-0.5 * blitz::dot(dUm, dUm)));
+          }
+        }
+      }
+    }
+  }
+
+  void neighborhoodFeatures(
+      atb::Array<float,3> const &volume,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &position, float *features)
+  {
+    int i = 0;
+    for (atb::BlitzIndexT dz = -1; dz <= 1; ++dz)
+    {
+      atb::BlitzIndexT z = std::min(
+          std::max(position(0) + dz, static_cast<atb::BlitzIndexT>(0)),
+          volume.extent(0) - 1);
+      for (atb::BlitzIndexT dy = -1; dy <= 1; ++dy)
+      {
+        atb::BlitzIndexT y = std::min(
+            std::max(position(1) + dy, static_cast<atb::BlitzIndexT>(0)),
+            volume.extent(1) - 1);
+        for (atb::BlitzIndexT dx = -1; dx <= 1; ++dx, ++i)
+        {
+          atb::BlitzIndexT x = std::min(
+              std::max(position(2) + dx, static_cast<atb::BlitzIndexT>(0)),
+              volume.extent(2) - 1);
+          features[i] = volume(z, y, x);
+        }
+      }
+    }
+  }
+
+}
@@ -0,0 +1,79 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef BENCHMARKSYNTHETICDATA_HH
+#define BENCHMARKSYNTHETICDATA_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <vector>
+
+#include <libArrayToolbox/Array.hh>
+
+namespace benchmark
+{
+
+/*======================================================================*/
+/*!
+ *   Element size of the synthetic volumes in micrometers. It resembles the
+ *   anisotropic sampling of the confocal recordings iRoCS is used with.
+ */
+/*======================================================================*/
+  blitz::TinyVector<double,3> syntheticElementSizeUm();
+
+/*======================================================================*/
+/*!
+ *   Render a cubic volume of nucleus-like Gaussian blobs on a noisy
+ *   background, one blob per 4096 voxels. The result only depends on the
+ *   size and the seed.
+ *
+ *   \param volume    The output volume, it is resized to size^3 voxels
+ *   \param size      The side length of the volume in voxels
+ *   \param centersUm If given the blob centers in micrometers are
+ *     returned in this vector
+ *   \param seed      Seed of the internal random number generator
+ */
+/*======================================================================*/
+  void syntheticNuclei(
+      atb::Array<float,3> &volume, atb::BlitzIndexT size,
+      std::vector< blitz::TinyVector<double,3> > *centersUm = NULL,
+      unsigned int seed = 1);
+
+/*======================================================================*/
+/*!
+ *   Extract the 3x3x3 neighborhood intensities around the given voxel as
+ *   feature vector. Out-of-volume positions are clamped to the border.
+ *
+ *   \param volume   The volume to sample
+ *   \param position The center voxel
+ *   \param features The 27 output values
+ */
+/*======================================================================*/
+  void neighborhoodFeatures(
+      atb::Array<float,3> const &volume,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &position, float *features);
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <libcmdline/CmdLine.hh>
+#include <libcmdline/ArgvIter.hh>
+
+#include "BenchmarkRunner.hh"
+#include "Benchmarks.hh"
+
+template<typename T>
+static std::vector<T> parseList(std::string const &list)
+{
+  std::vector<T> values;
+  std::stringstream stream(list);
+  std::string token;
+  while (std::getline(stream, token, ','))
+  {
+    std::stringstream tokenStream(token);
+    T value;
+    if (tokenStream >> value) values.push_back(value);
+  }
+  return values;
+}
+
+int main(int argc, char **argv)
+{
+  CmdArgType<std::string> sizes(
+      's', "sizes", "<n1,n2,...>", "Comma separated side lengths of the "
+      "cubic benchmark volumes in voxels. Benchmarks skip sizes above their "
+      "individual limit.");
+  sizes.setDefaultValue("64,128,256,512");
+  CmdArgType<std::string> threads(
+      't', "threads", "<n1,n2,...>", "Comma separated OpenMP thread counts "
+      "to run every benchmark with. Defaults to one thread and all "
+      "available threads.");
+  CmdArgType<double> minTime(
+      0, "minTime", "<seconds>", "Every benchmark is repeated at least "
+      "this long.");
+  minTime.setDefaultValue(1.0);
+  CmdArgType<int> minIterations(
+      0, "minIterations", "<positive integer>", "Every benchmark is "
+      "repeated at least this often.");
+  minIterations.setDefaultValue(3);
+  CmdArgType<int> maxIterations(
+      0, "maxIterations", "<positive integer>", "Every benchmark is "
+      "repeated at most this often.");
+  maxIterations.setDefaultValue(1000);
+  CmdArgType<std::string> filter(
+      'f', "filter", "<substring>", "Only run benchmarks whose name contains "
+      "the given string.");
+  CmdArgType<std::string> jsonFileName(
+      'j', "json", "<json file>", "If given, the results are written to the "
+      "given file in the JSON format of Google Benchmark.");
+  CmdArgSwitch list(
+      'l', "list", "List the available benchmarks and exit.");
+
+  CmdLine cmd(argv[0], "iRoCS benchmark suite");
+  cmd.description("Measure the run time of the core filters, the HDF5 I/O "
+                  "and the classifiers on synthetic volumes");
+
+  try
+  {
+    cmd.append(&sizes);
+    cmd.append(&threads);
+    cmd.append(&minTime);
+    cmd.append(&minIterations);
+    cmd.append(&maxIterations);
+    cmd.append(&filter);
+    cmd.append(&jsonFileName);
+    cmd.append(&list);
+
+    ArgvIter argvIter(--argc, ++argv);
+    cmd.parse(argvIter);
+
+    benchmark::BenchmarkRunner runner;
+    benchmark::registerFilterBenchmarks(runner);
+    benchmark::registerIOBenchmarks(runner);
+    benchmark::registerClassificationBenchmarks(runner);
+
+    if (list.given())
+    {
+      runner.listBenchmarks(std::cout);
+      return 0;
+    }
+
+    runner.setSizes(parseList<atb::BlitzIndexT>(sizes.value()));
+    if (threads.given()) runner.setThreadCounts(parseList<int>(threads.value()));
+    runner.setMinTime(minTime.value());
+    runner.setMinIterations(minIterations.value());
+    runner.setMaxIterations(maxIterations.value());
+    if (filter.given()) runner.setFilter(filter.value());
+
+    runner.run(std::cout);
+
+    if (jsonFileName.given())
+    {
+      std::ofstream jsonFile(jsonFileName.value().c_str());
+      if (!jsonFile.good())
+      {
+        std::cerr << "Could not write results to '" << jsonFileName.value()
+                  << "'" << std::endl;
+        return -2;
+      }
+      runner.writeJson(jsonFile);
+    }
+  }
+  catch (CmdLineUsageError &e)
+  {
+    cmd.usage();
+    exit(-1);
+  }
+  catch (CmdLineUsageHTMLError &e)
+  {
+    cmd.usageHTML(std::cout);
+    exit(-1);
+  }
+  catch (CmdLineUsageXMLError &e)
+  {
+    cmd.usageXML(std::cout);
+    exit(-1);
+  }
+  catch (CmdLineSyntaxError &e)
+  {
+    cmd.error() << e.str() << std::endl;
+    cmd.usage(std::cerr);
+    exit(-2);
+  }
+  return 0;
+}
@@ -16,6 +16,7 @@
 
 #include <libArrayToolbox/GaussianFilter.hh>
 #include <libArrayToolbox/Normalization.hh>
+#include <libArrayToolbox/SeparableResampler.hh>
 
 #include <libArrayToolbox/algo/ldiffusion.hh>
 #include <libArrayToolbox/algo/ltransform.hh>
@@ -1045,7 +1046,8 @@ mainFrame::equal()
   //always scale element size to the smallest one;
   backup();
   data.setInterpolator(atb::LinearInterpolator<float,3>(atb::RepeatBT));
-  data.rescale(blitz::TinyVector<double,3>(blitz::min(elSize)));
+  data.rescale(
+      blitz::TinyVector<double,3>(blitz::min(elSize)), atb::LinearRK);
   view(data);
 }
 
@@ -34,7 +34,11 @@
 #include <config.hh>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include "GaussianFilter.hh"
+#include "GaussianScaleSpace.hh"
 #include "CentralHessianUTFilter.hh"
 #include "ATBLinAlg.hh"
 
@@ -215,10 +219,62 @@ namespace atb
 /*======================================================================*/
     void setHessianUpdateStepWidth(int hessianUpdateStepWidth);
 
+/*======================================================================*/
+/*! 
+ *   Check whether the filter computes in single precision.
+ *
+ *   \return true if intermediate results are stored as float, false if
+ *     they are stored as double
+ */
+/*======================================================================*/
+    bool singlePrecision() const;
+
+/*======================================================================*/
+/*! 
+ *   Set whether the filter computes in single precision. Single precision
+ *   halves the memory footprint and bandwidth of the intermediate volumes.
+ *   Per-voxel arithmetic is always carried out in double precision.
+ *
+ *   \param singlePrecision If true, intermediate results are stored as
+ *     float, otherwise as double
+ */
+/*======================================================================*/
+    void setSinglePrecision(bool singlePrecision);
+
+/*======================================================================*/
+/*! 
+ *   Check whether the Gaussian pre-smoothing uses a GaussianScaleSpace.
+ *
+ *   \return true if the pre-smoothing kernels are computed once by a
+ *     GaussianScaleSpace and shared by all diffusion tensor updates, false
+ *     if a GaussianFilter is used
+ */
+/*======================================================================*/
+    bool useScaleSpace() const;
+
+/*======================================================================*/
+/*! 
+ *   Set whether the Gaussian pre-smoothing uses a GaussianScaleSpace. Its
+ *   kernels are normalized and truncated at seven standard deviations, so
+ *   the results differ slightly from the GaussianFilter results. Off by
+ *   default.
+ *
+ *   \param useScaleSpace If true, the pre-smoothing kernels are computed
+ *     once by a GaussianScaleSpace, otherwise a GaussianFilter is used
+ */
+/*======================================================================*/
+    void setUseScaleSpace(bool useScaleSpace);
+
 /*======================================================================*/
 /*! 
  *   Apply the filter to the given Array.
  *
+ *   The iterations between two diffusion tensor updates are computed
+ *   tile by tile. Each tile is extended by a halo of one voxel per
+ *   iteration, so that all iterations can be advanced while the tile is
+ *   cache resident. The results are identical to iterating over the full
+ *   volume.
+ *
  *   \param data          The blitz++ Array to apply the filter to
  *   \param elementSizeUm The element size of the Array
  *   \param filtered      The filtering result
@@ -312,8 +368,39 @@ namespace atb
 
   private:
     
+    template<typename ComputeT>
+    void _apply(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm,
+        blitz::Array<ResultT,Dim> &filtered,
+        iRoCS::ProgressReporter *pr) const;
+
+    template<typename ComputeT>
+    bool _updateDiffusionTensor(
+        blitz::Array<ComputeT,Dim> const &u,
+        blitz::TinyVector<double,Dim> const &elementSizeUm, double sigmaUm,
+        blitz::Array<blitz::TinyVector<ComputeT,Dim * (Dim + 1) / 2>,Dim> &D,
+        GaussianScaleSpace<ComputeT,Dim> *scaleSpace,
+        iRoCS::ProgressReporter *pr) const;
+
+    template<typename ComputeT>
+    bool _diffusionSteps(
+        blitz::Array<ComputeT,Dim> const &u,
+        blitz::Array<blitz::TinyVector<ComputeT,Dim * (Dim + 1) / 2>,Dim>
+        const &D, int nSteps, blitz::Array<ComputeT,Dim> &result,
+        std::vector<double> &sqrDiff, iRoCS::ProgressReporter *pr) const;
+
+    template<typename ComputeT>
+    double _diffusionUpdate(
+        ComputeT const *u, blitz::TinyVector<ptrdiff_t,Dim> const &uStride,
+        blitz::TinyVector<ComputeT,Dim * (Dim + 1) / 2> const *D,
+        blitz::TinyVector<ptrdiff_t,Dim> const &dStride,
+        blitz::TinyVector<BlitzIndexT,Dim> const &pos,
+        blitz::TinyVector<BlitzIndexT,Dim> const &shape) const;
+
     double _kappa, _sigmaUm, _tau, _zAnisotropyCorrection;
     int _nIterations, _hessianUpdateStepWidth;
+    bool _singlePrecision, _useScaleSpace;
 
   };
 
@@ -56,6 +56,27 @@
 namespace atb
 {
   
+/*======================================================================*/
+/*! 
+ *   \enum ResamplingKernelType Array.hh "libArrayToolbox/Array.hh"
+ *   \brief The ResamplingKernelType enum contains entries for all
+ *     kernels available for separable resampling.
+ */
+/*======================================================================*/
+  enum ResamplingKernelType {
+      /** Linear interpolation (triangle kernel of radius 1) */
+      LinearRK = 0x0001,
+      /** Cubic convolution (Catmull-Rom kernel of radius 2), this is the
+       *  kernel of the CubicInterpolator */
+      CubicRK = 0x0002,
+      /** Cubic B-spline approximation (kernel of radius 2). The result is
+       *  smoother than with the interpolating kernels. */
+      BSplineRK = 0x0004
+  };
+
+  template<typename DataT, int Dim>
+  class SeparableResampler;
+
 /*======================================================================*/
 /*!
  *  \class Array Array.hh "libArrayToolbox/Array.hh"
@@ -1421,6 +1442,31 @@ namespace atb
         blitz::TinyVector<double,Dim> const &targetElementSizeUm,
         iRoCS::ProgressReporter *pr = NULL);
 
+/*======================================================================*/
+/*! 
+ *   Rescale the Array so that the new Array element size is the given
+ *   target element size using a SeparableResampler with the given kernel.
+ *
+ *   The Array is processed one dimension at a time with precomputed
+ *   kernel weights. When down-scaling, the kernel is stretched instead of
+ *   smoothing the Array first. Out-of-Array samples repeat the boundary
+ *   values, the Interpolator associated with this Array is not used. If
+ *   the operation is aborted, the Array is left unchanged.
+ *
+ *   Callers have to include "libArrayToolbox/SeparableResampler.hh".
+ *
+ *   \param targetElementSizeUm The target voxel extents in micrometers
+ *   \param kernel              The resampling kernel
+ *   \param pr                  If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ *
+ *   \return A reference to this Array after rescaling
+ */
+/*======================================================================*/
+    Array<DataT,Dim>& rescale(
+        blitz::TinyVector<double,Dim> const &targetElementSizeUm,
+        ResamplingKernelType kernel, iRoCS::ProgressReporter *pr = NULL);
+
 /*======================================================================*/
 /*! 
  *   Set the Array data and meta-data according to a specification stored
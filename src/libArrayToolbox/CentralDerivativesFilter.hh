@@ -0,0 +1,307 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*======================================================================*/
+/*!
+ *  \file CentralDerivativesFilter.hh
+ *  \brief Computation of gradient, hessian and laplacian of the input data
+ *    using central differences in one pass over the data.
+ */
+/*======================================================================*/
+
+#ifndef ATBCENTRALDERIVATIVESFILTER_HH
+#define ATBCENTRALDERIVATIVESFILTER_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <vector>
+
+#include "CentralGradientFilter.hh"
+
+namespace atb
+{
+
+/*======================================================================*/
+/*!
+ *  \class CentralDerivativesFilter CentralDerivativesFilter.hh "libArrayToolbox/CentralDerivativesFilter.hh"
+ *  \brief The CentralDerivativesFilter class computes any combination of
+ *    gradient, hessian and laplacian of the input data using central
+ *    differences in a single sweep.
+ *
+ *  The CentralGradientFilter, CentralHessianUTFilter and LaplacianFilter
+ *  each traverse the data once per dimension or hessian component and
+ *  write one full-size intermediate Array per pass. This filter instead
+ *  visits every voxel once, loads the stencil neighbors along each
+ *  dimension once and derives all requested quantities from these values.
+ *  The results are either written to caller provided Arrays or handed to a
+ *  functor per voxel, so that e.g. the hessian eigenvalues can be computed
+ *  without ever storing the full hessian.
+ *
+ *  Lines along the innermost dimension are processed in memory order and
+ *  are distributed in contiguous chunks over the OpenMP threads, so that
+ *  the few hyperplanes touched by the stencil stay cache resident.
+ *
+ *  The hessian is stored in the upper triangular format of the
+ *  CentralHessianUTFilter and its mixed derivatives are the composition of
+ *  the first derivatives along both dimensions as computed there, including
+ *  the boundary treatment of the intermediate first derivative.
+ *  In contrast to the CentralGradientFilter the fourth order accurate
+ *  first derivatives are normalized by \f$1 / (12h)\f$.
+ *
+ *  The Filter interface apply() methods compute the laplacian.
+ *  CropBT boundary treatment is not supported.
+ */
+/*======================================================================*/
+  template<typename DataT, int Dim>
+  class CentralDerivativesFilter : public Filter<DataT,Dim,DataT>
+  {
+
+  public:
+    
+    typedef DataT ResultT;
+    typedef blitz::TinyVector<DataT,Dim> GradientT;
+    typedef blitz::TinyVector<DataT,Dim * (Dim + 1) / 2> HessianT;
+
+/*======================================================================*/
+/*! 
+ *   \enum Derivatives
+ *   \brief Flags for the derivatives to compute. They can be combined
+ *     using bitwise or.
+ */
+/*======================================================================*/
+    enum Derivatives {
+        /** The vector of first derivatives */
+        Gradient = 0x0001,
+        /** The upper triangle of the matrix of second derivatives */
+        Hessian = 0x0002,
+        /** The sum of the unmixed second derivatives */
+        Laplacian = 0x0004
+    };
+
+/*======================================================================*/
+/*! 
+ *   Default Constructor. Creates a filter with second order accurate
+ *   discrete derivative approximations using central differences.
+ *
+ *   \param bt             The boundary treatment this filter uses
+ *   \param boundaryValue  If bt is ValueBT, this value will be used for
+ *     out-of-Array access
+ */
+/*======================================================================*/ 
+    CentralDerivativesFilter(
+        BoundaryTreatmentType bt = ValueBT,
+        DataT const &boundaryValue = traits<DataT>::zero);
+    
+/*======================================================================*/
+/*! 
+ *   Constructor.
+ *
+ *   \param accuracy       The accuracy of the filter
+ *   \param bt             The boundary treatment this filter uses
+ *   \param boundaryValue  If bt is ValueBT, this value will be used for
+ *     out-of-Array access
+ */
+/*======================================================================*/ 
+    CentralDerivativesFilter(
+        typename CentralGradientFilter<DataT,Dim>::Accuracy accuracy,
+        BoundaryTreatmentType bt = ValueBT,
+        DataT const &boundaryValue = traits<DataT>::zero);
+    
+/*======================================================================*/
+/*! 
+ *   Destructor.
+ */
+/*======================================================================*/
+    virtual ~CentralDerivativesFilter();
+
+/*======================================================================*/
+/*! 
+ *   Get the order of accuracy of this filter. Currently only snd and 4th
+ *   order are implemented.
+ *
+ *   \return The accuracy of the discrete derivative approximation
+ */
+/*======================================================================*/
+    typename CentralGradientFilter<DataT,Dim>::Accuracy accuracy() const;
+
+/*======================================================================*/
+/*! 
+ *   Set the order of accuracy of this filter. Currently only snd and 4th
+ *   order are implemented.
+ *
+ *   \param accuracy The new accuracy of the discrete derivative approximation
+ */
+/*======================================================================*/
+    void setAccuracy(
+        typename CentralGradientFilter<DataT,Dim>::Accuracy accuracy);
+
+/*======================================================================*/
+/*! 
+ *   Compute the requested derivatives and pass them to the given functor
+ *   voxel by voxel. The functor must provide
+ *
+ *   \code
+ *   void operator()(
+ *       blitz::TinyVector<ptrdiff_t,Dim> const &pos,
+ *       GradientT const &gradient, HessianT const &hessian,
+ *       DataT laplacian);
+ *   \endcode
+ *
+ *   Derivatives that were not requested are passed as zero. The functor is
+ *   called concurrently from all OpenMP threads, each voxel exactly once,
+ *   so it must only write voxel-local state or synchronize itself.
+ *
+ *   \param data           The blitz++ Array to differentiate
+ *   \param elementSizeUm  The element size of the Array
+ *   \param derivatives    Bitwise or of the Derivatives to compute
+ *   \param functor        The per-voxel callback
+ *   \param pr             If given progress will be reported to this
+ *     ProgressReporter
+ *
+ *   \exception RuntimeError If the boundary treatment is CropBT
+ */
+/*======================================================================*/
+    template<typename FunctorT>
+    void apply(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm,
+        int derivatives, FunctorT &functor,
+        iRoCS::ProgressReporter *pr = NULL) const;
+
+/*======================================================================*/
+/*! 
+ *   Compute the requested derivatives into the given Arrays. Pass NULL
+ *   for derivatives you are not interested in. The given Arrays are
+ *   resized to the data shape.
+ *
+ *   \param data           The blitz++ Array to differentiate
+ *   \param elementSizeUm  The element size of the Array
+ *   \param gradient       If not NULL the gradient is written to this Array
+ *   \param hessian        If not NULL the upper triangle of the hessian is
+ *     written to this Array
+ *   \param laplacian      If not NULL the laplacian is written to this
+ *     Array
+ *   \param pr             If given progress will be reported to this
+ *     ProgressReporter
+ *
+ *   \exception RuntimeError If the boundary treatment is CropBT
+ */
+/*======================================================================*/
+    void apply(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm,
+        blitz::Array<GradientT,Dim> *gradient,
+        blitz::Array<HessianT,Dim> *hessian,
+        blitz::Array<DataT,Dim> *laplacian,
+        iRoCS::ProgressReporter *pr = NULL) const;
+
+/*======================================================================*/
+/*! 
+ *   Compute the requested derivatives into the given Arrays. Pass NULL
+ *   for derivatives you are not interested in. The given Arrays are
+ *   resized to the data shape and get the element size of the data.
+ *
+ *   \param data           The Array to differentiate
+ *   \param gradient       If not NULL the gradient is written to this Array
+ *   \param hessian        If not NULL the upper triangle of the hessian is
+ *     written to this Array
+ *   \param laplacian      If not NULL the laplacian is written to this
+ *     Array
+ *   \param pr             If given progress will be reported to this
+ *     ProgressReporter
+ *
+ *   \exception RuntimeError If the boundary treatment is CropBT
+ */
+/*======================================================================*/
+    void apply(
+        Array<DataT,Dim> const &data, Array<GradientT,Dim> *gradient,
+        Array<HessianT,Dim> *hessian, Array<DataT,Dim> *laplacian,
+        iRoCS::ProgressReporter *pr = NULL) const;
+
+/*======================================================================*/
+/*! 
+ *   Compute the laplacian of the given Array.
+ *
+ *   \param data          The blitz++ Array to apply the filter to
+ *   \param elementSizeUm The element size of the Array
+ *   \param filtered      The laplacian
+ *   \param pr            If given progress will be reported to this
+ *     ProgressReporter
+ *
+ *   \exception RuntimeError If the boundary treatment is CropBT
+ */
+/*======================================================================*/
+    virtual void apply(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm,
+        blitz::Array<DataT,Dim> &filtered,
+        iRoCS::ProgressReporter *pr = NULL) const;
+    
+    // Explicitly force the name mangler to also consider the base class
+    // implementation
+    using atb::Filter<DataT,Dim,DataT>::apply;
+
+  private:
+    
+    typedef typename traits<DataT>::HighPrecisionT hp_t;
+
+    struct ArrayWriter
+    {
+      ArrayWriter(
+          blitz::Array<GradientT,Dim> *gradient,
+          blitz::Array<HessianT,Dim> *hessian,
+          blitz::Array<DataT,Dim> *laplacian);
+
+      void operator()(
+          blitz::TinyVector<ptrdiff_t,Dim> const &pos,
+          GradientT const &gradient, HessianT const &hessian,
+          DataT laplacian);
+
+      blitz::Array<GradientT,Dim> *p_gradient;
+      blitz::Array<HessianT,Dim> *p_hessian;
+      blitz::Array<DataT,Dim> *p_laplacian;
+    };
+
+/*======================================================================*/
+/*! 
+ *   Read the data value at the given position. remap[d] maps the
+ *   position in dimension d shifted by the stencil radius to an in-Array
+ *   index or to -1 if the boundary value has to be used.
+ */
+/*======================================================================*/
+    static hp_t _sample(
+        DataT const *origin, blitz::TinyVector<ptrdiff_t,Dim> const &stride,
+        std::vector<ptrdiff_t> const *remap,
+        blitz::TinyVector<ptrdiff_t,Dim> const &pos, int radius,
+        hp_t const &boundaryValue);
+
+    typename CentralGradientFilter<DataT,Dim>::Accuracy _accuracy;
+
+  };
+
+}
+
+#include "CentralDerivativesFilter.icc"
+
+#endif
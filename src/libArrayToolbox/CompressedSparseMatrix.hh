@@ -0,0 +1,426 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*======================================================================*/
+/*!
+ *  \file CompressedSparseMatrix.hh
+ *  \brief Sparse matrices in compressed sparse row format and their
+ *    parallel products.
+ */
+/*======================================================================*/
+
+#ifndef ATBCOMPRESSEDSPARSEMATRIX_HH
+#define ATBCOMPRESSEDSPARSEMATRIX_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <vector>
+
+#include "TypeTraits.hh"
+#include "SparseMatrix.hh"
+
+namespace atb
+{
+
+/*======================================================================*/
+/*!
+ *  \class CompressedSparseMatrix CompressedSparseMatrix.hh "libArrayToolbox/CompressedSparseMatrix.hh"
+ *  \brief The CompressedSparseMatrix class stores an immutable sparse
+ *    matrix in compressed sparse row (CSR) format.
+ *
+ *  The non-zero entries are stored row by row in two flat arrays holding
+ *  the column indices and values, sorted by column within every row. A
+ *  third array holds the offset of the first entry of every row. In
+ *  contrast to SparseMatrix no tree nodes are allocated per entry and
+ *  products stream linearly through memory, which makes them cache
+ *  friendly and trivially parallel over the rows.
+ *
+ *  The compressed sparse column (CSC) representation of a matrix is the
+ *  CSR representation of its transpose, use transpose() to obtain it
+ *  whenever column access or products with the transpose are required.
+ *
+ *  Matrices are assembled with a CompressedSparseMatrixBuilder or
+ *  converted from SparseMatrix or dense blitz++ Arrays.
+ */
+/*======================================================================*/
+  template<typename T>
+  class CompressedSparseMatrix
+  {
+
+  public:
+
+    typedef unsigned int IndexT;
+
+/*======================================================================*/
+/*!
+ *   Create a new empty 0 x 0 CompressedSparseMatrix.
+ */
+/*======================================================================*/
+    CompressedSparseMatrix();
+
+/*======================================================================*/
+/*!
+ *   Create a new CompressedSparseMatrix of given shape without non-zero
+ *   entries.
+ *
+ *   \param r The number of matrix rows
+ *   \param c The number of matrix columns
+ *
+ *   \exception SparseMatrixError If the number of columns exceeds the
+ *     range of IndexT
+ */
+/*======================================================================*/
+    CompressedSparseMatrix(size_t r, size_t c);
+
+/*======================================================================*/
+/*!
+ *   Create a new CompressedSparseMatrix with the same shape and entries
+ *   as the given SparseMatrix.
+ *
+ *   \param m The SparseMatrix to convert
+ *
+ *   \exception SparseMatrixError If the number of columns exceeds the
+ *     range of IndexT
+ */
+/*======================================================================*/
+    explicit CompressedSparseMatrix(SparseMatrix<T> const &m);
+
+/*======================================================================*/
+/*!
+ *   Create a new CompressedSparseMatrix from the non-zero entries of a
+ *   dense blitz++ Array.
+ *
+ *   \param m The dense matrix to convert
+ *
+ *   \exception SparseMatrixError If the number of columns exceeds the
+ *     range of IndexT
+ */
+/*======================================================================*/
+    explicit CompressedSparseMatrix(blitz::Array<T,2> const &m);
+
+/*======================================================================*/
+/*!
+ *   Destructor.
+ */
+/*======================================================================*/
+    ~CompressedSparseMatrix();
+
+/*======================================================================*/
+/*!
+ *   Get the number of rows of this matrix.
+ *
+ *   \return The number of matrix rows
+ */
+/*======================================================================*/
+    size_t nRows() const;
+
+/*======================================================================*/
+/*!
+ *   Get the number of columns of this matrix.
+ *
+ *   \return The number of matrix columns
+ */
+/*======================================================================*/
+    size_t nColumns() const;
+
+/*======================================================================*/
+/*!
+ *   Get the shape of this matrix.
+ *
+ *   \return The matrix shape (nRows, nColumns)
+ */
+/*======================================================================*/
+    blitz::TinyVector<size_t,2> shape() const;
+
+/*======================================================================*/
+/*!
+ *   Get the number of stored entries of this matrix.
+ *
+ *   \return The number of stored matrix entries
+ */
+/*======================================================================*/
+    size_t nNonZeroEntries() const;
+
+/*======================================================================*/
+/*!
+ *   Get the matrix entry at the given position. The entry is searched
+ *   by bisection within the row, so this is an O(log(n)) operation with
+ *   n being the number of entries in row r.
+ *
+ *   \param r The row index
+ *   \param c The column index
+ *
+ *   \return The matrix entry at position (r, c)
+ *
+ *   \exception SparseMatrixError If the position is out of bounds
+ */
+/*======================================================================*/
+    T operator()(size_t r, size_t c) const;
+
+/*======================================================================*/
+/*!
+ *   Get the offsets of the rows into the columnIndices() and values()
+ *   arrays. The entries of row r are stored at positions
+ *   rowPointers()[r] to rowPointers()[r + 1] - 1. The vector has
+ *   nRows() + 1 elements.
+ *
+ *   \return The row offsets
+ */
+/*======================================================================*/
+    std::vector<size_t> const &rowPointers() const;
+
+/*======================================================================*/
+/*!
+ *   Get the column indices of all stored entries in row major order.
+ *
+ *   \return The column indices
+ */
+/*======================================================================*/
+    std::vector<IndexT> const &columnIndices() const;
+
+/*======================================================================*/
+/*!
+ *   Get the values of all stored entries in row major order.
+ *
+ *   \return The entry values
+ */
+/*======================================================================*/
+    std::vector<T> const &values() const;
+
+/*======================================================================*/
+/*!
+ *   Get the transpose of this matrix. Its storage is the compressed
+ *   sparse column representation of this matrix. The transpose is
+ *   computed by a counting sort in O(nRows + nColumns + nNonZeroEntries).
+ *
+ *   \return The transposed matrix
+ */
+/*======================================================================*/
+    CompressedSparseMatrix<T> transpose() const;
+
+/*======================================================================*/
+/*!
+ *   Compute y = A * x for this matrix A. The rows are processed in
+ *   parallel.
+ *
+ *   \param x The right-hand-side vector with nColumns() elements
+ *   \param y The result vector, it is resized to nRows() elements
+ *
+ *   \exception SparseMatrixError If the vector length does not match
+ *     the number of matrix columns
+ */
+/*======================================================================*/
+    void multiply(blitz::Array<T,1> const &x, blitz::Array<T,1> &y) const;
+
+/*======================================================================*/
+/*!
+ *   Compute y = A^T * x for this matrix A without explicitly forming the
+ *   transpose. The result is accumulated by scattering the rows, which is
+ *   done sequentially. If products with the transpose are needed
+ *   repeatedly, multiplying with transpose() is faster.
+ *
+ *   \param x The right-hand-side vector with nRows() elements
+ *   \param y The result vector, it is resized to nColumns() elements
+ *
+ *   \exception SparseMatrixError If the vector length does not match
+ *     the number of matrix rows
+ */
+/*======================================================================*/
+    void multiplyTransposed(
+        blitz::Array<T,1> const &x, blitz::Array<T,1> &y) const;
+
+/*======================================================================*/
+/*!
+ *   Get a SparseMatrix copy of this matrix.
+ *
+ *   \return The SparseMatrix with the same entries as this matrix
+ */
+/*======================================================================*/
+    SparseMatrix<T> toSparseMatrix() const;
+
+/*======================================================================*/
+/*!
+ *   Get a dense blitz++ Array copy of this matrix.
+ *
+ *   \return A dense nRows() x nColumns() blitz++ Array
+ */
+/*======================================================================*/
+    blitz::Array<T,2> toBlitz() const;
+
+  private:
+
+    static void _checkColumnRange(size_t c);
+
+    size_t _nRows, _nColumns;
+    std::vector<size_t> _rowPointers;
+    std::vector<IndexT> _columnIndices;
+    std::vector<T> _values;
+
+    template<typename T2>
+    friend class CompressedSparseMatrixBuilder;
+
+    template<typename T2>
+    friend CompressedSparseMatrix<T2> operator*(
+        CompressedSparseMatrix<T2> const &A,
+        CompressedSparseMatrix<T2> const &B);
+
+  };
+
+/*======================================================================*/
+/*!
+ *  \class CompressedSparseMatrixBuilder CompressedSparseMatrix.hh "libArrayToolbox/CompressedSparseMatrix.hh"
+ *  \brief The CompressedSparseMatrixBuilder class collects (row, column,
+ *    value) triplets in arbitrary order and assembles them into a
+ *    CompressedSparseMatrix.
+ *
+ *  Triplets addressing the same position are summed up, so finite
+ *  element style assembly works without lookups. Adding a triplet is
+ *  amortized O(1), build() sorts all triplets with two counting sorts in
+ *  O(nRows + nColumns + nTriplets).
+ */
+/*======================================================================*/
+  template<typename T>
+  class CompressedSparseMatrixBuilder
+  {
+
+  public:
+
+/*======================================================================*/
+/*!
+ *   Create a new builder for a matrix of the given shape.
+ *
+ *   \param r The number of matrix rows
+ *   \param c The number of matrix columns
+ *
+ *   \exception SparseMatrixError If the number of columns exceeds the
+ *     range of CompressedSparseMatrix<T>::IndexT
+ */
+/*======================================================================*/
+    CompressedSparseMatrixBuilder(size_t r, size_t c);
+
+/*======================================================================*/
+/*!
+ *   Destructor.
+ */
+/*======================================================================*/
+    ~CompressedSparseMatrixBuilder();
+
+/*======================================================================*/
+/*!
+ *   Reserve memory for the given number of triplets.
+ *
+ *   \param nTriplets The expected number of triplets
+ */
+/*======================================================================*/
+    void reserve(size_t nTriplets);
+
+/*======================================================================*/
+/*!
+ *   Add value to the matrix entry at position (r, c).
+ *
+ *   \param r     The row index
+ *   \param c     The column index
+ *   \param value The value to add
+ *
+ *   \exception SparseMatrixError If the position is out of bounds
+ */
+/*======================================================================*/
+    void add(size_t r, size_t c, T const &value);
+
+/*======================================================================*/
+/*!
+ *   Get the number of triplets added so far.
+ *
+ *   \return The number of triplets
+ */
+/*======================================================================*/
+    size_t nTriplets() const;
+
+/*======================================================================*/
+/*!
+ *   Assemble the matrix from the collected triplets. Duplicate positions
+ *   are summed, entries summing to zero are not stored. The builder is
+ *   left unchanged and can be used to add further triplets.
+ *
+ *   \param m The matrix to store the result to. Its previous content is
+ *     replaced.
+ */
+/*======================================================================*/
+    void build(CompressedSparseMatrix<T> &m) const;
+
+  private:
+
+    size_t _nRows, _nColumns;
+    std::vector<size_t> _rows;
+    std::vector<typename CompressedSparseMatrix<T>::IndexT> _columns;
+    std::vector<T> _values;
+
+  };
+
+/*======================================================================*/
+/*!
+ *   \relates atb::CompressedSparseMatrix
+ *   Matrix-vector product for compressed sparse matrices and dense 1-D
+ *   blitz++ Arrays. The rows are processed in parallel.
+ *
+ *   \param A The left-hand-side matrix
+ *   \param x The right-hand-side vector
+ *
+ *   \return The dense 1-D blitz++ Array A * x
+ *
+ *   \exception SparseMatrixError If the vector length does not match
+ *     the number of matrix columns
+ */
+/*======================================================================*/
+  template<typename T>
+  blitz::Array<T,1> operator*(
+      CompressedSparseMatrix<T> const &A, blitz::Array<T,1> const &x);
+
+/*======================================================================*/
+/*!
+ *   \relates atb::CompressedSparseMatrix
+ *   Matrix-matrix product for compressed sparse matrices. The product is
+ *   computed row by row with Gustavson's algorithm in parallel. A first
+ *   symbolic pass counts the entries of each result row, so the result
+ *   arrays are allocated once and filled in place by the second pass.
+ *   Entries that cancel to zero are kept.
+ *
+ *   \param A The left-hand-side matrix (n x k)
+ *   \param B The right-hand-side matrix (k x m)
+ *
+ *   \return The n x m product matrix
+ *
+ *   \exception SparseMatrixError If the matrix shapes are incompatible
+ */
+/*======================================================================*/
+  template<typename T>
+  CompressedSparseMatrix<T> operator*(
+      CompressedSparseMatrix<T> const &A,
+      CompressedSparseMatrix<T> const &B);
+
+}
+
+#include "CompressedSparseMatrix.icc"
+
+#endif
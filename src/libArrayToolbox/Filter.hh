@@ -38,6 +38,7 @@
 #include "BoundaryTreatment.hh"
 
 #include <libProgressReporter/ProgressReporter.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace atb
 {
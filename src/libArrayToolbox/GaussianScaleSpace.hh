@@ -0,0 +1,368 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*======================================================================*/
+/*!
+ *  \file GaussianScaleSpace.hh
+ *  \brief Incrementally computed Gaussian scale-space of an Array.
+ */
+/*======================================================================*/
+
+#ifndef ATBGAUSSIANSCALESPACE_HH
+#define ATBGAUSSIANSCALESPACE_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+#include <libProgressReporter/ProgressReporter.hh>
+
+#include "Array.hh"
+#include "ATBDataSynthesis.hh"
+#include "SeparableConvolutionFilter.hh"
+#include "Interpolator.hh"
+#include "RuntimeError.hh"
+
+namespace atb
+{
+  
+/*======================================================================*/
+/*!
+ *  \class GaussianScaleSpace GaussianScaleSpace.hh "libArrayToolbox/GaussianScaleSpace.hh"
+ *  \brief The GaussianScaleSpace class provides Gaussian smoothed versions
+ *    of an Array at arbitrary scales, deriving coarse scales from finer
+ *    ones.
+ *
+ *  Every scale \f$\sigma\f$ with \f$\sigma / 2\f$ not below the base scale
+ *  is computed from its parent scale \f$\sigma / 2\f$ by smoothing with the
+ *  increment \f$\sqrt{\sigma^2 - (\sigma / 2)^2}\f$. Finer scales are
+ *  computed directly from the data. The parent relation does not depend on
+ *  the order in which scales are requested, so every scale always results
+ *  from the same sequence of smoothing steps. For the common octave
+ *  sequence \f$\sigma_0, 2\sigma_0, 4\sigma_0, \ldots\f$ each scale is
+ *  derived from the previous one with a kernel that is much smaller than
+ *  the kernel of the full scale.
+ *
+ *  Kernels are truncated at seven standard deviations and normalized to
+ *  sum one. Scales computed directly use pixel integrated Gaussians like
+ *  atb::gaussian(), increments use sampled Gaussians, so that all scales
+ *  have the variance of their pixel integrated counterpart. Kernels are
+ *  cached, so smoothing several Arrays with the same scale computes them
+ *  only once.
+ *
+ *  Optionally scales are stored on grids downsampled by powers of two once
+ *  the scale is at least two coarse pixels (octave pyramid). Samples of
+ *  a downsampled scale coincide with full grid samples, scale() upsamples
+ *  them to the full grid by linear interpolation.
+ *
+ *  Computed scales are kept until they are released. The data Array is
+ *  referenced, not copied, and must outlive this object. Objects of this
+ *  class must not be used concurrently from different threads.
+ */
+/*======================================================================*/
+  template<typename DataT, int Dim>
+  class GaussianScaleSpace
+  {
+
+  public:
+
+/*======================================================================*/
+/*! 
+ *   Constructor.
+ *
+ *   \param bt             The boundary treatment of the smoothing
+ *   \param boundaryValue  If bt is ValueBT, this value will be used for
+ *     out-of-Array access
+ */
+/*======================================================================*/
+    GaussianScaleSpace(
+        BoundaryTreatmentType bt = RepeatBT,
+        DataT const &boundaryValue = traits<DataT>::zero);
+
+/*======================================================================*/
+/*! 
+ *   Destructor.
+ */
+/*======================================================================*/
+    ~GaussianScaleSpace();
+
+/*======================================================================*/
+/*! 
+ *   Set the data to compute the scale-space of. All stored scales are
+ *   released.
+ *
+ *   \param data           The data Array, it is referenced, not copied
+ *   \param elementSizeUm  The element size of the data. Scales are given
+ *     in the same unit.
+ */
+/*======================================================================*/
+    void setData(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm);
+
+/*======================================================================*/
+/*! 
+ *   Set the data to compute the scale-space of. All stored scales are
+ *   released.
+ *
+ *   \param data  The data Array, it is referenced, not copied
+ */
+/*======================================================================*/
+    void setData(Array<DataT,Dim> const &data);
+
+/*======================================================================*/
+/*! 
+ *   Check whether data has been set.
+ *
+ *   \return true if setData() was called, false otherwise
+ */
+/*======================================================================*/
+    bool hasData() const;
+
+/*======================================================================*/
+/*! 
+ *   Get the base scale. Scales below twice the base scale are computed
+ *   directly from the data.
+ *
+ *   \return The base scale. If it was not set, half the largest element
+ *     size is returned once data is set.
+ */
+/*======================================================================*/
+    double baseScaleUm() const;
+
+/*======================================================================*/
+/*! 
+ *   Set the base scale. Values below half the largest element size are
+ *   raised to it, because the increments would otherwise not be
+ *   representable as sampled Gaussians. All stored scales are released.
+ *
+ *   \param baseScaleUm  The new base scale
+ */
+/*======================================================================*/
+    void setBaseScaleUm(double baseScaleUm);
+
+/*======================================================================*/
+/*! 
+ *   Get the maximum number of times scales are downsampled by a factor of
+ *   two.
+ *
+ *   \return The maximum downsampling level, 0 means no downsampling
+ */
+/*======================================================================*/
+    int maxDownsamplingLevel() const;
+
+/*======================================================================*/
+/*! 
+ *   Set the maximum number of times scales are downsampled by a factor of
+ *   two. Downsampling trades accuracy for speed and memory. All stored
+ *   scales are released.
+ *
+ *   \param maxDownsamplingLevel  The new maximum downsampling level
+ */
+/*======================================================================*/
+    void setMaxDownsamplingLevel(int maxDownsamplingLevel);
+
+/*======================================================================*/
+/*! 
+ *   Get the scale the given scale is derived from.
+ *
+ *   \param sigmaUm  The scale
+ *
+ *   \return The parent scale or 0 if the scale is computed directly from
+ *     the data
+ */
+/*======================================================================*/
+    double parentScaleUm(double sigmaUm) const;
+
+/*======================================================================*/
+/*! 
+ *   Compute the data smoothed with a Gaussian of the given standard
+ *   deviation. Missing parent scales are computed and stored as well.
+ *
+ *   \param sigmaUm   The standard deviation of the Gaussian
+ *   \param smoothed  The smoothed data on the grid of the data
+ *   \param pr        If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ */
+/*======================================================================*/
+    void scale(
+        double sigmaUm, blitz::Array<DataT,Dim> &smoothed,
+        iRoCS::ProgressReporter *pr = NULL);
+
+/*======================================================================*/
+/*! 
+ *   Check whether the given scale is stored.
+ *
+ *   \param sigmaUm  The scale
+ *
+ *   \return true if the scale is stored, false otherwise
+ */
+/*======================================================================*/
+    bool hasScale(double sigmaUm) const;
+
+/*======================================================================*/
+/*! 
+ *   Store an externally computed (e.g. cached) scale, so that coarser
+ *   scales can be derived from it.
+ *
+ *   \param sigmaUm   The scale
+ *   \param smoothed  The smoothed data on the grid of the data
+ */
+/*======================================================================*/
+    void insertScale(double sigmaUm, blitz::Array<DataT,Dim> const &smoothed);
+
+/*======================================================================*/
+/*! 
+ *   Release the given scale.
+ *
+ *   \param sigmaUm  The scale
+ */
+/*======================================================================*/
+    void releaseScale(double sigmaUm);
+
+/*======================================================================*/
+/*! 
+ *   Release all scales except the given one. If scales are requested in
+ *   ascending order, this keeps exactly the parent of the next scale.
+ *
+ *   \param sigmaUm  The scale to keep
+ */
+/*======================================================================*/
+    void releaseOtherScales(double sigmaUm);
+
+/*======================================================================*/
+/*! 
+ *   Release all scales.
+ */
+/*======================================================================*/
+    void clear();
+
+/*======================================================================*/
+/*! 
+ *   Smooth the given Array with a Gaussian using the kernels of this
+ *   scale-space. This does not use or modify the stored scales.
+ *
+ *   \param data           The Array to smooth
+ *   \param elementSizeUm  The element size of the Array
+ *   \param sigmaUm        The standard deviation of the Gaussian
+ *   \param smoothed       The smoothed Array, may be the input Array
+ *   \param pr             If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ */
+/*======================================================================*/
+    void smooth(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm, double sigmaUm,
+        blitz::Array<DataT,Dim> &smoothed, iRoCS::ProgressReporter *pr = NULL);
+
+/*======================================================================*/
+/*! 
+ *   Smooth the given Array with a Gaussian using the kernels of this
+ *   scale-space. This does not use or modify the stored scales.
+ *
+ *   \param data      The Array to smooth
+ *   \param sigmaUm   The standard deviation of the Gaussian
+ *   \param smoothed  The smoothed Array, may be the input Array
+ *   \param pr        If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ */
+/*======================================================================*/
+    void smooth(
+        Array<DataT,Dim> const &data, double sigmaUm,
+        Array<DataT,Dim> &smoothed, iRoCS::ProgressReporter *pr = NULL);
+
+/*======================================================================*/
+/*! 
+ *   Compute the one-dimensional Gaussian kernel the scale-space uses.
+ *
+ *   \param sigmaPx  The standard deviation in pixels
+ *   \param sampled  If true the Gaussian is sampled, otherwise it is
+ *     integrated over the pixel areas
+ *   \param kernel   The normalized kernel of odd length
+ */
+/*======================================================================*/
+    static void kernel(
+        double sigmaPx, bool sampled, blitz::Array<DataT,1> &kernel);
+
+/*======================================================================*/
+/*! 
+ *   Get the parent of the given scale for the given base scale.
+ *
+ *   \param sigmaUm      The scale
+ *   \param baseScaleUm  The base scale
+ *
+ *   \return The parent scale or 0 if the scale is computed directly from
+ *     the data
+ */
+/*======================================================================*/
+    static double parentScaleUm(double sigmaUm, double baseScaleUm);
+
+  private:
+
+    struct Level
+    {
+      blitz::Array<DataT,Dim> data;
+      int downsamplingLevel;
+    };
+
+    Level const *_level(double sigmaUm, iRoCS::ProgressReporter *pr);
+
+    void _coarsen(double sigmaUm, Level &level) const;
+
+    double _maxElementSizeUm() const;
+
+    blitz::Array<DataT,1> const &_kernel(double sigmaPx, bool sampled);
+
+    void _smooth(
+        blitz::Array<DataT,Dim> const &data,
+        blitz::TinyVector<double,Dim> const &elementSizeUm, double sigmaUm,
+        bool sampled, blitz::Array<DataT,Dim> &smoothed,
+        iRoCS::ProgressReporter *pr);
+
+    static void _downsample(
+        blitz::Array<DataT,Dim> const &data, blitz::Array<DataT,Dim> &coarse);
+
+    static void _upsample(
+        blitz::Array<DataT,Dim> const &coarse, int downsamplingLevel,
+        blitz::Array<DataT,Dim> &data);
+
+    BoundaryTreatmentType _btType;
+    DataT _boundaryValue;
+    blitz::Array<DataT,Dim> const *p_data;
+    blitz::TinyVector<double,Dim> _elementSizeUm;
+    double _baseScaleUm;
+    int _maxDownsamplingLevel;
+    std::map<double,Level> _levels;
+    std::map<std::pair<double,bool>,blitz::Array<DataT,1> > _kernels;
+
+  };
+
+}
+
+#include "GaussianScaleSpace.icc"
+
+#endif
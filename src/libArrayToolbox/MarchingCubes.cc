@@ -22,8 +22,12 @@
 
 #include "MarchingCubes.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
 #include "ATBLinAlg.hh"
-#include "SparseMatrix.hh"
 
 // #define MARCHINGCUBES_DEBUG
 
@@ -33,6 +37,504 @@
 
 namespace atb
 {
+
+  // Lexicographic order of the grid cells the vertices fall into, ties are
+  // broken by the vertex index
+  struct VertexCellLess
+  {
+    explicit VertexCellLess(
+        std::vector< blitz::TinyVector<double,3> > const &vertexCells)
+            : cells(vertexCells)
+    {}
+
+    bool operator()(size_t a, size_t b) const
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        if (cells[a](d) < cells[b](d)) return true;
+        if (cells[b](d) < cells[a](d)) return false;
+      }
+      return a < b;
+    }
+
+    bool operator()(size_t a, blitz::TinyVector<double,3> const &cell) const
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        if (cells[a](d) < cell(d)) return true;
+        if (cell(d) < cells[a](d)) return false;
+      }
+      return false;
+    }
+
+    std::vector< blitz::TinyVector<double,3> > const &cells;
+  };
+
+  /*======================================================================*/
+  /*!
+   *  Edge collapse mesh simplification on flat arrays. The triangles of
+   *  every vertex are stored in CSR layout, collapsed vertices are chained
+   *  to the surviving vertex, so the triangle lists never need to be
+   *  rebuilt. Candidate collapses live in a binary heap, entries that were
+   *  computed for an outdated neighborhood are detected by per-vertex
+   *  version stamps and dropped when popped.
+   */
+  /*======================================================================*/
+  class EdgeCollapseSimplifier
+  {
+
+  public:
+
+    enum CostType { SweptVolume, QuadricError };
+
+    EdgeCollapseSimplifier(SurfaceGeometry &surface, CostType costType);
+
+    void simplify(double maxCost, size_t targetNTriangles);
+
+  private:
+
+    struct Collapse
+    {
+      double cost;
+      SurfaceGeometry::IndexT a, b;
+      unsigned int versionA, versionB;
+      SurfaceGeometry::VertexT position;
+
+      // Inverted for a min-heap
+      bool operator<(Collapse const &other) const
+      {
+        return cost > other.cost;
+      }
+    };
+
+    void _addPlaneQuadric(
+        SurfaceGeometry::IndexT v, blitz::TinyVector<double,3> const &n,
+        double d, double weight);
+    double _quadricError(
+        double const *Q, SurfaceGeometry::VertexT const &p) const;
+    void _triangles(
+        SurfaceGeometry::IndexT v,
+        std::vector<SurfaceGeometry::IndexT> &triangles) const;
+    void _neighbors(
+        SurfaceGeometry::IndexT v,
+        std::vector<SurfaceGeometry::IndexT> &neighbors) const;
+    void _pushCollapse(SurfaceGeometry::IndexT a, SurfaceGeometry::IndexT b);
+    bool _isValid(Collapse const &collapse) const;
+    void _collapse(Collapse const &collapse);
+    void _compact();
+
+    SurfaceGeometry &_surface;
+    CostType _costType;
+
+    std::vector<size_t> _offsets;
+    std::vector<SurfaceGeometry::IndexT> _vertexTriangles;
+    std::vector<ptrdiff_t> _chainNext, _chainTail;
+    std::vector<unsigned char> _vertexAlive, _triangleAlive;
+    std::vector<unsigned int> _versions;
+    std::vector<double> _quadrics;
+    std::vector<Collapse> _heap;
+    size_t _nTriangles;
+
+  };
+
+  EdgeCollapseSimplifier::EdgeCollapseSimplifier(
+      SurfaceGeometry &surface, CostType costType)
+          : _surface(surface), _costType(costType)
+  {
+    std::vector<SurfaceGeometry::VertexT> const &V = surface.vertices();
+    std::vector<SurfaceGeometry::IndexT> const &I = surface.indices();
+    size_t nVertices = V.size();
+    _nTriangles = I.size() / 3;
+
+    // Vertex to triangle adjacency in CSR layout
+    _offsets.assign(nVertices + 1, 0);
+    for (size_t i = 0; i < I.size(); ++i) _offsets[I[i] + 1]++;
+    for (size_t v = 0; v < nVertices; ++v) _offsets[v + 1] += _offsets[v];
+    _vertexTriangles.resize(I.size());
+    std::vector<size_t> fill(_offsets.begin(), _offsets.end() - 1);
+    for (size_t i = 0; i < I.size(); ++i)
+        _vertexTriangles[fill[I[i]]++] =
+            static_cast<SurfaceGeometry::IndexT>(i / 3);
+
+    _chainNext.assign(nVertices, -1);
+    _chainTail.resize(nVertices);
+    for (size_t v = 0; v < nVertices; ++v)
+        _chainTail[v] = static_cast<ptrdiff_t>(v);
+    _vertexAlive.assign(nVertices, 1);
+    _triangleAlive.assign(_nTriangles, 1);
+    _versions.assign(nVertices, 0);
+
+    // Collect the unique edges and find the boundary edges, that are used
+    // by one triangle only
+    std::vector< std::pair<SurfaceGeometry::IndexT,
+        SurfaceGeometry::IndexT> > edges;
+    edges.reserve(I.size());
+    for (size_t t = 0; t < _nTriangles; ++t)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        SurfaceGeometry::IndexT a = I[3 * t + j];
+        SurfaceGeometry::IndexT b = I[3 * t + (j + 1) % 3];
+        edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    if (_costType == QuadricError)
+    {
+      // Plane quadrics of all triangles
+      _quadrics.assign(10 * nVertices, 0.0);
+      for (size_t t = 0; t < _nTriangles; ++t)
+      {
+        blitz::TinyVector<double,3> p0(V[I[3 * t]]);
+        blitz::TinyVector<double,3> e1(V[I[3 * t + 1]]), e2(V[I[3 * t + 2]]);
+        e1 -= p0;
+        e2 -= p0;
+        blitz::TinyVector<double,3> n(blitz::cross(e1, e2));
+        double length = std::sqrt(blitz::dot(n, n));
+        if (length == 0.0) continue;
+        n /= length;
+        for (int j = 0; j < 3; ++j)
+            _addPlaneQuadric(I[3 * t + j], n, -blitz::dot(n, p0), 1.0);
+      }
+
+      // Boundary edges are preserved by heavily weighted planes
+      // perpendicular to the adjacent triangle
+      for (size_t t = 0; t < _nTriangles; ++t)
+      {
+        blitz::TinyVector<double,3> p0(V[I[3 * t]]);
+        blitz::TinyVector<double,3> e1(V[I[3 * t + 1]]), e2(V[I[3 * t + 2]]);
+        e1 -= p0;
+        e2 -= p0;
+        blitz::TinyVector<double,3> n(blitz::cross(e1, e2));
+        for (int j = 0; j < 3; ++j)
+        {
+          SurfaceGeometry::IndexT a = I[3 * t + j];
+          SurfaceGeometry::IndexT b = I[3 * t + (j + 1) % 3];
+          std::pair<SurfaceGeometry::IndexT,SurfaceGeometry::IndexT> edge(
+              std::min(a, b), std::max(a, b));
+          if (std::upper_bound(edges.begin(), edges.end(), edge) -
+              std::lower_bound(edges.begin(), edges.end(), edge) != 1)
+              continue;
+          blitz::TinyVector<double,3> pa(V[a]), e(V[b]);
+          e -= pa;
+          blitz::TinyVector<double,3> m(blitz::cross(e, n));
+          double length = std::sqrt(blitz::dot(m, m));
+          if (length == 0.0) continue;
+          m /= length;
+          _addPlaneQuadric(a, m, -blitz::dot(m, pa), 1000.0);
+          _addPlaneQuadric(b, m, -blitz::dot(m, pa), 1000.0);
+        }
+      }
+    }
+
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    _heap.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i)
+        _pushCollapse(edges[i].first, edges[i].second);
+  }
+
+  void EdgeCollapseSimplifier::simplify(
+      double maxCost, size_t targetNTriangles)
+  {
+    while (_heap.size() != 0 && _nTriangles > targetNTriangles)
+    {
+      std::pop_heap(_heap.begin(), _heap.end());
+      Collapse collapse = _heap.back();
+      _heap.pop_back();
+      if (collapse.cost >= maxCost) break;
+      if (!_isValid(collapse)) continue;
+      _collapse(collapse);
+    }
+    _compact();
+  }
+
+  void EdgeCollapseSimplifier::_addPlaneQuadric(
+      SurfaceGeometry::IndexT v, blitz::TinyVector<double,3> const &n,
+      double d, double weight)
+  {
+    double *Q = &_quadrics[10 * v];
+    Q[0] += weight * n(0) * n(0);
+    Q[1] += weight * n(0) * n(1);
+    Q[2] += weight * n(0) * n(2);
+    Q[3] += weight * n(0) * d;
+    Q[4] += weight * n(1) * n(1);
+    Q[5] += weight * n(1) * n(2);
+    Q[6] += weight * n(1) * d;
+    Q[7] += weight * n(2) * n(2);
+    Q[8] += weight * n(2) * d;
+    Q[9] += weight * d * d;
+  }
+
+  double EdgeCollapseSimplifier::_quadricError(
+      double const *Q, SurfaceGeometry::VertexT const &p) const
+  {
+    double x = p(0), y = p(1), z = p(2);
+    double error =
+        Q[0] * x * x + 2.0 * Q[1] * x * y + 2.0 * Q[2] * x * z +
+        2.0 * Q[3] * x + Q[4] * y * y + 2.0 * Q[5] * y * z + 2.0 * Q[6] * y +
+        Q[7] * z * z + 2.0 * Q[8] * z + Q[9];
+    return (error > 0.0) ? error : 0.0;
+  }
+
+  void EdgeCollapseSimplifier::_triangles(
+      SurfaceGeometry::IndexT v,
+      std::vector<SurfaceGeometry::IndexT> &triangles) const
+  {
+    triangles.clear();
+    for (ptrdiff_t u = v; u >= 0; u = _chainNext[u])
+        for (size_t i = _offsets[u]; i < _offsets[u + 1]; ++i)
+            if (_triangleAlive[_vertexTriangles[i]])
+                triangles.push_back(_vertexTriangles[i]);
+  }
+
+  void EdgeCollapseSimplifier::_neighbors(
+      SurfaceGeometry::IndexT v,
+      std::vector<SurfaceGeometry::IndexT> &neighbors) const
+  {
+    std::vector<SurfaceGeometry::IndexT> const &I = _surface.indices();
+    std::vector<SurfaceGeometry::IndexT> triangles;
+    _triangles(v, triangles);
+    neighbors.clear();
+    for (size_t i = 0; i < triangles.size(); ++i)
+        for (int j = 0; j < 3; ++j)
+            if (I[3 * triangles[i] + j] != v)
+                neighbors.push_back(I[3 * triangles[i] + j]);
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(
+        std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+  }
+
+  void EdgeCollapseSimplifier::_pushCollapse(
+      SurfaceGeometry::IndexT a, SurfaceGeometry::IndexT b)
+  {
+    std::vector<SurfaceGeometry::VertexT> const &V = _surface.vertices();
+    std::vector<SurfaceGeometry::IndexT> const &I = _surface.indices();
+    Collapse collapse;
+    collapse.a = a;
+    collapse.b = b;
+    collapse.versionA = _versions[a];
+    collapse.versionB = _versions[b];
+
+    if (_costType == QuadricError)
+    {
+      double Q[10];
+      for (int i = 0; i < 10; ++i)
+          Q[i] = _quadrics[10 * a + i] + _quadrics[10 * b + i];
+
+      // Minimize the quadric error, fall back to the best of the end
+      // points and the edge center if the system is ill-conditioned
+      double det =
+          Q[0] * (Q[4] * Q[7] - Q[5] * Q[5]) -
+          Q[1] * (Q[1] * Q[7] - Q[5] * Q[2]) +
+          Q[2] * (Q[1] * Q[5] - Q[4] * Q[2]);
+      double scale = Q[0] + Q[4] + Q[7];
+      if (std::abs(det) > 1e-9 * scale * scale * scale)
+      {
+        collapse.position(0) = static_cast<float>(
+            (-Q[3] * (Q[4] * Q[7] - Q[5] * Q[5]) +
+             Q[1] * (Q[6] * Q[7] - Q[5] * Q[8]) -
+             Q[2] * (Q[6] * Q[5] - Q[4] * Q[8])) / det);
+        collapse.position(1) = static_cast<float>(
+            (Q[0] * (-Q[6] * Q[7] + Q[8] * Q[5]) +
+             Q[3] * (Q[1] * Q[7] - Q[5] * Q[2]) -
+             Q[2] * (Q[1] * Q[8] - Q[6] * Q[2])) / det);
+        collapse.position(2) = static_cast<float>(
+            (Q[0] * (-Q[4] * Q[8] + Q[5] * Q[6]) -
+             Q[1] * (-Q[1] * Q[8] + Q[6] * Q[2]) -
+             Q[3] * (Q[1] * Q[5] - Q[4] * Q[2])) / det);
+        collapse.cost = _quadricError(Q, collapse.position);
+      }
+      else
+      {
+        SurfaceGeometry::VertexT candidates[3] = {
+            V[a], V[b], SurfaceGeometry::VertexT(0.5f * (V[a] + V[b])) };
+        collapse.cost = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 3; ++i)
+        {
+          double cost = _quadricError(Q, candidates[i]);
+          if (cost < collapse.cost)
+          {
+            collapse.cost = cost;
+            collapse.position = candidates[i];
+          }
+        }
+      }
+    }
+    else
+    {
+      // Sum of the volumes swept by the triangles of both vertices when
+      // moving the vertices to the edge center
+      collapse.position = 0.5f * (V[a] + V[b]);
+      blitz::TinyVector<double,3> p(collapse.position);
+      collapse.cost = 0.0;
+      std::vector<SurfaceGeometry::IndexT> triangles, trianglesB;
+      _triangles(a, triangles);
+      _triangles(b, trianglesB);
+      triangles.insert(triangles.end(), trianglesB.begin(), trianglesB.end());
+      for (size_t i = 0; i < triangles.size(); ++i)
+      {
+        SurfaceGeometry::IndexT const *t = &I[3 * triangles[i]];
+        if (i < triangles.size() - trianglesB.size() &&
+            (t[0] == b || t[1] == b || t[2] == b)) continue;
+        blitz::TinyVector<double,3> p0(V[t[0]]), e1(V[t[1]]), e2(V[t[2]]);
+        e1 -= p0;
+        e2 -= p0;
+        collapse.cost += std::abs(
+            blitz::dot(blitz::cross(e1, e2),
+                       blitz::TinyVector<double,3>(p - p0)));
+      }
+    }
+    _heap.push_back(collapse);
+    std::push_heap(_heap.begin(), _heap.end());
+  }
+
+  bool EdgeCollapseSimplifier::_isValid(Collapse const &collapse) const
+  {
+    SurfaceGeometry::IndexT a = collapse.a, b = collapse.b;
+    if (!_vertexAlive[a] || !_vertexAlive[b] ||
+        _versions[a] != collapse.versionA ||
+        _versions[b] != collapse.versionB) return false;
+
+    std::vector<SurfaceGeometry::VertexT> const &V = _surface.vertices();
+    std::vector<SurfaceGeometry::IndexT> const &I = _surface.indices();
+
+    // Link condition: the common neighbors of a and b must be exactly the
+    // opposite vertices of the triangles sharing the edge, otherwise the
+    // collapse makes the mesh non-manifold
+    std::vector<SurfaceGeometry::IndexT> neighborsA, neighborsB, common;
+    _neighbors(a, neighborsA);
+    _neighbors(b, neighborsB);
+    std::set_intersection(
+        neighborsA.begin(), neighborsA.end(),
+        neighborsB.begin(), neighborsB.end(), std::back_inserter(common));
+    std::vector<SurfaceGeometry::IndexT> triangles;
+    _triangles(a, triangles);
+    size_t nShared = 0;
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+      SurfaceGeometry::IndexT const *t = &I[3 * triangles[i]];
+      if (t[0] == b || t[1] == b || t[2] == b) ++nShared;
+    }
+    if (common.size() != nShared) return false;
+
+    // Reject collapses flipping the orientation of remaining triangles
+    std::vector<SurfaceGeometry::IndexT> trianglesB;
+    _triangles(b, trianglesB);
+    triangles.insert(triangles.end(), trianglesB.begin(), trianglesB.end());
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+      SurfaceGeometry::IndexT const *t = &I[3 * triangles[i]];
+      int nMoved = 0;
+      blitz::TinyVector<double,3> before[3], after[3];
+      for (int j = 0; j < 3; ++j)
+      {
+        before[j] = V[t[j]];
+        after[j] = before[j];
+        if (t[j] == a || t[j] == b)
+        {
+          after[j] = collapse.position;
+          ++nMoved;
+        }
+      }
+      if (nMoved != 1) continue;
+      blitz::TinyVector<double,3> nBefore(
+          blitz::cross(blitz::TinyVector<double,3>(before[1] - before[0]),
+                       blitz::TinyVector<double,3>(before[2] - before[0])));
+      blitz::TinyVector<double,3> nAfter(
+          blitz::cross(blitz::TinyVector<double,3>(after[1] - after[0]),
+                       blitz::TinyVector<double,3>(after[2] - after[0])));
+      if (blitz::dot(nBefore, nAfter) <= 0.0) return false;
+    }
+    return true;
+  }
+
+  void EdgeCollapseSimplifier::_collapse(Collapse const &collapse)
+  {
+    std::vector<SurfaceGeometry::VertexT> &V = _surface.vertices();
+    std::vector<SurfaceGeometry::IndexT> &I = _surface.indices();
+    SurfaceGeometry::IndexT a = collapse.a, b = collapse.b;
+
+    // Remove the triangles sharing the edge and connect the remaining
+    // triangles of b to a
+    std::vector<SurfaceGeometry::IndexT> triangles;
+    _triangles(b, triangles);
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+      SurfaceGeometry::IndexT *t = &I[3 * triangles[i]];
+      if (t[0] == a || t[1] == a || t[2] == a)
+      {
+        _triangleAlive[triangles[i]] = 0;
+        --_nTriangles;
+        continue;
+      }
+      for (int j = 0; j < 3; ++j) if (t[j] == b) t[j] = a;
+    }
+    _chainNext[_chainTail[a]] = b;
+    _chainTail[a] = _chainTail[b];
+    _vertexAlive[b] = 0;
+    V[a] = collapse.position;
+    if (_costType == QuadricError)
+        for (int i = 0; i < 10; ++i)
+            _quadrics[10 * a + i] += _quadrics[10 * b + i];
+    ++_versions[a];
+    ++_versions[b];
+
+    std::vector<SurfaceGeometry::IndexT> neighbors;
+    _neighbors(a, neighbors);
+    if (_costType == QuadricError)
+    {
+      // Only the collapses of a are affected
+      for (size_t i = 0; i < neighbors.size(); ++i)
+          _pushCollapse(std::min(a, neighbors[i]), std::max(a, neighbors[i]));
+      return;
+    }
+
+    // The swept volumes of all edges of the neighbors changed
+    for (size_t i = 0; i < neighbors.size(); ++i) ++_versions[neighbors[i]];
+    std::vector<SurfaceGeometry::IndexT> neighbors2;
+    for (size_t i = 0; i < neighbors.size(); ++i)
+    {
+      _neighbors(neighbors[i], neighbors2);
+      for (size_t j = 0; j < neighbors2.size(); ++j)
+      {
+        // Edges between two neighbors are pushed by the smaller one only
+        if (neighbors2[j] != a && neighbors2[j] < neighbors[i] &&
+            std::binary_search(
+                neighbors.begin(), neighbors.end(), neighbors2[j])) continue;
+        _pushCollapse(std::min(neighbors[i], neighbors2[j]),
+                      std::max(neighbors[i], neighbors2[j]));
+      }
+    }
+  }
+
+  void EdgeCollapseSimplifier::_compact()
+  {
+    std::vector<SurfaceGeometry::VertexT> &V = _surface.vertices();
+    std::vector<SurfaceGeometry::NormalT> &N = _surface.normals();
+    std::vector<SurfaceGeometry::IndexT> &I = _surface.indices();
+
+    std::vector<SurfaceGeometry::IndexT> indexMap(V.size());
+    size_t nVertices = 0;
+    for (size_t v = 0; v < V.size(); ++v)
+    {
+      if (!_vertexAlive[v]) continue;
+      indexMap[v] = static_cast<SurfaceGeometry::IndexT>(nVertices);
+      V[nVertices] = V[v];
+      if (v < N.size()) N[nVertices] = N[v];
+      ++nVertices;
+    }
+    V.resize(nVertices);
+    if (N.size() > nVertices) N.resize(nVertices);
+
+    size_t nIndices = 0;
+    for (size_t t = 0; t < _triangleAlive.size(); ++t)
+    {
+      if (!_triangleAlive[t]) continue;
+      for (int j = 0; j < 3; ++j) I[nIndices++] = indexMap[I[3 * t + j]];
+    }
+    I.resize(nIndices);
+  }
   
   int MarchingCubes::edgeTable[256] = {
       0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
@@ -326,6 +828,19 @@ namespace atb
       {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
       {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
 
+  int MarchingCubes::cellCorners[8][3] = {
+      {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+      {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+
+  int MarchingCubes::edgeCorners[12][2] = {
+      {0, 1}, {1, 2}, {3, 2}, {0, 3}, {4, 5}, {5, 6},
+      {7, 6}, {4, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+  int MarchingCubes::edgeCacheSlots[12][4] = {
+      {2, 0, 0, 0}, {1, 0, 0, 0}, {2, 1, 0, 0}, {0, 0, 0, 0},
+      {2, 0, 1, 0}, {1, 0, 1, 0}, {2, 1, 1, 0}, {0, 0, 1, 0},
+      {0, 0, 0, 1}, {1, 0, 0, 1}, {1, 1, 0, 1}, {0, 1, 0, 1}};
+
   int MarchingCubes::computeTrianglesForGridCell(
       GridCell const &gridCell, std::vector<Triangle>& triangles,
       double isoLevel)
@@ -434,167 +949,6 @@ namespace atb
     return nTriangles;
   }
 
-  void MarchingCubes::computeTrianglesForGridCell(
-      GridCell const &gridCell, blitz::TinyVector<int,12> &cellIndices,
-      SurfaceGeometry &surface, double isoLevel)
-  {
-    std::vector<SurfaceGeometry::VertexT> &V = surface.vertices();
-    std::vector<SurfaceGeometry::IndexT> &I = surface.indices();
-
-    int cubeIndex = 0;
-    for (int i = 0; i < 8; ++i)
-        if (gridCell.cornerValues(i) < isoLevel) cubeIndex |= 1 << i;
-
-    // Cube is entirely in/out of the surface
-    if (edgeTable[cubeIndex] == 0) return;
-
-    // Find the vertices where the surface intersects the cube
-    blitz::TinyVector<SurfaceGeometry::VertexT,12> vertexList(
-        SurfaceGeometry::VertexT(0.0f));
-    if ((edgeTable[cubeIndex] & 1) != 0)
-    {
-      if (cellIndices(0) == -1)
-          vertexList(0) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(0),
-              gridCell.cornerCoordinates(1),
-              gridCell.cornerValues(0), gridCell.cornerValues(1));
-      else vertexList(0) = V[cellIndices(0)];
-    }
-    if ((edgeTable[cubeIndex] & 2) != 0)
-    {
-      if (cellIndices(1) == -1)
-          vertexList(1) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(1),
-              gridCell.cornerCoordinates(2),
-              gridCell.cornerValues(1), gridCell.cornerValues(2));
-      else vertexList(1) = V[cellIndices(1)];
-    }
-    if ((edgeTable[cubeIndex] & 4) != 0)
-    {
-      if (cellIndices(2) == -1)
-          vertexList(2) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(2),
-              gridCell.cornerCoordinates(3),
-              gridCell.cornerValues(2), gridCell.cornerValues(3));
-      else vertexList(2) = V[cellIndices(2)];
-    }
-    if ((edgeTable[cubeIndex] & 8) != 0)
-    {
-      if (cellIndices(3) == -1)
-          vertexList(3) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(3),
-              gridCell.cornerCoordinates(0),
-              gridCell.cornerValues(3), gridCell.cornerValues(0));
-      else vertexList(3) = V[cellIndices(3)];
-    }
-    if ((edgeTable[cubeIndex] & 16) != 0)
-    {
-      if (cellIndices(4) == -1)
-          vertexList(4) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(4),
-              gridCell.cornerCoordinates(5),
-              gridCell.cornerValues(4), gridCell.cornerValues(5));
-      else vertexList(4) = V[cellIndices(4)];
-    }
-    if ((edgeTable[cubeIndex] & 32) != 0)
-    {
-      if (cellIndices(5) == -1)
-          vertexList(5) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(5),
-              gridCell.cornerCoordinates(6),
-              gridCell.cornerValues(5), gridCell.cornerValues(6));
-      else vertexList(5) = V[cellIndices(5)];
-    }
-    if ((edgeTable[cubeIndex] & 64) != 0)
-    {
-      if (cellIndices(6) == -1)
-          vertexList(6) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(6),
-              gridCell.cornerCoordinates(7),
-              gridCell.cornerValues(6), gridCell.cornerValues(7));
-      else vertexList(6) = V[cellIndices(6)];
-    }
-    if ((edgeTable[cubeIndex] & 128) != 0)
-    {
-      if (cellIndices(7) == -1)
-          vertexList(7) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(7),
-              gridCell.cornerCoordinates(4),
-              gridCell.cornerValues(7), gridCell.cornerValues(4));
-      else vertexList(7) = V[cellIndices(7)];
-    }
-    if ((edgeTable[cubeIndex] & 256) != 0)
-    {
-      if (cellIndices(8) == -1)
-          vertexList(8) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(0),
-              gridCell.cornerCoordinates(4),
-              gridCell.cornerValues(0), gridCell.cornerValues(4));
-      else vertexList(8) = V[cellIndices(8)];
-    }
-    if ((edgeTable[cubeIndex] & 512) != 0)
-    {
-      if (cellIndices(9) == -1)
-          vertexList(9) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(1),
-              gridCell.cornerCoordinates(5),
-              gridCell.cornerValues(1), gridCell.cornerValues(5));
-      else vertexList(9) = V[cellIndices(9)];
-    }
-    if ((edgeTable[cubeIndex] & 1024) != 0)
-    {
-      if (cellIndices(10) == -1)
-          vertexList(10) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(2),
-              gridCell.cornerCoordinates(6),
-              gridCell.cornerValues(2), gridCell.cornerValues(6));
-      else vertexList(10) = V[cellIndices(10)];
-    }
-    if ((edgeTable[cubeIndex] & 2048) != 0)
-    {
-      if (cellIndices(11) == -1)
-          vertexList(11) = getInterpolatedVertex(
-              isoLevel, gridCell.cornerCoordinates(3),
-              gridCell.cornerCoordinates(7),
-              gridCell.cornerValues(3), gridCell.cornerValues(7));
-      else vertexList(11) = V[cellIndices(11)];
-    }
-
-    for (int i = 0; triangleTable[cubeIndex][i] != -1; i += 3)
-    {
-      SurfaceGeometry::NormalT normal(
-          blitz::cross(
-              SurfaceGeometry::VertexT(
-                  vertexList(triangleTable[cubeIndex][i + 1]) -
-                  vertexList(triangleTable[cubeIndex][i])),
-              SurfaceGeometry::VertexT(
-                  vertexList(triangleTable[cubeIndex][i + 2]) -
-                  vertexList(triangleTable[cubeIndex][i]))));
-
-      // Ensure, that the triangle is not degenerate
-      float n = static_cast<float>(std::sqrt(blitz::dot(normal, normal)));
-      if (n > 0.0f)
-      {
-        for (int j = 0; j < 3; ++j)
-        {
-          unsigned int corner = triangleTable[cubeIndex][i + j];
-          if (cellIndices(corner) == -1)
-          {
-            V.push_back(vertexList(corner));
-            cellIndices(corner) = static_cast<int>(V.size()) - 1;
-            for (unsigned int k = corner + 1; k < 12; ++k)
-            {
-              if (blitz::all(vertexList(corner) == vertexList(k)))
-                  cellIndices(k) = cellIndices(corner);
-            }
-          }
-          I.push_back(
-              static_cast<SurfaceGeometry::IndexT>(cellIndices(corner)));
-        }
-      }
-    }
-  }
-
   SurfaceGeometry::VertexT MarchingCubes::getInterpolatedVertex(
       double isoLevel, SurfaceGeometry::VertexT const &p1,
       SurfaceGeometry::VertexT const &p2, double val1, double val2)
@@ -611,12 +965,12 @@ namespace atb
   {
     std::vector<SurfaceGeometry::VertexT> &V = surface.vertices();
     std::vector<SurfaceGeometry::NormalT> &N = surface.normals();
-    std::vector<SurfaceGeometry::IndexT> &I = surface.indices();
 
     if (V.size() != N.size()) N.resize(V.size());
 
 #ifdef MARCHINGCUBES_DEBUG
     // Some pre-condition assertions
+    std::vector<SurfaceGeometry::IndexT> &I = surface.indices();
     unsigned int maxIndex = 0;
     if (I.size() % 3 != 0)
     {
@@ -641,480 +995,85 @@ namespace atb
     _checkAndFixMesh(surface);
 
     if (simplifyTolerance <= 0.0) return;
-    
-    // Adjacency matrix
-    SparseMatrix<unsigned char> A(V.size(), V.size());
-
-    // Triangle lists for each vertex
-    std::vector< std::set<size_t> > T(V.size());
-
-    // Priority queue for edge popping
-    typedef std::pair<size_t, size_t> Edge;
-    typedef std::multimap<double, Edge> EdgeCostQueue;
-    typedef std::pair<double, Edge> EdgeCostQueueEntry;
-    EdgeCostQueue C;
-
-    // Matrix containing iterators into the cost queue for fast element removal
-    typedef std::map<size_t, EdgeCostQueue::iterator> EdgeVector;
-    typedef std::vector< std::map<size_t, EdgeCostQueue::iterator> > EdgeMatrix;
-    EdgeMatrix Cp(V.size());
-    
-    // Initialize adjacency matrix and triangle lists
-    for (size_t i = 0; i < I.size(); i += 3)
-    {
-      A(I[i    ], I[i + 1]) = A(I[i + 1], I[i    ]) = 1;
-      A(I[i    ], I[i + 2]) = A(I[i + 2], I[i    ]) = 1;
-      A(I[i + 1], I[i + 2]) = A(I[i + 2], I[i + 1]) = 1;
-      T[I[i]].insert(i / 3);
-      T[I[i + 1]].insert(i / 3);
-      T[I[i + 2]].insert(i / 3);
-    }
 
-#ifdef MARCHINGCUBES_DEBUG
-    // std::cerr << "=== INITIAL STATE ===================" << std::endl;
-
-    // std::cerr << "vertices = " << std::flush;
-    // for (std::vector<Vertex>::const_iterator it = vertices.begin();
-    //      it != vertices.end(); ++it)
-    //     std::cerr << *it << " " << std::flush;
-    // std::cerr << std::endl;
-
-    // std::cerr << "indices = " << std::flush;
-    // for (std::vector<unsigned int>::const_iterator it =
-    //      I.begin(); it != I.end(); ++it)
-    //     std::cerr << *it << " " << std::flush;
-    // std::cerr << std::endl;
-
-    // {
-    //   blitz::Array<short,2> adj(
-    //       ptrdiff_t(A.nRows()), ptrdiff_t(A.nColumns()));
-    //   adj = blitz::cast<short>(A.toBlitz());
-    //   std::cerr << "Adjacency matrix = " << adj << std::endl;
-    // }
-    
-    // std::cerr << "T = ( " << std::flush;
-    // for (size_t i = 0; i < T.size(); ++i)
-    // {
-    //   std::cerr << "{ " << std::flush;
-    //   for (std::set<size_t>::const_iterator it = T[i].begin();
-    //        it != T[i].end(); ++it)
-    //       std::cerr << *it << " " << std::flush;
-    //   std::cerr << "} " << std::flush;
-    // }
-    // std::cerr << ")" << std::endl;
-#endif
-
-    // Compute removal costs for each edge
-    for (size_t r = 0; r < A.nRows(); ++r)
-    {
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(r).begin(); rowIter != A.row(r).end(); ++rowIter)
-      {
-        if (rowIter->first < r) continue;
-        Edge edge(r, rowIter->first);
-        double cost = _computeEdgeRemovalCost(edge, surface, T);
-        if (cost < simplifyTolerance)
-            Cp[r][rowIter->first] = C.insert(EdgeCostQueueEntry(cost, edge));
-      }
-    }
-
-#ifdef MARCHINGCUBES_DEBUG
-    // std::cerr << "Edge cost queue = " << std::flush;
-    // for (std::map<double,Edge>::const_iterator it = C.begin(); it != C.end();
-    //      ++it)
-    // {
-    //   std::cerr << "(" << it->first << " -> " << it->second.first << ", "
-    //             << it->second.second << ")" << std::flush;
-    // }
-    // std::cerr << std::endl;
-
-    // std::cerr << "Queued edges = " << std::flush;
-    // for (std::map<Edge, std::multimap<double,Edge>::iterator>::const_iterator
-    //          it = Cp.begin(); it != Cp.end(); ++it)
-    // {
-    //   std::cerr << "(" << it->first.first << ", " << it->first.second << ") "
-    //             << std::flush;
-    // }
-    // std::cerr << std::endl;
-
-    // std::cerr << "=====================================" << std::endl;
-#endif
-
-    /*---------------------------------------------------------------------
-     *  Start the simplification
-     *---------------------------------------------------------------------*/ 
-
-#ifdef MARCHINGCUBES_DEBUG
-    int iter = 1;
-#endif
-    while (C.size() != 0)
-    {
-#ifdef MARCHINGCUBES_DEBUG
-      if (iter % 100 == 1)
-      {
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-        std::cerr << "  Mesh simplification iteration " << iter << " ("
-                  << V.size() << " vertices remaining, "
-                  << C.size() << " edges in queue)" << std::endl;
-      }
-      iter++;
-#endif
-
-      // Get edge (r, c) to remove
-      size_t r = C.begin()->second.first;
-      size_t c = C.begin()->second.second;
-
-#ifdef MARCHINGCUBES_DEBUG
-      // std::cerr << "Removing edge (" << r << ", " << c << ")" << std::endl;
-#endif
+    EdgeCollapseSimplifier simplifier(
+        surface, EdgeCollapseSimplifier::SweptVolume);
+    simplifier.simplify(simplifyTolerance, 0);
+  }
 
-      // Remove all edges with distance less than 3 from the removed edge
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(r).begin(); rowIter != A.row(r).end(); ++rowIter)
-      {
-        for (SparseVector<unsigned char>::const_iterator nbRowIter =
-                 A.row(rowIter->first).begin();
-             nbRowIter != A.row(rowIter->first).end(); ++nbRowIter)
-        {
-          Edge e;
-          if (nbRowIter->first <= rowIter->first)
-              e = Edge(nbRowIter->first, rowIter->first);
-          else e = Edge(rowIter->first, nbRowIter->first);
-          EdgeVector::iterator it = Cp[e.first].find(e.second);
-          if (it != Cp[e.first].end())
-          {
-            C.erase(it->second);
-            Cp[e.first].erase(it);
-          }
-        }
-        Edge e;
-        if (rowIter->first <= r) e = Edge(rowIter->first, r);
-        else e = Edge(r, rowIter->first);
-        EdgeVector::iterator it = Cp[e.first].find(e.second);
-        if (it != Cp[e.first].end())
-        {
-          C.erase(it->second);
-          Cp[e.first].erase(it);
-        }        
-      }
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(c).begin(); rowIter != A.row(c).end(); ++rowIter)
-      {
-        for (SparseVector<unsigned char>::const_iterator nbRowIter =
-                 A.row(rowIter->first).begin();
-             nbRowIter != A.row(rowIter->first).end(); ++nbRowIter)
-        {
-          Edge e;
-          if (nbRowIter->first <= rowIter->first)
-              e = Edge(nbRowIter->first, rowIter->first);
-          else e = Edge(rowIter->first, nbRowIter->first);
-          EdgeVector::iterator it = Cp[e.first].find(e.second);
-          if (it != Cp[e.first].end())
-          {
-            C.erase(it->second);
-            Cp[e.first].erase(it);
-          }
-        }
-        Edge e;
-        if (rowIter->first <= c) e = Edge(rowIter->first, c);
-        else e = Edge(c, rowIter->first);
-        EdgeVector::iterator it = Cp[e.first].find(e.second);
-        if (it != Cp[e.first].end())
-        {
-          C.erase(it->second);
-          Cp[e.first].erase(it);
-        }
-      }
+  void MarchingCubes::simplifyMeshQuadric(
+      SurfaceGeometry &surface, double maxError, size_t targetNTriangles)
+  {
+    if (surface.normals().size() != surface.vertices().size())
+        surface.normals().resize(surface.vertices().size());
+    _checkAndFixMesh(surface);
+    if (maxError <= 0.0 && targetNTriangles == 0) return;
 
-      // If last vertex is moved, update corresponding queue entries
-      if (c < V.size() - 1)
-      {
-        for (SparseVector<unsigned char>::const_iterator rowIter =
-                 A.row(A.nRows() - 1).begin();
-             rowIter != A.row(A.nRows() - 1).end(); ++rowIter)
-        {
-          Edge e;
-          e = Edge(rowIter->first, A.nRows() - 1);
-          EdgeVector::iterator it = Cp[e.first].find(e.second);
-          if (it != Cp[e.first].end())
-          {
-            Edge eNew;
-            if (e.first <= c) eNew = Edge(e.first, c);
-            else eNew = Edge(c, e.first);
-            it->second->second = eNew;
-            Cp[eNew.first][eNew.second] = it->second;
-            Cp[e.first].erase(it);
-          }
-        }
-      }
-      
-#ifdef MARCHINGCUBES_DEBUG
-      // std::cerr << "Edge cost queue (after removal) = " << std::flush;
-      // for (std::map<double,Edge>::const_iterator it = C.begin(); it != C.end();
-      //      ++it)
-      // {
-      //   std::cerr << "(" << it->first << " -> " << it->second.first << ", "
-      //             << it->second.second << ")" << std::flush;
-      // }
-      // std::cerr << std::endl;
-      
-      // std::cerr << "Queued edges = " << std::flush;
-      // for (std::map<Edge, std::multimap<double,Edge>::iterator>::const_iterator
-      //          it = Cp.begin(); it != Cp.end(); ++it)
-      // {
-      //   std::cerr << "(" << it->first.first << ", " << it->first.second << ") "
-      //             << std::flush;
-      // }
-      // std::cerr << std::endl;
-#endif
+    EdgeCollapseSimplifier simplifier(
+        surface, EdgeCollapseSimplifier::QuadricError);
+    simplifier.simplify(
+        (maxError > 0.0) ? maxError : std::numeric_limits<double>::infinity(),
+        targetNTriangles);
+  }
 
-      // Update vertex list
-      V[r] = 0.5 * (V[r] + V[c]);
-      if (c < V.size() - 1) V[c] = V[V.size() - 1];
-      V.pop_back();
-      
-#ifdef MARCHINGCUBES_DEBUG
-      // std::cerr << "vertices = " << std::flush;
-      // for (std::vector<SurfaceGeometry::VertexT>::const_iterator
-      //      it = V.begin(); it != V.end(); ++it)
-      //     std::cerr << *it << " " << std::flush;
-      // std::cerr << std::endl;
-#endif
+  void MarchingCubes::_checkAndFixMesh(SurfaceGeometry &surface)
+  {
+    std::vector<SurfaceGeometry::VertexT> &V = surface.vertices();
+    std::vector<SurfaceGeometry::NormalT> &N = surface.normals();
+    std::vector<SurfaceGeometry::IndexT> &I = surface.indices();    
 
-      // In index list replace all occurrences of c by r and all occurrences
-      // of vertices.size() by c, for this check all triangles around those
-      // vertices
-      for (std::set<size_t>::const_iterator itT = T[c].begin();
-           itT != T[c].end(); ++itT)
-      {
+    // Find duplicate vertices, i.e. vertices closer than the tolerance to
+    // a vertex with lower index. The vertices are binned into cells of the
+    // tolerance's size, so only vertices in neighbouring cells need to be
+    // compared.
+    double const tolerance = 1.0e-10;
+    std::vector< blitz::TinyVector<double,3> > cells(V.size());
+    for (size_t i = 0; i < V.size(); ++i)
         for (int d = 0; d < 3; ++d)
-            if (static_cast<size_t>(I[3 * *itT + d]) == c)
-                I[3 * *itT + d] = static_cast<unsigned int>(r);
-      }
-      if (c < V.size())
-      {
-        for (std::set<size_t>::const_iterator itT = T[V.size()].begin();
-             itT != T[V.size()].end(); ++itT)
-        {
-          for (int d = 0; d < 3; ++d)
-              if (static_cast<size_t>(I[3 * *itT + d]) == V.size())
-                  I[3 * *itT + d] = static_cast<unsigned int>(c);
-        }
-      }
-
-#ifdef MARCHINGCUBES_DEBUG
-      // std::cerr << "In the following all occurrences of " << c
-      //           << " should be replaced by " << r
-      //           << " and all occurrences of " << vertices.size()
-      //           << " should be replaced by " << c << std::endl;
-      // std::cerr << "indices = " << std::flush;
-      // for (std::vector<SurfaceGeometry::IndexT>::const_iterator it =
-      //      I.begin(); it != I.end(); ++it)
-      //     std::cerr << *it << " " << std::flush;
-      // std::cerr << std::endl;
-#endif
-
-      // Update adjacency matrix
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(c).begin(); rowIter != A.row(c).end(); ++rowIter)
-      {
-        if (rowIter->first != r)
-        {
-          A(r, rowIter->first) = rowIter->second;
-          A(rowIter->first, r) = rowIter->second;
-        }
-      }
-      A.clearRow(c);
-      A.clearColumn(c);
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(A.nRows() - 1).begin();
-           rowIter != A.row(A.nRows() - 1).end(); ++rowIter)
-      {
-        A(c, rowIter->first) = rowIter->second;
-        A(rowIter->first, c) = rowIter->second;
-      }
-      A.resize(V.size(), V.size());
-
-      // emptyTriangles = intersection of T[r] and T[c]
-      // T[r] = (union of T[r] and T[c]) - emptyTriangles
-      std::vector<size_t> emptyTriangles;
-      for (std::set<size_t>::const_iterator itC = T[c].begin();
-           itC != T[c].end(); ++itC)
-      {
-        std::set<size_t>::iterator itR = T[r].find(*itC);
-        if (itR != T[r].end())
-        {
-          emptyTriangles.push_back(*itR);
-          T[r].erase(itR);
-        }
-        else T[r].insert(*itC);
-      }
-
-      // Move triangle list of last vertex to c
-      if (c < V.size()) T[c] = T.back();
-
-      // Remove triangle list of moved vertex
-      T.pop_back();
-
-      // Remove empty triangles from triangle lists of all vertices adjacent
-      // to 3
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(r).begin(); rowIter != A.row(r).end(); ++rowIter)
-      {
-        for (size_t i = 0; i < emptyTriangles.size(); ++i)
-            T[rowIter->first].erase(emptyTriangles[i]);
-      }
-
-      // Replace indices of empty triangles by indices of last triangles
-      std::set<size_t> verticesForTriangleUpdate;
-      std::map<size_t,size_t> triangleShiftMap;
-      for (size_t i = 0; i < emptyTriangles.size(); ++i)
+            cells[i](d) = std::floor(static_cast<double>(V[i](d)) / tolerance);
+    VertexCellLess cellLess(cells);
+    std::vector<size_t> order(V.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), cellLess);
+    std::vector<size_t> representative(V.size());
+    for (size_t i = 0; i < V.size(); ++i)
+    {
+      representative[i] = i;
+      blitz::TinyVector<double,3> cell;
+      for (cell(0) = cells[i](0) - 1.0; cell(0) <= cells[i](0) + 1.0;
+           cell(0) += 1.0)
       {
-        if (I[3 * emptyTriangles[i]] < I.size() - 3)
+        for (cell(1) = cells[i](1) - 1.0; cell(1) <= cells[i](1) + 1.0;
+             cell(1) += 1.0)
         {
-          triangleShiftMap[(I.size() - 1) / 3] = emptyTriangles[i];
-          I[3 * emptyTriangles[i]] = I[I.size() - 3];
-          verticesForTriangleUpdate.insert(I[3 * emptyTriangles[i]]);
-          I[3 * emptyTriangles[i] + 1] = I[I.size() - 2];
-          verticesForTriangleUpdate.insert(I[3 * emptyTriangles[i] + 1]);
-          I[3 * emptyTriangles[i] + 2] = I[I.size() - 1];
-          verticesForTriangleUpdate.insert(I[3 * emptyTriangles[i] + 2]);
-          for (size_t j = i + 1; j < emptyTriangles.size(); ++j)
+          for (cell(2) = cells[i](2) - 1.0; cell(2) <= cells[i](2) + 1.0;
+               cell(2) += 1.0)
           {
-            if (3 * emptyTriangles[j] == I.size() - 3)
+            // The vertices of a cell are ordered by index
+            for (std::vector<size_t>::const_iterator it = std::lower_bound(
+                     order.begin(), order.end(), cell, cellLess);
+                 it != order.end() && blitz::all(cells[*it] == cell) &&
+                     *it < representative[i]; ++it)
             {
-              emptyTriangles[j] = i;
-              break;
+              if (representative[*it] != *it) continue;
+              double sqrDist = 0.0;
+              for (int d = 0; d < 3; ++d)
+              {
+                double diff = static_cast<double>(V[i](d)) -
+                    static_cast<double>(V[*it](d));
+                sqrDist += diff * diff;
+              }
+              if (sqrDist <= tolerance * tolerance)
+              {
+                representative[i] = *it;
+                break;
+              }
             }
           }
         }
-        I.pop_back();
-        I.pop_back();
-        I.pop_back();
-      }
-
-      // Check whether verticesForTriangleUpdate contains removed indices
-      std::set<size_t> verticesToUpdate;
-      for (std::set<size_t>::const_iterator it =
-               verticesForTriangleUpdate.begin();
-           it != verticesForTriangleUpdate.end(); ++it)
-          if (*it < V.size()) verticesToUpdate.insert(*it);
-
-      // Update triangle lists to reflect new triangle ordering
-      for (std::set<size_t>::const_iterator itV = verticesToUpdate.begin();
-           itV != verticesToUpdate.end(); ++itV)
-      {
-        for (std::map<size_t,size_t>::const_iterator itM =
-                 triangleShiftMap.begin(); itM != triangleShiftMap.end(); ++itM)
-        {
-          std::set<size_t>::iterator itT = T[*itV].find(itM->first);
-          if (itT != T[*itV].end())
-          {
-            T[*itV].erase(itT);
-            T[*itV].insert(itM->second);
-          }
-        }
-      }
-      
-      /*-----------------------------------------------------------------
-       *  Update edge removal cost queue
-       *-----------------------------------------------------------------*/
-      for (SparseVector<unsigned char>::const_iterator rowIter =
-               A.row(r).begin(); rowIter != A.row(r).end(); ++rowIter)
-      {
-        for (SparseVector<unsigned char>::const_iterator nbRowIter =
-                 A.row(rowIter->first).begin();
-             nbRowIter != A.row(rowIter->first).end(); ++nbRowIter)
-        {
-          if (nbRowIter->first < rowIter->first) continue;
-          Edge edge(rowIter->first, nbRowIter->first);
-          double cost = _computeEdgeRemovalCost(edge, surface, T);
-          if (cost < simplifyTolerance)
-              Cp[edge.first][edge.second] =
-                  C.insert(EdgeCostQueueEntry(cost, edge));
-        }
-        if (rowIter->first < r) continue;
-        Edge edge(r, rowIter->first);
-        double cost = _computeEdgeRemovalCost(edge, surface, T);
-        if (cost < simplifyTolerance)
-            Cp[edge.first][edge.second] =
-                C.insert(EdgeCostQueueEntry(cost, edge));
       }
     }
-  }
-
-  double MarchingCubes::_computeEdgeRemovalCost(
-      std::pair<size_t,size_t> const &edge,
-      SurfaceGeometry const &surface,
-      std::vector< std::set<size_t> > const &triangles)
-  { 
-    std::vector<SurfaceGeometry::VertexT> const &V = surface.vertices();
-    std::vector<SurfaceGeometry::IndexT> const &I = surface.indices();    
-
-    SurfaceGeometry::VertexT newVertex =
-        0.5 * (V[edge.first] + V[edge.second]);
-    double errorVolume = 0.0;
-    
-    // Sum up volumes of left end tetrahedrons
-    for (std::set<size_t>::const_iterator trIt =
-             triangles[edge.first].begin();
-         trIt != triangles[edge.first].end(); ++trIt)
-    {
-      // Ignore edge adjacent triangles (They will be added when
-      // computing the volume of the right end tetrahedrons)
-      if (I[3 * *trIt] == edge.second ||
-          I[3 * *trIt + 1] == edge.second ||
-          I[3 * *trIt + 2] == edge.second) continue;
-      blitz::TinyMatrix<double,4,4> tetra;
-      tetra = V[I[3 * *trIt]](0),
-          V[I[3 * *trIt + 1]](0),
-          V[I[3 * *trIt + 2]](0),
-          newVertex(0),
-          V[I[3 * *trIt]](1),
-          V[I[3 * *trIt + 1]](1),
-          V[I[3 * *trIt + 2]](1),
-          newVertex(1),
-          V[I[3 * *trIt]](2),
-          V[I[3 * *trIt + 1]](2),
-          V[I[3 * *trIt + 2]](2),
-          newVertex(2),
-          1.0, 1.0, 1.0, 1.0;
-      errorVolume += std::abs(determinant(tetra));
-    }
-    
-    // Add the volumes of the right end tetrahedrons
-    for (std::set<size_t>::const_iterator trIt =
-             triangles[edge.second].begin();
-         trIt != triangles[edge.second].end(); ++trIt)
-    {
-      blitz::TinyMatrix<double,4,4> tetra;
-      tetra = V[I[3 * *trIt]](0),
-          V[I[3 * *trIt + 1]](0),
-          V[I[3 * *trIt + 2]](0),
-          newVertex(0),
-          V[I[3 * *trIt]](1),
-          V[I[3 * *trIt + 1]](1),
-          V[I[3 * *trIt + 2]](1),
-          newVertex(1),
-          V[I[3 * *trIt]](2),
-          V[I[3 * *trIt + 1]](2),
-          V[I[3 * *trIt + 2]](2),
-          newVertex(2),
-          1.0, 1.0, 1.0, 1.0;
-      errorVolume += std::abs(determinant(tetra));
-    }
-    return errorVolume;
-  }
-
-  void MarchingCubes::_checkAndFixMesh(SurfaceGeometry &surface)
-  {
-    std::vector<SurfaceGeometry::VertexT> &V = surface.vertices();
-    std::vector<SurfaceGeometry::NormalT> &N = surface.normals();
-    std::vector<SurfaceGeometry::IndexT> &I = surface.indices();    
 
-    // Find duplicate vertices
     std::vector<size_t> indexMap(V.size());
     std::vector<SurfaceGeometry::VertexT> oldVertices(V);
     std::vector<SurfaceGeometry::NormalT> oldNormals(N);
@@ -1122,17 +1081,14 @@ namespace atb
     N.clear();
     for (size_t i = 0; i < oldVertices.size(); ++i)
     {
-      size_t j;
-      for (j = 0;
-           j < V.size() &&
-               blitz::dot(oldVertices[i] - V[j], oldVertices[i] - V[j]) >
-               1.0e-20; ++j);
-      if (j == V.size())
+      if (representative[i] != i)
       {
-        V.push_back(oldVertices[i]);
-        if (i < oldNormals.size()) N.push_back(oldNormals[i]);
+        indexMap[i] = indexMap[representative[i]];
+        continue;
       }
-      indexMap[i] = j;
+      indexMap[i] = V.size();
+      V.push_back(oldVertices[i]);
+      if (i < oldNormals.size()) N.push_back(oldNormals[i]);
     }
 
     // Update index list
@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 
 #include "Array.hh"
 #include "SurfaceGeometry.hh"
@@ -83,14 +84,30 @@ namespace atb
     static int edgeTable[256];    
     static int triangleTable[256][16];
 
+    // Cell corner offsets (z, y, x) in the corner order of the tables
+    static int cellCorners[8][3];
+
+    // Corners of each cube edge, the corner closer to the origin first
+    static int edgeCorners[12][2];
+
+    // Position of each cube edge in the edge index caches of a slab:
+    // { plane (0 = lower, 1 = upper, 2 = edges along z), dy, dx, axis
+    // within the plane (0 = y, 1 = x) }
+    static int edgeCacheSlots[12][4];
+
+    // The mesh of a slab of cube layers together with the vertex indices of
+    // the edges in its lower and upper boundary planes used for welding
+    struct SlabMesh
+    {
+      std::vector<SurfaceGeometry::VertexT> vertices;
+      std::vector<SurfaceGeometry::IndexT> indices;
+      std::vector<int> lowerPlane, upperPlane;
+    };
+
     static int computeTrianglesForGridCell(
         GridCell const &gridCell, std::vector<Triangle> &triangles,
         double isoLevel = 0.0);
     
-    static void computeTrianglesForGridCell(
-        GridCell const &gridCell, blitz::TinyVector<int,12> &cellIndices,
-        SurfaceGeometry &surface, double isoLevel = 0.0);
-
     static SurfaceGeometry::VertexT getInterpolatedVertex(
         double isoLevel, SurfaceGeometry::VertexT const &p1,
         SurfaceGeometry::VertexT const &p2, double val1, double val2);
@@ -150,6 +167,31 @@ namespace atb
         SurfaceGeometry &surface, double isoLevel = 0.0,
         double simplifyTolerance = 0.0);
 
+/*======================================================================*/
+/*! 
+ *   Compute one surface mesh per label of the given label Array in one
+ *   pass. The bounding boxes of all labels are gathered in a single scan,
+ *   afterwards the labels are meshed in parallel, each one within its
+ *   bounding box. The surfaces separate the voxels of the label from all
+ *   other voxels (iso level 0.5 of the label indicator function).
+ *
+ *   \param labels The label Array
+ *   \param elementSizeUm The element size in micrometers
+ *   \param surfaces The surfaces of all labels except the background label
+ *     0 are written to this map. Previous content is removed.
+ *   \param simplifyTolerance  If a value greater than 0 is given here
+ *     the meshes will be simplified by merging triangles until a triangle
+ *     merge exceeds the given tolerance which is the volume difference
+ *     before and after the merge
+ */
+/*======================================================================*/
+    template<typename LabelT>
+    static void triangulateLabels(
+        blitz::Array<LabelT,3> const &labels,
+        blitz::TinyVector<double,3> const &elementSizeUm,
+        std::map<LabelT,SurfaceGeometry> &surfaces,
+        double simplifyTolerance = 0.0);
+
 /*======================================================================*/
 /*! 
  *   Simplify the given mesh by merging vertices as long as the given
@@ -165,11 +207,43 @@ namespace atb
     static void simplifyMesh(
         SurfaceGeometry &surface, double simplifyTolerance);
 
+/*======================================================================*/
+/*! 
+ *   Simplify the given mesh by quadric error edge collapses. Every
+ *   collapse moves the two edge vertices to the position minimizing the
+ *   sum of squared distances to the planes of their original triangles.
+ *   Collapses are applied in order of increasing error until either the
+ *   next collapse exceeds the given error or the mesh has no more than the
+ *   requested number of triangles. Collapses that would make the mesh
+ *   non-manifold or flip triangles are skipped, mesh boundaries are
+ *   preserved.
+ *
+ *   \param surface  The SurfaceGeometry to simplify
+ *   \param maxError The maximum sum of squared distances in square
+ *     micrometers a collapse may introduce. If 0 only the triangle count
+ *     limits the simplification.
+ *   \param targetNTriangles The simplification stops when the mesh has this
+ *     many triangles or less
+ */
+/*======================================================================*/
+    static void simplifyMeshQuadric(
+        SurfaceGeometry &surface, double maxError,
+        size_t targetNTriangles = 0);
+
   private:
     
-    static double _computeEdgeRemovalCost(
-        std::pair<size_t,size_t> const &edge, SurfaceGeometry const &surface,
-        std::vector< std::set<size_t> > const &triangles);
+    template<typename DataT>
+    static void _triangulate(
+        blitz::Array<DataT,3> const &data,
+        blitz::TinyVector<double,3> const &elementSizeUm,
+        SurfaceGeometry &surface, double isoLevel, int nSlabs);
+
+    template<typename DataT>
+    static void _triangulateSlab(
+        blitz::Array<DataT,3> const &data,
+        blitz::TinyVector<double,3> const &elementSizeUm, double isoLevel,
+        std::vector<unsigned char> const &activeBlocks, ptrdiff_t zBegin,
+        ptrdiff_t zEnd, SlabMesh &mesh);
 
     static void _checkAndFixMesh(SurfaceGeometry &surface);
 
@@ -0,0 +1,377 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "SegmentStatistics.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace atb
+{
+
+  // Adjacency pairs are deduplicated whenever a thread has collected
+  // this many
+  static const size_t MaxPendingNeighborPairs = 1 << 20;
+
+  // The partial statistics of the slices processed by one thread
+  struct SegmentStatisticsPartial
+  {
+    SegmentStatisticsPartial()
+            : minLabel(std::numeric_limits<int>::max()),
+              maxLabel(std::numeric_limits<int>::min())
+    {}
+
+    void reserve(int label)
+    {
+      if (static_cast<size_t>(label) <= segments.size()) return;
+      size_t size = std::max(static_cast<size_t>(label), 2 * segments.size());
+      segments.resize(size);
+      runs.resize(size);
+    }
+
+    void compactPairs()
+    {
+      std::sort(pairs.begin(), pairs.end());
+      pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    }
+
+    int minLabel, maxLabel;
+    std::vector<SegmentStatistics::Segment> segments;
+    std::vector< std::vector<SegmentStatistics::Run> > runs;
+    std::vector< std::pair<int,int> > pairs;
+  };
+
+  SegmentStatistics::Segment::Segment()
+          : nVoxels(0), nSurfaceVoxels(0), sum(0.0), sqSum(0.0),
+            lowerBound(std::numeric_limits<BlitzIndexT>::max()),
+            upperBound(std::numeric_limits<BlitzIndexT>::min()),
+            touchesBorder(false)
+  {}
+
+  SegmentStatistics::SegmentStatistics()
+          : _minLabel(0), _maxLabel(0)
+  {}
+
+  bool SegmentStatistics::compute(
+      blitz::Array<int,3> const &L, iRoCS::ProgressReporter *pr)
+  {
+    _segments.clear();
+    _neighbors.clear();
+    _runs.clear();
+    _runOffsets.clear();
+    _minLabel = 0;
+    _maxLabel = 0;
+    if (L.size() == 0) return true;
+
+    int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
+    int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
+    if (pr != NULL && !pr->updateProgress(pMin)) return false;
+
+    blitz::TinyVector<BlitzIndexT,3> shape(L.shape());
+    blitz::TinyVector<ptrdiff_t,3> stride(L.stride());
+    int const *data = L.data();
+
+    int nThreads = 1;
+#ifdef _OPENMP
+    nThreads = omp_get_max_threads();
+#endif
+    std::vector<SegmentStatisticsPartial> partials(nThreads);
+    int p = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nThreads)
+#endif
+    {
+      int thread = 0;
+      int nActive = 1;
+#ifdef _OPENMP
+      thread = omp_get_thread_num();
+      nActive = omp_get_num_threads();
+#endif
+      SegmentStatisticsPartial &partial = partials[thread];
+      BlitzIndexT zStart = static_cast<BlitzIndexT>(
+          (static_cast<ptrdiff_t>(shape(0)) * thread) / nActive);
+      BlitzIndexT zEnd = static_cast<BlitzIndexT>(
+          (static_cast<ptrdiff_t>(shape(0)) * (thread + 1)) / nActive);
+
+      for (BlitzIndexT z = zStart; z < zEnd; ++z)
+      {
+        if (pr != NULL)
+        {
+          if (pr->isAborted()) break;
+          pr->updateProgress(
+              pMin + static_cast<int>(
+                  pScale * static_cast<double>(p) /
+                  static_cast<double>(shape(0))));
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+          ++p;
+        }
+        for (BlitzIndexT y = 0; y < shape(1); ++y)
+        {
+          int const *row = data + z * stride(0) + y * stride(1);
+          BlitzIndexT x = 0;
+          while (x < shape(2))
+          {
+            int label = row[x * stride(2)];
+            BlitzIndexT xStart = x;
+            while (x < shape(2) && row[x * stride(2)] == label) ++x;
+            partial.minLabel = std::min(partial.minLabel, label);
+            partial.maxLabel = std::max(partial.maxLabel, label);
+
+            if (label > 0)
+            {
+              partial.reserve(label);
+              Segment &s = partial.segments[label - 1];
+              Run run;
+              run.z = z;
+              run.y = y;
+              run.x = xStart;
+              run.length = x - xStart;
+              partial.runs[label - 1].push_back(run);
+
+              s.nVoxels += run.length;
+              s.lowerBound(0) = std::min(s.lowerBound(0), z);
+              s.lowerBound(1) = std::min(s.lowerBound(1), y);
+              s.lowerBound(2) = std::min(s.lowerBound(2), xStart);
+              s.upperBound(0) = std::max(s.upperBound(0), z);
+              s.upperBound(1) = std::max(s.upperBound(1), y);
+              s.upperBound(2) = std::max(s.upperBound(2), x - 1);
+              if (z == 0 || z == shape(0) - 1 || y == 0 ||
+                  y == shape(1) - 1 || xStart == 0 || x == shape(2))
+                  s.touchesBorder = true;
+
+              for (BlitzIndexT xi = xStart; xi < x; ++xi)
+              {
+                blitz::TinyVector<double,3> pos(z, y, xi);
+                s.sum += pos;
+                s.sqSum(0) += pos(0) * pos(0);
+                s.sqSum(1) += pos(0) * pos(1);
+                s.sqSum(2) += pos(0) * pos(2);
+                s.sqSum(3) += pos(1) * pos(1);
+                s.sqSum(4) += pos(1) * pos(2);
+                s.sqSum(5) += pos(2) * pos(2);
+
+                // Within the run only the ends can have an x-neighbor
+                // outside the segment
+                int const *voxel = row + xi * stride(2);
+                if (xi == xStart || xi == x - 1 ||
+                    z == 0 || voxel[-stride(0)] != label ||
+                    z == shape(0) - 1 || voxel[stride(0)] != label ||
+                    y == 0 || voxel[-stride(1)] != label ||
+                    y == shape(1) - 1 || voxel[stride(1)] != label)
+                    ++s.nSurfaceVoxels;
+              }
+            }
+            else if (label == 0)
+            {
+              // Collect the segments adjacent to the boundary voxels
+              for (BlitzIndexT xi = xStart; xi < x; ++xi)
+              {
+                int nbLabels[26];
+                int nNbLabels = 0;
+                for (BlitzIndexT dz = -1; dz <= 1; ++dz)
+                {
+                  if (z + dz < 0 || z + dz >= shape(0)) continue;
+                  for (BlitzIndexT dy = -1; dy <= 1; ++dy)
+                  {
+                    if (y + dy < 0 || y + dy >= shape(1)) continue;
+                    for (BlitzIndexT dx = -1; dx <= 1; ++dx)
+                    {
+                      if (xi + dx < 0 || xi + dx >= shape(2) ||
+                          (dz == 0 && dy == 0 && dx == 0)) continue;
+                      int nbLabel = data[(z + dz) * stride(0) +
+                                         (y + dy) * stride(1) +
+                                         (xi + dx) * stride(2)];
+                      if (nbLabel <= 0 ||
+                          std::find(nbLabels, nbLabels + nNbLabels,
+                                    nbLabel) != nbLabels + nNbLabels)
+                          continue;
+                      nbLabels[nNbLabels++] = nbLabel;
+                    }
+                  }
+                }
+                for (int i = 0; i < nNbLabels; ++i)
+                    for (int j = 0; j < nNbLabels; ++j)
+                        if (nbLabels[i] < nbLabels[j])
+                            partial.pairs.push_back(
+                                std::make_pair(nbLabels[i], nbLabels[j]));
+                if (partial.pairs.size() > MaxPendingNeighborPairs)
+                    partial.compactPairs();
+              }
+            }
+          }
+        }
+      }
+      partial.compactPairs();
+    }
+    if (pr != NULL && pr->isAborted()) return false;
+
+    // Merge the partial results in slice order
+    _minLabel = std::numeric_limits<int>::max();
+    _maxLabel = 0;
+    for (size_t t = 0; t < partials.size(); ++t)
+    {
+      if (partials[t].minLabel > partials[t].maxLabel) continue;
+      _minLabel = std::min(_minLabel, partials[t].minLabel);
+      _maxLabel = std::max(_maxLabel, partials[t].maxLabel);
+    }
+    _segments.resize(_maxLabel);
+    _runs.resize(_maxLabel);
+    _runOffsets.resize(_maxLabel);
+    _neighbors.resize(_maxLabel);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+    for (int i = 0; i < _maxLabel; ++i)
+    {
+      Segment &s = _segments[i];
+      for (size_t t = 0; t < partials.size(); ++t)
+      {
+        if (static_cast<size_t>(i) >= partials[t].segments.size()) continue;
+        Segment const &ps = partials[t].segments[i];
+        if (ps.nVoxels == 0) continue;
+        s.nVoxels += ps.nVoxels;
+        s.nSurfaceVoxels += ps.nSurfaceVoxels;
+        s.sum += ps.sum;
+        s.sqSum += ps.sqSum;
+        for (int d = 0; d < 3; ++d)
+        {
+          s.lowerBound(d) = std::min(s.lowerBound(d), ps.lowerBound(d));
+          s.upperBound(d) = std::max(s.upperBound(d), ps.upperBound(d));
+        }
+        s.touchesBorder |= ps.touchesBorder;
+        _runs[i].insert(_runs[i].end(), partials[t].runs[i].begin(),
+                        partials[t].runs[i].end());
+        std::vector<Run>().swap(partials[t].runs[i]);
+      }
+      _runOffsets[i].resize(_runs[i].size());
+      ptrdiff_t offset = 0;
+      for (size_t r = 0; r < _runs[i].size(); ++r)
+      {
+        _runOffsets[i][r] = offset;
+        offset += _runs[i][r].length;
+      }
+    }
+
+    std::vector< std::pair<int,int> > pairs;
+    for (size_t t = 0; t < partials.size(); ++t)
+    {
+      pairs.insert(pairs.end(), partials[t].pairs.begin(),
+                   partials[t].pairs.end());
+      std::vector< std::pair<int,int> >().swap(partials[t].pairs);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    // Pairs are sorted, therefore the neighbor lists are sorted as well
+    for (size_t i = 0; i < pairs.size(); ++i)
+    {
+      _neighbors[pairs[i].first - 1].push_back(pairs[i].second);
+      _neighbors[pairs[i].second - 1].push_back(pairs[i].first);
+    }
+
+    if (pr != NULL) pr->updateProgress(pMin + pScale);
+    return true;
+  }
+
+  int SegmentStatistics::minLabel() const
+  {
+    return _minLabel;
+  }
+
+  int SegmentStatistics::maxLabel() const
+  {
+    return _maxLabel;
+  }
+
+  SegmentStatistics::Segment const &SegmentStatistics::segment(
+      int label) const
+  {
+    return _segments[label - 1];
+  }
+
+  blitz::TinyVector<double,3> SegmentStatistics::centerUm(
+      int label, blitz::TinyVector<double,3> const &elementSizeUm) const
+  {
+    Segment const &s = _segments[label - 1];
+    if (s.nVoxels == 0) return blitz::TinyVector<double,3>(0.0);
+    return s.sum * elementSizeUm / static_cast<double>(s.nVoxels);
+  }
+
+  std::vector<int> const &SegmentStatistics::neighbors(int label) const
+  {
+    return _neighbors[label - 1];
+  }
+
+  std::vector<SegmentStatistics::Run> const &SegmentStatistics::runs(
+      int label) const
+  {
+    return _runs[label - 1];
+  }
+
+  blitz::TinyVector<BlitzIndexT,3> SegmentStatistics::voxel(
+      int label, ptrdiff_t index) const
+  {
+    std::vector<ptrdiff_t> const &offsets = _runOffsets[label - 1];
+    size_t r = std::upper_bound(offsets.begin(), offsets.end(), index) -
+        offsets.begin() - 1;
+    Run const &run = _runs[label - 1][r];
+    return blitz::TinyVector<BlitzIndexT,3>(
+        run.z, run.y, run.x + static_cast<BlitzIndexT>(index - offsets[r]));
+  }
+
+  double SegmentStatistics::convexity(
+      blitz::Array<int,3> const &L, int label, int nRandomPairs) const
+  {
+    ptrdiff_t nVoxels = _segments[label - 1].nVoxels;
+    if (nVoxels == 0) return 0.0;
+    if (nVoxels == 1) return 1.0;
+
+    blitz::TinyVector<BlitzIndexT,3> p;
+    ptrdiff_t a = static_cast<ptrdiff_t>(
+        (nVoxels - 1) * static_cast<double>(std::rand()) /
+        static_cast<double>(RAND_MAX));
+    blitz::TinyVector<BlitzIndexT,3> posA(voxel(label, a));
+    int convexCount = 0;
+    for (int i = 0; i < nRandomPairs; i++)
+    {
+      ptrdiff_t b = static_cast<ptrdiff_t>(
+          (nVoxels - 1) * static_cast<double>(std::rand()) /
+          static_cast<double>(RAND_MAX));
+      blitz::TinyVector<BlitzIndexT,3> posB(voxel(label, b));
+      p = (posA + posB) / 2;
+      if (L(p) == label) convexCount++;
+      posA = posB;
+    }
+    return static_cast<double>(convexCount) / static_cast<double>(nRandomPairs);
+  }
+
+}
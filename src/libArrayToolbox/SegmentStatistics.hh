@@ -0,0 +1,251 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*======================================================================*/
+/*!
+ *  \file SegmentStatistics.hh
+ *  \brief Single pass computation of per-segment statistics of a label
+ *    Array.
+ */
+/*======================================================================*/
+
+#ifndef ATBSEGMENTSTATISTICS_HH
+#define ATBSEGMENTSTATISTICS_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <vector>
+
+#include <libProgressReporter/ProgressReporter.hh>
+
+#include "Array.hh"
+
+namespace atb
+{
+
+/*======================================================================*/
+/*!
+ *  \class SegmentStatistics SegmentStatistics.hh "libArrayToolbox/SegmentStatistics.hh"
+ *  \brief The SegmentStatistics class gathers the statistics of all
+ *    segments of a label Array in one parallel scan.
+ *
+ *  Labels are expected to be positive, non-positive voxels are treated as
+ *  segment boundaries. For every label the voxel count, the first and
+ *  second order moments of the voxel positions, the bounding box, the
+ *  number of surface voxels and whether the segment touches the Array
+ *  boundary are recorded. Two segments are neighbors if they both touch a
+ *  common boundary voxel (label 0) in its 26-neighborhood.
+ *
+ *  Instead of voxel lists, each segment is stored as run-length encoding
+ *  of its rows along the last dimension in raster order. This allows
+ *  random access to the voxels of a segment at a fraction of the memory.
+ *
+ *  Every thread accumulates the statistics of a contiguous block of
+ *  slices, the partial results are merged in slice order.
+ */
+/*======================================================================*/
+  class SegmentStatistics
+  {
+
+  public:
+
+/*======================================================================*/
+/*!
+ *   A run of voxels along the last dimension with start position (z,y,x)
+ *   and length.
+ */
+/*======================================================================*/
+    struct Run
+    {
+      BlitzIndexT z, y, x, length;
+    };
+
+/*======================================================================*/
+/*!
+ *   The statistics of a single segment. Positions are given in voxel
+ *   coordinates.
+ */
+/*======================================================================*/
+    struct Segment
+    {
+      Segment();
+
+      /// Number of voxels of the segment
+      ptrdiff_t nVoxels;
+
+      /// Number of segment voxels with a 6-neighbor outside the segment
+      ptrdiff_t nSurfaceVoxels;
+
+      /// Sum of the voxel positions
+      blitz::TinyVector<double,3> sum;
+
+      /// Sum of the outer products of the voxel positions (upper triangle)
+      blitz::TinyVector<double,6> sqSum;
+
+      /// Bounding box of the segment (inclusive bounds)
+      blitz::TinyVector<BlitzIndexT,3> lowerBound, upperBound;
+
+      /// Whether the segment touches the Array boundary
+      bool touchesBorder;
+    };
+
+/*======================================================================*/
+/*!
+ *   Default constructor. Creates empty statistics.
+ */
+/*======================================================================*/
+    SegmentStatistics();
+
+/*======================================================================*/
+/*!
+ *   Compute the statistics of all segments of the given label Array.
+ *   Previous results are discarded.
+ *
+ *   \param L  The label Array
+ *   \param pr If given, progress will be reported to this progress reporter
+ *
+ *   \return false if the computation was aborted via the progress
+ *     reporter, true otherwise
+ */
+/*======================================================================*/
+    bool compute(blitz::Array<int,3> const &L,
+                 iRoCS::ProgressReporter *pr = NULL);
+
+/*======================================================================*/
+/*!
+ *   Get the smallest label value of the last processed Array, including
+ *   non-positive values.
+ *
+ *   \return The smallest label
+ */
+/*======================================================================*/
+    int minLabel() const;
+
+/*======================================================================*/
+/*!
+ *   Get the largest label value of the last processed Array.
+ *
+ *   \return The largest label
+ */
+/*======================================================================*/
+    int maxLabel() const;
+
+/*======================================================================*/
+/*!
+ *   Get the statistics of the segment with given label.
+ *
+ *   \param label The segment label in [1, maxLabel()]
+ *
+ *   \return The segment statistics
+ */
+/*======================================================================*/
+    Segment const &segment(int label) const;
+
+/*======================================================================*/
+/*!
+ *   Get the center of gravity of the segment with given label in
+ *   micrometers.
+ *
+ *   \param label The segment label in [1, maxLabel()]
+ *   \param elementSizeUm The voxel extents in micrometers
+ *
+ *   \return The segment center in micrometers. For empty segments the
+ *     origin is returned.
+ */
+/*======================================================================*/
+    blitz::TinyVector<double,3> centerUm(
+        int label, blitz::TinyVector<double,3> const &elementSizeUm) const;
+
+/*======================================================================*/
+/*!
+ *   Get the labels of all segments neighboring the segment with given
+ *   label.
+ *
+ *   \param label The segment label in [1, maxLabel()]
+ *
+ *   \return The neighbor labels in ascending order
+ */
+/*======================================================================*/
+    std::vector<int> const &neighbors(int label) const;
+
+/*======================================================================*/
+/*!
+ *   Get the run-length encoding of the segment with given label in raster
+ *   order.
+ *
+ *   \param label The segment label in [1, maxLabel()]
+ *
+ *   \return The segment runs
+ */
+/*======================================================================*/
+    std::vector<Run> const &runs(int label) const;
+
+/*======================================================================*/
+/*!
+ *   Get the position of the voxel with given raster order index within
+ *   the segment with given label. This is the voxel that would be at
+ *   position index in an explicit voxel list of the segment.
+ *
+ *   \param label The segment label in [1, maxLabel()]
+ *   \param index The voxel index in [0, segment(label).nVoxels - 1]
+ *
+ *   \return The voxel position
+ */
+/*======================================================================*/
+    blitz::TinyVector<BlitzIndexT,3> voxel(int label, ptrdiff_t index) const;
+
+/*======================================================================*/
+/*!
+ *   Compute a convexity measure for the segment with given label using
+ *   a Montecarlo estimator. Random voxel pairs are drawn from the
+ *   run-length encoding, the measure is the fraction of pairs whose
+ *   connecting line center lies within the segment.
+ *
+ *   \param L The label Array the statistics were computed for
+ *   \param label The segment label in [1, maxLabel()]
+ *   \param nRandomPairs The number of random point pairs to use for the
+ *     convexity test
+ *
+ *   \return Percentage of positive convexity tests
+ */
+/*======================================================================*/
+    double convexity(
+        blitz::Array<int,3> const &L, int label,
+        int nRandomPairs = 100000) const;
+
+  private:
+
+    int _minLabel, _maxLabel;
+    std::vector<Segment> _segments;
+    std::vector< std::vector<int> > _neighbors;
+    std::vector< std::vector<Run> > _runs;
+
+    // Index of the first voxel of each run within its segment
+    std::vector< std::vector<ptrdiff_t> > _runOffsets;
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*======================================================================*/
+/*!
+ *  \file SeparableResampler.hh
+ *  \brief Separable resampling of Arrays to a new element size.
+ */
+/*======================================================================*/
+
+#ifndef ATBSEPARABLERESAMPLER_HH
+#define ATBSEPARABLERESAMPLER_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <libProgressReporter/ProgressReporter.hh>
+
+#include "Array.hh"
+
+namespace atb
+{
+  
+/*======================================================================*/
+/*!
+ *  \class SeparableResampler SeparableResampler.hh "libArrayToolbox/SeparableResampler.hh"
+ *  \brief The SeparableResampler class rescales Arrays one dimension at
+ *    a time using precomputed kernel weights.
+ *
+ *  For every dimension the taps and weights of all output indices are
+ *  computed once. Each output hyperplane orthogonal to the processed
+ *  dimension is then the weighted sum of a few input hyperplanes, which is
+ *  evaluated with contiguous memory access. When down-scaling, the kernel
+ *  is stretched by the inverse scale factor, so that anti-aliasing is part
+ *  of the resampling and no separate smoothing pass is needed. Out-of-Array
+ *  taps repeat the boundary values.
+ *
+ *  The output is written into a single destination Array slab by slab
+ *  along the first dimension. For every slab the input hyperplanes it
+ *  depends on are resampled along the remaining dimensions into a small
+ *  scratch buffer, the down-scaled dimensions first, and then combined
+ *  along the first dimension into the destination. Besides input and
+ *  output only the scratch buffers of one slab are held in memory. The
+ *  input is replaced by the output when all slabs are done, so an aborted
+ *  operation leaves the input unchanged.
+ *
+ *  The output sampling grid is the same as the one of Array::rescale(),
+ *  i.e. output index i corresponds to input position i / scale.
+ */
+/*======================================================================*/
+  template<typename DataT, int Dim>
+  class SeparableResampler
+  {
+
+  public:
+
+/*======================================================================*/
+/*! 
+ *   Constructor.
+ *
+ *   \param kernel The resampling kernel
+ */
+/*======================================================================*/
+    SeparableResampler(ResamplingKernelType kernel = LinearRK);
+
+/*======================================================================*/
+/*! 
+ *   Destructor.
+ */
+/*======================================================================*/
+    ~SeparableResampler();
+
+/*======================================================================*/
+/*! 
+ *   Get the resampling kernel.
+ *
+ *   \return The resampling kernel
+ */
+/*======================================================================*/
+    ResamplingKernelType kernel() const;
+
+/*======================================================================*/
+/*! 
+ *   Set the resampling kernel.
+ *
+ *   \param kernel The new resampling kernel
+ */
+/*======================================================================*/
+    void setKernel(ResamplingKernelType kernel);
+
+/*======================================================================*/
+/*! 
+ *   Rescale the Array so that its element size becomes the given target
+ *   element size. The transformation is not altered.
+ *
+ *   \param data                The Array to rescale
+ *   \param targetElementSizeUm The target voxel extents in micrometers
+ *   \param pr                  If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ */
+/*======================================================================*/
+    void apply(
+        Array<DataT,Dim> &data,
+        blitz::TinyVector<double,Dim> const &targetElementSizeUm,
+        iRoCS::ProgressReporter *pr = NULL) const;
+
+/*======================================================================*/
+/*! 
+ *   Evaluate the given resampling kernel.
+ *
+ *   \param kernel The resampling kernel
+ *   \param x      The (unstretched) kernel argument in pixels
+ *
+ *   \return The kernel value at x
+ */
+/*======================================================================*/
+    static double kernelValue(ResamplingKernelType kernel, double x);
+
+/*======================================================================*/
+/*! 
+ *   Get the support radius of the given resampling kernel.
+ *
+ *   \param kernel The resampling kernel
+ *
+ *   \return The (unstretched) kernel radius in pixels
+ */
+/*======================================================================*/
+    static double kernelRadius(ResamplingKernelType kernel);
+
+  private:
+    
+    void _computeTaps(
+        BlitzIndexT inExtent, BlitzIndexT outExtent, double scale,
+        BlitzIndexT &nTaps, std::vector<BlitzIndexT> &indices,
+        std::vector<double> &weights) const;
+
+    bool _resampleLines(
+        DataT const *src, DataT *dst, BlitzIndexT outer,
+        BlitzIndexT inExtent, BlitzIndexT inner, BlitzIndexT outExtent,
+        BlitzIndexT nTaps, BlitzIndexT const *indices, double const *weights,
+        BlitzIndexT indexOffset, iRoCS::ProgressReporter *pr) const;
+
+    ResamplingKernelType _kernel;
+
+    // The number of output hyperplanes of the first dimension computed per
+    // slab
+    static BlitzIndexT const _slabDepth = 8;
+
+  };
+
+}
+
+#include "SeparableResampler.icc"
+
+#endif
@@ -35,7 +35,9 @@
 #include <config.hh>
 #endif
 
+#include <complex>
 #include <map>
+#include <vector>
 #include <omp.h>
 
 #include <libBlitzHdf5/FileIOWrapper.hh>
@@ -141,6 +143,76 @@ namespace atb
       double *in, BlitzIndexT sz[], BlitzIndexT L, double *out,
       double factor = 1.0);
 
+/*======================================================================*/
+/*! 
+ *   \brief Compute all components of spherical derivative band L from
+ *     band L - 1 in one pass per voxel and emit the band magnitude.
+ *
+ *   Both tensors are stored interleaved per voxel of a block of the given
+ *   shape, i.e. component c of voxel k of the input is in[k * L + c] and
+ *   of the output is out[k * (L + 1) + c]. The m-indices are ordered as
+ *   described for STderivReal().
+ *
+ *   Band L is only computed for the voxels whose distance to the magnitude
+ *   region is at most margin, all other output voxels are left untouched.
+ *   The magnitude region is the box of the shape of the magnitude Array
+ *   starting at voxel (border, border, border) of the block. border -
+ *   margin must be at least 1.
+ *
+ *   \param in        The band L - 1 tensor
+ *   \param out       The band L tensor
+ *   \param blockShape The shape of the block both tensors are defined on
+ *   \param L         The band to compute (L >= 1)
+ *   \param border    The offset of the magnitude region within the block
+ *   \param margin    The distance from the magnitude region up to which
+ *     band L will be computed
+ *   \param magnitude The magnitudes of the band L tensor within the
+ *     magnitude region are written to this Array
+ */
+/*======================================================================*/
+  template<typename ComputeT, typename DataT>
+  void STderivFusedBand(
+      std::complex<ComputeT> const *in, std::complex<ComputeT> *out,
+      blitz::TinyVector<BlitzIndexT,3> const &blockShape, BlitzIndexT L,
+      BlitzIndexT border, BlitzIndexT margin,
+      blitz::Array<DataT,3> &magnitude);
+
+/*======================================================================*/
+/*! 
+ *   \brief Compute spherical tensorial derivative magnitude features
+ *     slab by slab.
+ *
+ *   The volume is processed in slabs along the first (z) dimension. Each
+ *   slab is extended by maxBand + 1 voxels of halo in every direction
+ *   (with repeat boundary treatment at the volume borders) so that the
+ *   results are identical to a computation on the full volume. The slab
+ *   thickness is chosen such that the two temporary tensor blocks
+ *   including their halo fit into the given memory budget. Slabs are at
+ *   least as thick as their halo above and below together, if the budget
+ *   does not allow this it is exceeded with a warning. Only the band
+ *   magnitudes are stored, the tensors themselves are discarded.
+ *
+ *   The tensors are computed with complex<ComputeT> precision, use float
+ *   to halve the memory footprint and bandwidth at the cost of accuracy.
+ *
+ *   \param data    The input Array to compute voxelwise features for
+ *   \param sdFeatures The features sorted by the SDMagFeatureIndex. The
+ *     features for bands 1 to maxBand are (re-)allocated.
+ *   \param sigma   The current feature scale (only for SDMagFeatureIndex)
+ *   \param laplace The number of laplacians that have been applied before
+ *                  (only for SDMagFeatureIndex)
+ *   \param maxBand The maximum expansion band
+ *   \param maxBufferBytes The memory budget for the temporary tensor
+ *     blocks in bytes
+ */
+/*======================================================================*/
+  template<typename ComputeT, typename DataT>
+  void STderivSlabwise(
+      Array<DataT,3> const &data,
+      std::map< SDMagFeatureIndex, Array<DataT,3> > &sdFeatures,
+      double sigma, int laplace, BlitzIndexT maxBand,
+      size_t maxBufferBytes = 1024 * 1024 * 1024);
+
 /*======================================================================*/
 /*! 
  *   \brief Wrapper method for computing spherical tensorial derivative
@@ -188,6 +260,9 @@ namespace atb
  *   This function is used in iRoCS::Features to compute the Schmidt
  *   semi-normalized solid harmonic features.
  *
+ *   The features are computed slab-wise in double precision using
+ *   STderivSlabwise() with the default memory budget.
+ *
  *   \param data    The input Array to compute voxelwise features for
  *   \param out     The features sorted by the SDMagFeatureIndex
  *   \param sigma   The current feature scale (only for SDMagFeatureIndex)
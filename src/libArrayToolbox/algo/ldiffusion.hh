@@ -36,6 +36,9 @@
 
 #include "lParallel.hh"
 
+#include <algorithm>
+#include <vector>
+
 #include <blitz/array.h>
 
 int mindex3(int x, int y, int z, int sizx, int sizy);
@@ -58,6 +61,15 @@ void get1DAOS_blitz(
     double* alpha, double *beta, double *gamma, double* L, double *M,
     double *R);
 
+// Semi-implicit diffusion step along dimension dim. Neighbouring lines are
+// solved simultaneously in the lanes of an interleaved tile, the result is
+// written to (accumulate == false) or added to (accumulate == true) u_new.
+template<typename Type, typename GType>
+void AOS_1D_batched_blitz(
+    const blitz::Array<Type, 3>& u, const blitz::Array<GType, 3>& g,
+    blitz::Array<Type, 3>& u_new, const double delta_t, const int dim,
+    const bool accumulate);
+
 template<typename Type, typename gType>
 void AOS_3D_blitz(
     const blitz::Array<Type, 3>& u, blitz::Array<gType, 3>& g,
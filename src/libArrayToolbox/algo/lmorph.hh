@@ -34,7 +34,11 @@
 #include <config.hh>
 #endif
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <queue>
+#include <vector>
 
 #include <blitz/array.h>
 
@@ -53,15 +57,28 @@ void morphConnectedComponentLabelling(
     blitz::Array<MarkerT,Dim> &marker, blitz::Array<LabelT,Dim> &label,
     int conn);
 
+/*
+ * Both watershed variants flood in order of increasing data value, voxels
+ * of equal value are processed first in, first out. Watershed lines get
+ * label 0.
+ *
+ * With nBlocks > 1 the volume is split into nBlocks slabs along the first
+ * dimension that are flooded in parallel. Every slab sees the seeds up to
+ * haloWidth slices beyond its faces, afterwards regions touching across a
+ * slab face are separated by a watershed line at the higher voxel. The
+ * result may deviate from the sequential flooding close to the slab faces.
+ */
 template<typename VoxelT, typename MarkerT, typename LabelT, int Dim>
 void morphWatershed(
     blitz::Array<VoxelT,Dim> &data, blitz::Array<MarkerT,Dim> &marker,
-    blitz::Array<LabelT,Dim> &label, int conn);
+    blitz::Array<LabelT,Dim> &label, int conn, int nBlocks = 1,
+    int haloWidth = 16);
 
 //with labeled marker
 template<typename VoxelT, typename LabelT, int Dim>
 void morphWatershed(
-    blitz::Array<VoxelT,Dim> &data, blitz::Array<LabelT,Dim> &label, int conn);
+    blitz::Array<VoxelT,Dim> &data, blitz::Array<LabelT,Dim> &label, int conn,
+    int nBlocks = 1, int haloWidth = 16);
 
 /*
  * note that the boundary on the border will be omitted.
@@ -84,6 +101,87 @@ struct orderedPrioritizedNode
   bool operator <(orderedPrioritizedNode const &opN) const;
 };
 
+// Integer data with at most this many distinct levels is flooded using a
+// bucket queue, everything else uses a radix heap
+static const size_t watershedMaxBuckets = 65536;
+
+/*
+ * Hierarchical queue with one first in, first out bucket per level. Levels
+ * must be integral and may not drop below the level popped last.
+ */
+template<typename VoxelT>
+class WatershedBucketQueue
+{
+public:
+  WatershedBucketQueue(VoxelT minLevel, size_t nLevels);
+  void push(ptrdiff_t index, VoxelT level);
+  bool pop(ptrdiff_t &index, VoxelT &level);
+private:
+  VoxelT m_minLevel;
+  std::vector< std::vector<ptrdiff_t> > m_buckets;
+  size_t m_current;
+  size_t m_head;
+};
+
+/*
+ * Monotone radix heap over the order preserving bit patterns of the levels
+ * converted to double. Equal levels are popped in insertion order.
+ */
+template<typename VoxelT>
+class WatershedRadixHeap
+{
+public:
+  WatershedRadixHeap();
+  void push(ptrdiff_t index, VoxelT level);
+  bool pop(ptrdiff_t &index, VoxelT &level);
+private:
+  struct Item
+  {
+    unsigned long long key;
+    ptrdiff_t order;
+    ptrdiff_t index;
+  };
+  static bool orderLess(Item const &a, Item const &b);
+  static unsigned long long key(VoxelT level);
+  static VoxelT level(unsigned long long key);
+  static int bucket(unsigned long long key, unsigned long long last);
+
+  std::vector<Item> m_buckets[65];
+  size_t m_head;
+  unsigned long long m_last;
+  ptrdiff_t m_count;
+};
+
+/*
+ * Watershed flooding of a slab of a 3D volume on linear indices. The slab
+ * is copied into buffers padded by one voxel of label 0 that is marked
+ * processed, so the precomputed neighbor offsets need no border checks.
+ */
+template<typename VoxelT, typename LabelT>
+class WatershedFlooding
+{
+public:
+  explicit WatershedFlooding(int conn);
+  void load(blitz::Array<VoxelT,3> const &data,
+            blitz::Array<LabelT,3> const &label, int zBegin, int zEnd);
+  // raiseToSeedLevel: neighbors of seeds are flooded at least at the level
+  // of the seed
+  void flood(bool raiseToSeedLevel);
+  void store(blitz::Array<LabelT,3> &label, int zBegin, int zEnd) const;
+private:
+  template<typename QueueT>
+  void flood(QueueT &queue, bool raiseToSeedLevel);
+
+  int m_conn;
+  int m_zOffset;
+  blitz::TinyVector<ptrdiff_t,3> m_shape;
+  ptrdiff_t m_offsets[26];
+  VoxelT m_minLevel, m_maxLevel;
+  std::vector<VoxelT> m_level;
+  std::vector<LabelT> m_label;
+  std::vector<unsigned char> m_processed;
+};
+
 static const int moveIn3DNeighbor[26][3] =
 {
     { -1, 0, 0 },
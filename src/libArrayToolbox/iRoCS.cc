@@ -22,6 +22,9 @@
 
 #include "iRoCS.hh"
 
+#include <algorithm>
+#include <limits>
+
 #include "ATBDataSynthesis.hh"
 #include "ATBMorphology.hh"
 #include "SeparableConvolutionFilter.hh"
@@ -29,6 +32,13 @@
 namespace atb
 {
   
+  // Number of entries of the curve length cache. The cache covers the
+  // axis parameter range [uMin - uRange, uMax + uRange].
+  static const int CurveLengthCacheSize = 32768;
+
+  // Number of axis samples per leaf of the bounding sphere hierarchy
+  static const int AxisTreeLeafSize = 16;
+
   IRoCS::IRoCS(iRoCS::ProgressReporter *progressReporter)
           : p_progress(progressReporter), _nLatitudes(100), _nLongitudes(50)
   {
@@ -38,7 +48,7 @@ namespace atb
     _vertices.free();
     _indices.free();
     _normals.free();
-    p_curveLengthCache = new double[32768];
+    p_curveLengthCache = new double[CurveLengthCacheSize];
   }
 
   IRoCS::~IRoCS()
@@ -398,20 +408,7 @@ namespace atb
             "Initializing Curve Integral cache")) return;
     double qcDist = extendedDistance(p_ccm->axis(), _qcPos, _uQC);
     std::cout << "  QC: u = " << _uQC << ", dist = " << qcDist << std::endl;
-    double uMin = p_ccm->axis().knot(0);
-    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
-    double uRange = uMax - uMin;
-    p_curveLengthCache[0] = p_ccm->axis().extendedCurveIntegral(
-        _uQC, uMin - uRange);
-    for (int i = 1; i < 32768; ++i)
-    {
-      double u = static_cast<double>(i) / 32768.0 * 3.0 * uRange +
-          uMin - uRange;
-      double uOld = static_cast<double>(i - 1) / 32768.0 * 3.0 * uRange +
-          uMin - uRange;
-      p_curveLengthCache[i] = p_curveLengthCache[i - 1] +
-          p_ccm->axis().extendedCurveIntegral(uOld, u);
-    }
+    _updateAxisCache();
 
     if (p_progress != NULL && !p_progress->updateProgress(100)) return;
   }
@@ -419,35 +416,30 @@ namespace atb
   blitz::TinyVector<double,3> IRoCS::getCoordinates(
       const blitz::TinyVector<double,3>& pos) const
   {
-    blitz::TinyVector<double,3> res;
-    double uOpt;
-    
-    double uMin = p_ccm->axis().knot(0);
-    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
-    double uRange = uMax - uMin;
+    ptrdiff_t hint = -1;
+    return _coordinates(pos, hint);
+  }
 
-    res(1) = extendedDistance(p_ccm->axis(), pos, uOpt);
-    ptrdiff_t index = static_cast<ptrdiff_t>(
-        (uOpt - uMin + uRange) * 32768.0 / (3.0 * uRange));
-    if (index < 0) index = 0;
-    if (index >= 32768) index = 32767;
-    double uIndex =
-        static_cast<double>(index) / 32768.0 * 3.0 * uRange + uMin - uRange;
-    res(0) = p_curveLengthCache[index] +
-        p_ccm->axis().extendedCurveIntegral(uIndex, uOpt);
-    blitz::TinyVector<double,3> nPos(
-        homogeneousToEuclidean(
-            mvMult(_trafoInv, euclideanToHomogeneous(pos))));
-    blitz::TinyVector<double,3> axisPos(
-        homogeneousToEuclidean(
-            mvMult(_trafoInv, euclideanToHomogeneous(
-                       getAxisPosition(uOpt)))));
-    res(2) = std::atan2(nPos(2) - axisPos(2), nPos(1) - axisPos(1));
-    return res;
+  void IRoCS::getCoordinates(
+      std::vector< blitz::TinyVector<double,3> > const &positionsUm,
+      std::vector< blitz::TinyVector<double,3> > &coordinates) const
+  {
+    coordinates.resize(positionsUm.size());
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      ptrdiff_t hint = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(positionsUm.size());
+           ++i) coordinates[i] = _coordinates(positionsUm[i], hint);
+    }
   }
-  
+
 /*======================================================================*/
-/*! 
+/*!
  *   Get the signed euclidean distance of the given point to the tubular
  *   surface. Negative values indicate, that the point is inside the
  *   tubular structure, positive values mean it is outside.
@@ -462,12 +454,226 @@ namespace atb
       blitz::TinyVector<double,3> const &pos) const
   {
     double uOpt;
-    double distToAxis = extendedDistance(p_ccm->axis(), pos, uOpt);
+    ptrdiff_t hint = -1;
+    double distToAxis = _projectOntoAxis(pos, uOpt, hint);
     return distToAxis - p_ccm->thickness()(
         uOpt, p_ccm->axis().knot(0), p_ccm->axis().knot(
             p_ccm->axis().nKnots() - 1));
   }
-  
+
+  void IRoCS::_updateAxisCache()
+  {
+    double uMin = p_ccm->axis().knot(0);
+    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
+    double uRange = uMax - uMin;
+    p_curveLengthCache[0] = p_ccm->axis().extendedCurveIntegral(
+        _uQC, uMin - uRange);
+    for (int i = 1; i < CurveLengthCacheSize; ++i)
+    {
+      double u = static_cast<double>(i) / CurveLengthCacheSize * 3.0 *
+          uRange + uMin - uRange;
+      double uOld = static_cast<double>(i - 1) / CurveLengthCacheSize *
+          3.0 * uRange + uMin - uRange;
+      p_curveLengthCache[i] = p_curveLengthCache[i - 1] +
+          p_ccm->axis().extendedCurveIntegral(uOld, u);
+    }
+
+    // Sample the axis with the linear extension of extendedDistance()
+    _axisSamples.resize(CurveLengthCacheSize);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < CurveLengthCacheSize; ++i)
+        _axisSamples[i] = p_ccm->axis()(
+            static_cast<double>(i) / CurveLengthCacheSize * 3.0 * uRange +
+            uMin - uRange, 0.0, 1.0);
+
+    // Build the bounding sphere hierarchy bottom up. It is stored as
+    // implicit binary tree with root 1 and children 2k, 2k + 1 of node k.
+    int nLeaves = CurveLengthCacheSize / AxisTreeLeafSize;
+    _axisTreeCenters.resize(2 * nLeaves);
+    _axisTreeRadii.resize(2 * nLeaves);
+    for (int k = 2 * nLeaves - 1; k > 0; --k)
+    {
+      int depth = 0;
+      while ((k >> (depth + 1)) > 0) ++depth;
+      int nSamples = CurveLengthCacheSize >> depth;
+      int first = (k - (1 << depth)) * nSamples;
+      blitz::TinyVector<double,3> lb(_axisSamples[first]);
+      blitz::TinyVector<double,3> ub(_axisSamples[first]);
+      for (int i = first + 1; i < first + nSamples; ++i)
+      {
+        for (int d = 0; d < 3; ++d)
+        {
+          lb(d) = std::min(lb(d), _axisSamples[i](d));
+          ub(d) = std::max(ub(d), _axisSamples[i](d));
+        }
+      }
+      _axisTreeCenters[k] = 0.5 * (lb + ub);
+      double sqRadius = 0.0;
+      for (int i = first; i < first + nSamples; ++i)
+      {
+        blitz::TinyVector<double,3> d(_axisSamples[i] - _axisTreeCenters[k]);
+        sqRadius = std::max(sqRadius, blitz::dot(d, d));
+      }
+      _axisTreeRadii[k] = std::sqrt(sqRadius);
+    }
+  }
+
+  ptrdiff_t IRoCS::_closestAxisSample(
+      blitz::TinyVector<double,3> const &pos, ptrdiff_t hint) const
+  {
+    int nLeaves = CurveLengthCacheSize / AxisTreeLeafSize;
+
+    // The hint gives an upper bound that prunes most of the hierarchy
+    ptrdiff_t best = (hint >= 0 && hint < CurveLengthCacheSize) ? hint : 0;
+    blitz::TinyVector<double,3> d(_axisSamples[best] - pos);
+    double sqMinDist = blitz::dot(d, d);
+
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 1;
+    while (stackSize > 0)
+    {
+      int k = stack[--stackSize];
+      d = _axisTreeCenters[k] - pos;
+      double lowerBound = std::sqrt(blitz::dot(d, d)) - _axisTreeRadii[k];
+      if (lowerBound > 0.0 && lowerBound * lowerBound >= sqMinDist) continue;
+      if (k >= nLeaves)
+      {
+        int first = (k - nLeaves) * AxisTreeLeafSize;
+        for (int i = first; i < first + AxisTreeLeafSize; ++i)
+        {
+          d = _axisSamples[i] - pos;
+          double sqDist = blitz::dot(d, d);
+          if (sqDist < sqMinDist)
+          {
+            sqMinDist = sqDist;
+            best = i;
+          }
+        }
+        continue;
+      }
+
+      // Push the farther child first to visit the nearer one first
+      d = _axisTreeCenters[2 * k] - pos;
+      double sqDistLeft = blitz::dot(d, d);
+      d = _axisTreeCenters[2 * k + 1] - pos;
+      double sqDistRight = blitz::dot(d, d);
+      if (sqDistLeft < sqDistRight)
+      {
+        stack[stackSize++] = 2 * k + 1;
+        stack[stackSize++] = 2 * k;
+      }
+      else
+      {
+        stack[stackSize++] = 2 * k;
+        stack[stackSize++] = 2 * k + 1;
+      }
+    }
+    return best;
+  }
+
+  double IRoCS::_projectOntoAxis(
+      blitz::TinyVector<double,3> const &pos, double &u,
+      ptrdiff_t &hint) const
+  {
+    double uMin = p_ccm->axis().knot(0);
+    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
+    double uRange = uMax - uMin;
+    double uStep = 3.0 * uRange / CurveLengthCacheSize;
+
+    hint = _closestAxisSample(pos, hint);
+    u = static_cast<double>(hint) * uStep + uMin - uRange;
+    blitz::TinyVector<double,3> d(_axisSamples[hint] - pos);
+    double sqMinDist = blitz::dot(d, d);
+
+    // Newton iterations on the derivative of the squared distance,
+    // restricted to the interval between the neighboring samples. Beyond
+    // the outermost samples the axis is a straight line.
+    double uLow = (hint > 0) ?
+        u - uStep : -std::numeric_limits<double>::infinity();
+    double uHigh = (hint < CurveLengthCacheSize - 1) ?
+        u + uStep : std::numeric_limits<double>::infinity();
+    double uCurrent = u;
+    for (int iter = 0; iter < 10; ++iter)
+    {
+      blitz::TinyVector<double,3> diff(
+          p_ccm->axis()(uCurrent, 0.0, 1.0) - pos);
+      blitz::TinyVector<double,3> d1(
+          p_ccm->axis().extendedDerivative(uCurrent, 1, 0.0, 1.0));
+      blitz::TinyVector<double,3> d2(0.0);
+      if (uCurrent > 0.0 && uCurrent < 1.0)
+          d2 = p_ccm->axis().derivative(uCurrent, 2);
+      double f = blitz::dot(diff, d1);
+      double df = blitz::dot(d1, d1) + blitz::dot(diff, d2);
+      if (df <= 0.0) break;
+      double uNext = std::min(uHigh, std::max(uLow, uCurrent - f / df));
+      if (std::abs(uNext - uCurrent) < 1e-12) break;
+      uCurrent = uNext;
+    }
+    d = p_ccm->axis()(uCurrent, 0.0, 1.0) - pos;
+    double sqDist = blitz::dot(d, d);
+    if (sqDist < sqMinDist)
+    {
+      sqMinDist = sqDist;
+      u = uCurrent;
+    }
+    return std::sqrt(sqMinDist);
+  }
+
+  double IRoCS::_curveLengthUm(double u) const
+  {
+    double uMin = p_ccm->axis().knot(0);
+    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
+    double uRange = uMax - uMin;
+    double t = (u - uMin + uRange) * CurveLengthCacheSize / (3.0 * uRange);
+    ptrdiff_t index = static_cast<ptrdiff_t>(std::floor(t));
+    if (index < 0) index = 0;
+    if (index > CurveLengthCacheSize - 2) index = CurveLengthCacheSize - 2;
+
+    // The table is piecewise linear in u, beyond its ends the extended
+    // axis is a straight line
+    return p_curveLengthCache[index] + (t - index) *
+        (p_curveLengthCache[index + 1] - p_curveLengthCache[index]);
+  }
+
+  double IRoCS::_curveLengthToU(double lengthUm) const
+  {
+    double uMin = p_ccm->axis().knot(0);
+    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
+    double uRange = uMax - uMin;
+    double *end = p_curveLengthCache + CurveLengthCacheSize;
+    ptrdiff_t index = std::upper_bound(
+        p_curveLengthCache, end, lengthUm) - p_curveLengthCache - 1;
+    if (index < 0) index = 0;
+    if (index > CurveLengthCacheSize - 2) index = CurveLengthCacheSize - 2;
+    double segmentLength =
+        p_curveLengthCache[index + 1] - p_curveLengthCache[index];
+    double t = static_cast<double>(index);
+    if (segmentLength > 0.0)
+        t += (lengthUm - p_curveLengthCache[index]) / segmentLength;
+    return t / CurveLengthCacheSize * 3.0 * uRange + uMin - uRange;
+  }
+
+  blitz::TinyVector<double,3> IRoCS::_coordinates(
+      blitz::TinyVector<double,3> const &pos, ptrdiff_t &hint) const
+  {
+    blitz::TinyVector<double,3> res;
+    double uOpt;
+    res(1) = _projectOntoAxis(pos, uOpt, hint);
+    res(0) = _curveLengthUm(uOpt);
+    blitz::TinyVector<double,3> nPos(
+        homogeneousToEuclidean(
+            mvMult(_trafoInv, euclideanToHomogeneous(pos))));
+    blitz::TinyVector<double,3> axisPos(
+        homogeneousToEuclidean(
+            mvMult(_trafoInv, euclideanToHomogeneous(
+                       getAxisPosition(uOpt)))));
+    res(2) = std::atan2(nPos(2) - axisPos(2), nPos(1) - axisPos(1));
+    return res;
+  }
+
   blitz::TinyVector<double,3> IRoCS::getAxisPosition(
       double u) const
   {
@@ -658,20 +864,7 @@ namespace atb
     inFile.readAttribute(_qcPos, "qcPositionUm", groupName);
 
     extendedDistance(p_ccm->axis(), _qcPos, _uQC);
-    double uMin = p_ccm->axis().knot(0);
-    double uMax = p_ccm->axis().knot(p_ccm->axis().nKnots() - 1);
-    double uRange = uMax - uMin;
-    p_curveLengthCache[0] = p_ccm->axis().extendedCurveIntegral(
-        _uQC, uMin - uRange);
-    for (int i = 1; i < 32768; ++i)
-    {
-      double u = static_cast<double>(i) / 32768.0 * 3.0 * uRange +
-          uMin - uRange;
-      double uOld = static_cast<double>(i - 1) / 32768.0 * 3.0 * uRange +
-          uMin - uRange;
-      p_curveLengthCache[i] = p_curveLengthCache[i - 1] +
-          p_ccm->axis().extendedCurveIntegral(uOld, u);
-    }
+    _updateAxisCache();
 
     inFile.readAttribute(_kappa, "kappa", groupName);
     inFile.readAttribute(_lambda, "lambda", groupName);
@@ -306,6 +306,23 @@ namespace atb
     blitz::TinyVector<double,3> getCoordinates(
         blitz::TinyVector<double,3> const &pos) const;
 
+/*======================================================================*/
+/*! 
+ *   Get the iRoCS positions for all given image positions in micrometers.
+ *   The positions are processed in parallel. Consecutive positions that
+ *   are close to each other are transformed fastest, because each
+ *   projection onto the axis is warm-started from the previous one.
+ *
+ *   \param positionsUm The image positions (z,y,x) in micrometers to
+ *     transform into iRoCS coordinates
+ *   \param coordinates The iRoCS coordinate vectors (z,r,phi) corresponding
+ *     to the given Euclidean image positions are written to this vector
+ */
+/*======================================================================*/
+    void getCoordinates(
+        std::vector< blitz::TinyVector<double,3> > const &positionsUm,
+        std::vector< blitz::TinyVector<double,3> > &coordinates) const;
+
 /*======================================================================*/
 /*! 
  *   Get the signed euclidean distance of the given point to the tubular
@@ -388,6 +405,17 @@ namespace atb
     void computeTransformation();
 
     void fitEpidermalQuadricRANSAC();
+
+    void _updateAxisCache();
+    ptrdiff_t _closestAxisSample(
+        blitz::TinyVector<double,3> const &pos, ptrdiff_t hint) const;
+    double _projectOntoAxis(
+        blitz::TinyVector<double,3> const &pos, double &u,
+        ptrdiff_t &hint) const;
+    double _curveLengthUm(double u) const;
+    double _curveLengthToU(double lengthUm) const;
+    blitz::TinyVector<double,3> _coordinates(
+        blitz::TinyVector<double,3> const &pos, ptrdiff_t &hint) const;
     
     iRoCS::ProgressReporter* p_progress;
 
@@ -406,6 +434,13 @@ namespace atb
 
     double* p_curveLengthCache;
 
+    // The (linearly extended) axis sampled at the curve length cache
+    // positions and a bounding sphere hierarchy over these samples for
+    // closest sample queries
+    std::vector< blitz::TinyVector<double,3> > _axisSamples;
+    std::vector< blitz::TinyVector<double,3> > _axisTreeCenters;
+    std::vector<double> _axisTreeRadii;
+
   };
 
 }
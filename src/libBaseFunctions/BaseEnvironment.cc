@@ -212,3 +212,24 @@ std::string BaseEnvironment::HostName() {
   //}
   return hostName;
 }
+
+size_t BaseEnvironment::ParseMemorySize(std::string const &value) {
+  if (value.empty()) return 0;
+  if (value.find_last_of("0123456789") == value.size() - 1)
+      return static_cast<size_t>(atoi(value.c_str()));
+  size_t mem = static_cast<size_t>(
+      atoi(value.substr(0, value.size() - 1).c_str()));
+  switch(value[value.size() - 1]) {
+  case 'k' :
+  case 'K' :
+    return mem * 1024;
+  case 'm' :
+  case 'M' :
+    return mem * 1024 * 1024;
+  case 'g' :
+  case 'G' :
+    return mem * 1024 * 1024 * 1024;
+  default :
+    return mem;
+  }
+}
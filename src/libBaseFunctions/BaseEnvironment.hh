@@ -30,6 +30,7 @@
 #include <config.hh>
 #endif
 
+#include <cstddef>
 #include <string>
 
 #ifdef _WIN32
@@ -80,6 +81,17 @@ public:
    */
   static std::string HostName();
 
+  /**
+   * ParseMemorySize converts a memory size given as number of bytes
+   * with optional unit suffix k/K, m/M or g/G (powers of 1024) as
+   * accepted by the memoryLimit options of the iRoCS tools.
+   *
+   * @param value the memory size string, e.g. "512M"
+   *
+   * @return size_t the memory size in bytes
+   */
+  static size_t ParseMemorySize(std::string const &value);
+
 };
 
 #endif
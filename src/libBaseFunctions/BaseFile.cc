@@ -131,6 +131,12 @@ bool BaseFile::IsDirectory(std::string const &aPathName) {
 #endif
 }
 
+time_t BaseFile::ModificationTime(std::string const &aPathName) {
+  struct stat st;
+  if (stat(aPathName.c_str(), &st) != 0) return static_cast<time_t>(-1);
+  return st.st_mtime;
+}
+
 bool BaseFile::DirectoryCreate(std::string const &aPathName) {
   const std::string vBeautifyPathName = BaseFile::BeautifyFilePath(aPathName);
 
@@ -30,6 +30,7 @@
 #include <config.hh>
 #endif
 
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -118,6 +119,16 @@ public:
    */
   static bool IsDirectory(const std::string& aPathName);
 
+  /**
+   * ModificationTime returns the time of the last modification of
+   * a file system entry.
+   *
+   * @param aPathName the path to the file/directory to check
+   * @return time_t the modification time in seconds since the epoch,
+   *         or -1 if the entry does not exist.
+   */
+  static time_t ModificationTime(const std::string& aPathName);
+
   /**
    * DirectoryCreate cretaes a directory at the specified path. If
    * the directory already exists, nothing is done.
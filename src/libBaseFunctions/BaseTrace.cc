@@ -0,0 +1,372 @@
+/**************************************************************************
+ *
+ * This file is part of the XuV Tools suite. see http://www.xuvtools.org
+ * for more information
+ *
+ * Copyright (C) 2015 Mario Emmenlauer
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "BaseTrace.hh"
+
+ // standard libraries
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace {
+
+struct BaseTraceEvent {
+  const char* mName;
+  bool mIsTypeName;
+  long long mBegin;
+  long long mEnd;
+  int mDepth;
+};
+
+struct BaseTraceBuffer {
+  int mThreadId;
+  std::vector<BaseTraceEvent> mEvents;
+  size_t mNext;
+  size_t mSize;
+  unsigned long long mDropped;
+  // The regions currently open in the owning thread. Their mEnd is unused.
+  std::vector<BaseTraceEvent> mOpen;
+};
+
+// Aggregated statistics of one region path in the summary
+struct BaseTraceStats {
+  BaseTraceStats() : mCalls(0), mTotal(0), mSelf(0), mMax(0) {}
+  unsigned long long mCalls;
+  long long mTotal;
+  long long mSelf;
+  long long mMax;
+  std::set<int> mThreads;
+};
+
+size_t sBufferCapacity = 65536;
+
+// All buffers ever registered, indexed by thread id. Buffers are never
+// freed because the threads keep pointers to them.
+std::vector<BaseTraceBuffer*> sBuffers;
+
+// The buffer of the calling thread. Without OpenMP only single threaded
+// programs can be traced.
+BaseTraceBuffer* pThreadBuffer = NULL;
+#ifdef _OPENMP
+#pragma omp threadprivate(pThreadBuffer)
+#endif
+
+long long NowMicroseconds() {
+#ifdef _WIN32
+  LARGE_INTEGER vFrequency, vCounter;
+  QueryPerformanceFrequency(&vFrequency);
+  QueryPerformanceCounter(&vCounter);
+  return static_cast<long long>(
+      static_cast<double>(vCounter.QuadPart) * 1.0e6 /
+      static_cast<double>(vFrequency.QuadPart));
+#else
+  struct timeval vTime;
+  gettimeofday(&vTime, NULL);
+  return static_cast<long long>(vTime.tv_sec) * 1000000 + vTime.tv_usec;
+#endif
+}
+
+// Timestamps are given relative to the first time tracing was enabled
+long long sEpoch = 0;
+
+void ResetBuffer(BaseTraceBuffer* aBuffer) {
+  aBuffer->mEvents.resize(sBufferCapacity);
+  aBuffer->mNext = 0;
+  aBuffer->mSize = 0;
+  aBuffer->mDropped = 0;
+}
+
+BaseTraceBuffer* ThreadBuffer() {
+  if (pThreadBuffer == NULL) {
+    BaseTraceBuffer* vBuffer = new BaseTraceBuffer();
+    ResetBuffer(vBuffer);
+#ifdef _OPENMP
+#pragma omp critical (BaseTrace)
+#endif
+    {
+      vBuffer->mThreadId = static_cast<int>(sBuffers.size());
+      sBuffers.push_back(vBuffer);
+    }
+    pThreadBuffer = vBuffer;
+  }
+  return pThreadBuffer;
+}
+
+std::string RegionName(const BaseTraceEvent& aEvent) {
+  if (aEvent.mName == NULL) return "(unknown)";
+#ifdef __GNUG__
+  if (aEvent.mIsTypeName) {
+    int vStatus = 0;
+    char* vDemangled = abi::__cxa_demangle(aEvent.mName, NULL, NULL, &vStatus);
+    if (vStatus == 0 && vDemangled != NULL) {
+      std::string vName(vDemangled);
+      std::free(vDemangled);
+      return vName;
+    }
+  }
+#endif
+  return aEvent.mName;
+}
+
+// The recorded events of a buffer in the order they were completed
+std::vector<BaseTraceEvent> RecordedEvents(const BaseTraceBuffer* aBuffer) {
+  std::vector<BaseTraceEvent> vEvents;
+  vEvents.reserve(aBuffer->mSize);
+  size_t vCapacity = aBuffer->mEvents.size();
+  size_t vFirst = (aBuffer->mNext + vCapacity - aBuffer->mSize) % vCapacity;
+  for (size_t i = 0; i < aBuffer->mSize; ++i)
+    vEvents.push_back(aBuffer->mEvents[(vFirst + i) % vCapacity]);
+  return vEvents;
+}
+
+bool BeginsEarlier(const BaseTraceEvent& aLhs, const BaseTraceEvent& aRhs) {
+  if (aLhs.mBegin != aRhs.mBegin) return aLhs.mBegin < aRhs.mBegin;
+  return aLhs.mDepth < aRhs.mDepth;
+}
+
+std::string JsonEscape(const std::string& aString) {
+  std::ostringstream vOut;
+  for (size_t i = 0; i < aString.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(aString[i]);
+    if (c == '"' || c == '\\') vOut << '\\' << aString[i];
+    else if (c < 0x20) {
+      vOut << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+           << static_cast<int>(c) << std::dec << std::setfill(' ');
+    }
+    else vOut << aString[i];
+  }
+  return vOut.str();
+}
+
+}
+
+bool BaseTrace::sEnabled = false;
+
+void BaseTrace::Enable(bool aEnabled) {
+  if (aEnabled && sEpoch == 0) sEpoch = NowMicroseconds();
+  sEnabled = aEnabled;
+}
+
+void BaseTrace::SetBufferCapacity(size_t aCapacity) {
+  sBufferCapacity = (aCapacity > 0) ? aCapacity : 1;
+}
+
+size_t BaseTrace::BufferCapacity() {
+  return sBufferCapacity;
+}
+
+void BaseTrace::BeginRegion(const char* aName) {
+  BeginRegion(aName, false);
+}
+
+void BaseTrace::BeginRegion(const std::type_info& aType) {
+  BeginRegion(aType.name(), true);
+}
+
+void BaseTrace::BeginRegion(const char* aName, bool aIsTypeName) {
+  BaseTraceBuffer* vBuffer = ThreadBuffer();
+  BaseTraceEvent vEvent;
+  vEvent.mName = aName;
+  vEvent.mIsTypeName = aIsTypeName;
+  vEvent.mDepth = static_cast<int>(vBuffer->mOpen.size());
+  vEvent.mEnd = 0;
+  vEvent.mBegin = NowMicroseconds() - sEpoch;
+  vBuffer->mOpen.push_back(vEvent);
+}
+
+void BaseTrace::EndRegion() {
+  long long vEnd = NowMicroseconds() - sEpoch;
+  BaseTraceBuffer* vBuffer = ThreadBuffer();
+  if (vBuffer->mOpen.empty()) return;
+  BaseTraceEvent vEvent = vBuffer->mOpen.back();
+  vBuffer->mOpen.pop_back();
+  vEvent.mEnd = vEnd;
+  vBuffer->mEvents[vBuffer->mNext] = vEvent;
+  vBuffer->mNext = (vBuffer->mNext + 1) % vBuffer->mEvents.size();
+  if (vBuffer->mSize < vBuffer->mEvents.size()) ++vBuffer->mSize;
+  else ++vBuffer->mDropped;
+}
+
+void BaseTrace::Clear() {
+#ifdef _OPENMP
+#pragma omp critical (BaseTrace)
+#endif
+  {
+    for (size_t i = 0; i < sBuffers.size(); ++i) ResetBuffer(sBuffers[i]);
+  }
+}
+
+void BaseTrace::WriteSummary(std::ostream& aStream) {
+  std::map<std::vector<std::string>,BaseTraceStats> vStats;
+  unsigned long long vDropped = 0;
+#ifdef _OPENMP
+#pragma omp critical (BaseTrace)
+#endif
+  {
+    for (size_t b = 0; b < sBuffers.size(); ++b) {
+      const BaseTraceBuffer* vBuffer = sBuffers[b];
+      vDropped += vBuffer->mDropped;
+      std::vector<BaseTraceEvent> vEvents(RecordedEvents(vBuffer));
+      std::stable_sort(vEvents.begin(), vEvents.end(), BeginsEarlier);
+
+      // Rebuild the nesting from begin order and depth. vStack[d] is the
+      // enclosing region at depth d. Parents that were not recorded, e.g.
+      // because they are still open, are marked with npos and named after
+      // the open stack.
+      const size_t npos = static_cast<size_t>(-1);
+      std::vector<std::vector<std::string> > vPaths(vEvents.size());
+      std::vector<long long> vChildTime(vEvents.size(), 0);
+      std::vector<size_t> vStack;
+      for (size_t i = 0; i < vEvents.size(); ++i) {
+        size_t vDepth = static_cast<size_t>(vEvents[i].mDepth);
+        while (!vStack.empty() &&
+               (vStack.size() > vDepth ||
+                (vStack.back() != npos &&
+                 vEvents[vStack.back()].mEnd < vEvents[i].mBegin)))
+          vStack.pop_back();
+        while (vStack.size() < vDepth) vStack.push_back(npos);
+        std::vector<std::string> vPath;
+        for (size_t d = 0; d < vDepth; ++d) {
+          if (vStack[d] != npos) vPath.push_back(RegionName(vEvents[vStack[d]]));
+          else if (d < vBuffer->mOpen.size())
+              vPath.push_back(RegionName(vBuffer->mOpen[d]));
+          else vPath.push_back("(unknown)");
+        }
+        vPath.push_back(RegionName(vEvents[i]));
+        vPaths[i] = vPath;
+        if (vDepth > 0 && vStack[vDepth - 1] != npos)
+          vChildTime[vStack[vDepth - 1]] += vEvents[i].mEnd - vEvents[i].mBegin;
+        vStack.push_back(i);
+      }
+
+      for (size_t i = 0; i < vEvents.size(); ++i) {
+        long long vDuration = vEvents[i].mEnd - vEvents[i].mBegin;
+        BaseTraceStats& vEntry = vStats[vPaths[i]];
+        ++vEntry.mCalls;
+        vEntry.mTotal += vDuration;
+        vEntry.mSelf += vDuration - vChildTime[i];
+        vEntry.mMax = std::max(vEntry.mMax, vDuration);
+        vEntry.mThreads.insert(vBuffer->mThreadId);
+      }
+    }
+  }
+
+  // Regions without recorded calls get a row to keep the tree readable
+  std::vector<std::vector<std::string> > vPaths;
+  for (std::map<std::vector<std::string>,BaseTraceStats>::const_iterator
+           it = vStats.begin(); it != vStats.end(); ++it)
+    vPaths.push_back(it->first);
+  for (size_t i = 0; i < vPaths.size(); ++i)
+    for (size_t d = 1; d < vPaths[i].size(); ++d)
+      vStats[std::vector<std::string>(vPaths[i].begin(), vPaths[i].begin() + d)];
+
+  size_t vNameWidth = 6;
+  for (std::map<std::vector<std::string>,BaseTraceStats>::const_iterator
+           it = vStats.begin(); it != vStats.end(); ++it)
+    vNameWidth = std::max(
+        vNameWidth, 2 * (it->first.size() - 1) + it->first.back().size());
+
+  std::ios_base::fmtflags vFlags = aStream.flags();
+  std::streamsize vPrecision = aStream.precision();
+  aStream << std::left << std::setw(static_cast<int>(vNameWidth)) << "Region"
+          << std::right
+          << std::setw(10) << "Calls"
+          << std::setw(14) << "Total [ms]"
+          << std::setw(14) << "Self [ms]"
+          << std::setw(14) << "Mean [ms]"
+          << std::setw(14) << "Max [ms]"
+          << std::setw(9) << "Threads" << "\n";
+  aStream << std::fixed << std::setprecision(3);
+  for (std::map<std::vector<std::string>,BaseTraceStats>::const_iterator
+           it = vStats.begin(); it != vStats.end(); ++it) {
+    const BaseTraceStats& vEntry = it->second;
+    std::string vName =
+        std::string(2 * (it->first.size() - 1), ' ') + it->first.back();
+    if (vEntry.mCalls == 0) {
+      aStream << vName << "\n";
+      continue;
+    }
+    aStream << std::left << std::setw(static_cast<int>(vNameWidth)) << vName
+            << std::right
+            << std::setw(10) << vEntry.mCalls
+            << std::setw(14) << 1.0e-3 * vEntry.mTotal
+            << std::setw(14) << 1.0e-3 * vEntry.mSelf
+            << std::setw(14)
+            << 1.0e-3 * vEntry.mTotal / static_cast<double>(vEntry.mCalls)
+            << std::setw(14) << 1.0e-3 * vEntry.mMax
+            << std::setw(9) << vEntry.mThreads.size() << "\n";
+  }
+  if (vDropped > 0)
+    aStream << vDropped << " regions were dropped because the trace buffers "
+            << "were full, increase the buffer capacity to keep them\n";
+  aStream.flags(vFlags);
+  aStream.precision(vPrecision);
+  aStream << std::flush;
+}
+
+void BaseTrace::WriteChromeTrace(std::ostream& aStream) {
+  aStream << "{\"traceEvents\":[";
+  bool vFirst = true;
+#ifdef _OPENMP
+#pragma omp critical (BaseTrace)
+#endif
+  {
+    for (size_t b = 0; b < sBuffers.size(); ++b) {
+      std::vector<BaseTraceEvent> vEvents(RecordedEvents(sBuffers[b]));
+      for (size_t i = 0; i < vEvents.size(); ++i) {
+        aStream << (vFirst ? "\n" : ",\n")
+                << "{\"name\":\"" << JsonEscape(RegionName(vEvents[i]))
+                << "\",\"ph\":\"X\",\"ts\":" << vEvents[i].mBegin
+                << ",\"dur\":" << vEvents[i].mEnd - vEvents[i].mBegin
+                << ",\"pid\":1,\"tid\":" << sBuffers[b]->mThreadId << "}";
+        vFirst = false;
+      }
+    }
+  }
+  aStream << "\n],\"displayTimeUnit\":\"ms\"}\n" << std::flush;
+}
+
+bool BaseTrace::WriteChromeTrace(const std::string& aFileName) {
+  std::ofstream vFile(aFileName.c_str());
+  if (!vFile.good()) return false;
+  WriteChromeTrace(vFile);
+  return vFile.good();
+}
@@ -0,0 +1,187 @@
+/**************************************************************************
+ *
+ * This file is part of the XuV Tools suite. see http://www.xuvtools.org
+ * for more information
+ *
+ * Copyright (C) 2015 Mario Emmenlauer
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef BASETRACE_HH
+#define BASETRACE_HH BASETRACE_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <typeinfo>
+
+#ifdef _WIN32
+  #if defined(BaseFunctions_EXPORTS)
+    #define BASEFUNCTIONSDLL_API __declspec(dllexport)
+  #elif defined(BaseFunctions_USE_DLL)
+    #define BASEFUNCTIONSDLL_API __declspec(dllimport)
+  #else
+    #define BASEFUNCTIONSDLL_API
+  #endif
+#else
+  #define BASEFUNCTIONSDLL_API
+#endif
+
+/**
+ * BaseTrace records nested, named time regions per thread. Regions
+ * are usually opened with a BaseTraceRegion object on the stack.
+ *
+ * Every thread writes completed regions into its own ring buffer, so
+ * recording needs no locking except once per thread on its first
+ * region. When a buffer is full the oldest regions of that thread are
+ * overwritten and counted as dropped. Tracing is disabled by default,
+ * then opening a region only costs the test of a static flag.
+ *
+ * Region names are stored as pointers and must stay valid until the
+ * trace is written, i.e. they should be string literals.
+ */
+class BASEFUNCTIONSDLL_API BaseTrace {
+public:
+  /**
+   * IsEnabled tells whether regions are currently recorded.
+   *
+   * @return bool true if tracing is enabled, false otherwise
+   */
+  static bool IsEnabled() { return sEnabled; }
+
+  /**
+   * Enable switches recording on or off. Regions that are open while
+   * recording is switched off are still closed properly.
+   *
+   * @param aEnabled true to record regions
+   */
+  static void Enable(bool aEnabled = true);
+
+  /**
+   * SetBufferCapacity sets the number of regions every thread keeps.
+   * It takes effect for threads starting to record afterwards and on
+   * Clear().
+   *
+   * @param aCapacity the number of regions per thread (at least 1)
+   */
+  static void SetBufferCapacity(size_t aCapacity);
+
+  /**
+   * BufferCapacity returns the number of regions every thread keeps.
+   *
+   * @return size_t the ring buffer capacity
+   */
+  static size_t BufferCapacity();
+
+  /**
+   * BeginRegion opens a region in the calling thread. It is nested
+   * into the innermost region that is open in this thread.
+   *
+   * @param aName the region name, must outlive the trace
+   */
+  static void BeginRegion(const char* aName);
+
+  /**
+   * BeginRegion opens a region that is named after the given type.
+   *
+   * @param aType the type, e.g. typeid(*this)
+   */
+  static void BeginRegion(const std::type_info& aType);
+
+  /**
+   * EndRegion closes the innermost open region of the calling
+   * thread. Unbalanced calls are ignored.
+   */
+  static void EndRegion();
+
+  /**
+   * Clear discards all recorded regions and dropped counts. It must
+   * not be called while other threads record.
+   */
+  static void Clear();
+
+  /**
+   * WriteSummary writes a table with one row per region path,
+   * indented by nesting level. For every path the number of calls,
+   * the total time, the time not spent in child regions, the mean and
+   * maximum time and the number of threads are given. Regions running
+   * in parallel add up, so totals of parallel parts can exceed the
+   * wall time of their parent. Nesting is tracked per thread, regions
+   * that OpenMP worker threads open outside of any region of their own
+   * are listed at top level.
+   *
+   * @param aStream the output stream
+   */
+  static void WriteSummary(std::ostream& aStream);
+
+  /**
+   * WriteChromeTrace writes all recorded regions as complete events
+   * in the Chrome trace event format, which can be viewed with
+   * chrome://tracing or Perfetto.
+   *
+   * @param aStream the output stream
+   */
+  static void WriteChromeTrace(std::ostream& aStream);
+
+  /**
+   * WriteChromeTrace writes the Chrome trace to a file.
+   *
+   * @param aFileName the path to the output file
+   * @return bool true if the file was written, false otherwise
+   */
+  static bool WriteChromeTrace(const std::string& aFileName);
+
+private:
+  static void BeginRegion(const char* aName, bool aIsTypeName);
+
+  static bool sEnabled;
+};
+
+/**
+ * BaseTraceRegion opens a trace region on construction and closes it
+ * on destruction if tracing was enabled when it was constructed.
+ */
+class BASEFUNCTIONSDLL_API BaseTraceRegion {
+public:
+  explicit BaseTraceRegion(const char* aName)
+          : mActive(BaseTrace::IsEnabled()) {
+    if (mActive) BaseTrace::BeginRegion(aName);
+  }
+
+  explicit BaseTraceRegion(const std::type_info& aType)
+          : mActive(BaseTrace::IsEnabled()) {
+    if (mActive) BaseTrace::BeginRegion(aType);
+  }
+
+  ~BaseTraceRegion() {
+    if (mActive) BaseTrace::EndRegion();
+  }
+
+private:
+  BaseTraceRegion(const BaseTraceRegion&);
+  BaseTraceRegion& operator=(const BaseTraceRegion&);
+
+  bool mActive;
+};
+
+#endif
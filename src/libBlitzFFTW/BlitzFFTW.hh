@@ -43,6 +43,8 @@
 #include "BlitzFFTWError.hh"
 #include <fftw3.h>
 
+#include <libBaseFunctions/BaseTrace.hh>
+
 #include <blitz/array.h>
 
 #ifdef HAVE_BLITZ_V9
@@ -353,6 +353,39 @@ std::vector<hsize_t> BlitzH5File::getDatasetShape(std::string const &name) const
   return extents;
 }
 
+std::vector<hsize_t> BlitzH5File::getDatasetChunkShape(
+    std::string const &name) const
+{
+  if (_fileId < 0)
+      throw BlitzH5Error()
+          << "Could not get chunk shape of dataset '" << name
+          << "'. The BlitzH5File is not open.";
+  hid_t datasetId = H5Dopen2(_fileId, name.c_str(), H5P_DEFAULT);
+  if (datasetId < 0)
+      throw BlitzH5Error()
+          << "Could not get chunk shape of dataset '" << name
+          << "'. Dataset not found.";
+  hid_t createPropertiesId = H5Dget_create_plist(datasetId);
+  if (createPropertiesId < 0)
+  {
+    H5Dclose(datasetId);
+    throw BlitzH5Error()
+        << "Could not get creation properties for dataset '" << name
+        << "'.";
+  }
+  std::vector<hsize_t> chunkDims;
+  if (H5Pget_layout(createPropertiesId) == H5D_CHUNKED)
+  {
+    chunkDims.resize(H5S_MAX_RANK);
+    int nDims = H5Pget_chunk(
+        createPropertiesId, H5S_MAX_RANK, &chunkDims[0]);
+    chunkDims.resize((nDims > 0) ? nDims : 0);
+  }
+  H5Pclose(createPropertiesId);
+  H5Dclose(datasetId);
+  return chunkDims;
+}
+
 std::vector<std::string>
 BlitzH5File::allDatasets(std::string const &startGroup) const
 {
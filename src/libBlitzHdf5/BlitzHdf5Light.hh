@@ -62,6 +62,7 @@
 #include <hdf5.h>
 
 #include <libProgressReporter/ProgressReporter.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 #include "BlitzH5Traits.hh"
 
@@ -244,6 +245,18 @@ public:
   /*=======================================================================*/
   std::vector<hsize_t> getDatasetShape(std::string const &name) const;
 
+  /*======================================================================*/
+  /*!
+   *   Returns the chunk extents of a dataset. For datasets with contiguous
+   *   or compact layout a zero length vector is returned.
+   *
+   *   \param name dataset path descriptor
+   *
+   *   \return The dataset chunk shape as vector of extents.
+   */
+  /*=======================================================================*/
+  std::vector<hsize_t> getDatasetChunkShape(std::string const &name) const;
+
   /*======================================================================*/
   /*!
    *   Returns the absolute paths of all datasets below the given group
@@ -345,6 +358,30 @@ public:
       std::string &data, std::string const &name,
       iRoCS::ProgressReporter *pr = NULL) const;
 
+  /*======================================================================*/
+  /*!
+   *   Reads a rectangular block of a simple, multi dimensional data set.
+   *   The block starts at the given lower bound and has the shape of the
+   *   given Array, which must be stored contiguously. The file data are
+   *   converted to the Array type by HDF5. Only the chunks intersecting
+   *   the block are read from disk.
+   *
+   *   \param data       output array, its shape defines the block extents
+   *   \param name       dataset path descriptor
+   *   \param lowerBound The position of the first block element in the
+   *     dataset
+   *
+   *   \exception BlitzH5Error If the dataset can not be read, the ranks do
+   *     not match or the block exceeds the dataset this error is thrown
+   *
+   *   \sa existsDataset() to query the existence of a dataset before reading
+   */
+  /*======================================================================*/
+  template<typename DataT, int Rank>
+  void readHyperslab(
+      blitz::Array<DataT,Rank> &data, std::string const &name,
+      blitz::TinyVector<hsize_t,Rank> const &lowerBound) const;
+
   /*======================================================================*/
   /*!
    *   Writes a simple data set without chunking or compression. This should
@@ -25,87 +25,186 @@
 
 #include <libArrayToolbox/algo/helper.hh>
 #include <libArrayToolbox/algo/lBlitzRandomForest.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace iRoCS
 {
 
-  void trainLayerAssignmentToSegmentation(
+/*======================================================================*/
+/*!
+ *   Compute the standard cell features of all given segmentations and
+ *   additionally save them to the corresponding feature files. Files are
+ *   processed concurrently, but only as many as fit into memoryLimit bytes
+ *   (0 = unlimited) are loaded at a time. HDF5 access is serialized.
+ *
+ *   \return false on error or abort
+ */
+/*======================================================================*/
+  static bool computeStandardFeatures(
       std::vector<std::string> const &infiles,
       std::string const &segmentationName, std::string const &sctName,
-      double volumeThresholdUm3, std::string const &modelFileName,
+      double volumeThresholdUm3,
       std::vector<std::string> const &featureFileNames,
-      std::string const &featureGroup, std::vector<std::string> &featureNames,
-      std::vector<std::string> const &labelFileNames,
-      std::string const &labelName, blitz::TinyVector<int,2> const &labelRange,
-      bool computeFeatures, int backgroundLabel, ProgressReporter *pr)
+      std::string const &featureGroup, int backgroundLabel,
+      ptrdiff_t memoryLimit, std::vector<CellFeatures> &cellFeatures,
+      ProgressReporter *pr)
   {
-    if (computeFeatures)
+    int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
+    int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
+
+    // The segmentation and the segment statistics dominate the memory
+    // requirements, the segment statistics need at most as much as the
+    // segmentation
+    std::vector<ptrdiff_t> fileMemory(infiles.size());
+    for (size_t i = 0; i < infiles.size(); ++i)
     {
-      if (pr != NULL && !pr->updateProgressMessage(
-              "Computing standard feature set")) return;
-      for (size_t i = 0; i < infiles.size(); ++i)
+      try
       {
-        atb::Array<int,3> L;
-        ShellCoordinateTransform sct;
-        if (pr != NULL && !pr->updateProgressMessage(
-                "Loading '" + infiles[i] + ":" + segmentationName + "'"))
-            return;
-        try
+        BlitzH5File inFile(infiles[i]);
+        std::vector<hsize_t> shape(inFile.getDatasetShape(segmentationName));
+        fileMemory[i] = 2 * sizeof(int);
+        for (size_t d = 0; d < shape.size(); ++d)
+            fileMemory[i] *= static_cast<ptrdiff_t>(shape[d]);
+      }
+      catch (BlitzH5Error &e)
+      {
+        std::string msg(
+            "Could not load segmentation '" + infiles[i] + ":" +
+            segmentationName + "': " + e.what());
+        if (pr != NULL)
         {
-          L.load(infiles[i], segmentationName, pr);
+          pr->abortWithError(msg);
+          return false;
         }
-        catch (BlitzH5Error &e)
+        else
         {
-          std::string msg(
-              std::string("Could not load segmentation: ") + e.what());
-          if (pr != NULL)
+          std::cerr << msg << std::endl;
+          exit(-1);
+        }
+      }
+    }
+
+    cellFeatures.resize(infiles.size());
+    std::string errorMessage;
+    int nProcessed = 0;
+    size_t batchStart = 0;
+    while (batchStart < infiles.size())
+    {
+      // Process as many consecutive files concurrently as fit into the
+      // memory budget, always at least one
+      size_t batchEnd = batchStart + 1;
+      ptrdiff_t batchMemory = fileMemory[batchStart];
+      while (batchEnd < infiles.size() &&
+             (memoryLimit <= 0 ||
+              batchMemory + fileMemory[batchEnd] <= memoryLimit))
+          batchMemory += fileMemory[batchEnd++];
+
+      ptrdiff_t first = static_cast<ptrdiff_t>(batchStart);
+      ptrdiff_t last = static_cast<ptrdiff_t>(batchEnd);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (ptrdiff_t i = first; i < last; ++i)
+      {
+        bool skip;
+#ifdef _OPENMP
+#pragma omp critical (AssignLayersToSegmentationProgress)
+#endif
+        skip = !errorMessage.empty() || (pr != NULL && pr->isAborted());
+        if (skip) continue;
+
+        std::string error;
+        atb::Array<int,3> L;
+        ShellCoordinateTransform sct;
+#ifdef _OPENMP
+#pragma omp critical (AssignLayersToSegmentationIO)
+#endif
+        {
+          try
           {
-            pr->abortWithError(msg);
-            return;
+            L.load(infiles[i], segmentationName);
+            sct.load(infiles[i], sctName);
           }
-          else
+          catch (BlitzH5Error &e)
           {
-            std::cerr << msg << std::endl;
-            exit(-1);
+            error = "Could not load '" + infiles[i] + "': " + e.what();
           }
         }
-        
-        if (pr != NULL && !pr->updateProgressMessage(
-                "Loading Shell Coordinate Transform from '" + infiles[i] +
-                ":" + sctName)) return;
-        try
+
+        if (error.empty() && !computeCellFeatures(
+                L, sct, volumeThresholdUm3, cellFeatures[i], backgroundLabel))
+            error = "Could not compute cell features for '" + infiles[i] +
+                "'";
+        L.free();
+
+        if (error.empty())
         {
-          sct.load(infiles[i], sctName);
+#ifdef _OPENMP
+#pragma omp critical (AssignLayersToSegmentationIO)
+#endif
+          {
+            try
+            {
+              cellFeatures[i].save(featureFileNames[i], featureGroup);
+            }
+            catch (BlitzH5Error &e)
+            {
+              error = "Error while writing '" + featureFileNames[i] + "': " +
+                  e.what();
+            }
+          }
         }
-        catch (BlitzH5Error &e)
+
+#ifdef _OPENMP
+#pragma omp critical (AssignLayersToSegmentationProgress)
+#endif
         {
-          std::string msg(
-              std::string("Could not load iRoCS shell coordinate transform:") +
-              e.what());
+          if (!error.empty() && errorMessage.empty()) errorMessage = error;
+          ++nProcessed;
           if (pr != NULL)
-          {
-            pr->abortWithError(msg);
-            return;
-          }
-          else
-          {
-            std::cerr << msg << std::endl;
-            exit(-1);
-          }
+              pr->updateProgress(
+                  pMin + (pScale * nProcessed) /
+                  static_cast<int>(infiles.size()));
         }
-        computeCellFeatures(
-            L, sct, volumeThresholdUm3, featureFileNames[i], featureGroup,
-            backgroundLabel, pr);
       }
-      featureNames.clear();
-      featureNames.push_back("normCenters");
-      featureNames.push_back("RD");
-      featureNames.push_back("blockSize");
-      featureNames.push_back("volumeOverBlock");
-      featureNames.push_back("convexity");
+      batchStart = batchEnd;
+    }
+
+    if (pr != NULL && pr->isAborted()) return false;
+    if (!errorMessage.empty())
+    {
+      if (pr != NULL)
+      {
+        pr->abortWithError(errorMessage);
+        return false;
+      }
+      else
+      {
+        std::cerr << errorMessage << std::endl;
+        exit(-1);
+      }
     }
+    return true;
+  }
 
-    if (pr != NULL && !pr->updateProgressMessage("Analyzing features")) return;
+/*======================================================================*/
+/*!
+ *   Load the given features and the corresponding labels of all valid
+ *   segments from pre-computed feature files into one training matrix.
+ *
+ *   \return false on error or abort
+ */
+/*======================================================================*/
+  static bool loadFeaturesAndLabels(
+      std::vector<std::string> const &featureFileNames,
+      std::string const &featureGroup,
+      std::vector<std::string> const &featureNames,
+      std::vector<std::string> const &labelFileNames,
+      std::string const &labelName, blitz::Array<float,2> &features,
+      blitz::Array<int,1> &labels, ProgressReporter *pr)
+  {
+    if (pr != NULL && !pr->updateProgressMessage("Analyzing features"))
+        return false;
 
     // Get Feature Array extents and check input files
     blitz::TinyVector<atb::BlitzIndexT,2> featureShape(atb::BlitzIndexT(0));
@@ -153,7 +252,7 @@ namespace iRoCS
         if (pr != NULL)
         {
           pr->abortWithError(msg);
-          return;
+          return false;
         }
         else
         {
@@ -180,7 +279,7 @@ namespace iRoCS
         if (pr != NULL)
         {
           pr->abortWithError(msg);
-          return;
+          return false;
         }
         else
         {
@@ -191,11 +290,11 @@ namespace iRoCS
     }
       
     if (pr != NULL && !pr->updateProgressMessage(
-            "Loading features and labels")) return;
+            "Loading features and labels")) return false;
     
     // Load features and labels
-    blitz::Array<float,2> features(featureShape);
-    blitz::Array<int,1> labels(featureShape(0));
+    features.resize(featureShape);
+    labels.resize(featureShape(0));
     int segStart = 0;
     for (size_t i = 0; i < featureFileNames.size(); ++i)
     {
@@ -258,7 +357,7 @@ namespace iRoCS
         if (pr != NULL)
         {
           pr->abortWithError(msg.str());
-          return;
+          return false;
         }
         else
         {
@@ -293,7 +392,7 @@ namespace iRoCS
         if (pr != NULL)
         {
           pr->abortWithError(msg.str());
-          return;
+          return false;
         }
         else
         {
@@ -302,68 +401,25 @@ namespace iRoCS
         }
       }      
     }
-    
-    int nTree = 200;
-    lRandomForest forest(nTree);
-    trainRFSimple(forest, features, labels, 20, labelRange(0), labelRange(1));
-    saveRFSimple(forest, modelFileName);
-
-    try
-    {
-      BlitzH5File outFile(modelFileName, BlitzH5File::WriteOrNew);
-      outFile.writeAttribute(nTree, "nTree", "/");
-      outFile.writeAttribute(forest._maxLabel, "maxLabel", "/");
-      outFile.writeAttribute(featureShape(0), "nTrainingSamples", "/");
-      outFile.writeAttribute(featureShape(1), "nFeatures", "/");
-      outFile.writeAttribute(volumeThresholdUm3, "volumeThreshold_um3", "/");
-      outFile.writeAttribute(labelRange, "labelRange", "/");
-      for (size_t i = 0; i < infiles.size(); ++i)
-      {
-        std::stringstream attName;
-        attName << "infile_" << i;
-        outFile.writeAttribute(infiles[i], attName.str(), "/");
-      }
-      outFile.writeAttribute(featureGroup, "featureGroup", "/");
-      for (size_t i = 0; i < featureNames.size(); ++i)
-      {
-        std::stringstream attName;
-        attName << "featureName_" << i;
-        outFile.writeAttribute(featureNames[i], attName.str(), "/");
-      }
-    }
-    catch (BlitzH5Error &e)
-    {
-      std::cerr << "Could not write Random forest parameters: " << e.what()
-                << std::endl;
-      exit(-1);
-    }
+    return true;
   }
 
-  void assignLayersToSegmentation(
-      atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
-      double volumeThresholdUm3, std::string const &modelFileName,
+/*======================================================================*/
+/*!
+ *   Load the given features and the valid flags of all segments from a
+ *   pre-computed feature file.
+ *
+ *   \return false on error or abort
+ */
+/*======================================================================*/
+  static bool loadFeatures(
       std::string const &featureFileName, std::string const &featureGroup,
-      std::vector<std::string> &featureNames,
-      std::string const &outFileName, std::string const &labelName,
-      int backgroundLabel, ProgressReporter *pr)
+      std::vector<std::string> const &featureNames,
+      blitz::Array<float,2> &features, blitz::Array<unsigned char,1> &valid,
+      ProgressReporter *pr)
   {
-    if (L.size() != static_cast<size_t>(0))
-    {
-      // on-the-fly feature computation requested
-      if (pr != NULL && !pr->updateProgressMessage(
-              "Computing standard feature set")) return;
-      computeCellFeatures(
-          L, sct, volumeThresholdUm3, featureFileName, featureGroup,
-          backgroundLabel, pr);
-      featureNames.clear();
-      featureNames.push_back("normCenters");
-      featureNames.push_back("RD");
-      featureNames.push_back("blockSize");
-      featureNames.push_back("volumeOverBlock");
-      featureNames.push_back("convexity");      
-    }
-
-    if (pr != NULL && !pr->updateProgressMessage("Analyzing features")) return;
+    if (pr != NULL && !pr->updateProgressMessage("Analyzing features"))
+        return false;
 
     // Get Feature Array extents and check input file
     blitz::TinyVector<atb::BlitzIndexT,2> featureShape(atb::BlitzIndexT(0));
@@ -398,7 +454,7 @@ namespace iRoCS
       if (pr != NULL)
       {
         pr->abortWithError(msg.str());
-        return;
+        return false;
       }
       else
       {
@@ -409,10 +465,11 @@ namespace iRoCS
     std::cout << "  Found " << featureShape(0) << " segments, with "
               << featureShape(1) << " features each." << std::endl;
     
-    if (pr != NULL && !pr->updateProgressMessage("Loading features")) return;
+    if (pr != NULL && !pr->updateProgressMessage("Loading features"))
+        return false;
 
     // Load features
-    blitz::Array<float,2> features(featureShape);
+    features.resize(featureShape);
     try
     {
       BlitzH5File inFile(featureFileName);
@@ -450,7 +507,7 @@ namespace iRoCS
       if (pr != NULL)
       {
         pr->abortWithError(msg.str());
-        return;
+        return false;
       }
       else
       {
@@ -460,9 +517,8 @@ namespace iRoCS
     }
     
     if (pr != NULL && !pr->updateProgressMessage(
-            "Loading '" + featureFileName + ":/validFlag'")) return;
+            "Loading '" + featureFileName + ":/validFlag'")) return false;
 
-    blitz::Array<unsigned char,1> valid;
     try
     {
       BlitzH5File inFile(featureFileName);
@@ -475,7 +531,7 @@ namespace iRoCS
       if (pr != NULL)
       {
         pr->abortWithError(msg.str());
-        return;
+        return false;
       }
       else
       {
@@ -483,6 +539,173 @@ namespace iRoCS
         exit(-1);
       }
     }    
+    return true;
+  }
+
+  void trainLayerAssignmentToSegmentation(
+      std::vector<std::string> const &infiles,
+      std::string const &segmentationName, std::string const &sctName,
+      double volumeThresholdUm3, std::string const &modelFileName,
+      std::vector<std::string> const &featureFileNames,
+      std::string const &featureGroup, std::vector<std::string> &featureNames,
+      std::vector<std::string> const &labelFileNames,
+      std::string const &labelName, blitz::TinyVector<int,2> const &labelRange,
+      bool computeFeatures, int backgroundLabel, ProgressReporter *pr,
+      ptrdiff_t memoryLimit)
+  {
+    BaseTraceRegion trace("trainLayerAssignmentToSegmentation");
+
+    blitz::Array<float,2> features;
+    blitz::Array<int,1> labels;
+    if (computeFeatures)
+    {
+      if (pr != NULL && !pr->updateProgressMessage(
+              "Computing standard feature set")) return;
+      std::vector<CellFeatures> cellFeatures;
+      if (!computeStandardFeatures(
+              infiles, segmentationName, sctName, volumeThresholdUm3,
+              featureFileNames, featureGroup, backgroundLabel, memoryLimit,
+              cellFeatures, pr)) return;
+      featureNames = CellFeatures::standardFeatureNames();
+
+      if (pr != NULL && !pr->updateProgressMessage(
+              "Loading labels")) return;
+
+      // Stream the features of all valid segments directly into the
+      // training matrix
+      atb::BlitzIndexT nSamples = 0;
+      for (size_t i = 0; i < cellFeatures.size(); ++i)
+          for (atb::BlitzIndexT segIdx = 0;
+               segIdx < cellFeatures[i].validFlag.extent(0); ++segIdx)
+              if (cellFeatures[i].validFlag(segIdx) == 1) ++nSamples;
+      features.resize(nSamples, CellFeatures::nStandardFeatures);
+      labels.resize(nSamples);
+      atb::BlitzIndexT sampleIdx = 0;
+      for (size_t i = 0; i < cellFeatures.size(); ++i)
+      {
+        blitz::Array<int,1> lbl;
+        try
+        {
+          BlitzH5File inFile(labelFileNames[i]);
+          std::cout << "  Loading '" << labelFileNames[i] << ":" << labelName
+                    << "'" << std::endl;
+          inFile.readDataset(lbl, labelName);
+          if (lbl.extent(0) != cellFeatures[i].validFlag.extent(0))
+              throw BlitzH5Error(
+                  labelName + " contains the wrong number of labels.");
+        }
+        catch (BlitzH5Error &e)
+        {
+          std::string msg(
+              "Error while reading '" + labelFileNames[i] + "': " + e.what());
+          if (pr != NULL)
+          {
+            pr->abortWithError(msg);
+            return;
+          }
+          else
+          {
+            std::cerr << msg << std::endl;
+            exit(-1);
+          }
+        }
+        for (atb::BlitzIndexT segIdx = 0; segIdx < lbl.extent(0); ++segIdx)
+        {
+          if (cellFeatures[i].validFlag(segIdx) == 1)
+          {
+            cellFeatures[i].copyStandardFeatures(
+                segIdx, &features(sampleIdx, 0));
+            labels(sampleIdx) = lbl(segIdx);
+            ++sampleIdx;
+          }
+        }
+      }
+    }
+    else if (!loadFeaturesAndLabels(
+                 featureFileNames, featureGroup, featureNames, labelFileNames,
+                 labelName, features, labels, pr)) return;
+
+    
+    int nTree = 200;
+    lRandomForest forest(nTree);
+    trainRFSimple(forest, features, labels, 20, labelRange(0), labelRange(1));
+    saveRFSimple(forest, modelFileName);
+
+    try
+    {
+      BlitzH5File outFile(modelFileName, BlitzH5File::WriteOrNew);
+      outFile.writeAttribute(nTree, "nTree", "/");
+      outFile.writeAttribute(forest._maxLabel, "maxLabel", "/");
+      outFile.writeAttribute(features.extent(0), "nTrainingSamples", "/");
+      outFile.writeAttribute(features.extent(1), "nFeatures", "/");
+      outFile.writeAttribute(volumeThresholdUm3, "volumeThreshold_um3", "/");
+      outFile.writeAttribute(labelRange, "labelRange", "/");
+      for (size_t i = 0; i < infiles.size(); ++i)
+      {
+        std::stringstream attName;
+        attName << "infile_" << i;
+        outFile.writeAttribute(infiles[i], attName.str(), "/");
+      }
+      outFile.writeAttribute(featureGroup, "featureGroup", "/");
+      for (size_t i = 0; i < featureNames.size(); ++i)
+      {
+        std::stringstream attName;
+        attName << "featureName_" << i;
+        outFile.writeAttribute(featureNames[i], attName.str(), "/");
+      }
+    }
+    catch (BlitzH5Error &e)
+    {
+      std::cerr << "Could not write Random forest parameters: " << e.what()
+                << std::endl;
+      exit(-1);
+    }
+  }
+
+  void assignLayersToSegmentation(
+      atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
+      double volumeThresholdUm3, std::string const &modelFileName,
+      std::string const &featureFileName, std::string const &featureGroup,
+      std::vector<std::string> &featureNames,
+      std::string const &outFileName, std::string const &labelName,
+      int backgroundLabel, ProgressReporter *pr)
+  {
+    BaseTraceRegion trace("assignLayersToSegmentation");
+
+    blitz::Array<float,2> features;
+    blitz::Array<unsigned char,1> valid;
+    if (L.size() != static_cast<size_t>(0))
+    {
+      // on-the-fly feature computation requested
+      if (pr != NULL && !pr->updateProgressMessage(
+              "Computing standard feature set")) return;
+      CellFeatures cellFeatures;
+      if (!computeCellFeatures(
+              L, sct, volumeThresholdUm3, cellFeatures, backgroundLabel, pr))
+          return;
+      if (pr != NULL && !pr->updateProgressMessage(
+              "Saving local shape features")) return;
+      try
+      {
+        cellFeatures.save(featureFileName, featureGroup);
+      }
+      catch (BlitzH5Error &e)
+      {
+        std::cerr << "Something went wrong while processing '"
+                  << featureFileName << "': " << e.str() << std::endl;
+      }
+      featureNames = CellFeatures::standardFeatureNames();
+
+      // Use the computed features directly instead of reading them back
+      features.resize(
+          cellFeatures.validFlag.extent(0), CellFeatures::nStandardFeatures);
+      for (atb::BlitzIndexT segIdx = 0; segIdx < features.extent(0); ++segIdx)
+          cellFeatures.copyStandardFeatures(segIdx, &features(segIdx, 0));
+      valid.reference(cellFeatures.validFlag);
+    }
+    else if (!loadFeatures(
+                 featureFileName, featureGroup, featureNames, features, valid,
+                 pr)) return;
 
     if (pr != NULL && !pr->updateProgressMessage(
             "Loading Random Forest model from '" + modelFileName + "'")) return;
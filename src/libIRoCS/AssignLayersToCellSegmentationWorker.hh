@@ -35,6 +35,19 @@
 namespace iRoCS
 {
 
+/*======================================================================*/
+/*!
+ *   Train a random forest assigning layer labels to the segments of the
+ *   given cell segmentations.
+ *
+ *   If computeFeatures is true, the standard cell features are computed
+ *   for all infiles concurrently and streamed directly into the training
+ *   matrix. They are additionally written to the featureFileNames for
+ *   later use. At most as many segmentations are held in memory at the
+ *   same time as fit into memoryLimit bytes (0 = no limit). Otherwise the
+ *   given featureNames are read from the pre-computed featureFileNames.
+ */
+/*======================================================================*/
   void trainLayerAssignmentToSegmentation(
       std::vector<std::string> const &infiles,
       std::string const &segmentationName, std::string const &sctName,
@@ -44,7 +57,7 @@ namespace iRoCS
       std::vector<std::string> const &labelFileNames,
       std::string const &labelName, blitz::TinyVector<int,2> const &labelRange,
       bool computeFeatures, int backgroundLabel = 1,
-      ProgressReporter *pr = NULL);
+      ProgressReporter *pr = NULL, ptrdiff_t memoryLimit = 0);
 
   void assignLayersToSegmentation(
       atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
@@ -27,6 +27,7 @@
 #include <libArrayToolbox/algo/helper.hh>
 #include <libArrayToolbox/algo/lmorph.hh>
 #include <libArrayToolbox/algo/lrootShapeAnalysis.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace iRoCS
 {
@@ -94,6 +95,7 @@ namespace iRoCS
       atb::Array<double,3> *r, atb::Array<double,3> *p,
       iRoCS::ProgressReporter *pr)
   {
+    BaseTraceRegion trace("attachIRoCS");
     // Setup progress reporting
     int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
     int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
@@ -22,6 +22,8 @@
 
 #include "AttachIRoCSWorker.hh"
 
+#include <libBaseFunctions/BaseTrace.hh>
+
 namespace iRoCS
 {
   
@@ -31,6 +33,7 @@ namespace iRoCS
       double lambda, double mu, double searchRadiusUm, int nIterations,
       double tau, ProgressReporter *pr)
   {
+    BaseTraceRegion trace("attachIRoCS");
     if (pr != NULL)
     {
       pr->setProgressMin(0);
@@ -49,23 +52,17 @@ namespace iRoCS
     }
     
     // Finally set the intrinsic coordinates for the input markers
-    int p = 0;
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(nuclei.size()); ++i)
+    std::vector< blitz::TinyVector<double,3> > positionsUm(nuclei.size());
+    for (size_t i = 0; i < nuclei.size(); ++i)
+        positionsUm[i] = nuclei[i].positionUm();
+    std::vector< blitz::TinyVector<double,3> > coordinates;
+    iRoCS.getCoordinates(positionsUm, coordinates);
+    if (pr != NULL && !pr->updateProgress(109)) return;
+    for (size_t i = 0; i < nuclei.size(); ++i)
     {
-      if (pr != NULL && !pr->updateProgress(
-              static_cast<int>(102 + (7 * p) / nuclei.size()))) continue;
-#ifdef _OPENMP
-#pragma omp atomic
-#endif
-      ++p;
-      blitz::TinyVector<double,3> p(
-          iRoCS.getCoordinates(nuclei[i].positionUm()));
-      nuclei[i].setQcDistanceUm(p(0));
-      nuclei[i].setRadialDistanceUm(p(1));
-      nuclei[i].setPhi(p(2));
+      nuclei[i].setQcDistanceUm(coordinates[i](0));
+      nuclei[i].setRadialDistanceUm(coordinates[i](1));
+      nuclei[i].setPhi(coordinates[i](2));
     }
     if (pr != NULL) pr->updateProgress(110);    
   }
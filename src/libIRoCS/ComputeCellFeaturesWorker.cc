@@ -25,10 +25,11 @@
 #include <iostream>
 
 #include <libArrayToolbox/ATBLinAlg.hh>
-#include <libArrayToolbox/Neighborhood.hh>
+#include <libArrayToolbox/SegmentStatistics.hh>
 #include <libArrayToolbox/algo/lrootShapeAnalysis.hh>
 
 #include <libArrayToolbox/ATBTiming.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace iRoCS
 {
@@ -89,85 +90,89 @@ namespace iRoCS
     }
   }
 
-  void computeVoxelSetsPerLabel(
-      atb::Array<int,3> const &L,
-      blitz::Array<std::vector< blitz::TinyVector<atb::BlitzIndexT,3> >,1>
-      &voxelSets, int backgroundLabel, ProgressReporter *pr)
+  std::vector<std::string> CellFeatures::standardFeatureNames()
   {
-    int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
-    double pScale = (pr != NULL) ? static_cast<double>(
-        pr->taskProgressMax() - pMin) / static_cast<double>(L.size() - 1) : 100;
-    if (pr != NULL && !pr->updateProgress(pMin)) return;
-
-    int p = 0;
-    for (atb::BlitzIndexT z = 0; z < L.extent(0); ++z)
-    {
-      for (atb::BlitzIndexT y = 0; y < L.extent(1); ++y)
-      {
-        for (atb::BlitzIndexT x = 0; x < L.extent(2); ++x, ++p)
-        {
-          if (pr != NULL && p % (L.size() / 100) == 0 &&
-              !pr->updateProgress(static_cast<int>(pMin + pScale * p))) return;
-          int lbl = L(z, y, x);
-          if (lbl > 0 && lbl != backgroundLabel &&
-              lbl - 1 < static_cast<int>(voxelSets.size()))
-          {
-            voxelSets(lbl - 1).push_back(
-                blitz::TinyVector<atb::BlitzIndexT,3>(z, y, x));
-          }
-        }
-      }
-    }
-    if (pr != NULL) pr->updateProgress(pr->taskProgressMax());
+    std::vector<std::string> names;
+    names.push_back("normCenters");
+    names.push_back("RD");
+    names.push_back("blockSize");
+    names.push_back("volumeOverBlock");
+    names.push_back("convexity");
+    return names;
   }
-  
-  double computeConvexity(
-      atb::Array<int,3> const &L,
-      std::vector< blitz::TinyVector<atb::BlitzIndexT,3> > const &voxelSet,
-      int nRandomPairs)
+
+  void CellFeatures::copyStandardFeatures(
+      atb::BlitzIndexT segmentIndex, float *out) const
   {
-    if (voxelSet.size() == 0) return 0.0;
-    if (voxelSet.size() == 1) return 1.0;
+    for (int d = 0; d < 3; ++d)
+        *out++ = static_cast<float>(normCenters(segmentIndex)(d));
+    for (int d = 0; d < 26; ++d)
+        *out++ = static_cast<float>(RD(segmentIndex)(d));
+    for (int d = 0; d < 3; ++d)
+        *out++ = static_cast<float>(blockSize(segmentIndex)(d));
+    *out++ = static_cast<float>(volumeOverBlock(segmentIndex));
+    *out = static_cast<float>(convexity(segmentIndex));
+  }
 
-    blitz::TinyVector<atb::BlitzIndexT,3> p;
-    int a = static_cast<int>(
-        (voxelSet.size() - 1) * static_cast<double>(std::rand()) /
-        static_cast<double>(RAND_MAX));
-    int convexCount = 0;
-    for (int i = 0; i < nRandomPairs; i++)
-    {
-      int b = static_cast<int>(
-          (voxelSet.size() - 1) * static_cast<double>(std::rand()) /
-          static_cast<double>(RAND_MAX));
-      p = (voxelSet[a] + voxelSet[b]) / 2;
-      if (L(p) == L(voxelSet[0])) convexCount++;
-      a = b;
-    }
-    return static_cast<double>(convexCount) / static_cast<double>(nRandomPairs);
+  void CellFeatures::save(
+      std::string const &outFileName, std::string const &featureGroup) const
+  {
+    BlitzH5File outFile(outFileName, BlitzH5File::WriteOrNew);
+    outFile.writeDataset(validFlag, featureGroup + "/validFlag", 3);
+    outFile.writeDataset(borderFlag, featureGroup + "/borderFlag", 3);
+    outFile.writeDataset(volumes, featureGroup + "/volumes", 3);
+    outFile.writeDataset(centers, featureGroup + "/centers", 3);
+    outFile.writeAttribute(backgroundLabel, "backgroundLabel", featureGroup);
+    outFile.writeAttribute(centers.size(), "maxLabel", featureGroup);
+    outFile.writeDataset(normCenters, featureGroup + "/normCenters", 3);
+    outFile.writeDataset(localAxes, featureGroup + "/localAxes", 3);
+    outFile.writeDataset(RD, featureGroup + "/RD", 3);
+    outFile.writeDataset(blockSize, featureGroup + "/blockSize", 3);
+    outFile.writeDataset(
+        volumeOverBlock, featureGroup + "/volumeOverBlock", 3);
+    outFile.writeDataset(convexity, featureGroup + "/convexity", 3);
+    outFile.writeDataset(neighbors, featureGroup + "/neighbor", 3);
   }
 
-  void computeCellFeatures(
+  bool computeCellFeatures(
       atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
-      double volumeThresholdUm, std::string const &outFileName,
-      std::string const &featureGroup, int backgroundLabel,
+      double volumeThresholdUm, CellFeatures &features, int backgroundLabel,
       ProgressReporter *pr)
   {
+    BaseTraceRegion trace("computeCellFeatures");
     int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
     int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
-    if (pr != NULL && !pr->updateProgress(pMin)) return;
+    if (pr != NULL && !pr->updateProgress(pMin)) return false;
 
-    //Variables
-    blitz::Array<double,1> volumes;
-    blitz::Array<blitz::TinyVector<double,3>,1> centers;
+    // Gather all per-segment statistics in one scan
+    if (pr != NULL)
+    {
+      if (!pr->updateProgressMessage("Computing segment statistics"))
+          return false;
+      pr->setTaskProgressMax(static_cast<int>(pMin + pScale * 0.01));
+    }
+    atb::SegmentStatistics stats;
+    if (!stats.compute(L, pr)) return false;
+    if (pr != NULL)
+    {
+      pr->setTaskProgressMin(pMin);
+      pr->setTaskProgressMax(pMin + pScale);
+    }
 
-    // Compute centers (in um) and volume (in um3) and get the number of
-    // segments
-    if (pr != NULL && !pr->updateProgressMessage(
-            "Computing segment centers and volumes")) return;
-    centerAndVolume(L, centers, volumes, -1, L.elementSizeUm());
+    // Get centers (in um) and volume (in um3) and the number of segments
+    blitz::Array<double,1> &volumes = features.volumes;
+    blitz::Array<blitz::TinyVector<double,3>,1> &centers = features.centers;
+    volumes.resize(stats.maxLabel());
+    centers.resize(stats.maxLabel());
+    double elementVolumeUm3 = blitz::product(L.elementSizeUm());
+    for (int i = 0; i < stats.maxLabel(); ++i)
+    {
+      volumes(i) = stats.segment(i + 1).nVoxels * elementVolumeUm3;
+      centers(i) = stats.centerUm(i + 1, L.elementSizeUm());
+    }
     std::cout << "  Processing " << centers.size() << " segments" << std::endl;
-    int LMin = blitz::min(L);
-    int LMax = blitz::max(L);
+    int LMin = stats.minLabel();
+    int LMax = stats.maxLabel();
     if (LMin < 0 || LMax != static_cast<int>(centers.size()))
     {
       std::cerr << "Labels are not positive and contiguous... that's "
@@ -176,48 +181,53 @@ namespace iRoCS
                 << LMax << std::endl;
       std::cerr << "  nSegments = " << centers.size() << std::endl;
       if (pr != NULL) pr->abort();
-      return;
+      return false;
     }
 
     if (pr != NULL && !pr->updateProgress(
-            static_cast<int>(pMin + pScale * 0.01))) return;
+            static_cast<int>(pMin + pScale * 0.01))) return false;
 
     //prepare for coordinate fitting
     if (backgroundLabel < 0)
     {
       if (pr != NULL && !pr->updateProgressMessage(
-              "Searching background label")) return;
+              "Searching background label")) return false;
       backgroundLabel = (blitz::maxIndex(volumes))(0) + 1;
     }
     std::cout << "  background label = " << backgroundLabel << std::endl;
+    features.backgroundLabel = backgroundLabel;
 
     if (pr != NULL && !pr->updateProgress(
-            static_cast<int>(pMin + pScale * 0.02))) return;
+            static_cast<int>(pMin + pScale * 0.02))) return false;
 
     // Set all background and too small segments invalid
     if (pr != NULL && !pr->updateProgressMessage(
-            "Removing background and too small segments")) return;
-    blitz::Array<unsigned char,1> validFlag(centers.shape());
+            "Removing background and too small segments")) return false;
+    blitz::Array<unsigned char,1> &validFlag = features.validFlag;
+    validFlag.resize(centers.shape());
     validFlag = blitz::where(volumes < volumeThresholdUm, 0, 1);
     validFlag(backgroundLabel - 1) = 0;
 
     if (pr != NULL && !pr->updateProgress(
-            static_cast<int>(pMin + pScale * 0.03))) return;
+            static_cast<int>(pMin + pScale * 0.03))) return false;
 
     // remove all the cells which are cut off by image border
     if (pr != NULL && !pr->updateProgressMessage(
-            "Removing cells cut by boundary")) return;
-    blitz::Array<unsigned char, 1> borderFlag(centers.shape());
-    borderFlag = true;
-    labelOnBorder(L, borderFlag);
+            "Removing cells cut by boundary")) return false;
+    blitz::Array<unsigned char,1> &borderFlag = features.borderFlag;
+    borderFlag.resize(centers.shape());
+    for (int i = 0; i < stats.maxLabel(); ++i)
+        borderFlag(i) = stats.segment(i + 1).touchesBorder ? 0 : 1;
 
     if (pr != NULL && !pr->updateProgress(
-            static_cast<int>(pMin + pScale * 0.04))) return;
+            static_cast<int>(pMin + pScale * 0.04))) return false;
 
     // Get the iRoCS coordinates for each segment center
     if (pr != NULL && !pr->updateProgressMessage(
-            "Computing iRoCS coordinates of segment centers")) return;
-    blitz::Array<blitz::TinyVector<double,3>,1> iRoCSCenters(centers.shape());
+            "Computing iRoCS coordinates of segment centers")) return false;
+    blitz::Array<blitz::TinyVector<double,3>,1> &iRoCSCenters =
+        features.normCenters;
+    iRoCSCenters.resize(centers.shape());
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -225,12 +235,14 @@ namespace iRoCS
         iRoCSCenters(i) = sct.getCoordinatesWithNormalizedRadius(centers(i));
 
     if (pr != NULL && !pr->updateProgress(
-            static_cast<int>(pMin + pScale * 0.05))) return;
+            static_cast<int>(pMin + pScale * 0.05))) return false;
 
     // Compute local coordinate axes for each segment
     if (pr != NULL && !pr->updateProgressMessage(
-            "Computing local iRoCS axes per segment")) return;
-    blitz::Array<blitz::TinyMatrix<double,3,3>,1> localAxes(centers.shape());
+            "Computing local iRoCS axes per segment")) return false;
+    blitz::Array<blitz::TinyMatrix<double,3,3>,1> &localAxes =
+        features.localAxes;
+    localAxes.resize(centers.shape());
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -253,30 +265,26 @@ namespace iRoCS
       localAxes(i) = z(0), y(0), x(0), z(1), y(1), x(1), z(2), y(2), x(2);
     }
 
-    if (pr != NULL)
-    {
-      pr->updateProgress(static_cast<int>(pMin + pScale * 0.06));
-      if (!pr->updateProgressMessage("Computing per-label voxel sets")) return;
-      pr->setTaskProgressMin(static_cast<int>(pMin + pScale * 0.06));
-      pr->setTaskProgressMax(static_cast<int>(pMin + pScale * 0.2));      
-    }
-    blitz::Array<std::vector< blitz::TinyVector<atb::BlitzIndexT,3> >,1>
-        voxelSets(centers.shape());
-    computeVoxelSetsPerLabel(L, voxelSets, backgroundLabel, pr);
+    if (pr != NULL) pr->updateProgress(static_cast<int>(pMin + pScale * 0.2));
 
     if (pr != NULL && !pr->updateProgressMessage(
-            "Computing local shape features")) return;
-    blitz::Array<blitz::TinyVector<double,26>,1> RD(centers.shape());
-    blitz::Array<blitz::TinyVector<double,3>,1> blockSize(
-        centers.shape()); // lengths of cells' main axes
-    blitz::Array<double,1> volumeOverBlock(centers.shape());
-    blitz::Array<double,1> convexity(centers.shape());
-    double prScale = 0.5 / static_cast<double>(centers.size() - 1);
+            "Computing local shape features")) return false;
+    blitz::Array<blitz::TinyVector<double,26>,1> &RD = features.RD;
+    RD.resize(centers.shape());
+    blitz::Array<blitz::TinyVector<double,3>,1> &blockSize =
+        features.blockSize; // lengths of cells' main axes
+    blockSize.resize(centers.shape());
+    blitz::Array<double,1> &volumeOverBlock = features.volumeOverBlock;
+    volumeOverBlock.resize(centers.shape());
+    blitz::Array<double,1> &convexity = features.convexity;
+    convexity.resize(centers.shape());
+    double prScale = 0.79 / static_cast<double>(centers.size() - 1);
     for (atb::BlitzIndexT i = 0; i < centers.extent(0); ++i)
     {
       if (pr != NULL && i % (centers.extent(0) / 100) == 0 &&
           !pr->updateProgress(
-              static_cast<int>(pMin + pScale * (0.2 + prScale * i)))) return;
+              static_cast<int>(pMin + pScale * (0.2 + prScale * i))))
+          return false;
       if (validFlag(i) == 1)
       {
         extractRD(L, i + 1, centers(i), localAxes(i), RD(i));
@@ -284,7 +292,7 @@ namespace iRoCS
             RD(i)(12) + RD(i)(13),
             RD(i)(10) + RD(i)(15),
             RD(i)(4) + RD(i)(21);
-        convexity(i) = computeConvexity(L, voxelSets(i));
+        convexity(i) = stats.convexity(L, static_cast<int>(i + 1));
         volumeOverBlock(i) = volumes(i) / std::max(
             1.0, blitz::product(blockSize(i)));
       }
@@ -297,108 +305,58 @@ namespace iRoCS
       }
     }
 
-    // Find neighboring cells
     if (pr != NULL)
     {
-      pr->updateProgress(static_cast<int>(pMin + pScale * 0.7));
-      if (!pr->updateProgressMessage("Analyzing cell neighborhood")) return;
-    }
-    blitz::Array<std::set<int>,1> nbSets(centers.shape());
-    atb::Neighborhood<3> nh(atb::Neighborhood<3>::Complex);
-    prScale = 0.29 / static_cast<double>(L.size() - 1);
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(L.size()); ++i)
-    {
-      if (pr != NULL && i % (L.size() / 100) == 0 &&
-          !pr->updateProgress(
-              static_cast<int>(pMin + pScale * (0.7 + prScale * i))))
-          continue;
-
-      // If not on boundary => nothing to do
-      if (L.dataFirst()[i] != 0) continue;
-
-      blitz::TinyVector<atb::BlitzIndexT,3> posPx;
-      ptrdiff_t tmp = i;
-      for (int d = 2; d >= 0; --d)
-      {
-        posPx(d) = tmp % L.extent(d);
-        tmp /= L.extent(d);
-      }
-      std::set<int> s;
-      for (atb::Neighborhood<3>::const_iterator it = nh.begin();
-           it != nh.end(); ++it)
-      {
-        blitz::TinyVector<atb::BlitzIndexT,3> nbPos(posPx + *it);
-        if (blitz::all(nbPos >= 0 && nbPos < L.shape()) &&
-            L(nbPos) > 0) s.insert(L(nbPos));
-      }
-      if (s.size() > 1)
-      {
-        for (std::set<int>::const_iterator it = s.begin();
-             it != s.end(); ++it)
-        {
-          std::set<int>::const_iterator it2 = it;
-          ++it2;
-          for (; it2 != s.end(); ++it2)
-          {
-            nbSets(*it - 1).insert(*it2);
-            nbSets(*it2 - 1).insert(*it);
-          }
-        }
-      }
-    }
-    if (pr != NULL)
-    {
-      if (pr->isAborted()) return;
+      if (pr->isAborted()) return false;
       pr->updateProgressMessage("Searching largest neighborhood");
     }
     size_t maxNeighbors = 0;
-    for (size_t i = 0; i < nbSets.size(); ++i)
-        if (nbSets(i).size() > maxNeighbors) maxNeighbors = nbSets(i).size();
+    for (int i = 1; i <= stats.maxLabel(); ++i)
+        maxNeighbors = std::max(maxNeighbors, stats.neighbors(i).size());
     std::cout << "  Segment with largest neighborhood has " << maxNeighbors
               << " neighbors." << std::endl;
-    blitz::Array<int,2> neighbors(
+    blitz::Array<int,2> &neighbors = features.neighbors;
+    neighbors.resize(
         static_cast<atb::BlitzIndexT>(centers.size()),
         static_cast<atb::BlitzIndexT>(maxNeighbors));
     neighbors = -1;
-    for (int i = 0; i < static_cast<int>(nbSets.size()); ++i)
+    for (int i = 0; i < stats.maxLabel(); ++i)
     {
-      int j = 0;
-      for (std::set<int>::const_iterator it = nbSets(i).begin();
-           it != nbSets(i).end(); ++it, ++j) neighbors(i, j) = *it;
+      std::vector<int> const &nbs = stats.neighbors(i + 1);
+      for (size_t j = 0; j < nbs.size(); ++j)
+          neighbors(i, static_cast<atb::BlitzIndexT>(j)) = nbs[j];
     }
 
+    if (pr != NULL)
+    {
+      pr->setTaskProgressMin(pMin);
+      pr->setTaskProgressMax(pMin + pScale);
+      if (!pr->updateProgress(pMin + pScale)) return false;
+    }
+    return true;
+  }
+
+  void computeCellFeatures(
+      atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
+      double volumeThresholdUm, std::string const &outFileName,
+      std::string const &featureGroup, int backgroundLabel,
+      ProgressReporter *pr)
+  {
+    CellFeatures features;
+    if (!computeCellFeatures(
+            L, sct, volumeThresholdUm, features, backgroundLabel, pr)) return;
+
     if (pr != NULL && !pr->updateProgressMessage(
             "Saving local shape features")) return;
     try
     {
-      BlitzH5File outFile(outFileName, BlitzH5File::WriteOrNew);
-      outFile.writeDataset(validFlag, featureGroup + "/validFlag", 3);
-      outFile.writeDataset(borderFlag, featureGroup + "/borderFlag", 3);
-      outFile.writeDataset(volumes, featureGroup + "/volumes", 3);
-      outFile.writeDataset(centers, featureGroup + "/centers", 3);
-      outFile.writeAttribute(backgroundLabel, "backgroundLabel", featureGroup);
-      outFile.writeAttribute(centers.size(), "maxLabel", featureGroup);
-      outFile.writeDataset(iRoCSCenters, featureGroup + "/normCenters", 3);
-      outFile.writeDataset(localAxes, featureGroup + "/localAxes", 3);
-      outFile.writeDataset(RD, featureGroup + "/RD", 3);
-      outFile.writeDataset(blockSize, featureGroup + "/blockSize", 3);
-      outFile.writeDataset(
-          volumeOverBlock, featureGroup + "/volumeOverBlock", 3);
-      outFile.writeDataset(convexity, featureGroup + "/convexity", 3);
-      outFile.writeDataset(neighbors, featureGroup + "/neighbor", 3);
+      features.save(outFileName, featureGroup);
     }
     catch (BlitzH5Error& e)
     {
       std::cerr << "Something went wrong while processing '" << outFileName
                 << "': " << e.str() << std::endl;
     }
-
-    if (pr != NULL)
-    {
-      pr->setTaskProgressMin(pMin);
-      pr->setTaskProgressMax(pMin + pScale);      
-      pr->updateProgress(pMin + pScale);
-    }
   }
 
 }
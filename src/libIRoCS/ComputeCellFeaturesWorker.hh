@@ -51,51 +51,90 @@ namespace iRoCS
       blitz::TinyVector<double,26> &rd);
 
 /*======================================================================*/
-/*! 
- *   For each label compute the vector of voxel positions with that label
- *   in L. Voxels with intensities <= 0 or the given backgroundLabel are not
- *   added. The voxel positions for the segment with label i will be
- *   returned at index i-1.
+/*!
+ *  \struct CellFeatures ComputeCellFeaturesWorker.hh "libIRoCS/ComputeCellFeaturesWorker.hh"
+ *  \brief The per-segment features and flags computed by
+ *    computeCellFeatures(). Index i refers to the segment with label i + 1.
  *
- *   \param L          The segmentation mask Array
- *   \param voxelSets  For each label compute the set of voxels comprising
- *     the segment with that label. The Array must be given with appropriate
- *     size to fit all labels you are interested in.
- *   \param backgroundLabel Do not collect voxel positions for this label
+ *  See computeCellFeatures() for a description of the individual
+ *  features.
  */
 /*======================================================================*/
-  void computeVoxelSetsPerLabel(
-      atb::Array<int,3> const &L,
-      blitz::Array<std::vector< blitz::TinyVector<atb::BlitzIndexT,3> >,1>
-      &voxelSets, int backgroundLabel, ProgressReporter *pr = NULL);
+  struct CellFeatures
+  {
 
 /*======================================================================*/
-/*! 
- *   Compute a convexity measure for a segment based on sample points.
+/*!
+ *   The number of values of the standard feature vector used for layer
+ *   assignment (normCenters, RD, blockSize, volumeOverBlock and
+ *   convexity).
+ */
+/*======================================================================*/
+    static int const nStandardFeatures = 34;
+
+/*======================================================================*/
+/*!
+ *   The dataset names of the standard features in the order they are
+ *   concatenated to the standard feature vector.
+ */
+/*======================================================================*/
+    static std::vector<std::string> standardFeatureNames();
+
+/*======================================================================*/
+/*!
+ *   Copy the standard feature vector of the given segment to the
+ *   nStandardFeatures values starting at out.
  *
- *   From the given set of segment points, nRandomPairs random pairs are
- *   drawn. If the center point of their connecting line is in the
- *   segment the convexity test returns true and increments the
- *   positive count, otherwise it fails leaving the convexity test count at
- *   its current value. In the end the number of positive test results is
- *   divided by the number of tests to get a value in [0, 1].
+ *   \param segmentIndex The segment index (label - 1)
+ *   \param out          The output buffer
+ */
+/*======================================================================*/
+    void copyStandardFeatures(
+        atb::BlitzIndexT segmentIndex, float *out) const;
+
+/*======================================================================*/
+/*!
+ *   Write all features to the given hdf5 group in the layout read by
+ *   assignLayersToSegmentation() and trainLayerAssignmentToSegmentation().
  *
- *   \param L The segmentation as integer array containing unique labels
- *     for each segment
- *   \param voxelSet A (sub-)set of voxels stemming from the segment
- *   \param nRandomPairs The number of random point pairs to use for the
- *     convexity test
+ *   \exception BlitzH5Error if the features could not be written
+ */
+/*======================================================================*/
+    void save(
+        std::string const &outFileName, std::string const &featureGroup) const;
+
+    int backgroundLabel;
+    blitz::Array<unsigned char,1> validFlag;
+    blitz::Array<unsigned char,1> borderFlag;
+    blitz::Array<double,1> volumes;
+    blitz::Array<blitz::TinyVector<double,3>,1> centers;
+    blitz::Array<blitz::TinyVector<double,3>,1> normCenters;
+    blitz::Array<blitz::TinyMatrix<double,3,3>,1> localAxes;
+    blitz::Array<blitz::TinyVector<double,26>,1> RD;
+    blitz::Array<blitz::TinyVector<double,3>,1> blockSize;
+    blitz::Array<double,1> volumeOverBlock;
+    blitz::Array<double,1> convexity;
+    blitz::Array<int,2> neighbors;
+
+  };
+
+/*======================================================================*/
+/*!
+ *   Compute cell shape features for the given segmentation masks aligned
+ *   to the given iRoCS shell coordinate transform and keep them in memory.
+ *   See the file based variant below for a description of the features
+ *   and parameters.
  *
- *   \return Percentage of positive convexity tests
+ *   \return false if the computation failed or was aborted
  */
 /*======================================================================*/
-  double computeConvexity(
-      atb::Array<int,3> const &L,
-      std::vector< blitz::TinyVector<atb::BlitzIndexT,3> > const &voxelSet,
-      int nRandomPairs = 100000);
+  bool computeCellFeatures(
+      atb::Array<int,3> const &L, ShellCoordinateTransform const &sct,
+      double volumeThresholdUm, CellFeatures &features,
+      int backgroundLabel = -1, ProgressReporter *pr = NULL);
 
 /*======================================================================*/
-/*! 
+/*!
  *   Compute cell shape features for the given segmentation masks aligned
  *   to the given iRoCS shell coordinate transform.
  *   Features that are computed per segment include: \n
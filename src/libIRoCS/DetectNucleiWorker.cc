@@ -28,11 +28,22 @@
 namespace iRoCS
 {
 
+  // The voxel the i-th sample is taken from. An empty voxel list means
+  // that all voxels are sampled in memory order.
+  static inline ptrdiff_t sampleVoxel(
+      std::vector<ptrdiff_t> const &voxels, ptrdiff_t i)
+  {
+    return voxels.empty() ? i : voxels[i];
+  }
+
   void detectNuclei(
       atb::Array<double,3> const &data, std::vector<atb::Nucleus> &nuclei,
       std::string const &modelFileName, ptrdiff_t memoryLimit,
-      std::string const &cacheFileName, ProgressReporter *pr)
+      std::string const &cacheFileName, ProgressReporter *pr,
+      bool useCascade, ptrdiff_t nValidationSamples)
   {
+    BaseTraceRegion trace("detectNuclei");
+
     double sigmaMin = 0.5;
     double sigmaMax = 64.0;
     double sigmaStep = 2.0;
@@ -51,6 +62,7 @@ namespace iRoCS
     }
     try
     {
+      BaseTraceRegion stage("Load normalization parameters");
       features.loadNormalizationParameters(modelFileName);
     }
     catch (std::exception &e)
@@ -68,6 +80,8 @@ namespace iRoCS
       return;
     }
 
+    bool cascade = useCascade && features.loadCascadeParameters(modelFileName);
+
     if (pr != NULL && !pr->updateProgressMessage("Computing chunk size"))
         return;
 
@@ -75,23 +89,123 @@ namespace iRoCS
         blitz::TinyVector<double,3>(data.shape()) * data.elementSizeUm() /
         features.elementSizeUm());
 
-    int nFeatures = 0;
+    std::vector<atb::SDMagFeatureIndex> sdIndices;
     for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
         for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
             for (int band = 0; band <= bandMax - 2 * laplace; ++band)
-                nFeatures++;
+                sdIndices.push_back(
+                    atb::SDMagFeatureIndex(sigma, laplace, band));
+    int nFeatures = static_cast<int>(sdIndices.size());
     nFeatures += 4; // The hough features
 
     ptrdiff_t nVoxels = blitz::product(featureShape);
-    ptrdiff_t memNeeded = nVoxels * nFeatures * sizeof(double);
-    ptrdiff_t nChunks = (memoryLimit != 0) ?
+
+    classification.resize(featureShape);
+    classification.setElementSizeUm(features.elementSizeUm());
+
+    // The linear indices of the voxels to classify using the full SVM
+    // (cascade survivors followed by the validation samples)
+    std::vector<ptrdiff_t> voxels;
+    ptrdiff_t nSurvivors = nVoxels;
+    ptrdiff_t nValidation = 0;
+
+    if (cascade)
+    {
+      BaseTraceRegion stage("Cascade stage");
+      if (pr != NULL && !pr->updateProgressMessage("Applying cascade stage"))
+          return;
+
+      std::vector<int> const &cascadeIndices = features.cascadeFeatureIndices();
+      std::vector<double> const &cascadeWeights = features.cascadeWeights();
+
+      // Accumulate the linear decision values in the classification Array
+      classification = static_cast<float>(features.cascadeBias());
+      for (size_t k = 0; k < cascadeIndices.size(); ++k)
+      {
+        int feaIdx = cascadeIndices[k];
+        atb::Array<double,3> &fea = (feaIdx < nFeatures - 4) ?
+            features.sdFeature(
+                data, sdIndices[feaIdx],
+                bandMax - 2 * sdIndices[feaIdx].l, cacheFileName) :
+            features.houghFeature(
+                data, feaIdx - (nFeatures - 4) +
+                iRoCS::Features::PositiveMagnitude, cacheFileName);
+        if (pr != NULL && pr->isAborted()) return;
+        double w = cascadeWeights[k];
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ptrdiff_t i = 0; i < nVoxels; ++i)
+            classification.data()[i] += static_cast<float>(w * fea.data()[i]);
+
+        // Free the features of the current scale when they are not
+        // needed any more
+        if (feaIdx < nFeatures - 4 &&
+            (k + 1 == cascadeIndices.size() ||
+             cascadeIndices[k + 1] >= nFeatures - 4 ||
+             sdIndices[cascadeIndices[k + 1]].s != sdIndices[feaIdx].s))
+        {
+          for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
+              for (int band = 0; band <= bandMax - 2 * laplace; ++band)
+                  features.deleteFeature(
+                      atb::SDMagFeatureIndex(
+                          sdIndices[feaIdx].s, laplace, band));
+        }
+        else if (feaIdx >= nFeatures - 4)
+            features.deleteFeature(
+                feaIdx - (nFeatures - 4) + iRoCS::Features::PositiveMagnitude);
+
+        if (pr != NULL && !pr->updateProgress(
+                static_cast<int>(
+                    10.0 * static_cast<double>(k + 1) /
+                    static_cast<double>(cascadeIndices.size())))) return;
+      }
+
+      float threshold = static_cast<float>(features.cascadeThreshold());
+      nSurvivors = 0;
+      for (ptrdiff_t i = 0; i < nVoxels; ++i)
+          if (classification.data()[i] >= threshold) nSurvivors++;
+      ptrdiff_t nRejected = nVoxels - nSurvivors;
+      nValidation = std::max(
+          static_cast<ptrdiff_t>(0), std::min(nValidationSamples, nRejected));
+      voxels.resize(nSurvivors + nValidation);
+      ptrdiff_t validationStride =
+          (nValidation > 0) ? nRejected / nValidation : 1;
+      ptrdiff_t survivorIdx = 0, validationIdx = nSurvivors, rejectedIdx = 0;
+      for (ptrdiff_t i = 0; i < nVoxels; ++i)
+      {
+        if (classification.data()[i] >= threshold)
+            voxels[survivorIdx++] = i;
+        else
+        {
+          if (validationIdx < nSurvivors + nValidation &&
+              rejectedIdx % validationStride == 0)
+              voxels[validationIdx++] = i;
+          rejectedIdx++;
+          classification.data()[i] = -1.0f;
+        }
+      }
+
+      std::cout << "  Cascade stage rejected " << nRejected << " of "
+                << nVoxels << " voxels (rejection rate "
+                << static_cast<double>(nRejected) /
+          static_cast<double>(nVoxels) << ")" << std::endl;
+    }
+
+    // Without cascade all voxels are classified in memory order and no
+    // voxel index is built
+    ptrdiff_t nSamples =
+        cascade ? static_cast<ptrdiff_t>(voxels.size()) : nVoxels;
+    ptrdiff_t memNeeded = nSamples * nFeatures * sizeof(double);
+    ptrdiff_t nChunks = (nSamples == 0) ? 0 : ((memoryLimit != 0) ?
         (memNeeded / memoryLimit + ((memNeeded % memoryLimit > 0) ? 1 : 0)) :
-        1;
-    ptrdiff_t chunkSize = nVoxels / nChunks;
-    ptrdiff_t residualFeatures = nVoxels % nChunks;
+        1);
+    ptrdiff_t chunkSize = (nChunks != 0) ? nSamples / nChunks : 0;
+    ptrdiff_t residualFeatures = (nChunks != 0) ? nSamples % nChunks : 0;
 
     std::cout << "Classifying in " << nChunks << " chunk"
-              << ((nChunks > 1) ? "s" : "") << " with chunksize "
+              << ((nChunks != 1) ? "s" : "") << " with chunksize "
               << chunkSize << " (" << chunkSize * nFeatures *
         sizeof(double) / 1024 / 1024 << " MB)" << std::endl;
 
@@ -104,12 +218,11 @@ namespace iRoCS
     for (size_t i = 0; i < testVectors.size(); ++i)
         testVectors[i].resize(nFeatures);
 
-    classification.resize(featureShape);
-    classification.setElementSizeUm(features.elementSizeUm());
-
     if (pr != NULL && pr->isAborted()) return;
 
-    double progressPerChunk = 100.0 / static_cast<double>(nChunks);
+    double progressOffset = cascade ? 10.0 : 0.0;
+    double progressPerChunk = (nChunks != 0) ?
+        (100.0 - progressOffset) / static_cast<double>(nChunks) : 0.0;
     double progressLoadFeatures = progressPerChunk * 0.1;
     double progressStepPerFeatureLoad = progressLoadFeatures / nFeatures;
     double progressClassify = progressPerChunk - progressLoadFeatures;
@@ -118,6 +231,7 @@ namespace iRoCS
     for (ptrdiff_t chunk = 0; chunk < nChunks;
          ++chunk, currentPos += testVectors.size())
     {
+      BaseTraceRegion stage("Classify chunk");
       if (chunk != 0) testVectors.resize(chunkSize);
 
       // Compute SD features
@@ -138,9 +252,11 @@ namespace iRoCS
 #endif
             for (ptrdiff_t j = 0;
                  j < static_cast<ptrdiff_t>(testVectors.size()); ++j)
-                testVectors[j][feaIdx] = fea.data()[currentPos + j];
+                testVectors[j][feaIdx] =
+                    fea.data()[sampleVoxel(voxels, currentPos + j)];
 
             int progress = static_cast<int>(
+                progressOffset +
                 static_cast<double>(chunk) * progressPerChunk +
                 static_cast<double>(feaIdx) * progressStepPerFeatureLoad);
             if (pr != NULL && !pr->updateProgress(progress)) return;
@@ -167,9 +283,11 @@ namespace iRoCS
 #endif
         for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(testVectors.size());
              ++j)
-            testVectors[j][feaIdx] = fea.data()[currentPos + j];
+            testVectors[j][feaIdx] =
+                fea.data()[sampleVoxel(voxels, currentPos + j)];
 
         int progress = static_cast<int>(
+            progressOffset +
             static_cast<double>(chunk) * progressPerChunk +
             static_cast<double>(feaIdx) * progressStepPerFeatureLoad);
         if (pr != NULL &&
@@ -183,9 +301,11 @@ namespace iRoCS
       features.normalizeFeatures(testVectors);
     
       if (pr != NULL) pr->setTaskProgressRange(
-          static_cast<int>(static_cast<double>(chunk) * progressPerChunk +
+          static_cast<int>(progressOffset +
+                           static_cast<double>(chunk) * progressPerChunk +
                            static_cast<double>(progressLoadFeatures)),
-          static_cast<int>(static_cast<double>(chunk) * progressPerChunk +
+          static_cast<int>(progressOffset +
+                           static_cast<double>(chunk) * progressPerChunk +
                            static_cast<double>(
                                progressLoadFeatures + progressClassify)));
 
@@ -197,9 +317,33 @@ namespace iRoCS
 #pragma omp parallel for
 #endif
       for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(testVectors.size()); ++j)
-          classification.data()[currentPos + j] =
+          classification.data()[sampleVoxel(voxels, currentPos + j)] =
               static_cast<float>(testVectors[j].getLabel());
     }
+
+    if (cascade && nValidation > 0)
+    {
+      // Extrapolate the positive rate of the validation samples to all
+      // rejected voxels to estimate the voxel-level recall loss
+      ptrdiff_t nPositiveSurvivors = 0, nPositiveValidation = 0;
+      for (ptrdiff_t j = 0; j < nSurvivors; ++j)
+          if (classification.data()[voxels[j]] > 0.0f) nPositiveSurvivors++;
+      for (ptrdiff_t j = nSurvivors; j < nSamples; ++j)
+      {
+        if (classification.data()[voxels[j]] > 0.0f) nPositiveValidation++;
+        // Validation samples keep being rejected
+        classification.data()[voxels[j]] = -1.0f;
+      }
+      double nMissed = static_cast<double>(nPositiveValidation) *
+          static_cast<double>(nVoxels - nSurvivors) /
+          static_cast<double>(nValidation);
+      double recallLoss = (nMissed + nPositiveSurvivors > 0.0) ?
+          nMissed / (nMissed + static_cast<double>(nPositiveSurvivors)) : 0.0;
+      std::cout << "  " << nPositiveValidation << " of " << nValidation
+                << " rejected validation voxels were classified positive "
+                << "(estimated recall loss " << recallLoss << ")"
+                << std::endl;
+    }
   
     if (pr != NULL) pr->updateProgressMessage(
         "Freeing memory used up by features");
@@ -212,6 +356,7 @@ namespace iRoCS
               ":/decisionValues'")) return;
       try
       {
+        BaseTraceRegion stage("Save decision values");
         classification.save(cacheFileName, "/decisionValues", 1, pr);
       }
       catch (BlitzH5Error &e)
@@ -225,8 +370,11 @@ namespace iRoCS
         return;
 
     std::vector< blitz::TinyVector<ptrdiff_t,3> > lcMax;
-    atb::extractLocalMaxima(
-        classification, lcMax, 0.0f, atb::SIMPLE_NHOOD, pr);
+    {
+      BaseTraceRegion stage("Extract local maxima");
+      atb::extractLocalMaxima(
+          classification, lcMax, 0.0f, atb::SIMPLE_NHOOD, pr);
+    }
     std::cout << "  " << lcMax.size() << " local maxima extracted" << std::endl;
 
     if (pr != NULL && pr->isAborted()) return;
@@ -234,6 +382,7 @@ namespace iRoCS
     // Remove overlapping detections
     if (pr != NULL && !pr->updateProgressMessage("Removing overlapping nuclei"))
         return;
+    BaseTraceRegion stage("Remove overlapping nuclei");
     std::vector<atb::Nucleus> ncTmp;
     for (size_t i = 0; i < lcMax.size(); ++i)
     {
@@ -35,10 +35,43 @@
 namespace iRoCS
 {
   
+/*======================================================================*/
+/*! 
+ *   Detect nuclei in the given dataset using the given detector model.
+ *
+ *   If the model contains a linear early-reject stage (see
+ *   Features::trainCascade()) and useCascade is true, all voxels are first
+ *   classified using the cheap cascade features only. Only voxels passing
+ *   this stage are classified with the full SVM. The number of full
+ *   feature vectors (and thus the number of chunks and feature
+ *   recomputations) is restricted to the surviving voxels.
+ *
+ *   To estimate the recall loss of the cascade, nValidationSamples of the
+ *   rejected voxels (regularly sampled) are additionally classified with
+ *   the full SVM. The fraction of them being classified positive is
+ *   extrapolated to all rejected voxels.
+ *
+ *   \param data               The dataset to detect nuclei in
+ *   \param nuclei             The detected nuclei are appended to this
+ *     vector
+ *   \param modelFileName      The detector model (svmtl hdf5 model)
+ *   \param memoryLimit        The memory in bytes to use for feature
+ *     vectors at most. Pass 0 for no limit.
+ *   \param cacheFileName      If not empty, features are read from and
+ *     written to the given file
+ *   \param pr                 If not NULL, progress is reported using this
+ *     progress reporter
+ *   \param useCascade         If false, the full SVM is evaluated for all
+ *     voxels even if the model contains a cascade stage
+ *   \param nValidationSamples The number of rejected voxels to
+ *     additionally classify using the full SVM for recall loss estimation
+ */
+/*======================================================================*/
   void detectNuclei(
       atb::Array<double,3> const &data, std::vector<atb::Nucleus> &nuclei,
       std::string const &modelFileName, ptrdiff_t memoryLimit,
-      std::string const &cacheFileName = "", ProgressReporter *pr = NULL);
+      std::string const &cacheFileName = "", ProgressReporter *pr = NULL,
+      bool useCascade = true, ptrdiff_t nValidationSamples = 1000);
 
 }
 
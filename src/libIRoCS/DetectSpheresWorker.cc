@@ -23,8 +23,10 @@
 #include "DetectSpheresWorker.hh"
 
 #include <libArrayToolbox/GaussianFilter.hh>
+#include <libArrayToolbox/GaussianScaleSpace.hh>
 #include <libArrayToolbox/HoughTransform.hh>
 #include <libArrayToolbox/LocalMaximumExtraction.hh>
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace iRoCS
 {
@@ -35,8 +37,9 @@ namespace iRoCS
       blitz::TinyVector<double,2> const &radiusRangeUm, double radiusStepUm,
       double preSmoothingSigmaUm, double postSmoothingSigmaUm,
       double minMagnitude, bool invertGradients, double gamma,
-      ProgressReporter *pr)
+      ProgressReporter *pr, bool useScaleSpace)
   {
+    BaseTraceRegion trace("detectSpheres");
     double pStart = (pr != NULL) ? pr->taskProgressMin() : 0.0;
     double pScale = (pr != NULL) ? (pr->taskProgressMax() - pStart) : 1.0;
     
@@ -57,6 +60,10 @@ namespace iRoCS
 
     if (pr != NULL && !pr->updateProgress(0.02 * pScale + pStart)) return;
 
+    // If requested, pre- and post-smoothing share the kernels of one scale
+    // space
+    atb::GaussianScaleSpace<float,3> scaleSpace(atb::RepeatBT);
+
     // Apply pre-smoothing
     if (preSmoothingSigmaUm > 0.0)
     {
@@ -69,7 +76,9 @@ namespace iRoCS
         pr->setTaskProgressMin(pr->progress());
         pr->setTaskProgressMax(0.05 * pScale + pStart);
       }
-      filter.apply(dataProc, dataProc, pr);
+      if (useScaleSpace)
+          scaleSpace.smooth(dataProc, preSmoothingSigmaUm, dataProc, pr);
+      else filter.apply(dataProc, dataProc, pr);
     }
     if (pr != NULL && !pr->updateProgress(0.05 * pScale + pStart)) return;
 
@@ -103,7 +112,9 @@ namespace iRoCS
         pr->setTaskProgressMin(pr->progress());
         pr->setTaskProgressMax(0.95 * pScale + pStart);
       }
-      filter.apply(response, response);
+      if (useScaleSpace)
+          scaleSpace.smooth(response, postSmoothingSigmaUm, response);
+      else filter.apply(response, response);
     }
 
     if (pr != NULL && !pr->updateProgressMessage("Extracting local maxima"))
@@ -41,7 +41,8 @@ namespace iRoCS
       blitz::TinyVector<double,2> const &radiusRangeUm, double radiusStepUm,
       double preSmoothingSigmaUm, double postSmoothingSigmaUm,
       double minMagnitude = 0.0, bool invertGradients = false,
-      double gamma = 1.0, ProgressReporter *pr = NULL);
+      double gamma = 1.0, ProgressReporter *pr = NULL,
+      bool useScaleSpace = false);
 
 }
 
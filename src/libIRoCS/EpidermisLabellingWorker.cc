@@ -22,6 +22,7 @@
 
 #include "EpidermisLabellingWorker.hh"
 #include "iRoCSFeatures.hh"
+#include "PointSampledFeatures.hh"
 
 namespace iRoCS
 {
@@ -31,6 +32,7 @@ namespace iRoCS
       std::string const &modelFileName, std::string const &cacheFileName,
       bool forceFeatureComputation, ProgressReporter *pr)
   {
+    BaseTraceRegion trace("labelEpidermis");
     double sigmaMin = 0.5;
     double sigmaMax = 64.0;
     double sigmaStep = 2.0;
@@ -111,78 +113,19 @@ namespace iRoCS
     
     if (needsFeatureUpdate)
     {
+      BaseTraceRegion stage("Compute features");
       if (pr != NULL)
       {
         pr->updateProgressMessage("Preparing feature vectors");
         if (!pr->updateProgress(4)) return;
       }
       
-      // Compute SD features
-      int feaIdx = 0;
-      for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
-      {
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-        {
-          int maxBand = bandMax - 2 * laplace;
-          for (int band = 0; band <= maxBand; ++band, ++feaIdx)
-          {
-            if (pr != NULL && pr->isAborted()) return;
-            atb::Array<double,3> &fea = features.sdFeature(
-                data, atb::SDMagFeatureIndex(sigma, laplace, band), maxBand,
-                cacheFileName);
-          
-            atb::LinearInterpolator<double,3> ip(atb::ValueBT);
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-            for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nuclei.size());
-                 ++j)
-            {
-              if (!nuclei[j].needsFeatureUpdate() ||
-                  (pr != NULL && pr->isAborted())) continue;
-              blitz::TinyVector<double,3> pos(
-                  nuclei[j].positionUm() / features.elementSizeUm());
-              nuclei[j].features()[feaIdx] = ip.get(fea, pos);
-            }
-            
-            progress += progressStepPerFeatureLoad;
-            if (pr != NULL) pr->updateProgress(static_cast<int>(progress));
-          }
-          for (int band = 1; band <= bandMax - 2 * laplace; ++band)
-              features.deleteFeature(
-                  atb::SDMagFeatureIndex(sigma, laplace, band));
-        }
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-            features.deleteFeature(atb::SDMagFeatureIndex(sigma, laplace, 0));
-        features.deleteFeature(atb::SDMagFeatureIndex(sigma, 0, 0));
-      }
-      
-      // Compute hough features
-      for (int i = iRoCS::Features::PositiveMagnitude;
-           i <= iRoCS::Features::NegativeRadius; ++i, ++feaIdx)
-      {
-        atb::Array<double,3> &fea =
-            features.houghFeature(data, i, cacheFileName);
-        
-        atb::LinearInterpolator<double,3> ip(atb::ValueBT);
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-        for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nuclei.size()); ++j)
-        {
-          if (!nuclei[j].needsFeatureUpdate() ||
-              (pr != NULL && pr->isAborted())) continue;
-          blitz::TinyVector<double,3> pos(
-              nuclei[j].positionUm() / features.elementSizeUm());
-          nuclei[j].features()[feaIdx] = ip.get(fea, pos);
-        }
-        
-        features.deleteFeature(i);
-        progress += progressStepPerFeatureLoad;
-        
-        if (pr != NULL &&
-            !pr->updateProgress(static_cast<int>(progress))) return;
-      }
+      // Evaluate the features only in windows around the nuclei that need
+      // an update instead of computing whole-volume feature stacks
+      if (!PointSampledFeatures::updateNucleusFeatures(
+              features.dataScaled(data, cacheFileName), nuclei, sigmaMin,
+              sigmaMax, sigmaStep, bandMax, progressStepPerFeatureLoad,
+              progress, pr)) return;
     }
     else
     {
@@ -0,0 +1,165 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "FeatureCache.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace iRoCS
+{
+
+  // FNV-1a offset basis and prime, applied to 64 bit words instead of
+  // bytes
+  static unsigned long long const fnvOffsetBasis = 14695981039346656037ULL;
+  static unsigned long long const fnvPrime = 1099511628211ULL;
+
+  // Raw data is hashed in blocks of this size, the block hashes are then
+  // combined in order
+  static size_t const hashBlockSize = 1 << 20;
+
+  static unsigned long long hashBlock(unsigned char const *data, size_t nBytes)
+  {
+    unsigned long long hash = fnvOffsetBasis;
+    size_t i = 0;
+    for (; i + sizeof(unsigned long long) <= nBytes;
+         i += sizeof(unsigned long long))
+    {
+      unsigned long long word;
+      std::memcpy(&word, data + i, sizeof(unsigned long long));
+      hash = (hash ^ word) * fnvPrime;
+    }
+    for (; i < nBytes; ++i)
+        hash = (hash ^ static_cast<unsigned long long>(data[i])) * fnvPrime;
+    return hash;
+  }
+
+  FeatureCacheKey::FeatureCacheKey()
+          : _hash(fnvOffsetBasis)
+  {}
+
+  FeatureCacheKey::FeatureCacheKey(std::string const &parentKey)
+          : _hash(fnvOffsetBasis)
+  {
+    *this << parentKey;
+  }
+
+  FeatureCacheKey &FeatureCacheKey::operator<<(std::string const &value)
+  {
+    _mix(static_cast<unsigned long long>(value.size()));
+    _mix(hashBlock(
+             reinterpret_cast<unsigned char const*>(value.data()),
+             value.size()));
+    return *this;
+  }
+
+  FeatureCacheKey &FeatureCacheKey::operator<<(char const *value)
+  {
+    return *this << std::string(value);
+  }
+
+  FeatureCacheKey &FeatureCacheKey::operator<<(int value)
+  {
+    _mix(static_cast<unsigned long long>(static_cast<long long>(value)));
+    return *this;
+  }
+
+  FeatureCacheKey &FeatureCacheKey::operator<<(double value)
+  {
+    unsigned long long word = 0;
+    std::memcpy(&word, &value, sizeof(double));
+    _mix(word);
+    return *this;
+  }
+
+  FeatureCacheKey &FeatureCacheKey::addData(void const *data, size_t nBytes)
+  {
+    unsigned char const *bytes = static_cast<unsigned char const*>(data);
+    ptrdiff_t nBlocks = static_cast<ptrdiff_t>(
+        (nBytes + hashBlockSize - 1) / hashBlockSize);
+    std::vector<unsigned long long> blockHashes(nBlocks);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ptrdiff_t i = 0; i < nBlocks; ++i)
+    {
+      size_t offset = static_cast<size_t>(i) * hashBlockSize;
+      blockHashes[i] = hashBlock(
+          bytes + offset, std::min(hashBlockSize, nBytes - offset));
+    }
+    _mix(static_cast<unsigned long long>(nBytes));
+    for (ptrdiff_t i = 0; i < nBlocks; ++i) _mix(blockHashes[i]);
+    return *this;
+  }
+
+  std::string FeatureCacheKey::str() const
+  {
+    // Final avalanche, so that similar inputs give dissimilar keys
+    unsigned long long hash = _hash;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    std::stringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return out.str();
+  }
+
+  void FeatureCacheKey::_mix(unsigned long long word)
+  {
+    _hash = (_hash ^ word) * fnvPrime;
+  }
+
+  std::string const FeatureCache::keyAttribute = "cache_key";
+
+  bool FeatureCache::isValid(
+      std::string const &cacheFileName, std::string const &dsName,
+      std::string const &key)
+  {
+    if (cacheFileName == "") return false;
+    try
+    {
+      BlitzH5File inFile(cacheFileName);
+      return _isValid(inFile, dsName, key);
+    }
+    catch (BlitzH5Error &)
+    {
+      return false;
+    }
+  }
+
+  bool FeatureCache::_isValid(
+      BlitzH5File const &cacheFile, std::string const &dsName,
+      std::string const &key)
+  {
+    if (!cacheFile.existsDataset(dsName) ||
+        !cacheFile.existsAttribute(keyAttribute, dsName)) return false;
+    std::string storedKey;
+    cacheFile.readAttribute(storedKey, keyAttribute, dsName);
+    return storedKey == key;
+  }
+
+}
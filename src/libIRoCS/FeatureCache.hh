@@ -0,0 +1,228 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef IROCSFEATURECACHE_HH
+#define IROCSFEATURECACHE_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <string>
+
+#include <libArrayToolbox/Array.hh>
+#include <libProgressReporter/ProgressReporter.hh>
+
+namespace iRoCS
+{
+
+/*======================================================================*/
+/*!
+ *  \class FeatureCacheKey FeatureCache.hh "libIRoCS/FeatureCache.hh"
+ *  \brief 64 bit fingerprint identifying the content of a cached feature.
+ *
+ *  A key is built by streaming everything a feature depends on into it:
+ *  the key of the feature it is computed from, the name of the operation
+ *  and its parameters. The key of the root of the dependency chain
+ *  additionally hashes the raw input data. Changing the input or any
+ *  parameter along the chain therefore changes the keys of all derived
+ *  features, while features that do not depend on the change keep their
+ *  key.
+ */
+/*======================================================================*/
+  class FeatureCacheKey
+  {
+
+  public:
+
+    FeatureCacheKey();
+
+/*======================================================================*/
+/*!
+ *   Start a key for a feature derived from the feature with the given key.
+ *
+ *   \param parentKey The key of the input feature as returned by str()
+ */
+/*======================================================================*/
+    explicit FeatureCacheKey(std::string const &parentKey);
+
+    FeatureCacheKey &operator<<(std::string const &value);
+    FeatureCacheKey &operator<<(char const *value);
+    FeatureCacheKey &operator<<(int value);
+    FeatureCacheKey &operator<<(double value);
+
+    template<typename DataT, int Dim>
+    FeatureCacheKey &operator<<(blitz::TinyVector<DataT,Dim> const &value)
+    {
+      for (int d = 0; d < Dim; ++d) *this << value(d);
+      return *this;
+    }
+
+/*======================================================================*/
+/*!
+ *   Add the given raw memory block to the key. Large blocks are hashed
+ *   chunk-wise in parallel; the result does not depend on the number of
+ *   threads.
+ *
+ *   \param data   Pointer to the first byte
+ *   \param nBytes The number of bytes to hash
+ */
+/*======================================================================*/
+    FeatureCacheKey &addData(void const *data, size_t nBytes);
+
+/*======================================================================*/
+/*!
+ *   Get the key as 16 digit hexadecimal string.
+ */
+/*======================================================================*/
+    std::string str() const;
+
+  private:
+
+    void _mix(unsigned long long word);
+
+    unsigned long long _hash;
+
+  };
+
+/*======================================================================*/
+/*!
+ *  \class FeatureCache FeatureCache.hh "libIRoCS/FeatureCache.hh"
+ *  \brief Key-verified access to the features cached in an hdf5 file.
+ *
+ *  Every cached dataset carries the key of its content in the
+ *  'cache_key' attribute. A dataset is only loaded if its key matches
+ *  the expected key, otherwise it is treated as missing and recomputed.
+ *  Datasets written by older versions without key are therefore never
+ *  reused. The key is removed before and written after the data, so an
+ *  interrupted write leaves a dataset that is recognized as stale.
+ */
+/*======================================================================*/
+  class FeatureCache
+  {
+
+  public:
+
+    static std::string const keyAttribute;
+
+/*======================================================================*/
+/*!
+ *   Check whether the given cache dataset exists and holds content with
+ *   the given key.
+ *
+ *   \param cacheFileName The hdf5 cache file
+ *   \param dsName        The dataset name
+ *   \param key           The expected cache key
+ *
+ *   \return \c true if the cache entry is valid, \c false otherwise
+ */
+/*======================================================================*/
+    static bool isValid(
+        std::string const &cacheFileName, std::string const &dsName,
+        std::string const &key);
+
+/*======================================================================*/
+/*!
+ *   Load the given cache dataset if it holds content with the given key.
+ *
+ *   \param array         The Array to load the data to
+ *   \param cacheFileName The hdf5 cache file
+ *   \param dsName        The dataset name
+ *   \param key           The expected cache key
+ *   \param pr            If given, progress is reported to this reporter
+ *
+ *   \return \c true if the Array was loaded, \c false if the cache entry
+ *     is missing, stale or cannot be read
+ */
+/*======================================================================*/
+    template<typename DataT, int Dim>
+    static bool load(
+        atb::Array<DataT,Dim> &array, std::string const &cacheFileName,
+        std::string const &dsName, std::string const &key,
+        ProgressReporter *pr = NULL);
+
+/*======================================================================*/
+/*!
+ *   Save the given Array to the cache and tag it with the given key.
+ *
+ *   \param array         The Array to save
+ *   \param cacheFileName The hdf5 cache file
+ *   \param dsName        The dataset name
+ *   \param key           The cache key of the Array content
+ *   \param pr            If given, progress is reported to this reporter
+ *
+ *   \exception BlitzH5Error if the cache entry cannot be written
+ */
+/*======================================================================*/
+    template<typename DataT, int Dim>
+    static void save(
+        atb::Array<DataT,Dim> const &array, std::string const &cacheFileName,
+        std::string const &dsName, std::string const &key,
+        ProgressReporter *pr = NULL);
+
+  private:
+
+    static bool _isValid(
+        BlitzH5File const &cacheFile, std::string const &dsName,
+        std::string const &key);
+
+  };
+
+  template<typename DataT, int Dim>
+  bool FeatureCache::load(
+      atb::Array<DataT,Dim> &array, std::string const &cacheFileName,
+      std::string const &dsName, std::string const &key,
+      ProgressReporter *pr)
+  {
+    if (cacheFileName == "") return false;
+    try
+    {
+      BlitzH5File inFile(cacheFileName);
+      if (!_isValid(inFile, dsName, key)) return false;
+      array.load(inFile, dsName, pr);
+      return true;
+    }
+    catch (BlitzH5Error &)
+    {
+      return false;
+    }
+  }
+
+  template<typename DataT, int Dim>
+  void FeatureCache::save(
+      atb::Array<DataT,Dim> const &array, std::string const &cacheFileName,
+      std::string const &dsName, std::string const &key,
+      ProgressReporter *pr)
+  {
+    BlitzH5File outFile(cacheFileName, BlitzH5File::WriteOrNew);
+    // Existing datasets of compatible type are overwritten in place
+    // keeping their attributes, so invalidate the old key first
+    if (outFile.existsDataset(dsName) &&
+        outFile.existsAttribute(keyAttribute, dsName))
+        outFile.deleteAttribute(keyAttribute, dsName);
+    array.save(outFile, dsName, 0, pr);
+    outFile.writeAttribute(key, keyAttribute, dsName);
+  }
+
+}
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "LayerAssignmentWorker.hh"
 #include "iRoCSFeatures.hh"
+#include "PointSampledFeatures.hh"
 
 namespace iRoCS
 {
@@ -33,6 +34,7 @@ namespace iRoCS
       bool cacheCoordinates, bool forceFeatureComputation,
       ProgressReporter *pr)
   {
+    BaseTraceRegion trace("assignLayers");
     double sigmaMin = 0.5;
     double sigmaMax = 64.0;
     double sigmaStep = 2.0;
@@ -113,78 +115,19 @@ namespace iRoCS
     
     if (needsFeatureUpdate)
     {
+      BaseTraceRegion stage("Compute features");
       if (pr != NULL)
       {
         pr->updateProgressMessage("Preparing feature vectors");
         if (!pr->updateProgress(4)) return;
       }
       
-      // Compute SD features
-      int feaIdx = 0;
-      for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
-      {
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-        {
-          int maxBand = bandMax - 2 * laplace;
-          for (int band = 0; band <= maxBand; ++band, ++feaIdx)
-          {
-            if (pr != NULL && pr->isAborted()) return;
-            atb::Array<double,3> &fea = features.sdFeature(
-                data, atb::SDMagFeatureIndex(sigma, laplace, band), maxBand,
-                cacheFileName);
-          
-            atb::LinearInterpolator<double,3> ip(atb::ValueBT);
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-            for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nuclei.size());
-                 ++j)
-            {
-              if (!nuclei[j].needsFeatureUpdate() ||
-                  (pr != NULL && pr->isAborted())) continue;
-              blitz::TinyVector<double,3> pos(
-                  nuclei[j].positionUm() / features.elementSizeUm());
-              nuclei[j].features()[feaIdx] = ip.get(fea, pos);
-            }
-            
-            progress += progressStepPerFeatureLoad;
-            if (pr != NULL) pr->updateProgress(static_cast<int>(progress));
-          }
-          for (int band = 1; band <= bandMax - 2 * laplace; ++band)
-              features.deleteFeature(
-                  atb::SDMagFeatureIndex(sigma, laplace, band));
-        }
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-            features.deleteFeature(atb::SDMagFeatureIndex(sigma, laplace, 0));
-        features.deleteFeature(atb::SDMagFeatureIndex(sigma, 0, 0));
-      }
-      
-      // Compute hough features
-      for (int i = iRoCS::Features::PositiveMagnitude;
-           i <= iRoCS::Features::NegativeRadius; ++i, ++feaIdx)
-      {
-        atb::Array<double,3> &fea =
-            features.houghFeature(data, i, cacheFileName);
-        
-        atb::LinearInterpolator<double,3> ip(atb::ValueBT);
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-        for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nuclei.size()); ++j)
-        {
-          if (!nuclei[j].needsFeatureUpdate() ||
-              (pr != NULL && pr->isAborted())) continue;
-          blitz::TinyVector<double,3> pos(
-              nuclei[j].positionUm() / features.elementSizeUm());
-          nuclei[j].features()[feaIdx] = ip.get(fea, pos);
-        }
-        
-        features.deleteFeature(i);
-        progress += progressStepPerFeatureLoad;
-        
-        if (pr != NULL &&
-            !pr->updateProgress(static_cast<int>(progress))) return;
-      }
+      // Evaluate the features only in windows around the nuclei that need
+      // an update instead of computing whole-volume feature stacks
+      if (!PointSampledFeatures::updateNucleusFeatures(
+              features.dataScaled(data, cacheFileName), nuclei, sigmaMin,
+              sigmaMax, sigmaStep, bandMax, progressStepPerFeatureLoad,
+              progress, pr)) return;
     }
     else
     {
@@ -207,14 +150,14 @@ namespace iRoCS
         features.intrinsicCoordinates(data, iRoCS, cacheFileName);
 
     // Compute intrinsic coordinate features for markers
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(nuclei.size()); ++j)
+    std::vector< blitz::TinyVector<double,3> > positionsUm(nuclei.size());
+    for (size_t j = 0; j < nuclei.size(); ++j)
+        positionsUm[j] = nuclei[j].positionUm();
+    std::vector< blitz::TinyVector<double,3> > coordinates;
+    iRoCS.getCoordinates(positionsUm, coordinates);
+    for (size_t j = 0; j < nuclei.size(); ++j)
     {
-      if (pr != NULL && pr->isAborted()) continue;
-      blitz::TinyVector<double,3> p(
-          iRoCS.getCoordinates(nuclei[j].positionUm()));
+      blitz::TinyVector<double,3> const &p = coordinates[j];
       testVectors[j][nFeatures] = p(2);
       testVectors[j][nFeatures + 1] = p(0);
       testVectors[j][nFeatures + 2] = p(1);
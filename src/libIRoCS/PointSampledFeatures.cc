@@ -0,0 +1,766 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "PointSampledFeatures.hh"
+#include "iRoCSFeatures.hh"
+
+#include <libArrayToolbox/ATBDataSynthesis.hh>
+#include <libBaseFunctions/BaseTrace.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+namespace iRoCS
+{
+
+  typedef blitz::TinyVector<atb::BlitzIndexT,3> BoxIndexT;
+
+  const atb::BlitzIndexT PointSampledFeatures::WindowSize = 16;
+
+  static atb::BlitzIndexT clampIndex(atb::BlitzIndexT i, atb::BlitzIndexT n)
+  {
+    return (i < 0) ? 0 : ((i >= n) ? n - 1 : i);
+  }
+
+  // Grow the box [lb, ub] by margin voxels and clip it to the volume
+  static void growBox(
+      BoxIndexT const &lb, BoxIndexT const &ub, BoxIndexT const &margin,
+      BoxIndexT const &shape, BoxIndexT &lbOut, BoxIndexT &ubOut)
+  {
+    for (int d = 0; d < 3; ++d)
+    {
+      lbOut(d) = std::max(lb(d) - margin(d), atb::BlitzIndexT(0));
+      ubOut(d) = std::min(ub(d) + margin(d), shape(d) - 1);
+    }
+  }
+
+  // Allocate an Array indexed by the volume coordinates of the box
+  static void allocateBox(
+      BoxIndexT const &lb, BoxIndexT const &ub, blitz::Array<double,3> &box)
+  {
+    BoxIndexT extent;
+    for (int d = 0; d < 3; ++d) extent(d) = ub(d) - lb(d) + 1;
+    blitz::Array<double,3> tmp(lb, extent);
+    box.reference(tmp);
+  }
+
+  // Reverse a convolution kernel for correlation
+  static void correlationKernel(
+      blitz::Array<double,1> const &kernel, std::vector<double> &out)
+  {
+    ptrdiff_t m = kernel.size();
+    out.resize(m);
+    for (ptrdiff_t i = 0; i < m; ++i) out[i] = kernel.data()[m - 1 - i];
+  }
+
+  // The box filtered in pass dim of a separable filter producing [lb, ub]:
+  // already filtered dimensions are restricted to the box, the remaining
+  // ones carry the halo of their kernels
+  static void passBox(
+      BoxIndexT const &lb, BoxIndexT const &ub,
+      std::vector< std::vector<double> > const &kernels,
+      BoxIndexT const &shape, int dim, BoxIndexT &lbOut, BoxIndexT &ubOut)
+  {
+    for (int d = 0; d < 3; ++d)
+    {
+      atb::BlitzIndexT radius = (d > dim) ?
+          static_cast<atb::BlitzIndexT>(kernels[d].size() / 2) : 0;
+      lbOut(d) = std::max(lb(d) - radius, atb::BlitzIndexT(0));
+      ubOut(d) = std::min(ub(d) + radius, shape(d) - 1);
+    }
+  }
+
+  static double smoothingCost(
+      BoxIndexT const &lb, BoxIndexT const &ub,
+      std::vector< std::vector<double> > const &kernels,
+      BoxIndexT const &shape)
+  {
+    double cost = 0.0;
+    for (int dim = 0; dim < 3; ++dim)
+    {
+      BoxIndexT l, u;
+      passBox(lb, ub, kernels, shape, dim, l, u);
+      cost += static_cast<double>(u(0) - l(0) + 1) *
+          static_cast<double>(u(1) - l(1) + 1) *
+          static_cast<double>(u(2) - l(2) + 1) *
+          static_cast<double>(kernels[dim].size());
+    }
+    return cost;
+  }
+
+  // Correlate the lines of in along dim with repeat boundary treatment
+  // for every voxel of out. in must contain the clamped line neighborhoods.
+  static void correlateAlongDim(
+      blitz::Array<double,3> const &in, std::vector<double> const &kernel,
+      int dim, BoxIndexT const &shape, blitz::Array<double,3> &out)
+  {
+    int a = (dim + 1) % 3;
+    int b = (dim + 2) % 3;
+    ptrdiff_t m = kernel.size();
+    ptrdiff_t center = m / 2;
+    ptrdiff_t n = out.extent(dim);
+    ptrdiff_t nLines =
+        static_cast<ptrdiff_t>(out.extent(a)) * out.extent(b);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<double> line(n + m - 1);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+      for (ptrdiff_t i = 0; i < nLines; ++i)
+      {
+        BoxIndexT p;
+        p(a) = out.lbound(a) + static_cast<atb::BlitzIndexT>(
+            i / out.extent(b));
+        p(b) = out.lbound(b) + static_cast<atb::BlitzIndexT>(
+            i % out.extent(b));
+        for (ptrdiff_t t = 0; t < n + m - 1; ++t)
+        {
+          p(dim) = clampIndex(
+              out.lbound(dim) + static_cast<atb::BlitzIndexT>(t - center),
+              shape(dim));
+          line[t] = in(p);
+        }
+        for (ptrdiff_t t = 0; t < n; ++t)
+        {
+          double f = 0.0;
+          for (ptrdiff_t k = 0; k < m; ++k) f += kernel[k] * line[t + k];
+          p(dim) = out.lbound(dim) + static_cast<atb::BlitzIndexT>(t);
+          out(p) = f;
+        }
+      }
+    }
+  }
+
+  // Apply the separable correlation kernels to in for the box [lb, ub]
+  static void smoothBox(
+      blitz::Array<double,3> const &in,
+      std::vector< std::vector<double> > const &kernels,
+      BoxIndexT const &shape, BoxIndexT const &lb, BoxIndexT const &ub,
+      blitz::Array<double,3> &out)
+  {
+    blitz::Array<double,3> tmp[2];
+    blitz::Array<double,3> const *src = &in;
+    for (int dim = 0; dim < 3; ++dim)
+    {
+      blitz::Array<double,3> &dst = (dim == 2) ? out : tmp[dim];
+      BoxIndexT l, u;
+      passBox(lb, ub, kernels, shape, dim, l, u);
+      allocateBox(l, u, dst);
+      correlateAlongDim(*src, kernels[dim], dim, shape, dst);
+      src = &dst;
+    }
+  }
+
+  // Second order Laplacian with repeat boundary treatment for the box
+  // [lb, ub], as computed by atb::LaplacianFilter
+  static void laplacianBox(
+      blitz::Array<double,3> const &in, BoxIndexT const &shape,
+      BoxIndexT const &lb, BoxIndexT const &ub, blitz::Array<double,3> &out)
+  {
+    allocateBox(lb, ub, out);
+    BoxIndexT p;
+    for (p(0) = lb(0); p(0) <= ub(0); ++p(0))
+    {
+      for (p(1) = lb(1); p(1) <= ub(1); ++p(1))
+      {
+        for (p(2) = lb(2); p(2) <= ub(2); ++p(2))
+        {
+          double res = 0.0;
+          for (int r = 0; r < 3; ++r)
+          {
+            BoxIndexT q(p);
+            double deriv = -2.0 * in(p);
+            if (p(r) > 0 && p(r) < shape(r) - 1)
+            {
+              q(r) = p(r) - 1;
+              double left = in(q);
+              q(r) = p(r) + 1;
+              deriv += left + in(q);
+            }
+            else
+            {
+              q(r) = clampIndex(p(r) - 1, shape(r));
+              deriv += in(q);
+              q(r) = clampIndex(p(r) + 1, shape(r));
+              deriv += in(q);
+            }
+            res += deriv;
+          }
+          out(p) = res;
+        }
+      }
+    }
+  }
+
+  // Gradient components for the box [lb, ub]
+  static void gradientBox(
+      blitz::Array<double,3> const &in,
+      std::vector< std::vector<double> > const *kernels,
+      BoxIndexT const &shape, BoxIndexT const &lb, BoxIndexT const &ub,
+      blitz::Array<double,3> *gradient)
+  {
+    for (int d = 0; d < 3; ++d)
+        smoothBox(in, kernels[d], shape, lb, ub, gradient[d]);
+  }
+
+  // Linear interpolation with zero values outside the volume as done by
+  // atb::LinearInterpolator with ValueBT. The values Array is indexed by
+  // volume coordinates minus offset.
+  static double interpolate(
+      blitz::Array<double,3> const &values, BoxIndexT const &offset,
+      BoxIndexT const &shape, blitz::TinyVector<double,3> const &pos)
+  {
+    BoxIndexT lPos;
+    blitz::TinyVector<double,3> lambda[2];
+    for (int d = 0; d < 3; ++d)
+    {
+      lPos(d) = static_cast<atb::BlitzIndexT>(std::floor(pos(d)));
+      lambda[1](d) = pos(d) - static_cast<double>(lPos(d));
+      lambda[0](d) = 1.0 - lambda[1](d);
+    }
+    double res = 0.0;
+    for (int i = 0; i < 8; ++i)
+    {
+      double factor = 1.0;
+      bool inside = true;
+      BoxIndexT binPos;
+      for (int d = 0; d < 3; ++d)
+      {
+        int o = (i >> d) % 2;
+        factor *= lambda[o](d);
+        binPos(d) = lPos(d) + o;
+        inside &= (binPos(d) >= 0 && binPos(d) < shape(d));
+      }
+      if (!inside) continue;
+      for (int d = 0; d < 3; ++d) binPos(d) -= offset(d);
+      res += factor * values(binPos);
+    }
+    return res;
+  }
+
+  PointSampledFeatures::PointSampledFeatures(
+      atb::Array<double,3> const &data,
+      std::vector< blitz::TinyVector<double,3> > const &positionsUm,
+      ProgressReporter *pr)
+          : _data(data), _positionsPx(positionsUm.size()), p_progress(pr)
+  {
+    BoxIndexT shape(data.shape());
+    typedef std::pair<
+        atb::BlitzIndexT, std::pair<atb::BlitzIndexT,atb::BlitzIndexT> >
+        CellT;
+    std::map<CellT,size_t> windowIndex;
+    for (size_t j = 0; j < positionsUm.size(); ++j)
+    {
+      BoxIndexT lb, ub;
+      bool inside = true;
+      for (int d = 0; d < 3; ++d)
+      {
+        _positionsPx[j](d) = positionsUm[j](d) / data.elementSizeUm()(d);
+        atb::BlitzIndexT l =
+            static_cast<atb::BlitzIndexT>(std::floor(_positionsPx[j](d)));
+        lb(d) = std::max(l, atb::BlitzIndexT(0));
+        ub(d) = std::min(l + 1, shape(d) - 1);
+        inside &= (lb(d) <= ub(d));
+      }
+
+      // Without interpolation corners in the volume all features are zero
+      if (!inside) continue;
+
+      CellT cell(lb(0) / WindowSize,
+                 std::make_pair(lb(1) / WindowSize, lb(2) / WindowSize));
+      std::map<CellT,size_t>::iterator it = windowIndex.find(cell);
+      if (it == windowIndex.end())
+      {
+        it = windowIndex.insert(std::make_pair(cell, _windowLb.size())).first;
+        _windowLb.push_back(lb);
+        _windowUb.push_back(ub);
+        _windowMembers.push_back(std::vector<size_t>());
+      }
+      for (int d = 0; d < 3; ++d)
+      {
+        _windowLb[it->second](d) = std::min(_windowLb[it->second](d), lb(d));
+        _windowUb[it->second](d) = std::max(_windowUb[it->second](d), ub(d));
+      }
+      _windowMembers[it->second].push_back(j);
+    }
+  }
+
+  PointSampledFeatures::~PointSampledFeatures()
+  {}
+
+  size_t PointSampledFeatures::nPositions() const
+  {
+    return _positionsPx.size();
+  }
+
+  size_t PointSampledFeatures::nWindows() const
+  {
+    return _windowMembers.size();
+  }
+
+  void PointSampledFeatures::computeSDFeatures(
+      double sigma, int bandMax,
+      std::map< atb::SDMagFeatureIndex, std::vector<double> > &features)
+      const
+  {
+    BaseTraceRegion trace("PointSampledFeatures::computeSDFeatures");
+    BoxIndexT shape(_data.shape());
+    int lMax = bandMax / 2;
+
+    // Output vectors are allocated up front, the windows only write
+    // their members' entries
+    features.clear();
+    std::vector< std::vector< std::vector<double>* > > out(lMax + 1);
+    for (int l = 0; l <= lMax; ++l)
+    {
+      for (int b = 0; b <= bandMax - 2 * l; ++b)
+      {
+        std::vector<double> &f = features[atb::SDMagFeatureIndex(sigma, l, b)];
+        f.assign(_positionsPx.size(), 0.0);
+        out[l].push_back(&f);
+      }
+    }
+    if (_windowMembers.size() == 0) return;
+
+    // The Gaussian kernels of Features::sdFeature()
+    std::vector< std::vector<double> > kernels(3);
+    for (int dim = 0; dim < 3; ++dim)
+    {
+      blitz::Array<double,1> kernel;
+      Features::sdGaussianKernel(sigma, shape(dim), kernel);
+      correlationKernel(kernel, kernels[dim]);
+    }
+
+    // Halo of Laplacian level l needed by the band computations of this
+    // level and the Laplacians of all following levels
+    std::vector<atb::BlitzIndexT> halo(lMax + 1);
+    for (int l = lMax; l >= 0; --l)
+    {
+      atb::BlitzIndexT maxBand = bandMax - 2 * l;
+      halo[l] = (maxBand > 0) ? maxBand + 1 : 0;
+      if (l < lMax) halo[l] = std::max(halo[l], halo[l + 1] + 1);
+    }
+
+    // Broad kernels make overlapping windows more expensive than smoothing
+    // the whole volume once
+    double windowCost = 0.0;
+    for (size_t w = 0; w < _windowMembers.size(); ++w)
+    {
+      BoxIndexT lb, ub;
+      growBox(_windowLb[w], _windowUb[w], BoxIndexT(halo[0]), shape, lb, ub);
+      windowCost += smoothingCost(lb, ub, kernels, shape);
+    }
+    BoxIndexT volumeUb;
+    for (int d = 0; d < 3; ++d) volumeUb(d) = shape(d) - 1;
+    bool smoothVolume =
+        windowCost > smoothingCost(BoxIndexT(0), volumeUb, kernels, shape);
+    blitz::Array<double,3> smoothed;
+    if (smoothVolume)
+    {
+      smoothBox(_data, kernels, shape, BoxIndexT(0), volumeUb, smoothed);
+      if (p_progress != NULL && p_progress->isAborted()) return;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector< std::complex<double> > a, b;
+      blitz::Array<double,3> smoothedWindow, laplacian[2];
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (ptrdiff_t w = 0; w < static_cast<ptrdiff_t>(_windowMembers.size());
+           ++w)
+      {
+        if (p_progress != NULL && p_progress->isAborted()) continue;
+
+        BoxIndexT const &lb = _windowLb[w];
+        BoxIndexT const &ub = _windowUb[w];
+        std::vector<size_t> const &members = _windowMembers[w];
+
+        blitz::Array<double,3> const *level = &smoothed;
+        BoxIndexT boxLb, boxUb;
+        if (!smoothVolume)
+        {
+          growBox(lb, ub, BoxIndexT(halo[0]), shape, boxLb, boxUb);
+          smoothBox(_data, kernels, shape, boxLb, boxUb, smoothedWindow);
+          level = &smoothedWindow;
+        }
+
+        for (int l = 0; l <= lMax; ++l)
+        {
+          if (l > 0)
+          {
+            growBox(lb, ub, BoxIndexT(halo[l]), shape, boxLb, boxUb);
+            laplacianBox(*level, shape, boxLb, boxUb, laplacian[l % 2]);
+            level = &laplacian[l % 2];
+          }
+
+          for (size_t i = 0; i < members.size(); ++i)
+              (*out[l][0])[members[i]] = interpolate(
+                  *level, BoxIndexT(0), shape, _positionsPx[members[i]]);
+
+          // Bands as computed by atb::STderivSlabwise() on a block around
+          // the window
+          atb::BlitzIndexT maxBand = bandMax - 2 * l;
+          if (maxBand < 1) continue;
+          atb::BlitzIndexT border = maxBand + 1;
+          BoxIndexT windowShape, blockShape;
+          size_t blockSize = 1;
+          for (int d = 0; d < 3; ++d)
+          {
+            windowShape(d) = ub(d) - lb(d) + 1;
+            blockShape(d) = windowShape(d) + 2 * border;
+            blockSize *= static_cast<size_t>(blockShape(d));
+          }
+          a.resize((maxBand + 1) * blockSize);
+          b.resize((maxBand + 1) * blockSize);
+
+          size_t k = 0;
+          BoxIndexT p, q;
+          for (p(0) = 0; p(0) < blockShape(0); ++p(0))
+          {
+            q(0) = clampIndex(lb(0) - border + p(0), shape(0));
+            for (p(1) = 0; p(1) < blockShape(1); ++p(1))
+            {
+              q(1) = clampIndex(lb(1) - border + p(1), shape(1));
+              for (p(2) = 0; p(2) < blockShape(2); ++p(2), ++k)
+              {
+                q(2) = clampIndex(lb(2) - border + p(2), shape(2));
+                a[k] = std::complex<double>((*level)(q));
+              }
+            }
+          }
+
+          blitz::Array<double,3> magnitude(windowShape);
+          for (atb::BlitzIndexT L = 1; L <= maxBand; ++L)
+          {
+            atb::STderivFusedBand(
+                &a[0], &b[0], blockShape, L, border, maxBand - L, magnitude);
+            a.swap(b);
+            for (size_t i = 0; i < members.size(); ++i)
+                (*out[l][L])[members[i]] = interpolate(
+                    magnitude, lb, shape, _positionsPx[members[i]]);
+          }
+        }
+      }
+    }
+  }
+
+  void PointSampledFeatures::computeHoughFeatures(
+      std::map< int, std::vector<double> > &features,
+      double rMin, double rMax, double rStep, double preSmoothing,
+      double postSmoothing, double minMagnitude) const
+  {
+    BaseTraceRegion trace("PointSampledFeatures::computeHoughFeatures");
+    BoxIndexT shape(_data.shape());
+    blitz::TinyVector<double,3> elSize(_data.elementSizeUm());
+
+    // Keys as in atb::computeHoughTransform(): magnitudes 1, 2 and radii
+    // 3, 4 for positive and negative direction
+    features.clear();
+    for (int i = 1; i <= 4; ++i)
+        features[i].assign(_positionsPx.size(), 0.0);
+    std::vector<double> *magnitudeOut[] = { &features[1], &features[2] };
+    std::vector<double> *radiusOut[] = { &features[3], &features[4] };
+    if (_windowMembers.size() == 0) return;
+
+    // Gradient kernels as in atb::computeHoughTransform(), central
+    // differences without pre-smoothing
+    std::vector< std::vector<double> > gradientKernels[3];
+    for (int c = 0; c < 3; ++c) gradientKernels[c].resize(3);
+    for (int d = 0; d < 3; ++d)
+    {
+      std::vector<double> gauss, derivative;
+      if (preSmoothing > 0.0)
+      {
+        blitz::Array<double,1> kernel;
+        atb::gaussian(
+            kernel, blitz::TinyVector<double,1>(preSmoothing),
+            blitz::TinyVector<double,1>(elSize(d)));
+        correlationKernel(kernel, gauss);
+        atb::gaussianDerivative(
+            kernel, blitz::TinyVector<double,1>(preSmoothing),
+            blitz::TinyVector<double,1>(elSize(d)),
+            blitz::TinyVector<int,1>(1));
+        correlationKernel(kernel, derivative);
+      }
+      else
+      {
+        gauss.assign(1, 1.0);
+        derivative.assign(3, 0.0);
+        derivative[0] = -0.5 / elSize(d);
+        derivative[2] = 0.5 / elSize(d);
+      }
+      for (int c = 0; c < 3; ++c)
+          gradientKernels[c][d] = (c == d) ? derivative : gauss;
+    }
+
+    // Post-smoothing kernels as in atb::GaussianFilter with a minimum
+    // kernel shape of one element
+    std::vector< std::vector<double> > postKernels(3);
+    BoxIndexT postRadius(0);
+    if (postSmoothing != 0.0)
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        blitz::Array<double,1> kernel;
+        atb::BlitzIndexT minExtent = static_cast<atb::BlitzIndexT>(elSize(d));
+        if (minExtent <= 0)
+            atb::gaussian(
+                kernel, blitz::TinyVector<double,1>(postSmoothing),
+                blitz::TinyVector<double,1>(elSize(d)), atb::NORMALIZE);
+        else
+        {
+          if (minExtent % 2 == 0) minExtent++;
+          kernel.resize(
+              std::max(minExtent, 2 * static_cast<atb::BlitzIndexT>(
+                           3.0 * postSmoothing / elSize(d)) + 1));
+          atb::gaussian(
+              kernel, blitz::TinyVector<double,1>(postSmoothing),
+              blitz::TinyVector<double,1>(elSize(d)),
+              atb::NORESIZE | atb::NORMALIZE);
+        }
+        correlationKernel(kernel, postKernels[d]);
+        postRadius(d) = static_cast<atb::BlitzIndexT>(postKernels[d].size() / 2);
+      }
+    }
+
+    // The magnitude normalization needs the range over the whole volume.
+    // It is gathered tile by tile without keeping the gradient.
+    BoxIndexT tileShape(2 * WindowSize, 4 * WindowSize, 4 * WindowSize);
+    BoxIndexT nTiles;
+    for (int d = 0; d < 3; ++d)
+        nTiles(d) = (shape(d) + tileShape(d) - 1) / tileShape(d);
+    double magMin = std::numeric_limits<double>::infinity();
+    double magMax = -std::numeric_limits<double>::infinity();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      double localMin = std::numeric_limits<double>::infinity();
+      double localMax = -std::numeric_limits<double>::infinity();
+      blitz::Array<double,3> gradient[3];
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (ptrdiff_t t = 0; t < static_cast<ptrdiff_t>(blitz::product(nTiles));
+           ++t)
+      {
+        if (p_progress != NULL && p_progress->isAborted()) continue;
+        BoxIndexT lb, ub;
+        ptrdiff_t tmp = t;
+        for (int d = 2; d >= 0; --d)
+        {
+          lb(d) = static_cast<atb::BlitzIndexT>(tmp % nTiles(d)) *
+              tileShape(d);
+          ub(d) = std::min(lb(d) + tileShape(d), shape(d)) - 1;
+          tmp /= nTiles(d);
+        }
+        gradientBox(_data, gradientKernels, shape, lb, ub, gradient);
+        for (size_t i = 0; i < gradient[0].size(); ++i)
+        {
+          double mag = std::sqrt(
+              gradient[0].data()[i] * gradient[0].data()[i] +
+              gradient[1].data()[i] * gradient[1].data()[i] +
+              gradient[2].data()[i] * gradient[2].data()[i]);
+          if (mag > localMax) localMax = mag;
+          if (mag < localMin) localMin = mag;
+        }
+      }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      {
+        if (localMax > magMax) magMax = localMax;
+        if (localMin < magMin) magMin = localMin;
+      }
+    }
+    if (p_progress != NULL && p_progress->isAborted()) return;
+
+    // Voters may reach the accumulator window from this distance
+    BoxIndexT voteRadius;
+    for (int d = 0; d < 3; ++d)
+        voteRadius(d) = static_cast<atb::BlitzIndexT>(
+            std::ceil(rMax / elSize(d))) + 1;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      blitz::Array<double,3> gradient[3], accu, houghMag, houghRadius,
+          smoothedMag;
+      std::vector<BoxIndexT> voterPos;
+      std::vector< blitz::TinyVector<double,3> > voterDir;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (ptrdiff_t w = 0; w < static_cast<ptrdiff_t>(_windowMembers.size());
+           ++w)
+      {
+        if (p_progress != NULL && p_progress->isAborted()) continue;
+
+        BoxIndexT const &lb = _windowLb[w];
+        BoxIndexT const &ub = _windowUb[w];
+        std::vector<size_t> const &members = _windowMembers[w];
+
+        // Accumulator window covering the post-smoothing halo and the
+        // voters that can reach it
+        BoxIndexT accuLb, accuUb, voteLb, voteUb;
+        growBox(lb, ub, postRadius, shape, accuLb, accuUb);
+        growBox(accuLb, accuUb, voteRadius, shape, voteLb, voteUb);
+        gradientBox(_data, gradientKernels, shape, voteLb, voteUb, gradient);
+
+        voterPos.clear();
+        voterDir.clear();
+        BoxIndexT p;
+        for (p(0) = voteLb(0); p(0) <= voteUb(0); ++p(0))
+        {
+          for (p(1) = voteLb(1); p(1) <= voteUb(1); ++p(1))
+          {
+            for (p(2) = voteLb(2); p(2) <= voteUb(2); ++p(2))
+            {
+              blitz::TinyVector<double,3> g(
+                  gradient[0](p), gradient[1](p), gradient[2](p));
+              double mag = std::sqrt(g(0) * g(0) + g(1) * g(1) + g(2) * g(2));
+              if ((mag - magMin) / (magMax - magMin) < minMagnitude) continue;
+              if (mag != 0.0) for (int d = 0; d < 3; ++d) g(d) /= mag;
+              voterPos.push_back(p);
+              voterDir.push_back(g);
+            }
+          }
+        }
+
+        allocateBox(accuLb, accuUb, accu);
+        for (int i = 0; i < 2; ++i)
+        {
+          allocateBox(accuLb, accuUb, houghMag);
+          allocateBox(accuLb, accuUb, houghRadius);
+          houghMag = 0.0;
+          houghRadius = 0.0;
+          double direction = (i == 0) ? 1.0 : -1.0;
+          for (double r = rMin; r <= rMax; r += rStep)
+          {
+            accu = 0.0;
+            for (size_t v = 0; v < voterPos.size(); ++v)
+            {
+              BoxIndexT target;
+              bool inside = true;
+              for (int d = 0; d < 3; ++d)
+              {
+                ptrdiff_t c = static_cast<ptrdiff_t>(
+                    static_cast<double>(voterPos[v](d)) +
+                    direction * r * voterDir[v](d) / elSize(d) + 0.5);
+                inside &= (c >= accuLb(d) && c <= accuUb(d));
+                target(d) = static_cast<atb::BlitzIndexT>(c);
+              }
+              if (inside) accu(target) += 1.0;
+            }
+            for (size_t j = 0; j < accu.size(); ++j)
+            {
+              if (accu.data()[j] > houghMag.data()[j])
+              {
+                houghRadius.data()[j] = r;
+                houghMag.data()[j] = accu.data()[j];
+              }
+            }
+          }
+
+          blitz::Array<double,3> const *mag = &houghMag;
+          if (postSmoothing != 0.0)
+          {
+            smoothBox(houghMag, postKernels, shape, lb, ub, smoothedMag);
+            mag = &smoothedMag;
+          }
+          for (size_t m = 0; m < members.size(); ++m)
+          {
+            (*magnitudeOut[i])[members[m]] = interpolate(
+                *mag, BoxIndexT(0), shape, _positionsPx[members[m]]);
+            (*radiusOut[i])[members[m]] = interpolate(
+                houghRadius, BoxIndexT(0), shape, _positionsPx[members[m]]);
+          }
+        }
+      }
+    }
+  }
+
+  bool PointSampledFeatures::updateNucleusFeatures(
+      atb::Array<double,3> const &data, std::vector<atb::Nucleus> &nuclei,
+      double sigmaMin, double sigmaMax, double sigmaStep, int bandMax,
+      double progressStepPerFeature, double &progress, ProgressReporter *pr)
+  {
+    std::vector<size_t> updateIndices;
+    std::vector< blitz::TinyVector<double,3> > positionsUm;
+    for (size_t j = 0; j < nuclei.size(); ++j)
+    {
+      if (!nuclei[j].needsFeatureUpdate()) continue;
+      updateIndices.push_back(j);
+      positionsUm.push_back(nuclei[j].positionUm());
+    }
+    PointSampledFeatures sampler(data, positionsUm, pr);
+
+    // Compute SD features
+    int feaIdx = 0;
+    for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
+    {
+      if (pr != NULL && pr->isAborted()) return false;
+      std::map< atb::SDMagFeatureIndex, std::vector<double> > values;
+      sampler.computeSDFeatures(sigma, bandMax, values);
+      if (pr != NULL && pr->isAborted()) return false;
+
+      for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
+      {
+        for (int band = 0; band <= bandMax - 2 * laplace; ++band, ++feaIdx)
+        {
+          std::vector<double> const &fea =
+              values[atb::SDMagFeatureIndex(sigma, laplace, band)];
+          for (size_t i = 0; i < updateIndices.size(); ++i)
+              nuclei[updateIndices[i]].features()[feaIdx] = fea[i];
+          progress += progressStepPerFeature;
+        }
+      }
+      if (pr != NULL) pr->updateProgress(static_cast<int>(progress));
+    }
+
+    // Compute hough features
+    std::map< int, std::vector<double> > houghValues;
+    sampler.computeHoughFeatures(houghValues);
+    if (pr != NULL && pr->isAborted()) return false;
+    for (int i = Features::PositiveMagnitude;
+         i <= Features::NegativeRadius; ++i, ++feaIdx)
+    {
+      std::vector<double> const &fea = houghValues[i];
+      for (size_t j = 0; j < updateIndices.size(); ++j)
+          nuclei[updateIndices[j]].features()[feaIdx] = fea[j];
+      progress += progressStepPerFeature;
+    }
+    return pr == NULL || pr->updateProgress(static_cast<int>(progress));
+  }
+
+}
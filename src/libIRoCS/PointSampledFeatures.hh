@@ -0,0 +1,189 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef IROCSPOINTSAMPLEDFEATURES_HH
+#define IROCSPOINTSAMPLEDFEATURES_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <map>
+#include <vector>
+
+#include <libArrayToolbox/Array.hh>
+#include <libArrayToolbox/SphericalTensor.hh>
+#include <libArrayToolbox/ATBNucleus.hh>
+#include <libProgressReporter/ProgressReporter.hh>
+
+namespace iRoCS
+{
+
+/*======================================================================*/
+/*!
+ *  \class PointSampledFeatures PointSampledFeatures.hh "libIRoCS/PointSampledFeatures.hh"
+ *  \brief Evaluation of the SD and Hough features of iRoCS::Features at
+ *    a given set of positions only.
+ *
+ *  The positions are grouped into cubic cells of WindowSize voxels. For
+ *  every cell the filter cascades are evaluated on a window covering the
+ *  interpolation corners of its positions plus the halo the cascade
+ *  needs, so nearby nuclei share their windows. Reads outside the volume
+ *  are clamped (repeat boundary treatment) as in the full-volume
+ *  computation, therefore the sampled values equal the linearly
+ *  interpolated full-volume features up to rounding.
+ *
+ *  Cells are processed in parallel. If the windows of a scale together
+ *  would cost more than smoothing the whole volume (large sigma), the
+ *  Gaussian is computed once for the full volume and the windows read
+ *  from it.
+ *
+ *  The data Array is referenced, not copied, and must outlive this
+ *  object.
+ */
+/*======================================================================*/
+  class PointSampledFeatures
+  {
+
+  public:
+
+/*======================================================================*/
+/*!
+ *   Side length of the cells positions are grouped into in voxels.
+ */
+/*======================================================================*/
+    static const atb::BlitzIndexT WindowSize;
+
+/*======================================================================*/
+/*!
+ *   Constructor. Groups the given positions into windows.
+ *
+ *   \param data        The scaled and normalized data as returned by
+ *     Features::dataScaled()
+ *   \param positionsUm The query positions in micrometers
+ *   \param pr          Optional progress reporter for abort requests
+ */
+/*======================================================================*/
+    PointSampledFeatures(
+        atb::Array<double,3> const &data,
+        std::vector< blitz::TinyVector<double,3> > const &positionsUm,
+        ProgressReporter *pr = NULL);
+
+    ~PointSampledFeatures();
+
+    size_t nPositions() const;
+
+    size_t nWindows() const;
+
+/*======================================================================*/
+/*!
+ *   Compute all SD features of one scale at the query positions. The
+ *   result contains for every feature index (sigma, laplace, band) with
+ *   laplace <= bandMax / 2 and band <= bandMax - 2 * laplace one value per
+ *   position. The values are those Features::sdFeature() would yield
+ *   after linear interpolation with zero boundary treatment.
+ *
+ *   \param sigma    The standard deviation of the Gaussian in voxels
+ *   \param bandMax  The maximum band for laplace level 0
+ *   \param features The output feature values
+ */
+/*======================================================================*/
+    void computeSDFeatures(
+        double sigma, int bandMax,
+        std::map< atb::SDMagFeatureIndex, std::vector<double> > &features)
+        const;
+
+/*======================================================================*/
+/*!
+ *   Compute the Hough features at the query positions. The result
+ *   contains one value per position for each of the keys
+ *   Features::PositiveMagnitude to Features::NegativeRadius. The
+ *   defaults are the parameters used by Features::houghFeature().
+ *
+ *   The normalization of the gradient magnitude needs its range over the
+ *   whole volume, it is computed in a slab-wise pass without storing the
+ *   gradient.
+ *
+ *   \param features     The output feature values
+ *   \param rMin         Minimum radius in micrometers
+ *   \param rMax         Maximum radius in micrometers
+ *   \param rStep        Radius step in micrometers
+ *   \param preSmoothing Gaussian standard deviation of the gradient
+ *     computation in micrometers
+ *   \param postSmoothing Gaussian standard deviation applied to the
+ *     magnitude maps in micrometers
+ *   \param minMagnitude Minimum normalized gradient magnitude of voters
+ */
+/*======================================================================*/
+    void computeHoughFeatures(
+        std::map< int, std::vector<double> > &features,
+        double rMin = 0.5, double rMax = 6.0, double rStep = 0.5,
+        double preSmoothing = 0.5, double postSmoothing = 1.0,
+        double minMagnitude = 0.01) const;
+
+/*======================================================================*/
+/*!
+ *   Compute the SD features of all scales followed by the Hough features
+ *   for the nuclei that need a feature update, in the order the SVM
+ *   models of layer assignment and epidermis labelling expect them.
+ *
+ *   \param data      The scaled and normalized data as returned by
+ *     Features::dataScaled()
+ *   \param nuclei    The nuclei. The features of nuclei that need an
+ *     update are overwritten starting at index zero.
+ *   \param sigmaMin  The finest scale in voxels
+ *   \param sigmaMax  The coarsest scale in voxels
+ *   \param sigmaStep The factor between consecutive scales
+ *   \param bandMax   The maximum band for laplace level 0
+ *   \param progressStepPerFeature The progress to add per feature
+ *   \param progress  The current progress, it is advanced by
+ *     progressStepPerFeature per feature
+ *   \param pr        Optional progress reporter for progress updates and
+ *     abort requests
+ *
+ *   \return false if the computation was aborted, true otherwise
+ */
+/*======================================================================*/
+    static bool updateNucleusFeatures(
+        atb::Array<double,3> const &data, std::vector<atb::Nucleus> &nuclei,
+        double sigmaMin, double sigmaMax, double sigmaStep, int bandMax,
+        double progressStepPerFeature, double &progress,
+        ProgressReporter *pr = NULL);
+
+  private:
+
+    atb::Array<double,3> const &_data;
+    std::vector< blitz::TinyVector<double,3> > _positionsPx;
+
+    // Per window the bounding box of the interpolation corners of its
+    // positions (clipped to the volume) and the indices of its positions
+    std::vector< blitz::TinyVector<atb::BlitzIndexT,3> > _windowLb;
+    std::vector< blitz::TinyVector<atb::BlitzIndexT,3> > _windowUb;
+    std::vector< std::vector<size_t> > _windowMembers;
+
+    ProgressReporter *p_progress;
+
+  };
+
+}
+
+#endif
@@ -29,11 +29,13 @@
 #include <libArrayToolbox/MedianFilter.hh>
 #include <libArrayToolbox/GaussianFilter.hh>
 #include <libArrayToolbox/AnisotropicDiffusionFilter.hh>
+#include <libArrayToolbox/CentralDerivativesFilter.hh>
 #include <libArrayToolbox/ATBLinAlg.hh>
 #include <libArrayToolbox/ATBMorphology.hh>
 #include <libArrayToolbox/algo/ltransform.hh> // For randomColorMapping
 #include <libArrayToolbox/algo/lmorph.hh> // For watershed
 #include <libArrayToolbox/algo/lrootShapeAnalysis.hh> // For volume and eraseMarkers
+#include <libBaseFunctions/BaseTrace.hh>
 
 namespace iRoCS
 {
@@ -41,8 +43,10 @@ namespace iRoCS
   void varianceNormalization(
       blitz::Array<double,3> &data,
       blitz::TinyVector<double,3> const &elementSizeUm, double sigmaUm,
-      double epsilon, iRoCS::ProgressReporter *pr)
+      double epsilon, iRoCS::ProgressReporter *pr,
+      atb::GaussianScaleSpace<double,3> *scaleSpace)
   {
+    BaseTraceRegion trace("varianceNormalization");
     int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
     int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
     blitz::Array<double,3> dataMean(data.shape());
@@ -57,7 +61,9 @@ namespace iRoCS
     }
     atb::GaussianFilter<double,3> filter(atb::RepeatBT);
     filter.setStandardDeviationUm(sigmaUm);
-    filter.apply(data, elementSizeUm, dataMean, pr);
+    if (scaleSpace != NULL)
+        scaleSpace->smooth(data, elementSizeUm, sigmaUm, dataMean, pr);
+    else filter.apply(data, elementSizeUm, dataMean, pr);
   
     if (pr != NULL && !pr->updateProgressMessage("Subtracting local mean"))
         return;
@@ -75,7 +81,10 @@ namespace iRoCS
       pr->setTaskProgressMin(static_cast<int>(pMin + 0.5 * pScale));
       pr->setTaskProgressMax(pMin + pScale);
     }
-    filter.apply(dataVariance, elementSizeUm, dataVariance, pr);
+    if (scaleSpace != NULL)
+        scaleSpace->smooth(
+            dataVariance, elementSizeUm, sigmaUm, dataVariance, pr);
+    else filter.apply(dataVariance, elementSizeUm, dataVariance, pr);
   
     if (pr != NULL && !pr->updateProgressMessage(
             "Normalizing to unit standard deviation")) return;
@@ -89,6 +98,45 @@ namespace iRoCS
     }
   }
 
+/*======================================================================*/
+/*!
+ *   Per-voxel callback for the CentralDerivativesFilter storing the
+ *   smallest hessian eigenvalue l1, its eigenvector v1 and the absolute
+ *   z-component of v1.
+ */
+/*======================================================================*/
+  struct HessianEigenvalueWriter
+  {
+    HessianEigenvalueWriter(
+        atb::Array<double,3> &l1, atb::Array<blitz::TinyVector<double,3>,3> &v1,
+        atb::Array<double,3> &v1z)
+            : l1(l1), v1(v1), v1z(v1z)
+    {}
+
+    void operator()(
+        blitz::TinyVector<ptrdiff_t,3> const &pos,
+        blitz::TinyVector<double,3> const &,
+        blitz::TinyVector<double,6> const &hessian, double)
+    {
+      blitz::TinyMatrix<double,3,3> m;
+      blitz::TinyVector<double,3> lambda;
+      int k = 0;
+      for (int r = 0; r < 3; ++r)
+      {
+        m(r, r) = hessian(k++);
+        for (int c = r + 1; c < 3; ++c) m(r, c) = m(c, r) = hessian(k++);
+      }
+      atb::eigenvalueDecompositionRealSymmetric(m, m, lambda, atb::Ascending);
+      l1(pos) = lambda(0);
+      v1(pos) = m(0, 0), m(1, 0), m(2, 0);
+      v1z(pos) = std::abs(m(0, 0));
+    }
+
+    atb::Array<double,3> &l1;
+    atb::Array<blitz::TinyVector<double,3>,3> &v1;
+    atb::Array<double,3> &v1z;
+  };
+
   void segmentCells(
       atb::Array<double,3> &data, atb::Array<int,3> &segmentation, double gamma,
       int normalizationType, int medianWidthPx, double processingElementSizeUm,
@@ -96,12 +144,19 @@ namespace iRoCS
       bool preDiffusion, int nDiffusionIterations, float zCompensationFactor,
       double kappa, float deltaT, float l1Threshold, float volumeThresholdUm,
       int boundaryThicknessPx, std::string const &debugFileName,
-      iRoCS::ProgressReporter *pr)
+      iRoCS::ProgressReporter *pr, bool useScaleSpace)
   {
+    BaseTraceRegion trace("segmentCells");
     double proc = (processingElementSizeUm <= 0.0) ?
         blitz::min(data.elementSizeUm()) : processingElementSizeUm;
     if (sigmaHessianUm <= 0.0f) sigmaHessianUm = proc;
 
+    // If requested, all Gaussian smoothing steps share the kernels of one
+    // scale space
+    atb::GaussianScaleSpace<double,3> scaleSpace(atb::RepeatBT);
+    atb::GaussianScaleSpace<double,3> *sharedScaleSpace =
+        useScaleSpace ? &scaleSpace : NULL;
+
     // Setup progress reporting
     int pMin = (pr != NULL) ? pr->taskProgressMin() : 0;
     int pScale = (pr != NULL) ? (pr->taskProgressMax() - pMin) : 100;
@@ -163,10 +218,8 @@ namespace iRoCS
         pVec.push_back(1);
       }
     }
-    mVec.push_back("Computing hessian matrix");
-    pVec.push_back(100);
-    mVec.push_back("Eigenvalue decomposition");
-    pVec.push_back(100);
+    mVec.push_back("Computing hessian eigenvalue decomposition");
+    pVec.push_back(200);
     if (debugFileName != "")
     {
       mVec.push_back("Saving '" + debugFileName + ":/hessian/l1'");
@@ -349,7 +402,8 @@ namespace iRoCS
         pr->setTaskProgressMax(pVec[pState]);
       }
       varianceNormalization(
-          data, data.elementSizeUm(), varSigmaUm, varEpsilon, pr);
+          data, data.elementSizeUm(), varSigmaUm, varEpsilon, pr,
+          sharedScaleSpace);
       switch (normalizationType)
       {
       case 1:
@@ -397,6 +451,7 @@ namespace iRoCS
       atb::AnisotropicDiffusionFilter<double,3> anisotropicDiffusionFilter(
           kappa, sigmaHessianUm, deltaT, zCompensationFactor,
           nDiffusionIterations, 4, atb::RepeatBT);
+      anisotropicDiffusionFilter.setUseScaleSpace(useScaleSpace);
       anisotropicDiffusionFilter.apply(data, data, pr);
       pState++;
       if (debugFileName != "")
@@ -426,68 +481,38 @@ namespace iRoCS
       pr->setTaskProgressMin((pState > 0) ? pVec[pState - 1] : 0);
       pr->setTaskProgressMax(pVec[pState]);
     }
-    atb::GaussianFilter<double,3> gaussianFilter(atb::RepeatBT);
-    gaussianFilter.setStandardDeviationUm(
-        blitz::TinyVector<double,3>(sigmaHessianUm));
-    gaussianFilter.apply(data, data);
-
-    atb::Array<blitz::TinyVector<double,6>,3> hessian(
-        data.shape(), data.elementSizeUm());
-    atb::CentralHessianUTFilter<double,3> hessianFilter(atb::MirrorBT);
-    hessianFilter.apply(data, hessian, pr);
-
-    pState++;
+    if (sharedScaleSpace != NULL)
+        sharedScaleSpace->smooth(data, sigmaHessianUm, data);
+    else
+    {
+      atb::GaussianFilter<double,3> gaussianFilter(atb::RepeatBT);
+      gaussianFilter.setStandardDeviationUm(
+          blitz::TinyVector<double,3>(sigmaHessianUm));
+      gaussianFilter.apply(data, data);
+    }
 
-    if (pr != NULL && !pr->updateProgressMessage(mVec[pState])) return;
+    // The hessian is only needed voxel-wise for its eigen decomposition,
+    // so it is handed to the decomposition right after computation instead
+    // of being stored
     atb::Array<double,3> l1(data.shape(), data.elementSizeUm());
     atb::Array<blitz::TinyVector<double,3>,3> v1(
         data.shape(), data.elementSizeUm());
     atb::Array<double,3> v1z(data.shape(), data.elementSizeUm());
+    HessianEigenvalueWriter eigenvalueWriter(l1, v1, v1z);
+    atb::CentralDerivativesFilter<double,3> hessianFilter(atb::MirrorBT);
+    hessianFilter.apply(
+        data, data.elementSizeUm(),
+        atb::CentralDerivativesFilter<double,3>::Hessian, eigenvalueWriter,
+        pr);
+    if (pr != NULL && pr->isAborted()) return;
+
     double varSum = 0.0;
-    int p = 0;
-    double prStart = (pState > 0) ? pVec[pState - 1] : 0;
-    double prScale = static_cast<double>(pVec[pState] - prStart) /
-        static_cast<double>(data.size() - 1);
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(data.size()); ++i)
-    {
-      if (pr != NULL)
-      {
-        if (pr->isAborted()) continue;
-        int progress = 0;
 #ifdef _OPENMP
-#pragma omp critical
+#pragma omp parallel for reduction(+:varSum)
 #endif
-        {
-          progress = p;
-          ++p;
-        }
-        if (progress % std::max(1, static_cast<int>(data.size() / 100)) == 0)
-            pr->updateProgress(
-                static_cast<int>(prStart + progress * prScale));
-      }
-      blitz::TinyMatrix<double,3,3> m;
-      blitz::TinyVector<double,3> lambda;
-      int k = 0;
-      for (int r = 0; r < 3; ++r)
-      {
-        m(r, r) = hessian.data()[i](k++);
-        for (int c = r + 1; c < 3; ++c)
-            m(r, c) = m(c, r) = hessian.data()[i](k++);
-      }
-      atb::eigenvalueDecompositionRealSymmetric(m, m, lambda, atb::Ascending);
-      l1.data()[i] = lambda(0);
-      v1.data()[i] = m(0, 0), m(1, 0), m(2, 0);
-      v1z.data()[i] = std::abs(m(0, 0));
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-      varSum += blitz::pow2(lambda(0));      
-    }
-    if (pr != NULL && pr->isAborted()) return;
-    double stddevInv = 1.0 / std::sqrt(varSum / hessian.size());
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(l1.size()); ++i)
+        varSum += blitz::pow2(l1.data()[i]);
+    double stddevInv = 1.0 / std::sqrt(varSum / l1.size());
 
 #ifdef _OPENMP
 #pragma omp parallel for
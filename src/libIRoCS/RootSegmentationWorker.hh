@@ -30,14 +30,32 @@
 #include <libProgressReporter/ProgressReporter.hh>
 
 #include <libArrayToolbox/Array.hh>
+#include <libArrayToolbox/GaussianScaleSpace.hh>
 
 namespace iRoCS
 {
   
+/*======================================================================*/
+/*!
+ *   Normalize the data to zero local mean and unit local variance. Local
+ *   mean and variance are Gaussian weighted.
+ *
+ *   \param data          The data to normalize in place
+ *   \param elementSizeUm The element size of the data
+ *   \param sigmaUm       The standard deviation of the Gaussian weights
+ *   \param epsilon       Added to the local standard deviation before
+ *     dividing by it
+ *   \param pr            If given, progress is reported to this
+ *     ProgressReporter, and the operation can be aborted
+ *   \param scaleSpace    If given, both Gaussians are computed with the
+ *     kernels of this scale space instead of a GaussianFilter
+ */
+/*======================================================================*/
   void varianceNormalization(
       blitz::Array<double,3> &data,
       blitz::TinyVector<double,3> const &elementSizeUm, double sigmaUm,
-      double epsilon = 1e-10, iRoCS::ProgressReporter *pr = NULL);
+      double epsilon = 1e-10, iRoCS::ProgressReporter *pr = NULL,
+      atb::GaussianScaleSpace<double,3> *scaleSpace = NULL);
 
   void segmentCells(
       atb::Array<double,3> &data, atb::Array<int,3> &segmentation, double gamma,
@@ -46,7 +64,7 @@ namespace iRoCS
       bool preDiffusion, int nDiffusionIterations, float zCompensationFactor,
       double kappa, float deltaT, float l1Threshold, float volumeThresholdUm,
       int boundaryThicknessPx, std::string const &debugFileName = "",
-      iRoCS::ProgressReporter *pr = NULL);
+      iRoCS::ProgressReporter *pr = NULL, bool useScaleSpace = false);
 
 }
 
@@ -0,0 +1,455 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "SVMModelRegistry.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <libsvmtl/StDataHdf5.hh>
+#include <libsvmtl/MultiClassSVMOneVsOne.hh>
+#include <libsvmtl/TwoClassSVMc.hh>
+#include <libsvmtl/Kernel_RBF.hh>
+#include <libsvmtl/Model.hh>
+
+#include <libBaseFunctions/BaseFile.hh>
+#include <libBaseFunctions/BaseTrace.hh>
+
+namespace iRoCS
+{
+
+  CompactSVMModel::CompactSVMModel()
+          : _gamma(1.0), _nFeatures(0)
+  {}
+
+  void CompactSVMModel::loadTwoClass(std::string const &modelFileName)
+  {
+    BaseTraceRegion trace("CompactSVMModel::loadTwoClass");
+    svt::Model<svt::BasicFV> model;
+    svt::TwoClassSVMc<svt::Kernel_RBF> svm;
+    {
+      svt::StDataHdf5 modelMap(modelFileName.c_str());
+      modelMap.setExceptionFlag(true);
+      model.loadParameters(modelMap);
+      svm.loadParameters(modelMap);
+    }
+
+    *this = CompactSVMModel();
+    _gamma = svm.kernel().gamma();
+    for (unsigned int i = 0; i < model.size(); ++i)
+        _nFeatures = std::max(_nFeatures, model.supportVector(i)->size());
+
+    _svIndices.resize(1);
+    _alphas.resize(1);
+    for (unsigned int i = 0; i < model.size(); ++i)
+    {
+      _addSupportVector(*model.supportVector(i));
+      _svIndices[0].push_back(i);
+      _alphas[0].push_back(model.alpha(i));
+    }
+    _rho.push_back(model.rho());
+  }
+
+  void CompactSVMModel::loadMultiClass(std::string const &modelFileName)
+  {
+    BaseTraceRegion trace("CompactSVMModel::loadMultiClass");
+    svt::Model_MC_OneVsOne< svt::Model<svt::BasicFV> > model;
+    svt::MultiClassSVMOneVsOne< svt::TwoClassSVMc<svt::Kernel_RBF> > svm;
+    {
+      svt::StDataHdf5 modelMap(modelFileName.c_str());
+      modelMap.setExceptionFlag(true);
+      model.loadParameters(modelMap);
+      svm.loadParameters(modelMap);
+    }
+
+    *this = CompactSVMModel();
+    _gamma = svm.twoClassSVM().kernel().gamma();
+    std::vector<svt::BasicFV*> const &supportVectors =
+        model.collectedSupportVectors();
+    for (size_t i = 0; i < supportVectors.size(); ++i)
+        _nFeatures = std::max(_nFeatures, supportVectors[i]->size());
+
+    // The two-class models reference the shared support vectors by
+    // unique ID
+    std::vector<size_t> rowByUID(model.maxUniqueID() + 1, 0);
+    for (size_t i = 0; i < supportVectors.size(); ++i)
+    {
+      rowByUID[supportVectors[i]->uniqueID()] = i;
+      _addSupportVector(*supportVectors[i]);
+    }
+
+    for (unsigned int c1 = 0; c1 + 1 < model.nClasses(); ++c1)
+    {
+      for (unsigned int c2 = c1 + 1; c2 < model.nClasses(); ++c2)
+      {
+        svt::Model<svt::BasicFV> const &tcModel = model.twoClassModel(c1, c2);
+        _svIndices.push_back(std::vector<size_t>(tcModel.size()));
+        _alphas.push_back(std::vector<double>(tcModel.size()));
+        for (unsigned int i = 0; i < tcModel.size(); ++i)
+        {
+          _svIndices.back()[i] = rowByUID[tcModel.supportVector(i)->uniqueID()];
+          _alphas.back()[i] = tcModel.alpha(i);
+        }
+        _rho.push_back(tcModel.rho());
+      }
+    }
+    for (unsigned int c = 0; c < model.nClasses(); ++c)
+        _classLabels.push_back(model.classIndexToLabel(c));
+  }
+
+  bool CompactSVMModel::isMultiClass() const
+  {
+    return _classLabels.size() != 0;
+  }
+
+  size_t CompactSVMModel::nSupportVectors() const
+  {
+    return _squaredNorms.size();
+  }
+
+  size_t CompactSVMModel::nFeatures() const
+  {
+    return _nFeatures;
+  }
+
+  double CompactSVMModel::classify(svt::BasicFV const &fv) const
+  {
+    std::vector<double> kernel;
+    return classify(fv, kernel);
+  }
+
+  double CompactSVMModel::classify(
+      svt::BasicFV const &fv, std::vector<double> &kernel) const
+  {
+    // Evaluate the RBF kernel exp(-gamma * (|x|^2 - 2 <x,s> + |s|^2)) for
+    // all support vectors s
+    size_t nFeatures = std::min(_nFeatures, fv.size());
+    double fvSquare = fv.square();
+    if (kernel.size() < _squaredNorms.size())
+        kernel.resize(_squaredNorms.size());
+    double const *sv = &_supportVectors[0];
+    for (size_t i = 0; i < _squaredNorms.size(); ++i, sv += _nFeatures)
+    {
+      double dot = 0.0;
+      svt::BasicFV::const_iterator x = fv.begin();
+      for (size_t j = 0; j < nFeatures; ++j, ++x) dot += *x * sv[j];
+      kernel[i] = std::exp(
+          -_gamma * (fvSquare - 2.0 * dot + _squaredNorms[i]));
+    }
+
+    if (!isMultiClass())
+    {
+      double sum = 0.0;
+      for (size_t i = 0; i < _svIndices[0].size(); ++i)
+          sum += _alphas[0][i] * kernel[_svIndices[0][i]];
+      return sum - _rho[0];
+    }
+
+    // One-vs-one voting, ties are resolved in favour of the lower class
+    // index
+    size_t nClasses = _classLabels.size();
+    std::vector<int> victories(nClasses, 0);
+    size_t machine = 0;
+    for (size_t c1 = 0; c1 + 1 < nClasses; ++c1)
+    {
+      for (size_t c2 = c1 + 1; c2 < nClasses; ++c2, ++machine)
+      {
+        double sum = 0.0;
+        for (size_t i = 0; i < _svIndices[machine].size(); ++i)
+            sum += _alphas[machine][i] * kernel[_svIndices[machine][i]];
+        if (sum - _rho[machine] > 0.0) victories[c1]++;
+        else victories[c2]++;
+      }
+    }
+    return _classLabels[
+        std::max_element(victories.begin(), victories.end()) -
+        victories.begin()];
+  }
+
+  void CompactSVMModel::_addSupportVector(svt::BasicFV const &fv)
+  {
+    _supportVectors.resize(_supportVectors.size() + _nFeatures, 0.0);
+    double *row = &_supportVectors[_supportVectors.size() - _nFeatures];
+    std::copy(fv.begin(), fv.end(), row);
+    _squaredNorms.push_back(fv.square());
+  }
+
+  void SVMNormalizationParameters::load(std::string const &modelFileName)
+  {
+    svt::StDataHdf5 modelMap(modelFileName.c_str());
+    modelMap.setExceptionFlag(true);
+
+    int nFeatureGroups = modelMap.getArraySize("featureGroups");
+    featureGroups.resize(nFeatureGroups);
+    modelMap.getArray("featureGroups", featureGroups.begin(), nFeatureGroups);
+    normalization.resize(nFeatureGroups);
+    modelMap.getArray(
+        "featureNormalization", normalization.begin(), nFeatureGroups);
+    featureNames.resize(nFeatureGroups);
+    means.resize(nFeatureGroups);
+    stddevs.resize(nFeatureGroups);
+    for (int i = 0; i < nFeatureGroups; ++i)
+    {
+      std::string groupName = featureGroups[i];
+      std::replace(groupName.begin(), groupName.end(), '/', '_');
+      featureNames[i].resize(
+          modelMap.getArraySize("featureNames_" + groupName));
+      int nFeatures = static_cast<int>(featureNames[i].size());
+      modelMap.getArray(
+          "featureNames_" + groupName, featureNames[i].begin(), nFeatures);
+      means[i].resize(nFeatures);
+      modelMap.getArray(
+          "featureMeans_" + groupName, means[i].begin(), nFeatures);
+      stddevs[i].resize(nFeatures);
+      modelMap.getArray(
+          "featureStddevs_" + groupName, stddevs[i].begin(), nFeatures);
+    }
+  }
+
+  std::map<std::string,SVMModelRegistry::Entry> SVMModelRegistry::_entries;
+  std::map<void const*,int> SVMModelRegistry::_useCounts;
+  std::vector<CompactSVMModel*> SVMModelRegistry::_retiredModels;
+  std::vector<SVMNormalizationParameters*>
+  SVMModelRegistry::_retiredNormalizations;
+
+  SVMModelRegistry::Entry::Entry()
+          : modificationTime(static_cast<time_t>(-1)), twoClass(NULL),
+            multiClass(NULL), normalization(NULL)
+  {}
+
+  CompactSVMModel const &SVMModelRegistry::twoClassModel(
+      std::string const &modelFileName)
+  {
+    CompactSVMModel *model = NULL;
+    std::string error;
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      Entry &entry = _entry(modelFileName);
+      if (entry.twoClass == NULL)
+      {
+        CompactSVMModel *loaded = new CompactSVMModel();
+        try
+        {
+          loaded->loadTwoClass(modelFileName);
+          entry.twoClass = loaded;
+        }
+        catch (std::exception &e)
+        {
+          error = e.what();
+          delete loaded;
+        }
+      }
+      model = entry.twoClass;
+      if (model != NULL) ++_useCounts[model];
+    }
+    if (model == NULL) throw std::runtime_error(error);
+    return *model;
+  }
+
+  CompactSVMModel const &SVMModelRegistry::multiClassModel(
+      std::string const &modelFileName)
+  {
+    CompactSVMModel *model = NULL;
+    std::string error;
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      Entry &entry = _entry(modelFileName);
+      if (entry.multiClass == NULL)
+      {
+        CompactSVMModel *loaded = new CompactSVMModel();
+        try
+        {
+          loaded->loadMultiClass(modelFileName);
+          entry.multiClass = loaded;
+        }
+        catch (std::exception &e)
+        {
+          error = e.what();
+          delete loaded;
+        }
+      }
+      model = entry.multiClass;
+      if (model != NULL) ++_useCounts[model];
+    }
+    if (model == NULL) throw std::runtime_error(error);
+    return *model;
+  }
+
+  SVMNormalizationParameters const &SVMModelRegistry::normalizationParameters(
+      std::string const &modelFileName)
+  {
+    SVMNormalizationParameters *parameters = NULL;
+    std::string error;
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      Entry &entry = _entry(modelFileName);
+      if (entry.normalization == NULL)
+      {
+        SVMNormalizationParameters *loaded = new SVMNormalizationParameters();
+        try
+        {
+          loaded->load(modelFileName);
+          entry.normalization = loaded;
+        }
+        catch (std::exception &e)
+        {
+          error = e.what();
+          delete loaded;
+        }
+      }
+      parameters = entry.normalization;
+      if (parameters != NULL) ++_useCounts[parameters];
+    }
+    if (parameters == NULL) throw std::runtime_error(error);
+    return *parameters;
+  }
+
+  void SVMModelRegistry::release(CompactSVMModel const &model)
+  {
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      if (_release(&model))
+      {
+        std::vector<CompactSVMModel*>::iterator it = std::find(
+            _retiredModels.begin(), _retiredModels.end(), &model);
+        if (it != _retiredModels.end())
+        {
+          delete *it;
+          _retiredModels.erase(it);
+        }
+      }
+    }
+  }
+
+  void SVMModelRegistry::release(SVMNormalizationParameters const &parameters)
+  {
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      if (_release(&parameters))
+      {
+        std::vector<SVMNormalizationParameters*>::iterator it = std::find(
+            _retiredNormalizations.begin(), _retiredNormalizations.end(),
+            &parameters);
+        if (it != _retiredNormalizations.end())
+        {
+          delete *it;
+          _retiredNormalizations.erase(it);
+        }
+      }
+    }
+  }
+
+  void SVMModelRegistry::invalidate(std::string const &modelFileName)
+  {
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      std::map<std::string,Entry>::iterator it = _entries.find(modelFileName);
+      if (it != _entries.end())
+      {
+        _retire(it->second);
+        _entries.erase(it);
+      }
+    }
+  }
+
+  void SVMModelRegistry::clear()
+  {
+#ifdef _OPENMP
+#pragma omp critical (SVMModelRegistry)
+#endif
+    {
+      for (std::map<std::string,Entry>::iterator it = _entries.begin();
+           it != _entries.end(); ++it) _retire(it->second);
+      _entries.clear();
+      for (size_t i = 0; i < _retiredModels.size(); ++i)
+          delete _retiredModels[i];
+      _retiredModels.clear();
+      for (size_t i = 0; i < _retiredNormalizations.size(); ++i)
+          delete _retiredNormalizations[i];
+      _retiredNormalizations.clear();
+      _useCounts.clear();
+    }
+  }
+
+  SVMModelRegistry::Entry &SVMModelRegistry::_entry(
+      std::string const &modelFileName)
+  {
+    time_t modificationTime = BaseFile::ModificationTime(modelFileName);
+    Entry &entry = _entries[modelFileName];
+    if (entry.modificationTime != modificationTime)
+    {
+      _retire(entry);
+      entry.modificationTime = modificationTime;
+    }
+    return entry;
+  }
+
+  void SVMModelRegistry::_retire(Entry &entry)
+  {
+    // Entries still in use by other threads are deleted when they are
+    // released
+    if (entry.twoClass != NULL)
+    {
+      if (_useCounts.find(entry.twoClass) == _useCounts.end())
+          delete entry.twoClass;
+      else _retiredModels.push_back(entry.twoClass);
+    }
+    if (entry.multiClass != NULL)
+    {
+      if (_useCounts.find(entry.multiClass) == _useCounts.end())
+          delete entry.multiClass;
+      else _retiredModels.push_back(entry.multiClass);
+    }
+    if (entry.normalization != NULL)
+    {
+      if (_useCounts.find(entry.normalization) == _useCounts.end())
+          delete entry.normalization;
+      else _retiredNormalizations.push_back(entry.normalization);
+    }
+    entry.twoClass = NULL;
+    entry.multiClass = NULL;
+    entry.normalization = NULL;
+  }
+
+  bool SVMModelRegistry::_release(void const *object)
+  {
+    std::map<void const*,int>::iterator it = _useCounts.find(object);
+    if (it == _useCounts.end()) return false;
+    if (--it->second > 0) return false;
+    _useCounts.erase(it);
+    return true;
+  }
+
+}
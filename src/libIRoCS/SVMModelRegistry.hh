@@ -0,0 +1,243 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef IROCSSVMMODELREGISTRY_HH
+#define IROCSSVMMODELREGISTRY_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libsvmtl/BasicFV.hh>
+
+namespace iRoCS
+{
+
+/*======================================================================*/
+/*!
+ *  \class CompactSVMModel SVMModelRegistry.hh "libIRoCS/SVMModelRegistry.hh"
+ *  \brief Classification-ready layout of a two-class or one-vs-one
+ *    multi-class SVM with RBF kernel.
+ *
+ *  The support vectors are stored as one packed row-major matrix together
+ *  with their precomputed squared norms, so evaluating the kernel for a
+ *  test vector is a single pass over contiguous memory. Support vectors
+ *  shared by several two-class machines of a multi-class model are stored
+ *  and evaluated only once. All classification methods are const and
+ *  may be called concurrently.
+ */
+/*======================================================================*/
+  class CompactSVMModel
+  {
+
+  public:
+
+    CompactSVMModel();
+
+/*======================================================================*/
+/*!
+ *   Load a svt::TwoClassSVMc<svt::Kernel_RBF> model with its
+ *   svt::Model<svt::BasicFV> from the given svmtl hdf5 model file.
+ *
+ *   \exception std::exception If the model cannot be read
+ */
+/*======================================================================*/
+    void loadTwoClass(std::string const &modelFileName);
+
+/*======================================================================*/
+/*!
+ *   Load a svt::MultiClassSVMOneVsOne< svt::TwoClassSVMc<svt::Kernel_RBF> >
+ *   model from the given svmtl hdf5 model file.
+ *
+ *   \exception std::exception If the model cannot be read
+ */
+/*======================================================================*/
+    void loadMultiClass(std::string const &modelFileName);
+
+    bool isMultiClass() const;
+    size_t nSupportVectors() const;
+    size_t nFeatures() const;
+
+/*======================================================================*/
+/*!
+ *   Classify the given feature vector. For two-class models the decision
+ *   value is returned, for multi-class models the label of the class
+ *   winning most pairwise votes. This gives the same results as
+ *   svt::TwoClassSVMc::classify() and
+ *   svt::MultiClassSVMOneVsOne::classify() respectively.
+ *
+ *   \param fv The feature vector to classify
+ *
+ *   \return The decision value (two-class) or class label (multi-class)
+ */
+/*======================================================================*/
+    double classify(svt::BasicFV const &fv) const;
+
+/*======================================================================*/
+/*!
+ *   Classify the given feature vector like classify(fv), but evaluate
+ *   the kernel into the given scratch buffer. Keep one buffer per thread
+ *   when classifying many vectors to avoid reallocating it for every call.
+ *
+ *   \param fv     The feature vector to classify
+ *   \param kernel Scratch buffer for the kernel values. It is resized to
+ *     nSupportVectors() if necessary.
+ *
+ *   \return The decision value (two-class) or class label (multi-class)
+ */
+/*======================================================================*/
+    double classify(
+        svt::BasicFV const &fv, std::vector<double> &kernel) const;
+
+  private:
+
+    void _addSupportVector(svt::BasicFV const &fv);
+
+    double _gamma;
+    size_t _nFeatures;
+    std::vector<double> _supportVectors;
+    std::vector<double> _squaredNorms;
+
+    // One entry per two-class machine, ordered (0,1), (0,2), ..., (1,2), ...
+    // for multi-class models
+    std::vector< std::vector<size_t> > _svIndices;
+    std::vector< std::vector<double> > _alphas;
+    std::vector<double> _rho;
+    std::vector<double> _classLabels;
+
+  };
+
+/*======================================================================*/
+/*!
+ *  \struct SVMNormalizationParameters SVMModelRegistry.hh "libIRoCS/SVMModelRegistry.hh"
+ *  \brief The feature group and normalization information iRoCS::Features
+ *    stores alongside the SVM in a model file.
+ */
+/*======================================================================*/
+  struct SVMNormalizationParameters
+  {
+    std::vector<std::string> featureGroups;
+    std::vector<int> normalization;
+    std::vector< std::vector<std::string> > featureNames;
+    std::vector< std::vector<double> > means, stddevs;
+
+/*======================================================================*/
+/*!
+ *   \exception std::exception If the parameters cannot be read
+ */
+/*======================================================================*/
+    void load(std::string const &modelFileName);
+  };
+
+/*======================================================================*/
+/*!
+ *  \class SVMModelRegistry SVMModelRegistry.hh "libIRoCS/SVMModelRegistry.hh"
+ *  \brief Process-wide cache of parsed SVM model files.
+ *
+ *  Models are keyed by file name and modification time, so a model file
+ *  is read once per process unless it changes on disk. Lookups are
+ *  thread-safe. Every lookup must be paired with a call to release() when
+ *  the returned reference is not needed any more. The reference stays
+ *  valid until then, even if the entry is reloaded in the meantime because
+ *  the file changed. Replaced entries are freed as soon as they are
+ *  released by all users.
+ */
+/*======================================================================*/
+  class SVMModelRegistry
+  {
+
+  public:
+
+    static CompactSVMModel const &twoClassModel(
+        std::string const &modelFileName);
+
+    static CompactSVMModel const &multiClassModel(
+        std::string const &modelFileName);
+
+    static SVMNormalizationParameters const &normalizationParameters(
+        std::string const &modelFileName);
+
+/*======================================================================*/
+/*!
+ *   Release a reference obtained by twoClassModel() or multiClassModel().
+ *   If the model was replaced in the meantime and this was its last user,
+ *   it is freed.
+ */
+/*======================================================================*/
+    static void release(CompactSVMModel const &model);
+
+/*======================================================================*/
+/*!
+ *   Release a reference obtained by normalizationParameters(). If the
+ *   parameters were replaced in the meantime and this was their last
+ *   user, they are freed.
+ */
+/*======================================================================*/
+    static void release(SVMNormalizationParameters const &parameters);
+
+/*======================================================================*/
+/*!
+ *   Drop the cached entries of the given model file. Call this after
+ *   writing to a model file, because the modification time has only a
+ *   resolution of one second.
+ */
+/*======================================================================*/
+    static void invalidate(std::string const &modelFileName);
+
+/*======================================================================*/
+/*!
+ *   Free all cached models. References obtained before become invalid.
+ */
+/*======================================================================*/
+    static void clear();
+
+  private:
+
+    struct Entry
+    {
+      Entry();
+
+      time_t modificationTime;
+      CompactSVMModel *twoClass;
+      CompactSVMModel *multiClass;
+      SVMNormalizationParameters *normalization;
+    };
+
+    static Entry &_entry(std::string const &modelFileName);
+    static void _retire(Entry &entry);
+    static bool _release(void const *object);
+
+    static std::map<std::string,Entry> _entries;
+    static std::map<void const*,int> _useCounts;
+    static std::vector<CompactSVMModel*> _retiredModels;
+    static std::vector<SVMNormalizationParameters*> _retiredNormalizations;
+
+  };
+
+}
+
+#endif
@@ -22,25 +22,118 @@
 
 #include "TrainDetectorWorker.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
 #include <libsvmtl/StDataHdf5.hh>
 
+#include <libBaseFunctions/BaseFile.hh>
+
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
+#endif 
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
-#endif 
 
 #include "TrainfileParameters.hh"
 
 #include "iRoCSFeatures.hh"
+#include "PointSampledFeatures.hh"
+#include "FeatureCache.hh"
 
 namespace iRoCS
 {
 
+  // The training samples of one training file. features holds one row
+  // per sample in the training set order of the features.
+  struct DetectorSampleBlock
+  {
+    std::string group;
+    std::string key;
+    std::vector< blitz::TinyVector<double,3> > positionsUm;
+    std::vector<int> labels;
+    blitz::Array<double,2> features;
+  };
+
+  static std::string detectorSampleGroup(size_t fileIdx)
+  {
+    std::stringstream group;
+    group << "/samples/file" << std::setw(4) << std::setfill('0') << fileIdx;
+    return group.str();
+  }
+
+  // Load the sample positions, labels and features of the given block if
+  // they were stored with matching key. The labels are written last, so a
+  // block with labels is complete.
+  static bool loadDetectorSampleBlock(
+      std::string const &sampleFileName, DetectorSampleBlock &block,
+      int nFeatures)
+  {
+    if (sampleFileName == "" || !BaseFile::Exists(sampleFileName))
+        return false;
+    try
+    {
+      BlitzH5File inFile(sampleFileName);
+      std::string labelsName = block.group + "/labels";
+      if (!inFile.existsDataset(labelsName) ||
+          !inFile.existsAttribute(FeatureCache::keyAttribute, labelsName))
+          return false;
+      std::string key;
+      inFile.readAttribute(key, FeatureCache::keyAttribute, labelsName);
+      if (key != block.key) return false;
+      std::vector<int> labels;
+      inFile.readDataset(labels, labelsName);
+      blitz::Array<double,2> positionsUm;
+      inFile.readDataset(positionsUm, block.group + "/positions_um");
+      blitz::Array<double,2> features;
+      inFile.readDataset(features, block.group + "/features");
+      int nSamples = static_cast<int>(labels.size());
+      if (positionsUm.extent(0) != nSamples || positionsUm.extent(1) != 3 ||
+          features.extent(0) != nSamples || features.extent(1) != nFeatures)
+          return false;
+      block.labels = labels;
+      block.positionsUm.resize(labels.size());
+      for (int i = 0; i < nSamples; ++i)
+          for (int d = 0; d < 3; ++d)
+              block.positionsUm[i](d) = positionsUm(i, d);
+      block.features.reference(features);
+      return true;
+    }
+    catch (BlitzH5Error &)
+    {
+      return false;
+    }
+  }
+
+  static void saveDetectorSampleBlock(
+      std::string const &sampleFileName, DetectorSampleBlock const &block,
+      std::string const &trainFileName)
+  {
+    BlitzH5File outFile(sampleFileName, BlitzH5File::WriteOrNew);
+    std::string labelsName = block.group + "/labels";
+    if (outFile.existsDataset(labelsName)) outFile.deleteDataset(labelsName);
+    int nSamples = static_cast<int>(block.labels.size());
+    blitz::Array<double,2> positionsUm(nSamples, 3);
+    for (int i = 0; i < nSamples; ++i)
+        for (int d = 0; d < 3; ++d)
+            positionsUm(i, d) = block.positionsUm[i](d);
+    outFile.writeDataset(positionsUm, block.group + "/positions_um");
+    outFile.writeDataset(block.features, block.group + "/features");
+    blitz::Array<int,1> labels(nSamples);
+    for (int i = 0; i < nSamples; ++i) labels(i) = block.labels[i];
+    outFile.writeDataset(labels, labelsName);
+    outFile.writeAttribute(trainFileName, "trainFile", block.group);
+    outFile.writeAttribute(block.key, FeatureCache::keyAttribute, labelsName);
+  }
+
   void trainDetector(
       TrainingParameters const &parameters, ProgressReporter *pr)
   {
+    BaseTraceRegion trace("trainDetector");
     double sigmaMin = 0.5;
     double sigmaMax = 64.0;
     double sigmaStep = 2.0;
@@ -57,14 +150,21 @@ namespace iRoCS
                 nFeatures++;
     nFeatures += 4; // The hough features
     
+    // The cascade stage only uses the band 0 features (smoothed data and
+    // its iterated Laplacians), which need no Gauss-Laguerre transform
+    std::vector<int> cascadeFeatures;
     std::string sdMagGroup = BlitzH5File::simplifyGroupDescriptor(
         parameters.featureGroup() + "/SDmag");
+    int sdIdx = 0;
     for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
         for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-            for (int band = 0; band <= bandMax - 2 * laplace; ++band)
-                features.addFeatureToGroup(
-                    sdMagGroup, features.sdFeatureName(
-                        atb::SDMagFeatureIndex(sigma, laplace, band)));
+            for (int band = 0; band <= bandMax - 2 * laplace; ++band, ++sdIdx)
+            {
+              features.addFeatureToGroup(
+                  sdMagGroup, features.sdFeatureName(
+                      atb::SDMagFeatureIndex(sigma, laplace, band)));
+              if (band == 0) cascadeFeatures.push_back(sdIdx);
+            }
     features.setGroupNormalization(
         sdMagGroup, parameters.sdFeatureNormalization());
   
@@ -76,65 +176,66 @@ namespace iRoCS
     features.setGroupNormalization(
         houghGroup, parameters.houghFeatureNormalization());
 
-    std::vector<svt::BasicFV> trainingSet;
-    int trainIndex = 0;
-    int nPositives = 0;
-    int nNegatives = 0;
-
     std::vector<TrainfileParameters*> trainFiles(parameters.trainFiles());
+    std::string sampleFileName(parameters.sampleFileName());
     if (pr != NULL)
         pr->setProgressMax(100 * static_cast<int>(trainFiles.size()) + 10);
+
+    // Collect the sample positions of all files. This is done sequentially,
+    // because the random samples are drawn from the global random number
+    // generator. Files whose samples were stored by a previous run reuse
+    // the stored positions, so no random samples are drawn for them.
+    std::vector<DetectorSampleBlock> blocks(trainFiles.size());
+    std::vector<size_t> pendingFiles;
+    std::vector<size_t> fileMemory(trainFiles.size(), 0);
     for (size_t fileIdx = 0; fileIdx < trainFiles.size(); ++fileIdx)
     {
-      if (pr != NULL)
-      {
-        if (!pr->updateProgressMessage(
-                "Processing '" + trainFiles[fileIdx]->trainFileName() + "'"))
-            return;
-        pr->updateProgress(static_cast<int>(fileIdx) * 100);
-      }
-
-      // Read dataset
-      atb::Array<double,3> data;
-      try
-      {
-        std::cout << "  Loading '" << trainFiles[fileIdx]->trainFileName()
-                  << ":" << trainFiles[fileIdx]->dataChannelName() << "'... "
-                  << std::flush;
-        data.load(
-            trainFiles[fileIdx]->trainFileName(),
-            trainFiles[fileIdx]->dataChannelName());
-        std::cout << "OK" << std::endl;
-      }
-      catch (BlitzH5Error &e)
-      {
-        std::cout << "failed" << std::endl;
-        if (pr != NULL)
-            pr->abortWithError(
-                "Could not read '" + trainFiles[fileIdx]->trainFileName() +
-                ":" + trainFiles[fileIdx]->dataChannelName() + "': " +
-                e.what());
-        else
-            std::cerr << "Could not read '"
-                      << trainFiles[fileIdx]->trainFileName() << ":"
-                      << trainFiles[fileIdx]->dataChannelName() << "': "
-                      << e.what() << std::endl;
-        return;
-      }
-
+      TrainfileParameters const &trainFile = *trainFiles[fileIdx];
       if (pr != NULL &&
-          !pr->updateProgress(static_cast<int>(fileIdx) * 100 + 3)) return;
+          !pr->updateProgressMessage(
+              "Preparing samples of '" + trainFile.trainFileName() + "'"))
+          return;
 
       // Read markers
-      std::cout << "  Loading '" << trainFiles[fileIdx]->trainFileName() << ":"
-                << trainFiles[fileIdx]->annotationChannelName() << "'... "
+      std::cout << "  Loading '" << trainFile.trainFileName() << ":"
+                << trainFile.annotationChannelName() << "'... "
                 << std::flush;
       std::vector<atb::Nucleus> nuclei;
+      blitz::TinyVector<double,3> upperBoundUm(0.0);
       try
       {
-        BlitzH5File inFile(trainFiles[fileIdx]->trainFileName());
+        BlitzH5File inFile(trainFile.trainFileName());
         atb::Nucleus::loadList(
-            nuclei, inFile, trainFiles[fileIdx]->annotationChannelName());
+            nuclei, inFile, trainFile.annotationChannelName());
+        std::vector<hsize_t> shape(
+            inFile.getDatasetShape(trainFile.dataChannelName()));
+        if (shape.size() != 3)
+            throw BlitzH5Error() << "Dataset '"
+                                 << trainFile.dataChannelName()
+                                 << "' is not three-dimensional";
+        blitz::TinyVector<double,3> elementSizeUm(1.0);
+        if (inFile.existsAttribute(
+                "element_size_um", trainFile.dataChannelName()))
+            inFile.readAttribute(
+                elementSizeUm, "element_size_um",
+                trainFile.dataChannelName());
+        for (int d = 0; d < 3; ++d)
+            upperBoundUm(d) =
+                static_cast<double>(shape[d]) * elementSizeUm(d);
+
+        // The loaded data and its scaled copy coexist while scaling. Then
+        // the Gaussian of large scales is computed for the whole scaled
+        // volume, which needs up to three volumes besides the scaled data.
+        double nVoxels = 1.0, nScaledVoxels = 1.0;
+        for (int d = 0; d < 3; ++d)
+        {
+          nVoxels *= static_cast<double>(shape[d]);
+          nScaledVoxels *= std::ceil(
+              upperBoundUm(d) / features.elementSizeUm()(d));
+        }
+        fileMemory[fileIdx] = static_cast<size_t>(
+            sizeof(double) * std::max(
+                nVoxels + nScaledVoxels, 4.0 * nScaledVoxels));
         std::cout << "OK" << std::endl;
       }
       catch (std::exception &e)
@@ -142,19 +243,45 @@ namespace iRoCS
         std::cout << "failed" << std::endl;
         if (pr != NULL)
             pr->abortWithError(
-                "Could not read '" + trainFiles[fileIdx]->trainFileName() +
-                ":" + trainFiles[fileIdx]->annotationChannelName() + "': " +
+                "Could not read '" + trainFile.trainFileName() + "': " +
                 e.what());
         else
-            std::cerr << "Could not read '"
-                      << trainFiles[fileIdx]->trainFileName() << ":"
-                      << trainFiles[fileIdx]->annotationChannelName() << "': "
-                      << e.what() << std::endl;
+            std::cerr << "Could not read '" << trainFile.trainFileName()
+                      << "': " << e.what() << std::endl;
         return;
       }
-      
-      if (pr != NULL &&
-          !pr->updateProgress(static_cast<int>(fileIdx) * 100 + 4)) return;
+
+      // The stored samples are reused if neither the training file, the
+      // annotations, the sampling parameters nor the feature layout
+      // changed. The random samples are not part of the key, they are
+      // stored with the block.
+      DetectorSampleBlock &block = blocks[fileIdx];
+      block.group = detectorSampleGroup(fileIdx);
+      FeatureCacheKey key;
+      key << "detectorSamples" << trainFile.trainFileName()
+          << trainFile.dataChannelName() << trainFile.annotationChannelName()
+          << static_cast<double>(
+              BaseFile::ModificationTime(trainFile.trainFileName()))
+          << sigmaMin << sigmaMax << sigmaStep << bandMax << nFeatures
+          << static_cast<int>(parameters.generateRandomSamples())
+          << parameters.nInRootSamples() << parameters.nOutRootSamples()
+          << static_cast<int>(nuclei.size());
+      for (size_t k = 0; k < nuclei.size(); ++k)
+      {
+        blitz::TinyVector<double,3> positionUm(nuclei[k].positionUm());
+        int label = nuclei[k].label() + ((nuclei[k].mitotic()) ? 10 : 0);
+        key.addData(&positionUm, sizeof(blitz::TinyVector<double,3>));
+        key.addData(&label, sizeof(int));
+      }
+      block.key = key.str();
+
+      if (loadDetectorSampleBlock(sampleFileName, block, nFeatures))
+      {
+        std::cout << "  Using stored samples of '"
+                  << trainFile.trainFileName() << "'" << std::endl;
+        if (pr != NULL && !pr->updateProgress(pr->progress() + 100)) return;
+        continue;
+      }
 
       // Generate Random Samples
       if (parameters.generateRandomSamples())
@@ -165,9 +292,7 @@ namespace iRoCS
         for (size_t i = 0; i < nMarkers; ++i)
             markers[i] = nuclei[i].positionUm();
         features.generateRandomSamples(
-            markers, blitz::TinyVector<double,3>(
-                blitz::TinyVector<double,3>(data.shape()) *
-                data.elementSizeUm()), parameters.nInRootSamples(),
+            markers, upperBoundUm, parameters.nInRootSamples(),
             parameters.nOutRootSamples());
         for (size_t i = nMarkers; i < markers.size(); ++i)
         {
@@ -179,95 +304,221 @@ namespace iRoCS
         }
         std::cout << "OK" << std::endl;
       }
+      if (pr != NULL && pr->isAborted()) return;
 
-      if (pr != NULL &&
-          !pr->updateProgress(static_cast<int>(fileIdx) * 100 + 8)) return;
+      for (size_t k = 0; k < nuclei.size(); ++k)
+      {
+        if (nuclei[k].label() == -1) continue;
+        block.positionsUm.push_back(nuclei[k].positionUm());
+        block.labels.push_back(
+            nuclei[k].label() + ((nuclei[k].mitotic()) ? 10 : 0));
+      }
+      block.features.resize(static_cast<int>(block.labels.size()), nFeatures);
+      if (block.labels.size() != 0) pendingFiles.push_back(fileIdx);
+      else if (pr != NULL && !pr->updateProgress(pr->progress() + 100))
+          return;
+    }
+
+    // Evaluate the features at the sample positions. As many consecutive
+    // files as fit into the memory limit are processed concurrently,
+    // always at least one, remaining threads are used within the files.
+    // Without memory limit the files are processed one after the other.
+    // HDF5 access is serialized.
+    size_t memoryLimit = parameters.memoryLimit();
+    std::string errorMessage;
+    int progressBase = (pr != NULL) ? pr->progress() : 0;
+    int nExtracted = 0;
+#ifdef _OPENMP
+    int previousMaxActiveLevels = omp_get_max_active_levels();
+    int previousMaxThreads = omp_get_max_threads();
+#endif
+    size_t batchStart = 0;
+    while (batchStart < pendingFiles.size() && errorMessage == "" &&
+           (pr == NULL || !pr->isAborted()))
+    {
+      size_t batchEnd = batchStart + 1;
+      size_t batchMemory = fileMemory[pendingFiles[batchStart]];
+      while (batchEnd < pendingFiles.size() && memoryLimit > 0 &&
+             batchMemory + fileMemory[pendingFiles[batchEnd]] <= memoryLimit)
+          batchMemory += fileMemory[pendingFiles[batchEnd++]];
 
-      // Generate Features
-      for (size_t i = 0; i < nuclei.size(); ++i)
-          nuclei[i].features().resize(nFeatures);
+      int nConcurrentFiles = 1;
+      int nThreadsPerFile = 1;
+#ifdef _OPENMP
+      nConcurrentFiles = std::max(
+          1, std::min(static_cast<int>(batchEnd - batchStart),
+                      previousMaxThreads));
+      nThreadsPerFile = std::max(1, previousMaxThreads / nConcurrentFiles);
+      omp_set_max_active_levels(
+          (nConcurrentFiles > 1 && nThreadsPerFile > 1) ?
+          2 : previousMaxActiveLevels);
+#endif
+      if (nConcurrentFiles > 1)
+          std::cout << "  Extracting samples of " << nConcurrentFiles
+                    << " files concurrently (estimated "
+                    << batchMemory / 1024 / 1024 << " MB)" << std::endl;
 
-      int feaIdx = 0;
-      for (double sigma = sigmaMin; sigma <= sigmaMax; sigma *= sigmaStep)
+      ptrdiff_t first = static_cast<ptrdiff_t>(batchStart);
+      ptrdiff_t last = static_cast<ptrdiff_t>(batchEnd);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nConcurrentFiles) \
+  if (nConcurrentFiles > 1)
+#endif
+      for (ptrdiff_t i = first; i < last; ++i)
       {
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
+#ifdef _OPENMP
+        omp_set_num_threads(nThreadsPerFile);
+#endif
+        if (pr != NULL && pr->isAborted()) continue;
+        TrainfileParameters const &trainFile = *trainFiles[pendingFiles[i]];
+        DetectorSampleBlock &block = blocks[pendingFiles[i]];
+        std::string error;
+
+        atb::Array<double,3> data;
+#ifdef _OPENMP
+#pragma omp critical(TrainDetectorIO)
+#endif
         {
-          int maxBand = bandMax - 2 * laplace;
-          for (int band = 0; band <= maxBand; ++band, ++feaIdx)
-          {  
-            if (pr != NULL && !pr->updateProgress(
-                    static_cast<int>(fileIdx) * 100 + 8 +
-                    static_cast<int>(82.0 * static_cast<double>(feaIdx) /
-                                     static_cast<double>(nFeatures - 4))))
-                continue;
-            blitz::Array<double,3>& fea = features.sdFeature(
-                data, atb::SDMagFeatureIndex(sigma, laplace, band), maxBand,
-                trainFiles[fileIdx]->cacheFileName());
-
-            atb::LinearInterpolator<double,3> ip(atb::ValueBT);
+          try
+          {
+            data.load(trainFile.trainFileName(), trainFile.dataChannelName());
+          }
+          catch (BlitzH5Error &e)
+          {
+            error = "Could not read '" + trainFile.trainFileName() + ":" +
+                trainFile.dataChannelName() + "': " + e.what();
+          }
+        }
 
+        if (error == "")
+        {
+          // One Features object per file, it holds the scaled data. The
+          // scaled data is shared with the other iRoCS workers through the
+          // cache file of the training file. The cache is HDF5 as well.
+          Features fileFeatures(features.elementSizeUm());
+          atb::Array<double,3> *dataScaled = NULL;
+          if (trainFile.cacheFileName() == "")
+              dataScaled = &fileFeatures.dataScaled(data, "");
+          else
+          {
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp critical(TrainDetectorIO)
 #endif
-            for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(nuclei.size());
-                 ++k)
+            dataScaled = &fileFeatures.dataScaled(
+                data, trainFile.cacheFileName());
+          }
+          data.free();
+          PointSampledFeatures sampler(*dataScaled, block.positionsUm, pr);
+
+          int feaIdx = 0;
+          for (double sigma = sigmaMin; sigma <= sigmaMax &&
+                   (pr == NULL || !pr->isAborted()); sigma *= sigmaStep)
+          {
+            std::map< atb::SDMagFeatureIndex, std::vector<double> > values;
+            sampler.computeSDFeatures(sigma, bandMax, values);
+            for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
             {
-              if (!nuclei[k].needsFeatureUpdate() ||
-                  (pr != NULL && pr->isAborted())) continue;
-              blitz::TinyVector<double,3> pos(
-                  nuclei[k].positionUm() / features.elementSizeUm());
-              nuclei[k].features()[feaIdx] = ip.get(fea, pos);
+              for (int band = 0; band <= bandMax - 2 * laplace;
+                   ++band, ++feaIdx)
+              {
+                std::vector<double> const &fea =
+                    values[atb::SDMagFeatureIndex(sigma, laplace, band)];
+                for (size_t k = 0; k < fea.size(); ++k)
+                    block.features(static_cast<int>(k), feaIdx) = fea[k];
+              }
             }
           }
-          for (int band = 1; band <= bandMax - 2 * laplace; ++band)
-              features.deleteFeature(
-                  atb::SDMagFeatureIndex(sigma, laplace, band));
-        }
-        for (int laplace = 0; laplace <= bandMax / 2; ++laplace)
-            features.deleteFeature(atb::SDMagFeatureIndex(sigma, laplace, 0));
-        features.deleteFeature(atb::SDMagFeatureIndex(sigma, 0, 0));
-      }
 
-      // Compute hough features
-      for (int i = iRoCS::Features::PositiveMagnitude;
-           i <= iRoCS::Features::NegativeRadius; ++i, ++feaIdx)
-      {
-        if (pr != NULL && !pr->updateProgress(
-                static_cast<int>(fileIdx) * 100 + 90 + 2 * i)) continue;
-        blitz::Array<double,3>& fea =
-            features.houghFeature(
-                data, i, trainFiles[fileIdx]->cacheFileName());
-        if (pr->isAborted()) continue;
+          std::map< int, std::vector<double> > houghValues;
+          if (pr == NULL || !pr->isAborted())
+              sampler.computeHoughFeatures(houghValues);
+          for (int s = iRoCS::Features::PositiveMagnitude;
+               s <= iRoCS::Features::NegativeRadius; ++s, ++feaIdx)
+          {
+            std::vector<double> const &fea = houghValues[s];
+            for (size_t k = 0; k < fea.size(); ++k)
+                block.features(static_cast<int>(k), feaIdx) = fea[k];
+          }
+        }
 
-        atb::LinearInterpolator<double,3> ip(atb::ValueBT);
+        if (error == "" && sampleFileName != "" &&
+            (pr == NULL || !pr->isAborted()))
+        {
+#ifdef _OPENMP
+#pragma omp critical(TrainDetectorIO)
+#endif
+          {
+            try
+            {
+              saveDetectorSampleBlock(
+                  sampleFileName, block, trainFile.trainFileName());
+            }
+            catch (BlitzH5Error &e)
+            {
+              std::cerr << "Could not save samples of '"
+                        << trainFile.trainFileName() << "' to '"
+                        << sampleFileName << "': " << e.what() << std::endl;
+            }
+          }
+        }
 
+        // The progress reporter may process GUI events, so it is not called
+        // while other threads wait for the lock
+        int progress = 0;
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp critical(TrainDetectorProgress)
 #endif
-        for (ptrdiff_t k = 0; k < static_cast<ptrdiff_t>(nuclei.size()); ++k)
         {
-          if (!nuclei[k].needsFeatureUpdate() ||
-              (pr != NULL && pr->isAborted())) continue;
-          blitz::TinyVector<double,3> pos(
-              nuclei[k].positionUm() / features.elementSizeUm());
-          nuclei[k].features()[feaIdx] = ip.get(fea, pos);
+          if (error != "")
+          {
+            if (errorMessage == "") errorMessage = error;
+          }
+          else
+          {
+            std::cout << "  Extracted " << block.labels.size()
+                      << " samples from '" << trainFile.trainFileName() << "'"
+                      << std::endl;
+            progress = progressBase + 100 * ++nExtracted;
+          }
+        }
+        if (pr != NULL)
+        {
+          if (error != "") pr->abortWithError(error);
+          else pr->updateProgress(progress);
         }
-        features.deleteFeature(i);
-        if (pr != NULL && pr->isAborted()) return;
       }
+      batchStart = batchEnd;
+    }
 
-      // Append samples to training set
-      for (size_t k = 0; k < nuclei.size(); ++k)
+#ifdef _OPENMP
+    omp_set_max_active_levels(previousMaxActiveLevels);
+    omp_set_num_threads(previousMaxThreads);
+#endif
+    if (errorMessage != "")
+    {
+      if (pr == NULL) std::cerr << errorMessage << std::endl;
+      return;
+    }
+    if (pr != NULL && pr->isAborted()) return;
+
+    // Append samples to training set
+    std::vector<svt::BasicFV> trainingSet;
+    int trainIndex = 0;
+    int nPositives = 0;
+    int nNegatives = 0;
+    for (size_t fileIdx = 0; fileIdx < blocks.size(); ++fileIdx)
+    {
+      DetectorSampleBlock const &block = blocks[fileIdx];
+      for (size_t k = 0; k < block.labels.size(); ++k)
       {
-        if (nuclei[k].label() != -1)
-        {
-          int label = nuclei[k].label() + ((nuclei[k].mitotic()) ? 10 : 0);
-          trainingSet.push_back(
-              svt::BasicFV(nuclei[k].features(), label, trainIndex));
-          if (nuclei[k].label() > 0) nPositives++;
-          else nNegatives++;
-          trainIndex++;
-        }
+        std::vector<double> fv(nFeatures);
+        for (int j = 0; j < nFeatures; ++j)
+            fv[j] = block.features(static_cast<int>(k), j);
+        trainingSet.push_back(
+            svt::BasicFV(fv, block.labels[k], trainIndex));
+        if (block.labels[k] > 0) nPositives++;
+        else nNegatives++;
+        trainIndex++;
       }
     }
     
@@ -280,6 +531,11 @@ namespace iRoCS
       return;
     }
 
+    // Train the early-reject stage on the raw features
+    features.trainCascade(
+        trainingSet, cascadeFeatures, parameters.cascadeRecall());
+    if (pr != NULL && pr->isAborted()) return;
+
     // Normalize features
     if (pr != NULL && !pr->updateProgressMessage("Normalizing features"))
         return;
@@ -316,6 +572,8 @@ namespace iRoCS
     if (pr != NULL && pr->isAborted()) return;
 
     features.saveNormalizationParameters(parameters.modelFileName());
+    features.saveCascadeParameters(parameters.modelFileName());
+    if (pr != NULL && pr->isAborted()) return;
 
     // Train svm
     if (pr != NULL)
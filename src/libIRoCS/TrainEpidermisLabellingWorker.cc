@@ -40,6 +40,7 @@ namespace iRoCS
   void trainEpidermisLabelling(
       TrainingParameters const &parameters, ProgressReporter *pr)
   {
+    BaseTraceRegion trace("trainEpidermisLabelling");
     double sigmaMin = 0.5;
     double sigmaMax = 64.0;
     double sigmaStep = 2.0;
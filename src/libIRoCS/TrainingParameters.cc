@@ -27,9 +27,10 @@ TrainingParameters::TrainingParameters()
         : _trainFiles(), _featureGroup("/features"),
           _generateRandomSamples(false), _nInRootSamples(0),
           _nOutRootSamples(0), _modelFileName("svmModel.h5"),
+          _sampleFileName(""), _memoryLimit(0),
           _sdNormalization(iRoCS::Features::FeatureZeroMeanStddev),
           _houghNormalization(iRoCS::Features::FeatureZeroMeanStddev),
-          _cost(100.0), _gamma(0.01)
+          _cost(100.0), _gamma(0.01), _cascadeRecall(0.995)
 {}
 
 TrainingParameters::~TrainingParameters()
@@ -97,6 +98,26 @@ std::string TrainingParameters::modelFileName() const
   return _modelFileName;
 }
 
+void TrainingParameters::setSampleFileName(std::string const &name)
+{
+  _sampleFileName = name;
+}
+
+std::string TrainingParameters::sampleFileName() const
+{
+  return _sampleFileName;
+}
+
+void TrainingParameters::setMemoryLimit(size_t memoryLimit)
+{
+  _memoryLimit = memoryLimit;
+}
+
+size_t TrainingParameters::memoryLimit() const
+{
+  return _memoryLimit;
+}
+
 void TrainingParameters::setSdFeatureNormalization(
     iRoCS::Features::NormalizationType normType)
 {
@@ -141,6 +162,16 @@ double TrainingParameters::gamma() const
   return _gamma;
 }
 
+void TrainingParameters::setCascadeRecall(double recall)
+{
+  _cascadeRecall = recall;
+}
+
+double TrainingParameters::cascadeRecall() const
+{
+  return _cascadeRecall;
+}
+
 std::string TrainingParameters::check()
 {
   // Check input files
@@ -159,6 +190,8 @@ std::string TrainingParameters::check()
   if (nPositiveSamples == nSamples && nInRootSamples() + nOutRootSamples() == 0)
       return "No negative samples available for discriminative training. "
           "You need to generate random negative samples.";
+  if (cascadeRecall() < 0.0 || cascadeRecall() > 1.0)
+      return "The cascade recall must be in [0, 1]";
 
   return "";
 }
@@ -60,6 +60,32 @@ public:
   virtual void setModelFileName(std::string const &name);
   virtual std::string modelFileName() const;
 
+/*======================================================================*/
+/*! 
+ *   Set the hdf5 file the per-file training samples are stored to while
+ *   the training set is built. Files whose samples are already stored
+ *   with matching parameters are skipped when training is restarted. If
+ *   empty (default), the samples are only kept in memory.
+ *
+ *   \param name The sample file name
+ */
+/*======================================================================*/
+  virtual void setSampleFileName(std::string const &name);
+  virtual std::string sampleFileName() const;
+
+/*======================================================================*/
+/*! 
+ *   Set the memory in bytes the feature extraction may use. As many
+ *   training files as fit into this budget by their estimated memory
+ *   requirements are processed concurrently, but always at least one. If
+ *   zero (default), the files are processed one after the other.
+ *
+ *   \param memoryLimit The memory limit in bytes
+ */
+/*======================================================================*/
+  virtual void setMemoryLimit(size_t memoryLimit);
+  virtual size_t memoryLimit() const;
+
   virtual void setSdFeatureNormalization(
       iRoCS::Features::NormalizationType normType);
   virtual iRoCS::Features::NormalizationType sdFeatureNormalization() const;
@@ -74,6 +100,19 @@ public:
   virtual void setGamma(double gamma);
   virtual double gamma() const;
 
+/*======================================================================*/
+/*! 
+ *   Set the fraction of positive training samples the linear early-reject
+ *   stage of the detector cascade must retain. The rejection threshold of
+ *   the cascade stage is chosen accordingly. Set it to 0 to train no
+ *   cascade stage.
+ *
+ *   \param recall The target recall of the cascade stage in [0, 1]
+ */
+/*======================================================================*/
+  virtual void setCascadeRecall(double recall);
+  virtual double cascadeRecall() const;
+
   std::string check();
 
 private:
@@ -83,8 +122,11 @@ private:
   bool _generateRandomSamples;
   int _nInRootSamples, _nOutRootSamples;
   std::string _modelFileName;
+  std::string _sampleFileName;
+  size_t _memoryLimit;
   iRoCS::Features::NormalizationType _sdNormalization, _houghNormalization;
   double _cost, _gamma;
+  double _cascadeRecall;
   
 };
 
@@ -21,8 +21,12 @@
  **************************************************************************/
 
 #include "iRoCSFeatures.hh"
+#include "SVMModelRegistry.hh"
+
+#include <algorithm>
 
 #include <libArrayToolbox/Random.hh>
+#include <libArrayToolbox/ATBLinAlg.hh>
 
 #include <libsvmtl/StDataHdf5.hh>
 #include <libsvmtl/MultiClassSVMOneVsOne.hh>
@@ -73,7 +77,7 @@ namespace iRoCS
   Features::Features(
       blitz::TinyVector<double,3> const &featureElementSizeUm,
       iRoCS::ProgressReporter *progress)
-          : p_progress(progress)
+          : p_progress(progress), _cascadeBias(0.0), _cascadeThreshold(0.0)
   {
     std::cout << "Initializing iRoCS::Features... " << std::flush;
     _dataScaled.setElementSizeUm(featureElementSizeUm);
@@ -211,6 +215,7 @@ namespace iRoCS
 
   void Features::normalizeFeatures(std::vector<svt::BasicFV> &samples)
   {
+    BaseTraceRegion trace("Features::normalizeFeatures");
     size_t feaStart = 0;
     for (size_t i = 0; i < _featureGroups.size(); ++i) 
     {
@@ -342,6 +347,7 @@ namespace iRoCS
         modelMap.setArray("featureStddevs_" + groupName,
                           _stddevs[i].begin(), _stddevs[i].size());
       }
+      SVMModelRegistry::invalidate(modelFileName);
     }
     catch (std::exception &e)
     {
@@ -355,43 +361,24 @@ namespace iRoCS
   void Features::loadNormalizationParameters(
       std::string const &modelFileName) 
   {
+    SVMNormalizationParameters const *cached = NULL;
     try
     {
-      svt::StDataHdf5 modelMap(modelFileName.c_str());
-      modelMap.setExceptionFlag(true);
+      cached = &SVMModelRegistry::normalizationParameters(modelFileName);
+      SVMNormalizationParameters const &parameters = *cached;
 
-      int nFeatureGroups = modelMap.getArraySize("featureGroups");
-      _featureGroups.resize(nFeatureGroups);
-      modelMap.getArray(
-          "featureGroups", _featureGroups.begin(), nFeatureGroups);
+      _featureGroups = parameters.featureGroups;
       _featureBaseGroup = _featureGroups.front().substr(
           0, _featureGroups.front().rfind("/"));
       _featureBaseGroup = _featureBaseGroup.substr(
           0, _featureBaseGroup.rfind("/"));
-      _normalize.resize(nFeatureGroups);
-      std::vector<int> normalize(nFeatureGroups);
-      modelMap.getArray(
-          "featureNormalization", normalize.begin(), nFeatureGroups);
-      for (int i = 0; i < nFeatureGroups; ++i)
-          _normalize[i] = static_cast<NormalizationType>(normalize[i]);
-      _featureNames.resize(_featureGroups.size());
-      _means.resize(_featureGroups.size());
-      _stddevs.resize(_featureGroups.size());
-      for (size_t i = 0; i < _featureGroups.size(); ++i) 
-      {
-        std::string groupName = h5GroupName(_featureGroups[i]);
-        _featureNames[i].resize(
-            modelMap.getArraySize("featureNames_" + groupName));
-        int nFeatures = _featureNames[i].size();
-        modelMap.getArray(
-            "featureNames_" + groupName, _featureNames[i].begin(), nFeatures);
-        _means[i].resize(nFeatures);
-        modelMap.getArray(
-            "featureMeans_" + groupName, _means[i].begin(), nFeatures);
-        _stddevs[i].resize(nFeatures);
-        modelMap.getArray(
-            "featureStddevs_" + groupName, _stddevs[i].begin(), nFeatures);
-      }
+      _normalize.resize(parameters.normalization.size());
+      for (size_t i = 0; i < parameters.normalization.size(); ++i)
+          _normalize[i] =
+              static_cast<NormalizationType>(parameters.normalization[i]);
+      _featureNames = parameters.featureNames;
+      _means = parameters.means;
+      _stddevs = parameters.stddevs;
     }
     catch (std::exception &e)
     {
@@ -399,6 +386,7 @@ namespace iRoCS
           std::string("Could not load normalization parameters from SVM "
                       "model:") + e.what());
     }
+    if (cached != NULL) SVMModelRegistry::release(*cached);
   }
 
   void Features::trainTwoClassSVM(
@@ -406,6 +394,7 @@ namespace iRoCS
       std::string const &modelFileName,
       float cost, float gamma) 
   {
+    BaseTraceRegion trace("Features::trainTwoClassSVM");
     std::cout << "Training two-class SVM on " << trainVectors.size()
               << " training samples" << std::endl;
     
@@ -422,6 +411,7 @@ namespace iRoCS
       modelMap.setExceptionFlag(true);
       svm.saveParameters(modelMap);
       model.saveParameters(modelMap);
+      SVMModelRegistry::invalidate(modelFileName);
     }
     catch (std::exception& e) 
     {
@@ -435,17 +425,15 @@ namespace iRoCS
       std::vector<svt::BasicFV> &testVectors,
       std::string const &modelFileName)
   {
+    BaseTraceRegion trace("Features::classifyTwoClassSVM");
     std::cout << "Classifying " << testVectors.size() << " test samples"
               << std::endl;
-    svt::Model<svt::BasicFV> model;
-    svt::TwoClassSVMc<svt::Kernel_RBF> svm;
 
+    CompactSVMModel const *model = NULL;
     try
     {
-      svt::StDataHdf5 modelMap(modelFileName.c_str());
-      modelMap.setExceptionFlag(true);
-      model.loadParameters(modelMap);    
-      svm.loadParameters(modelMap);
+      BaseTraceRegion loadTrace("Load SVM model");
+      model = &SVMModelRegistry::twoClassModel(modelFileName);
     }
     catch (std::exception &e)
     {
@@ -454,8 +442,6 @@ namespace iRoCS
       return;
     }
     
-    svm.clearKernelCache();
-    
     double progressStepPerClassification = 0.0;
     if (p_progress != NULL)
     {
@@ -468,26 +454,35 @@ namespace iRoCS
 
     int nClassified = 0;
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(testVectors.size()); ++i)
     {
-      if (p_progress != NULL)
+      std::vector<double> kernel(model->nSupportVectors());
+#ifdef _OPENMP
+#pragma omp for
+#endif
+      for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(testVectors.size());
+           ++i)
       {
-        if (p_progress->isAborted()) continue;
+        if (p_progress != NULL)
+        {
+          if (p_progress->isAborted()) continue;
 #ifdef _OPENMP
 #pragma omp critical
 #endif
-        {
-          nClassified++;
-          int progress = static_cast<int>(
-              static_cast<double>(p_progress->taskProgressMin()) +
-              static_cast<double>(nClassified) * progressStepPerClassification);
-          p_progress->updateProgress(progress);
+          {
+            nClassified++;
+            int progress = static_cast<int>(
+                static_cast<double>(p_progress->taskProgressMin()) +
+                static_cast<double>(nClassified) *
+                progressStepPerClassification);
+            p_progress->updateProgress(progress);
+          }
         }
+        testVectors[i].setLabel(model->classify(testVectors[i], kernel));
       }
-      testVectors[i].setLabel(svm.classify(testVectors[i], model));
     }
+    SVMModelRegistry::release(*model);
     std::cout << "Classification finished" << std::endl;
   }
 
@@ -496,6 +491,7 @@ namespace iRoCS
       std::string const &modelFileName,
       float cost, float gamma) 
   {
+    BaseTraceRegion trace("Features::trainMultiClassSVM");
     std::cout << "Training multi-class SVM on " << trainVectors.size()
               << " training samples" << std::endl;
     
@@ -512,6 +508,7 @@ namespace iRoCS
       modelMap.setExceptionFlag(true);
       svm.saveParameters(modelMap);
       model.saveParameters(modelMap);
+      SVMModelRegistry::invalidate(modelFileName);
     }
     catch (std::exception& e) 
     {
@@ -525,17 +522,15 @@ namespace iRoCS
       std::vector<svt::BasicFV> &testVectors,
       std::string const &modelFileName) 
   {
+    BaseTraceRegion trace("Features::classifyMultiClassSVM");
     std::cout << "Classifying " << testVectors.size() << " test samples"
               << std::endl;
-    svt::Model_MC_OneVsOne< svt::Model<svt::BasicFV> > model;
-    svt::MultiClassSVMOneVsOne< svt::TwoClassSVMc<svt::Kernel_RBF> > svm;
 
+    CompactSVMModel const *model = NULL;
     try
     {
-      svt::StDataHdf5 modelMap(modelFileName.c_str());
-      modelMap.setExceptionFlag(true);
-      model.loadParameters(modelMap);
-      svm.loadParameters(modelMap);
+      BaseTraceRegion loadTrace("Load SVM model");
+      model = &SVMModelRegistry::multiClassModel(modelFileName);
     }
     catch (std::exception &e)
     {
@@ -543,8 +538,6 @@ namespace iRoCS
           "Could not load SVM model from '" + modelFileName + "': " + e.what());
       return;
     }
-
-    svm.clearKernelCache();
     
     double progressStepPerClassification = 0.0;
     double progress = 0;
@@ -559,25 +552,243 @@ namespace iRoCS
     }
 
 #ifdef _OPENMP
-#pragma omp parallel for
+#pragma omp parallel
 #endif
-    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(testVectors.size()); ++i)
     {
-      if (p_progress != NULL)
+      std::vector<double> kernel(model->nSupportVectors());
+#ifdef _OPENMP
+#pragma omp for
+#endif
+      for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(testVectors.size());
+           ++i)
       {
-        if (p_progress->isAborted()) continue;
+        if (p_progress != NULL)
+        {
+          if (p_progress->isAborted()) continue;
 #ifdef _OPENMP
 #pragma omp atomic
 #endif
-        progress += progressStepPerClassification;
-        p_progress->updateProgress(static_cast<int>(progress));
+          progress += progressStepPerClassification;
+          p_progress->updateProgress(static_cast<int>(progress));
+        }
+
+        testVectors[i].setLabel(model->classify(testVectors[i], kernel));
       }
-      
-      testVectors[i].setLabel(svm.classify(testVectors[i], model));
     }
+    SVMModelRegistry::release(*model);
     std::cout << "Classification finished" << std::endl;
   }
 
+  void Features::trainCascade(
+      std::vector<svt::BasicFV> const &trainVectors,
+      std::vector<int> const &featureIndices, double targetRecall)
+  {
+    _cascadeFeatureIndices.clear();
+    _cascadeWeights.clear();
+    _cascadeBias = 0.0;
+    _cascadeThreshold = 0.0;
+    if (targetRecall <= 0.0 || featureIndices.size() == 0 ||
+        trainVectors.size() == 0) return;
+
+    if (p_progress != NULL && !p_progress->updateProgressMessage(
+            "Training cascade stage")) return;
+
+    int nFeatures = static_cast<int>(featureIndices.size());
+    double nSamples = static_cast<double>(trainVectors.size());
+
+    // Standardize the cascade features to get a well-conditioned
+    // within-class scatter matrix
+    std::vector<double> mean(nFeatures, 0.0), stddev(nFeatures, 0.0);
+    for (size_t i = 0; i < trainVectors.size(); ++i)
+        for (int k = 0; k < nFeatures; ++k)
+            mean[k] += trainVectors[i][featureIndices[k]];
+    for (int k = 0; k < nFeatures; ++k) mean[k] /= nSamples;
+    for (size_t i = 0; i < trainVectors.size(); ++i)
+        for (int k = 0; k < nFeatures; ++k)
+            stddev[k] += (trainVectors[i][featureIndices[k]] - mean[k]) *
+                (trainVectors[i][featureIndices[k]] - mean[k]);
+    for (int k = 0; k < nFeatures; ++k)
+    {
+      stddev[k] = std::sqrt(stddev[k] / nSamples);
+      if (stddev[k] == 0.0) stddev[k] = 1.0;
+    }
+
+    blitz::Array<double,1> x(nFeatures);
+    blitz::Array<double,1> meanPos(nFeatures), meanNeg(nFeatures);
+    meanPos = 0.0;
+    meanNeg = 0.0;
+    ptrdiff_t nPos = 0, nNeg = 0;
+    for (size_t i = 0; i < trainVectors.size(); ++i)
+    {
+      for (int k = 0; k < nFeatures; ++k)
+          x(k) = (trainVectors[i][featureIndices[k]] - mean[k]) / stddev[k];
+      if (trainVectors[i].getLabel() > 0)
+      {
+        meanPos += x;
+        nPos++;
+      }
+      else
+      {
+        meanNeg += x;
+        nNeg++;
+      }
+    }
+    if (nPos == 0 || nNeg == 0)
+    {
+      std::cout << "Cascade stage needs positive and negative samples. "
+                << "Skipping cascade training" << std::endl;
+      return;
+    }
+    meanPos /= static_cast<double>(nPos);
+    meanNeg /= static_cast<double>(nNeg);
+
+    blitz::Array<double,2> Sw(nFeatures, nFeatures);
+    Sw = 0.0;
+    for (size_t i = 0; i < trainVectors.size(); ++i)
+    {
+      for (int k = 0; k < nFeatures; ++k)
+          x(k) = (trainVectors[i][featureIndices[k]] - mean[k]) / stddev[k];
+      if (trainVectors[i].getLabel() > 0) x -= meanPos;
+      else x -= meanNeg;
+      for (int r = 0; r < nFeatures; ++r)
+          for (int c = 0; c < nFeatures; ++c) Sw(r, c) += x(r) * x(c);
+    }
+    Sw /= nSamples;
+    for (int k = 0; k < nFeatures; ++k) Sw(k, k) += 1.0e-3;
+
+    blitz::Array<double,1> meanDiff(nFeatures);
+    meanDiff = meanPos - meanNeg;
+    blitz::Array<double,1> w(atb::mvMult(atb::invert(Sw), meanDiff));
+
+    // Fold the standardization into the weights, so that the stage can
+    // be applied to raw feature values
+    _cascadeFeatureIndices = featureIndices;
+    _cascadeWeights.resize(nFeatures);
+    for (int k = 0; k < nFeatures; ++k)
+    {
+      _cascadeWeights[k] = w(k) / stddev[k];
+      _cascadeBias -= _cascadeWeights[k] * mean[k];
+    }
+
+    // Choose the threshold to retain the requested fraction of positives
+    std::vector<double> posValues, negValues;
+    for (size_t i = 0; i < trainVectors.size(); ++i)
+    {
+      if (trainVectors[i].getLabel() > 0)
+          posValues.push_back(cascadeDecisionValue(trainVectors[i]));
+      else negValues.push_back(cascadeDecisionValue(trainVectors[i]));
+    }
+    std::sort(posValues.begin(), posValues.end());
+    size_t thresholdIdx = static_cast<size_t>(
+        std::floor((1.0 - std::min(targetRecall, 1.0)) *
+                   static_cast<double>(posValues.size())));
+    if (thresholdIdx >= posValues.size()) thresholdIdx = posValues.size() - 1;
+    _cascadeThreshold = posValues[thresholdIdx];
+
+    ptrdiff_t nRejectedNeg = 0;
+    for (size_t i = 0; i < negValues.size(); ++i)
+        if (negValues[i] < _cascadeThreshold) nRejectedNeg++;
+    std::cout << "  Cascade stage on " << nFeatures << " features: recall "
+              << static_cast<double>(posValues.size() - thresholdIdx) /
+        static_cast<double>(posValues.size())
+              << ", negative rejection rate "
+              << static_cast<double>(nRejectedNeg) /
+        static_cast<double>(negValues.size()) << " (training set)"
+              << std::endl;
+  }
+
+  void Features::saveCascadeParameters(std::string const &modelFileName)
+  {
+    if (!hasCascade()) return;
+    try
+    {
+      svt::StDataHdf5 modelMap(modelFileName.c_str(), H5F_ACC_RDWR);
+      modelMap.setExceptionFlag(true);
+      modelMap.setArray(
+          "cascadeFeatureIndices", _cascadeFeatureIndices.begin(),
+          _cascadeFeatureIndices.size());
+      modelMap.setArray(
+          "cascadeWeights", _cascadeWeights.begin(), _cascadeWeights.size());
+      modelMap.setValue("cascadeBias", _cascadeBias);
+      modelMap.setValue("cascadeThreshold", _cascadeThreshold);
+    }
+    catch (std::exception &e)
+    {
+      if (p_progress != NULL)
+          p_progress->abortWithError(
+              std::string("Could not save cascade parameters to SVM "
+                          "model: ") + e.what());
+    }
+  }
+
+  bool Features::loadCascadeParameters(std::string const &modelFileName)
+  {
+    _cascadeFeatureIndices.clear();
+    _cascadeWeights.clear();
+    _cascadeBias = 0.0;
+    _cascadeThreshold = 0.0;
+    try
+    {
+      svt::StDataHdf5 modelMap(modelFileName.c_str());
+      modelMap.setExceptionFlag(true);
+      if (!modelMap.valueExists("cascadeThreshold")) return false;
+      size_t nFeatures = modelMap.getArraySize("cascadeFeatureIndices");
+      std::vector<int> featureIndices(nFeatures);
+      std::vector<double> weights(nFeatures);
+      modelMap.getArray(
+          "cascadeFeatureIndices", featureIndices.begin(),
+          static_cast<int>(nFeatures));
+      modelMap.getArray(
+          "cascadeWeights", weights.begin(), static_cast<int>(nFeatures));
+      modelMap.getValue("cascadeBias", _cascadeBias);
+      modelMap.getValue("cascadeThreshold", _cascadeThreshold);
+      _cascadeFeatureIndices = featureIndices;
+      _cascadeWeights = weights;
+    }
+    catch (std::exception &e)
+    {
+      std::cerr << "Could not load cascade parameters from '"
+                << modelFileName << "': " << e.what() << std::endl;
+      _cascadeFeatureIndices.clear();
+      _cascadeWeights.clear();
+      return false;
+    }
+    return hasCascade();
+  }
+
+  bool Features::hasCascade() const
+  {
+    return _cascadeFeatureIndices.size() != 0;
+  }
+
+  std::vector<int> const &Features::cascadeFeatureIndices() const
+  {
+    return _cascadeFeatureIndices;
+  }
+
+  std::vector<double> const &Features::cascadeWeights() const
+  {
+    return _cascadeWeights;
+  }
+
+  double Features::cascadeBias() const
+  {
+    return _cascadeBias;
+  }
+
+  double Features::cascadeThreshold() const
+  {
+    return _cascadeThreshold;
+  }
+
+  double Features::cascadeDecisionValue(svt::BasicFV const &fv) const
+  {
+    double res = _cascadeBias;
+    for (size_t k = 0; k < _cascadeFeatureIndices.size(); ++k)
+        res += _cascadeWeights[k] * fv[_cascadeFeatureIndices[k]];
+    return res;
+  }
+
   std::string Features::h5GroupName(const std::string& rawGroup)
   {
     std::string res = rawGroup;
@@ -585,4 +796,62 @@ namespace iRoCS
     return res;
   }
 
+  void Features::sdGaussianKernel(
+      double sigmaPx, atb::BlitzIndexT extent, blitz::Array<double,1> &kernel)
+  {
+    blitz::Array<double,1> full(2 * (extent / 2) + 1);
+    atb::gaussian(
+        full, blitz::TinyVector<double,1>(sigmaPx),
+        blitz::TinyVector<double,1>(1.0), atb::NORESIZE);
+    atb::BlitzIndexT skip = 0;
+    while (skip < full.extent(0) / 2 && full(skip) == 0.0 &&
+           full(full.extent(0) - 1 - skip) == 0.0) ++skip;
+    kernel.resize(full.extent(0) - 2 * skip);
+    kernel = full(blitz::Range(skip, full.extent(0) - 1 - skip));
+  }
+
+  std::string Features::sdFeatureCacheKey(
+      atb::SDMagFeatureIndex const &index) const
+  {
+    if (index.b > 0)
+    {
+      FeatureCacheKey key(
+          sdFeatureCacheKey(atb::SDMagFeatureIndex(index.s, index.l, 0)));
+      key << "STderiv" << index.b;
+      return key.str();
+    }
+    if (index.l > 0)
+    {
+      FeatureCacheKey key(
+          sdFeatureCacheKey(atb::SDMagFeatureIndex(index.s, index.l - 1, 0)));
+      key << "laplacian" << static_cast<int>(
+          atb::LaplacianFilter<double,3>::SecondOrder);
+      return key.str();
+    }
+    FeatureCacheKey key(_dataScaledCacheKey);
+    key << "gaussian" << index.s;
+    return key.str();
+  }
+
+  std::string Features::intrinsicCoordinatesCacheKey(
+      atb::IRoCS const &rct) const
+  {
+    FeatureCacheKey key(_dataScaledCacheKey);
+    key << "intrinsicCoordinates" << rct.axisSpline().degree();
+    for (size_t i = 0; i < rct.axisSpline().nControlPoints(); ++i)
+        key << rct.axisSpline().controlPoint(i);
+    for (size_t i = 0; i < rct.axisSpline().nKnots(); ++i)
+        key << rct.axisSpline().knot(i);
+    key << rct.thicknessSpline().degree();
+    for (size_t i = 0; i < rct.thicknessSpline().nControlPoints(); ++i)
+        key << rct.thicknessSpline().controlPoint(i);
+    for (size_t i = 0; i < rct.thicknessSpline().nKnots(); ++i)
+        key << rct.thicknessSpline().knot(i);
+    key << rct.uQC();
+    for (int r = 0; r < 4; ++r)
+        for (int c = 0; c < 4; ++c)
+            key << rct.normalizationTransformation()(r, c);
+    return key.str();
+  }
+
 }
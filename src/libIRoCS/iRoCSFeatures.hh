@@ -27,6 +27,8 @@
 #include <config.hh>
 #endif
 
+#include <limits>
+
 #include <libArrayToolbox/ATBDataSynthesis.hh>
 #include <libArrayToolbox/SeparableConvolutionFilter.hh>
 #include <libArrayToolbox/LaplacianFilter.hh>
@@ -37,6 +39,10 @@
 
 #include <libsvmtl/BasicFV.hh>
 
+#include <libBaseFunctions/BaseTrace.hh>
+
+#include "FeatureCache.hh"
+
 namespace iRoCS
 {
 
@@ -145,15 +151,118 @@ namespace iRoCS
         std::vector<svt::BasicFV>& testVectors,
         std::string const &modelFileName);
 
+/*======================================================================*/
+/*! 
+ *   Train the linear early-reject stage of the detector cascade. A
+ *   regularized Fisher discriminant is fitted to the given subset of
+ *   (unnormalized) features of the training vectors. The rejection
+ *   threshold is chosen such that the given fraction of positive training
+ *   samples (label > 0) passes the stage. Recall and rejection rate on the
+ *   training set are reported to std::cout. If targetRecall is <= 0 or no
+ *   feature indices are given, the cascade is cleared.
+ *
+ *   \param trainVectors   The training vectors with raw feature values
+ *   \param featureIndices The indices of the features the linear stage
+ *     operates on. Only cheap features should be used here, otherwise
+ *     the cascade will not pay off.
+ *   \param targetRecall   The fraction of positive samples to retain
+ */
+/*======================================================================*/
+    void trainCascade(
+        std::vector<svt::BasicFV> const &trainVectors,
+        std::vector<int> const &featureIndices, double targetRecall);
+
+    void saveCascadeParameters(std::string const &modelFileName);
+
+/*======================================================================*/
+/*! 
+ *   Load the parameters of the linear early-reject stage from the given
+ *   model file. Models without cascade stage are valid, in this case false
+ *   is returned and hasCascade() will be false afterwards.
+ *
+ *   \param modelFileName The SVM model file name
+ *
+ *   \return true if a cascade stage was found, false otherwise
+ */
+/*======================================================================*/
+    bool loadCascadeParameters(std::string const &modelFileName);
+
+    bool hasCascade() const;
+    std::vector<int> const &cascadeFeatureIndices() const;
+    std::vector<double> const &cascadeWeights() const;
+    double cascadeBias() const;
+    double cascadeThreshold() const;
+
+/*======================================================================*/
+/*! 
+ *   Compute the linear decision value of the cascade stage for the given
+ *   (unnormalized) feature vector. Samples with decision values below
+ *   cascadeThreshold() are rejected.
+ *
+ *   \param fv The full feature vector to evaluate the cascade stage for
+ *
+ *   \return The decision value of the linear stage
+ */
+/*======================================================================*/
+    double cascadeDecisionValue(svt::BasicFV const &fv) const;
+
     static std::string h5GroupName(const std::string& rawGroup);
 
+/*======================================================================*/
+/*! 
+ *   Compute the Gaussian kernel the SD features of the given scale are
+ *   smoothed with: the unnormalized, pixel integrated Gaussian spanning
+ *   the data extent. Entries that are exactly zero are removed from both
+ *   ends. Smoothing with the shortened kernel gives the same values as
+ *   smoothing with the full one, but small scales need far fewer
+ *   operations.
+ *
+ *   \param sigmaPx  The standard deviation in pixels
+ *   \param extent   The data extent along the filtered dimension
+ *   \param kernel   The kernel of odd length
+ */
+/*======================================================================*/
+    static void sdGaussianKernel(
+        double sigmaPx, atb::BlitzIndexT extent,
+        blitz::Array<double,1> &kernel);
+
   private:
+
+/*======================================================================*/
+/*!
+ *   Get the cache key of the scaled data. It hashes the raw data, its
+ *   type and element size and the feature element size. All other cache
+ *   keys are derived from it, so any change to the input invalidates all
+ *   cached features.
+ */
+/*======================================================================*/
+    template<typename DataT>
+    std::string const &dataScaledCacheKey(atb::Array<DataT,3> const &data);
+
+/*======================================================================*/
+/*!
+ *   Get the cache key of the given SD feature. Gaussians depend on the
+ *   scaled data, Laplacians on the next lower Laplacian level and bands
+ *   on band zero of their scale and level. dataScaledCacheKey() must have
+ *   been called before.
+ */
+/*======================================================================*/
+    std::string sdFeatureCacheKey(atb::SDMagFeatureIndex const &index) const;
+
+/*======================================================================*/
+/*!
+ *   Get the cache key of the intrinsic coordinates for the given iRoCS
+ *   model. dataScaledCacheKey() must have been called before.
+ */
+/*======================================================================*/
+    std::string intrinsicCoordinatesCacheKey(atb::IRoCS const &rct) const;
   
     iRoCS::ProgressReporter *p_progress;
 
     std::map<int,std::string> _houghDsNames;
 
     atb::Array<double,3> _dataScaled;
+    std::string _dataScaledCacheKey;
     std::map< atb::SDMagFeatureIndex, atb::Array<double,3> > _sdFeatures;
     std::map< int, atb::Array<double,3> > _houghFeatures;
     atb::Array<blitz::TinyVector<double,3>,3> _intrinsicCoordinates;
@@ -164,6 +273,10 @@ namespace iRoCS
     std::vector< std::vector<std::string> > _featureNames;
     std::vector< std::vector<double> > _means, _stddevs;
 
+    std::vector<int> _cascadeFeatureIndices;
+    std::vector<double> _cascadeWeights;
+    double _cascadeBias, _cascadeThreshold;
+
   };
 
 }
@@ -85,6 +85,9 @@ void AnalyzeAndSTLDataIO::save(std::string const &fileNameStub) const
       // Constant array... not so good for normalization
       if (valueScale == 0.0f) valueScale = 1.0f;
 
+      // Fetch the data once, paged channels are loaded on first access
+      atb::Array<float,3> const *channelData = channel->data();
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -98,7 +101,7 @@ void AnalyzeAndSTLDataIO::save(std::string const &fileNameStub) const
           tmp /= data.extent(d);
         }
         float val =
-            (channel->data()->valueAt(posUm) - channel->displayMin()) /
+            (channelData->valueAt(posUm) - channel->displayMin()) /
             valueScale;
         if (val < 0.0f) val = 0.0f;
         if (val > 1.0f) val = 1.0f;
@@ -58,7 +58,8 @@
 
 AnnotationChannelSpecs::AnnotationChannelSpecs(
     Marker::MarkerType markerType, MultiChannelModel *model)
-        : ChannelSpecs(model), _markerType(markerType), _selectedMarker(NULL)
+        : ChannelSpecs(model), _markerType(markerType), _selectedMarker(NULL),
+          _markerIndexUpToDate(true), _markerIndexRevision(0)
 {
   disconnect(
       p_alphaControl, SIGNAL(valueChanged()), this, SLOT(emitUpdateRequest()));
@@ -273,21 +274,29 @@ Marker *AnnotationChannelSpecs::closestMarker(
     blitz::TinyVector<double,3> const &positionUm, bool intersecting)
 {
   if (_markers.size() == 0) return NULL;
+  if (!_markerIndexUpToDate) _rebuildMarkerIndex();
+  return _markerIndex.closestMarker(positionUm, intersecting);
+}
 
-  Marker *res = NULL;
-  double minSqDistance = std::numeric_limits<double>::infinity();
-  for (const_iterator it = _markers.begin(); it != _markers.end(); ++it)
-  {
-    if (intersecting && !(*it)->occupiesPositionUm(positionUm)) continue;
-    double sqDistance = blitz::dot(
-        positionUm - (*it)->positionUm(), positionUm - (*it)->positionUm());
-    if (sqDistance < minSqDistance)
-    {
-      minSqDistance = sqDistance;
-      res = *it;
-    }
-  }
-  return res;
+void AnnotationChannelSpecs::markersIntersectingPlane(
+    int dimension, double positionUm, double marginUm,
+    std::vector<Marker*> &markers)
+{
+  if (_markers.size() == 0) return;
+  if (!_markerIndexUpToDate) _rebuildMarkerIndex();
+  _markerIndex.markersIntersectingPlane(
+      dimension, positionUm, marginUm, markers);
+}
+
+void AnnotationChannelSpecs::updateMarkerIndex(Marker *marker)
+{
+  if (!_markerIndexUpToDate) return;
+  _markerIndex.update(marker);
+}
+
+unsigned int AnnotationChannelSpecs::markerIndexRevision() const
+{
+  return _markerIndexRevision;
 }
 
 Marker *AnnotationChannelSpecs::addMarker(
@@ -346,6 +355,7 @@ void AnnotationChannelSpecs::addMarker(Marker *marker)
   }
   _markers.push_back(marker);
   marker->setChannel(this);
+  if (_markerIndexUpToDate) _markerIndex.insert(marker);
 
   if (p_model != NULL)
   {
@@ -401,6 +411,7 @@ void AnnotationChannelSpecs::removeMarker(Marker *marker)
   iterator it = _markers.begin();
   while (*it != marker) ++it;
   if (it != _markers.end()) _markers.erase(it);
+  _markerIndex.remove(marker);
   if (marker == _selectedMarker) selectMarker(NULL);
   delete marker;
   if (p_model != NULL) p_model->setModified(true);
@@ -877,6 +888,24 @@ void AnnotationChannelSpecs::setCoordinateUpdateButtonEnabled(bool enable)
   p_coordinateUpdateButton->setEnabled(enable);
 }
 
+void AnnotationChannelSpecs::setTransformation(
+    blitz::TinyMatrix<double,4,4> const &transformation)
+{
+  if (blitz::all(_transformation == transformation)) return;
+  // All marker positions change, the index is lazily rebuilt on next query
+  _markerIndexUpToDate = false;
+  ++_markerIndexRevision;
+  ChannelSpecs::setTransformation(transformation);
+}
+
+void AnnotationChannelSpecs::_rebuildMarkerIndex()
+{
+  _markerIndex.clear();
+  for (iterator it = _markers.begin(); it != _markers.end(); ++it)
+      _markerIndex.insert(*it);
+  _markerIndexUpToDate = true;
+}
+
 void AnnotationChannelSpecs::updateBoundingBox()
 {
 #ifdef DEBUG
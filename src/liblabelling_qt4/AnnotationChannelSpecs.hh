@@ -33,6 +33,7 @@
 
 #include "HDF5DataIO.hh"
 #include "Marker.hh"
+#include "MarkerSpatialIndex.hh"
 
 class QComboBox;
 class QStackedWidget;
@@ -70,6 +71,46 @@ public:
 
   Marker *closestMarker(
       blitz::TinyVector<double,3> const &positionUm, bool intersecting = false);
+
+/*======================================================================*/
+/*! 
+ *   Append all markers whose bounding box, padded by the given margin,
+ *   may intersect the plane orthogonal to the given dimension at the given
+ *   position. The query is answered by the channel's spatial marker index
+ *   and does not touch markers far from the plane.
+ *
+ *   \param dimension  The dimension orthogonal to the plane
+ *   \param positionUm The plane position along dimension in micrometers
+ *   \param marginUm   Additional tolerance in micrometers
+ *   \param markers    The found markers are appended to this vector
+ */
+/*======================================================================*/
+  void markersIntersectingPlane(
+      int dimension, double positionUm, double marginUm,
+      std::vector<Marker*> &markers);
+
+/*======================================================================*/
+/*! 
+ *   Re-register the given marker in the spatial marker index. This is
+ *   called by the Marker whenever its position or extent changed.
+ *
+ *   \param marker The changed marker of this channel
+ */
+/*======================================================================*/
+  void updateMarkerIndex(Marker *marker);
+
+/*======================================================================*/
+/*! 
+ *   Get the revision of the spatial marker index. The revision is
+ *   incremented whenever all marker positions change at once, e.g. when
+ *   the channel transformation is altered. Renderers that remember query
+ *   results must discard them when the revision changes.
+ *
+ *   \return The current marker index revision
+ */
+/*======================================================================*/
+  unsigned int markerIndexRevision() const;
+
   Marker *addMarker(blitz::TinyVector<double,3> const &positionUm);
 
   void addMarker(Marker *marker);
@@ -121,6 +162,8 @@ signals:
 public slots:
         
   void setCoordinateUpdateButtonEnabled(bool enable);
+  void setTransformation(
+      blitz::TinyMatrix<double,4,4> const &transformation);
 
 private slots:
   
@@ -130,10 +173,16 @@ private slots:
 
 private:
   
+  void _rebuildMarkerIndex();
+
   Marker::MarkerType _markerType;
   Marker *_selectedMarker;
   std::vector<Marker*> _markers;
 
+  MarkerSpatialIndex _markerIndex;
+  bool _markerIndexUpToDate;
+  unsigned int _markerIndexRevision;
+
   MarkerPresetWidget *p_presetWidget;
   MarkerControlWidget *p_controlWidget;
 
@@ -30,6 +30,8 @@
 #include <QtCore/QThread>
 #include <QtXml/QXmlStreamWriter>
 
+#include <algorithm>
+
 #include "MarkerOrthoViewRenderer.hh"
 #include "OrthoViewUserInteractionEvent.hh"
 #include "NucleusMarker.hh"
@@ -38,10 +40,16 @@
 #include "AnnotationChannelSpecs.hh"
 #include "OrthoViewPlane.hh"
 
+// Markers are drawn up to this distance in pixels from the slice (see
+// PointMarkerOrthoViewRenderer and SphereMarkerOrthoViewRenderer)
+static const double SliceMarginPx = 6.0;
+
 AnnotationChannelSpecsOrthoViewRenderer::
 AnnotationChannelSpecsOrthoViewRenderer(
     AnnotationChannelSpecs* channel, OrthoViewWidget* view)
-        : ChannelSpecsOrthoViewRenderer(channel, view), p_marker(NULL)
+        : ChannelSpecsOrthoViewRenderer(channel, view), p_marker(NULL),
+          _sliceUm(0.0), _sliceMarginUm(0.0), _sliceValid(false),
+          _sliceIndexRevision(0)
 {}
   
 AnnotationChannelSpecsOrthoViewRenderer::
@@ -209,7 +217,10 @@ void AnnotationChannelSpecsOrthoViewRenderer::render(QPainter* painter) const
   if (painter == NULL || !painter->isActive()) return;
   if (p_channel == NULL) return;
 
-  std::vector<Marker*> const &markers =
+  std::vector<Marker*> sliceMarkers;
+  bool useIndex = _sliceMarkersAvailable(_orthogonalDimension);
+  if (useIndex) _sliceMarkers(_orthogonalDimension, sliceMarkers);
+  std::vector<Marker*> const &markers = useIndex ? sliceMarkers :
       static_cast<AnnotationChannelSpecs*>(p_channel)->markers();
 
   for (size_t i = 0; i < markers.size(); ++i)
@@ -286,6 +297,7 @@ void AnnotationChannelSpecsOrthoViewRenderer::setCacheUpdatesEnabled(
   if (_cacheUpdatesEnabled == enable) return;
   
   _cacheUpdatesEnabled = enable;
+  if (enable) _sliceValid = false;
 
   std::vector<Marker*> const &markers =
       static_cast<AnnotationChannelSpecs*>(p_channel)->markers();
@@ -301,8 +313,29 @@ void AnnotationChannelSpecsOrthoViewRenderer::updateCache(int direction) const
   bool oldUpdatesEnabledState = p_view->updatesEnabled();
   p_view->setUpdatesEnabled(false);
 
+  AnnotationChannelSpecs *channel =
+      static_cast<AnnotationChannelSpecs*>(p_channel);
+  OrthoViewWidget *view = static_cast<OrthoViewWidget*>(p_view);
+  double sliceUm = view->positionUm()(direction);
+  double sliceMarginUm = view->scaleToUm(SliceMarginPx);
+
+  // Markers with active cache lie close to the old slice, markers that
+  // may become visible lie close to the new slice. All others keep their
+  // inactive caches.
+  std::vector<Marker*> sliceMarkers;
+  bool useIndex = _sliceMarkersAvailable(direction);
+  if (useIndex)
+  {
+    _sliceMarkers(direction, sliceMarkers);
+    channel->markersIntersectingPlane(
+        direction, sliceUm, sliceMarginUm, sliceMarkers);
+    std::sort(sliceMarkers.begin(), sliceMarkers.end());
+    sliceMarkers.erase(
+        std::unique(sliceMarkers.begin(), sliceMarkers.end()),
+        sliceMarkers.end());
+  }
   std::vector<Marker*> const &markers =
-      static_cast<AnnotationChannelSpecs*>(p_channel)->markers();
+      useIndex ? sliceMarkers : channel->markers();
   
   for (size_t i = 0; i < markers.size(); ++i)
   {
@@ -313,7 +346,30 @@ void AnnotationChannelSpecsOrthoViewRenderer::updateCache(int direction) const
                      << " could not be rendered. No associated renderer found"
                      << std::endl;
   }
+  _sliceUm(direction) = sliceUm;
+  _sliceMarginUm(direction) = sliceMarginUm;
+  _sliceValid(direction) = true;
+  _sliceIndexRevision(direction) = channel->markerIndexRevision();
+
   p_view->setUpdatesEnabled(oldUpdatesEnabledState);
   p_view->update();
 }
 
+bool AnnotationChannelSpecsOrthoViewRenderer::_sliceMarkersAvailable(
+    int direction) const
+{
+  AnnotationChannelSpecs *channel =
+      static_cast<AnnotationChannelSpecs*>(p_channel);
+
+  // Cylinders are drawn as projections in every slice
+  if (channel->markerType() == Marker::Cylinder) return false;
+  return _sliceValid(direction) &&
+      _sliceIndexRevision(direction) == channel->markerIndexRevision();
+}
+
+void AnnotationChannelSpecsOrthoViewRenderer::_sliceMarkers(
+    int direction, std::vector<Marker*> &markers) const
+{
+  static_cast<AnnotationChannelSpecs*>(p_channel)->markersIntersectingPlane(
+      direction, _sliceUm(direction), _sliceMarginUm(direction), markers);
+}
@@ -31,6 +31,8 @@
 
 #include "ChannelSpecsOrthoViewRenderer.hh"
 
+#include <vector>
+
 class AnnotationChannelSpecs;
 class OrthoViewWidget;
 class Marker;
@@ -94,8 +96,20 @@ public slots:
 
 private:
   
+  bool _sliceMarkersAvailable(int direction) const;
+  void _sliceMarkers(
+      int direction, std::vector<Marker*> &markers) const;
+
   Marker *p_marker;
 
+  // The slice positions and margins used at the last cache update for
+  // each direction. All markers with active cache are close to these
+  // slices, so only those have to be visited when rendering or when the
+  // slice moves.
+  mutable blitz::TinyVector<double,3> _sliceUm, _sliceMarginUm;
+  mutable blitz::TinyVector<bool,3> _sliceValid;
+  mutable blitz::TinyVector<unsigned int,3> _sliceIndexRevision;
+
 };
 
 #endif
@@ -238,6 +238,7 @@ void CylinderMarker::setLengthUm(double lengthUm)
   _boundingBoxUpToDate = false;
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
     if (p_channel->model() != NULL)
@@ -260,6 +261,7 @@ void CylinderMarker::setTheta(double theta)
   _boundingBoxUpToDate = false;
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
     if (p_channel->model() != NULL)
@@ -282,6 +284,7 @@ void CylinderMarker::setPhi(double phi)
   _boundingBoxUpToDate = false;
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
     if (p_channel->model() != NULL)
@@ -310,6 +313,7 @@ void CylinderMarker::setOrientation(
   _phi = std::atan2(orientation(1), orientation(2));
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
     if (p_channel->model() != NULL)
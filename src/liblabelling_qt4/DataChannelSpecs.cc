@@ -26,6 +26,7 @@
 
 #include <QtGui/QVBoxLayout>
 #include <QtGui/QPushButton>
+#include <QtCore/QMutexLocker>
 
 #include "ColorControlElement.hh"
 #include "DoubleControlElement.hh"
@@ -36,20 +37,46 @@
 #include "DataChannelSpecsOrthoViewRenderer.hh"
 #include "DataChannelSpecsOpenGlRenderingViewRenderer.hh"
 #include "MultiChannelModel.hh"
+#include "PagedDataArray.hh"
 
 // #include <blitz/tinyvec-et.h>
 
 #include <iostream>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 DataChannelSpecs::DataChannelSpecs(
     atb::Array<float,3> *data, MultiChannelModel *model) 
-        : ChannelSpecs(model), p_data(data)
+        : ChannelSpecs(model), p_data(data), p_pagedData(NULL),
+          p_retiredPagedData(NULL), _dataRevision(0)
 {
   this->_lowerBoundUm = data->lowerBoundUm();
   this->_upperBoundUm = data->upperBoundUm();
   this->_elementSizeUm = data->elementSizeUm();
   this->_originalTransformation = data->transformation();
   setTransformation(this->_originalTransformation);
+  _createControls();
+}
+
+DataChannelSpecs::DataChannelSpecs(
+    PagedDataArray *data, MultiChannelModel *model) 
+        : ChannelSpecs(model), p_data(new atb::Array<float,3>()),
+          p_pagedData(data), p_retiredPagedData(NULL), _dataRevision(0)
+{
+  p_data->setElementSizeUm(data->elementSizeUm());
+  p_data->setTransformation(data->transformation());
+  this->_lowerBoundUm = data->lowerBoundUm();
+  this->_upperBoundUm = data->upperBoundUm();
+  this->_elementSizeUm = data->elementSizeUm();
+  this->_originalTransformation = data->transformation();
+  setTransformation(this->_originalTransformation);
+  _createControls();
+}
+
+void DataChannelSpecs::_createControls()
+{
   _gammaLUT.resize(65536);
 
   p_colorControl = new ColorControlElement(
@@ -90,6 +117,10 @@ DataChannelSpecs::DataChannelSpecs(
 
 DataChannelSpecs::~DataChannelSpecs()
 {
+  // Background slice refinements may still access the data
+  _abortSliceSampling();
+  delete p_pagedData;
+  delete p_retiredPagedData;
   delete p_data;
 }
 
@@ -152,17 +183,30 @@ void DataChannelSpecs::setShowExposureProblems(bool exposure)
 
 atb::Array<float,3> const *DataChannelSpecs::data() const
 {
+  _loadPagedData();
   return p_data;
 }
 
 atb::Array<float,3> *DataChannelSpecs::data() 
 {
+  _loadPagedData();
   return p_data;
 }
 
+bool DataChannelSpecs::isPaged() const
+{
+  return p_pagedData != NULL;
+}
+
+PagedDataArray const *DataChannelSpecs::pagedData() const
+{
+  return p_pagedData;
+}
+
 float DataChannelSpecs::valueAt(
     blitz::TinyVector<double,3> const &positionUm) const 
 {
+  if (p_pagedData != NULL) return p_pagedData->valueAt(positionUm);
   return p_data->valueAt(positionUm);
 }
   
@@ -170,26 +214,106 @@ std::string DataChannelSpecs::stringValueAt(
     blitz::TinyVector<double,3> const &positionUm) const
 {
   std::stringstream os;
-  os << p_data->valueAt(positionUm);
+  os << valueAt(positionUm);
   return os.str();
 }
 
+blitz::Array<float,3> const &DataChannelSpecs::mipLevel(
+    int direction, int level)
+{
+  if (level <= 0 || p_pagedData != NULL) return *p_data;
+
+  std::vector< blitz::Array<float,3> > &levels = _mipLevels[direction];
+  if (static_cast<int>(levels.size()) < level) levels.resize(level);
+  if (levels[level - 1].size() != 0) return levels[level - 1];
+
+  blitz::Array<float,3> const &src = mipLevel(direction, level - 1);
+  blitz::TinyVector<atb::BlitzIndexT,3> shape(src.shape());
+  for (int d = 0; d < 3; ++d)
+      if (d != direction) shape(d) = (shape(d) + 1) / 2;
+  blitz::Array<float,3> &dst = levels[level - 1];
+  dst.resize(shape);
+
+  // Average each 2x2 block orthogonal to direction, blocks at the upper
+  // border may be incomplete
+  int d0 = (direction + 1) % 3;
+  int d1 = (direction + 2) % 3;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(dst.size()); ++i)
+  {
+    blitz::TinyVector<atb::BlitzIndexT,3> pos;
+    ptrdiff_t tmp = i;
+    for (int d = 2; d >= 0; --d)
+    {
+      pos(d) = tmp % shape(d);
+      tmp /= shape(d);
+    }
+    float sum = 0.0f;
+    int n = 0;
+    blitz::TinyVector<atb::BlitzIndexT,3> srcPos(pos);
+    for (int o0 = 0; o0 < 2; ++o0)
+    {
+      srcPos(d0) = 2 * pos(d0) + o0;
+      if (srcPos(d0) >= src.extent(d0)) break;
+      for (int o1 = 0; o1 < 2; ++o1)
+      {
+        srcPos(d1) = 2 * pos(d1) + o1;
+        if (srcPos(d1) >= src.extent(d1)) break;
+        sum += src(srcPos);
+        ++n;
+      }
+    }
+    dst.data()[i] = sum / static_cast<float>(n);
+  }
+  return dst;
+}
+
+unsigned int DataChannelSpecs::dataRevision() const
+{
+  return _dataRevision;
+}
+
 void DataChannelSpecs::setTransformation(
     blitz::TinyMatrix<double,4,4> const &transformation)
 {
   if (blitz::all(_transformation == transformation)) return;
   p_data->setTransformation(transformation);
-  _lowerBoundUm = p_data->lowerBoundUm();
-  _upperBoundUm = p_data->upperBoundUm();
+  if (p_pagedData != NULL)
+  {
+    p_pagedData->setTransformation(transformation);
+    _lowerBoundUm = p_pagedData->lowerBoundUm();
+    _upperBoundUm = p_pagedData->upperBoundUm();
+  }
+  else
+  {
+    _lowerBoundUm = p_data->lowerBoundUm();
+    _upperBoundUm = p_data->upperBoundUm();
+  }
   ChannelSpecs::setTransformation(transformation);
 }
 
 void DataChannelSpecs::revalidate()
 {
-  this->_lowerBoundUm = p_data->lowerBoundUm();
-  this->_upperBoundUm = p_data->upperBoundUm();
-  this->_elementSizeUm = p_data->elementSizeUm();
-  this->_originalTransformation = p_data->transformation();
+  // Slices sampled in the background from the old data are outdated
+  _abortSliceSampling();
+  for (int d = 0; d < 3; ++d) _mipLevels[d].clear();
+  ++_dataRevision;
+  if (p_pagedData != NULL)
+  {
+    // Paged data cannot be changed, only the transformation is reset
+    this->_lowerBoundUm = p_pagedData->lowerBoundUm();
+    this->_upperBoundUm = p_pagedData->upperBoundUm();
+    this->_originalTransformation = p_pagedData->transformation();
+  }
+  else
+  {
+    this->_lowerBoundUm = p_data->lowerBoundUm();
+    this->_upperBoundUm = p_data->upperBoundUm();
+    this->_elementSizeUm = p_data->elementSizeUm();
+    this->_originalTransformation = p_data->transformation();
+  }
   setTransformation(this->_originalTransformation);
   ChannelSpecs::revalidate();
 }
@@ -241,12 +365,36 @@ void DataChannelSpecs::updateGammaLUT()
 
 void DataChannelSpecs::normalize() 
 {
-  p_displayRangeControl->setValue(
+  if (p_pagedData != NULL)
+  {
+    float minValue, maxValue;
+    p_pagedData->valueRange(minValue, maxValue);
+    p_displayRangeControl->setValue(
+        static_cast<double>(minValue), static_cast<double>(maxValue));
+  }
+  else p_displayRangeControl->setValue(
       static_cast<double>(blitz::min(*p_data)),
       static_cast<double>(blitz::max(*p_data)));
   if (p_model != NULL) p_model->setModified(true);
 }
 
+void DataChannelSpecs::_loadPagedData() const
+{
+  QMutexLocker lock(&_pagedDataMutex);
+  if (p_pagedData == NULL) return;
+  std::cout << "Loading paged data channel '" << p_pagedData->fileName()
+            << ":" << p_pagedData->dataset() << "' into memory" << std::endl;
+  p_pagedData->load(*p_data);
+
+  // The views may still read through the pager, so only release its
+  // memory and file handle here and delete it with the channel
+  p_pagedData->clearCache();
+  p_pagedData->detachFile();
+  p_retiredPagedData = p_pagedData;
+  p_pagedData = NULL;
+  ++_dataRevision;
+}
+
 void DataChannelSpecs::setDisplayRange(float displayMin, float displayMax)
 {
   p_displayRangeControl->setValue(static_cast<double>(displayMin),
@@ -266,3 +414,13 @@ void DataChannelSpecs::setDisplayMax(float displayMax)
   if (p_model != NULL) p_model->setModified(true);
 }
 
+void DataChannelSpecs::_abortSliceSampling() const
+{
+  for (std::map<ViewWidget*,ChannelSpecsRenderer*>::const_iterator it =
+           _renderers.begin(); it != _renderers.end(); ++it)
+  {
+    if (it->first->viewType() == ViewWidget::OrthoView)
+        static_cast<DataChannelSpecsOrthoViewRenderer*>(
+            it->second)->abortSliceSampling();
+  }
+}
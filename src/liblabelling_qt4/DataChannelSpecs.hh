@@ -31,8 +31,11 @@
 
 #include "ChannelSpecs.hh"
 
+#include <QtCore/QMutex>
+
 #include <libArrayToolbox/Array.hh>
 
+class PagedDataArray;
 class ColorControlElement;
 class DoubleRangeControlElement;
 class QPushButton;
@@ -45,6 +48,20 @@ class DataChannelSpecs : public ChannelSpecs
 public:
   
   DataChannelSpecs(atb::Array<float,3> *data, MultiChannelModel *model = NULL);
+
+/*======================================================================*/
+/*! 
+ *   Create an out-of-core data channel. The channel takes ownership of
+ *   the given PagedDataArray. The orthoview reads the slices it needs
+ *   brick-wise from the file. The complete dataset is only loaded into
+ *   memory on the first call of data(), e.g. when a plugin processes
+ *   the channel or it is saved.
+ *
+ *   \param data  The paged dataset
+ *   \param model The model this channel belongs to
+ */
+/*======================================================================*/
+  DataChannelSpecs(PagedDataArray *data, MultiChannelModel *model = NULL);
   ~DataChannelSpecs();
   
   ChannelSpecs::ChannelType channelType() const;
@@ -65,9 +82,71 @@ public:
   bool showExposureProblems() const;
   void setShowExposureProblems(bool exposure);
 
+/*======================================================================*/
+/*! 
+ *   Get the channel data. For paged channels the complete dataset is
+ *   loaded into memory first, afterwards the channel is no longer paged.
+ *   Loading happens only once, even if plugin worker threads request the
+ *   data concurrently. The PagedDataArray stays valid until the channel
+ *   is destroyed, so renderers still reading from it are not affected.
+ *   Callers that only need single values or slices should use valueAt()
+ *   or pagedData() instead, to keep large channels out of memory.
+ *
+ *   \return The channel data
+ */
+/*======================================================================*/
   atb::Array<float,3> const *data() const;
   atb::Array<float,3> *data();
+
+/*======================================================================*/
+/*! 
+ *   Check whether the channel data are still served out-of-core by a
+ *   PagedDataArray.
+ *
+ *   \return true if the channel is paged, false if the data are in memory
+ */
+/*======================================================================*/
+  bool isPaged() const;
+
+/*======================================================================*/
+/*! 
+ *   Get the out-of-core data source of this channel.
+ *
+ *   \return The PagedDataArray or NULL if the data are in memory
+ */
+/*======================================================================*/
+  PagedDataArray const *pagedData() const;
   float valueAt(blitz::TinyVector<double,3> const &positionUm) const;
+
+/*======================================================================*/
+/*! 
+ *   Get the given level of the slice pyramid for the given orthoview
+ *   direction. Level 0 is the data Array itself, every following level
+ *   halves the resolution in the two dimensions orthogonal to direction by
+ *   averaging 2x2 blocks, while the resolution along direction is kept, so
+ *   that every data slice has a counterpart in every level. Levels are
+ *   computed lazily on first request and dropped on revalidate(). Paged
+ *   channels have no pyramid, the empty data Array is returned for all
+ *   levels.
+ *
+ *   \param direction The dimension orthogonal to the slices
+ *   \param level     The pyramid level
+ *
+ *   \return The requested pyramid level
+ */
+/*======================================================================*/
+  blitz::Array<float,3> const &mipLevel(int direction, int level);
+
+/*======================================================================*/
+/*! 
+ *   Get the revision of the data. It is incremented whenever the
+ *   underlying data are revalidated, so that renderers can detect
+ *   changed data without comparing voxel values.
+ *
+ *   \return The data revision
+ */
+/*======================================================================*/
+  unsigned int dataRevision() const;
   std::string stringValueAt(
       blitz::TinyVector<double,3> const &positionUm) const;
 
@@ -99,10 +178,20 @@ private slots:
 
 private:
 
+  void _createControls();
+  void _loadPagedData() const;
+  void _abortSliceSampling() const;
+
   atb::Array<float,3> *p_data;
+  mutable PagedDataArray *p_pagedData;
+  mutable PagedDataArray *p_retiredPagedData;
+  mutable QMutex _pagedDataMutex;
 
   std::vector<float> _gammaLUT;
 
+  std::vector< blitz::Array<float,3> > _mipLevels[3];
+  mutable unsigned int _dataRevision;
+
   ColorControlElement *p_colorControl;
   DoubleControlElement *p_gammaControl;
   QPushButton *p_normalizeButton;
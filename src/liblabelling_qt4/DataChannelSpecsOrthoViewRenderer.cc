@@ -33,18 +33,88 @@
 #include "DataChannelSpecs.hh"
 #include "OrthoViewWidget.hh"
 #include "OrthoViewPlane.hh"
+#include "SliceSamplingThread.hh"
+#include "PagedDataArray.hh"
+
+#include <algorithm>
+#include <limits>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+// The coarsest pyramid level used for zoomed out views
+static const int MaxMipLevel = 4;
+
+// The preview of a progressive refinement is sampled this many pyramid
+// levels above the target level
+static const int PreviewLevelOffset = 2;
+
+// Slices with fewer samples are computed synchronously without preview
+static const size_t MinProgressiveSamples = 262144;
+
+DataChannelSpecsOrthoViewRenderer::SliceKey::SliceKey()
+        : level(-1), dataRevision(0), dims(0, 0), positionUm(0.0),
+          transformation(0.0), lowerBoundUm(0.0), upperBoundUm(0.0),
+          modelElementSizeUm(0.0), offsetPx(0), shapePx(0)
+{}
+
+bool DataChannelSpecsOrthoViewRenderer::SliceKey::operator==(
+    SliceKey const &key) const
+{
+  return level >= 0 && level == key.level &&
+      dataRevision == key.dataRevision &&
+      blitz::all(dims == key.dims) && positionUm == key.positionUm &&
+      blitz::all(transformation == key.transformation) &&
+      blitz::all(lowerBoundUm == key.lowerBoundUm) &&
+      blitz::all(upperBoundUm == key.upperBoundUm) &&
+      blitz::all(modelElementSizeUm == key.modelElementSizeUm) &&
+      blitz::all(offsetPx == key.offsetPx) &&
+      blitz::all(shapePx == key.shapePx);
+}
+
+static bool isScaleTranslateTransform(
+    blitz::TinyMatrix<double,4,4> const &trafo)
+{
+  return trafo(0, 1) == 0.0 && trafo(0, 2) == 0.0 &&
+      trafo(1, 0) == 0.0 && trafo(1, 2) == 0.0 &&
+      trafo(2, 0) == 0.0 && trafo(2, 1) == 0.0 &&
+      trafo(3, 0) == 0.0 && trafo(3, 1) == 0.0 &&
+      trafo(3, 2) == 0.0 && trafo(3, 3) == 1.0;
+}
+
+// Checks whether the data grid coincides with the cache grid, so that
+// slices can be copied without interpolation
+static bool isDirectCopy(
+    DataChannelSpecsOrthoViewRenderer::SliceKey const &key,
+    blitz::TinyVector<double,3> const &dataElSizeUm)
+{
+  blitz::TinyMatrix<double,4,4> const &trafo = key.transformation;
+  if (!isScaleTranslateTransform(trafo)) return false;
+  blitz::TinyVector<double,3> scaling(trafo(0, 0), trafo(1, 1), trafo(2, 2));
+  blitz::TinyVector<double,3> translation(
+      trafo(0, 3), trafo(1, 3), trafo(2, 3));
+  return blitz::all(scaling == 1.0) &&
+      blitz::all(translation + key.offsetPx * key.modelElementSizeUm == 0.0) &&
+      blitz::all(dataElSizeUm == key.modelElementSizeUm);
+}
+
 DataChannelSpecsOrthoViewRenderer::DataChannelSpecsOrthoViewRenderer(
     DataChannelSpecs* channel, OrthoViewWidget* view)
         : ChannelSpecsOrthoViewRenderer(channel, view)
-{}
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    p_samplingThread[d] = new SliceSamplingThread(this, d, this);
+    connect(p_samplingThread[d], SIGNAL(sliceSampled(int)),
+            SLOT(finishSliceRefinement(int)));
+  }
+}
   
 DataChannelSpecsOrthoViewRenderer::~DataChannelSpecsOrthoViewRenderer()
-{}
+{
+  abortSliceSampling();
+}
 
 void DataChannelSpecsOrthoViewRenderer::render(QPainter*) const
 {
@@ -99,258 +169,389 @@ blitz::Array<blitz::TinyVector<float,3>,2> const
   return _cache(direction);
 }
 
-void DataChannelSpecsOrthoViewRenderer::updateCache(int direction) const
+void DataChannelSpecsOrthoViewRenderer::sampleSlice(
+    int direction, SliceKey const &key,
+    blitz::Array<float,3> const &levelData, blitz::Array<float,2> &slice,
+    bool const volatile *abort) const
 {
-  if (!cacheUpdatesEnabled()) return;
-#ifdef DEBUG
-  std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache(" << direction
-            << ")" << std::endl;
-#endif
-  
-  OrthoViewWidget *view = static_cast<OrthoViewWidget*>(p_view);
-  blitz::TinyVector<double,3> const &viewPosUm = view->positionUm();
+  blitz::TinyVector<int,2> const &dims = key.dims;
+  atb::BlitzIndexT step = atb::BlitzIndexT(1) << key.level;
+  slice.reference(
+      blitz::Array<float,2>(
+          (key.shapePx(dims(0)) + step - 1) / step,
+          (key.shapePx(dims(1)) + step - 1) / step));
+  slice = std::numeric_limits<float>::quiet_NaN();
 
-  OrthoViewPlane *plane = view->orthoViewPlane(direction);
-  blitz::TinyVector<int,2> dims(plane->dimensions());
+  blitz::TinyVector<double,3> const &modelElSizeUm = key.modelElementSizeUm;
+  if (key.positionUm < key.lowerBoundUm(direction) -
+      modelElSizeUm(direction) / 2.0 ||
+      key.positionUm > key.upperBoundUm(direction) +
+      modelElSizeUm(direction) / 2.0) return;
 
-  blitz::TinyVector<atb::BlitzIndexT,3> lbPx(cacheOffsetPx());
-  blitz::TinyVector<atb::BlitzIndexT,3> shapePx(cacheShapePx());
-  _cache(direction).resize(shapePx(dims(0)), shapePx(dims(1)));
-  
   DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(p_channel);
-  blitz::TinyVector<double,3> const &channelLbUm = channel->lowerBoundUm();
-  blitz::TinyVector<double,3> const &channelUbUm = channel->upperBoundUm();
-  float alpha = channel->alpha();
-
-  MultiChannelModel *model = channel->model();
-  blitz::TinyVector<double,3> const &modelElSizeUm = model->elementSizeUm();
+  if (channel->isPaged())
+  {
+    _samplePagedSlice(direction, key, slice);
+    return;
+  }
+  atb::Array<float,3> const *data = channel->data();
+  blitz::TinyVector<double,3> const &dataElSizeUm = data->elementSizeUm();
 
-  blitz::TinyVector<float,3> channelColor(alpha * channel->color());
-  blitz::TinyVector<float,3> underFlowColor(0.0f, 0.0f, alpha);
-  blitz::TinyVector<float,3> overFlowColor(alpha, 0.0f, 0.0f);
-  float valueScale = channel->displayMax() - channel->displayMin();
+  blitz::TinyMatrix<double,4,4> const &trafo = key.transformation;
+  bool simpleScaleTranslateTransform = isScaleTranslateTransform(trafo);
+  blitz::TinyVector<double,3> scaling(1.0);
+  blitz::TinyVector<double,3> translation(0.0);
+  if (simpleScaleTranslateTransform)
+  {
+    scaling = trafo(0, 0), trafo(1, 1), trafo(2, 2);
+    translation = trafo(0, 3), trafo(1, 3), trafo(2, 3);
+  }
 
-  // Constant array... not so good for normalization
-  if (valueScale == 0.0f) valueScale = 1.0f;
+  // Sub-pixel positions at full resolution are mapped to the pyramid level
+  // whose pixel centers lie in the centers of the averaged blocks
+  double levelScale = 1.0 / static_cast<double>(step);
+  double levelShift = 0.5 * levelScale - 0.5;
 
-  if (viewPosUm(direction) >= channelLbUm(direction) -
-      modelElSizeUm(direction) / 2.0 &&
-      viewPosUm(direction) <= channelUbUm(direction) +
-      modelElSizeUm(direction) / 2.0)
+  if (simpleScaleTranslateTransform)
   {
-    atb::Array<float,3>* data = channel->data();
-    blitz::TinyVector<double,3> const &dataElSizeUm = data->elementSizeUm();
-
-    blitz::TinyMatrix<double,4,4> const &trafo = data->transformation();
-    bool simpleScaleTranslateTransform =
-        trafo(0, 1) == 0.0 && trafo(0, 2) == 0.0 &&
-        trafo(1, 0) == 0.0 && trafo(1, 2) == 0.0 &&
-        trafo(2, 0) == 0.0 && trafo(2, 1) == 0.0 &&
-        trafo(3, 0) == 0.0 && trafo(3, 1) == 0.0 &&
-        trafo(3, 2) == 0.0 && trafo(3, 3) == 1.0;
-    blitz::TinyVector<double,3> scaling(1.0);
-    blitz::TinyVector<double,3> translation(0.0);
-    if (simpleScaleTranslateTransform)
-    {
-      scaling = trafo(0, 0), trafo(1, 1), trafo(2, 2);
-      translation = trafo(0, 3), trafo(1, 3), trafo(2, 3);
-    }
-
-    if (simpleScaleTranslateTransform)
+    if (isDirectCopy(key, dataElSizeUm))
     {
-      if (blitz::all(scaling == 1.0) &&
-          blitz::all(translation + lbPx * modelElSizeUm == 0.0) &&
-          blitz::all(dataElSizeUm == modelElSizeUm))
-      {
-        // Direct copy
-        atb::BlitzIndexT z = static_cast<atb::BlitzIndexT>(
-            std::floor((viewPosUm(direction) + translation(direction)) /
-                       dataElSizeUm(direction) + 0.5));
+      // Direct copy
+      atb::BlitzIndexT z = static_cast<atb::BlitzIndexT>(
+          std::floor((key.positionUm + translation(direction)) /
+                     dataElSizeUm(direction) + 0.5));
 #ifdef DEBUG
-        std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache("
-                  << direction << "): Identity transform detected: Direct copy "
-                  << "of slice " << z << std::endl;
+      std::cerr << "DataChannelSpecsOrthoViewRenderer::sampleSlice("
+                << direction << "): Identity transform detected: Direct copy "
+                << "of slice " << z << " at level " << key.level << std::endl;
 #endif
-        if (z >= 0 && z < data->extent(direction))
-        {
+      if (z < 0 || z >= levelData.extent(direction)) return;
+      atb::BlitzIndexT yEnd = std::min(
+          slice.extent(0), levelData.extent(dims(0)));
+      atb::BlitzIndexT xEnd = std::min(
+          slice.extent(1), levelData.extent(dims(1)));
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-          for (atb::BlitzIndexT y = 0; y < _cache(direction).extent(0); ++y)
-          {
-            blitz::TinyVector<atb::BlitzIndexT,3> srcPos;
-            srcPos(direction) = z;
-            srcPos(dims(0)) = y;
-            if (srcPos(dims(0)) >= 0 && srcPos(dims(0)) < data->extent(dims(0)))
-            {
-              for (atb::BlitzIndexT x = 0; x < _cache(direction).extent(1); ++x)
-              {
-                srcPos(dims(1)) = x;
-                if (srcPos(dims(1)) >= 0 &&
-                    srcPos(dims(1)) < data->extent(dims(1)))
-                {
-                  float val = (*data)(srcPos);
-                  float rawVal = val;
-                  val = (val - channel->displayMin()) / valueScale;
-                  if (val < 0.0f) val = 0.0f;
-                  if (val > 1.0f) val = 1.0f;
-                  if (channel->gamma() != 1.0)
-                      val = channel->gammaLUT(static_cast<int>(val * 65535.0f));
-                  _cache(direction)(y, x) = channelColor * val;
-                  if (channel->showExposureProblems())
-                  {
-                    if (rawVal <= channel->displayMin())
-                        _cache(direction)(y, x) = underFlowColor;
-                    if (rawVal >= channel->displayMax())
-                        _cache(direction)(y, x) = overFlowColor;          
-                  }
-                }
-                else _cache(direction)(y, x) = blitz::TinyVector<float,3>(0.0f);
-              }
-            }
-            else std::memset(&_cache(direction)(y, 0), 0,
-                             _cache(direction).extent(1) * 3 * sizeof(float));
-          }
+      for (atb::BlitzIndexT y = 0; y < yEnd; ++y)
+      {
+        if (abort != NULL && *abort) continue;
+        blitz::TinyVector<atb::BlitzIndexT,3> srcPos;
+        srcPos(direction) = z;
+        srcPos(dims(0)) = y;
+        for (atb::BlitzIndexT x = 0; x < xEnd; ++x)
+        {
+          srcPos(dims(1)) = x;
+          slice(y, x) = levelData(srcPos);
         }
-        else std::memset(_cache(direction).data(), 0,
-                         _cache(direction).size() * 3 * sizeof(float));
       }
-      else if (blitz::all(translation == 0.0))
-      {
-        // Scaled copy
+    }
+    else if (blitz::all(translation == 0.0))
+    {
+      // Scaled copy
 #ifdef DEBUG
-        std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache("
-                  << direction << "): Pure scaling transform detected"
-                  << std::endl;
+      std::cerr << "DataChannelSpecsOrthoViewRenderer::sampleSlice("
+                << direction << "): Pure scaling transform detected"
+                << std::endl;
 #endif
-        double zUm =
-            scaling(direction) * viewPosUm(direction) /
-            dataElSizeUm(direction);
-        double s0 = scaling(dims(0)) * modelElSizeUm(dims(0)) /
-            dataElSizeUm(dims(0));
-        double s1 = scaling(dims(1)) * modelElSizeUm(dims(1)) /
-            dataElSizeUm(dims(1));
+      double zPx =
+          scaling(direction) * key.positionUm / dataElSizeUm(direction);
+      double s0 = scaling(dims(0)) * modelElSizeUm(dims(0)) /
+          dataElSizeUm(dims(0));
+      double s1 = scaling(dims(1)) * modelElSizeUm(dims(1)) /
+          dataElSizeUm(dims(1));
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (atb::BlitzIndexT y = 0; y < _cache(direction).extent(0); ++y)
+      for (atb::BlitzIndexT y = 0; y < slice.extent(0); ++y)
+      {
+        if (abort != NULL && *abort) continue;
+        blitz::TinyVector<double,3> srcPosPx;
+        srcPosPx(direction) = zPx;
+        srcPosPx(dims(0)) = s0 * (y * step) * levelScale + levelShift;
+        for (atb::BlitzIndexT x = 0; x < slice.extent(1); ++x)
         {
-          blitz::TinyVector<double,3> srcPosPx;
-          srcPosPx(direction) = zUm;
-          srcPosPx(dims(0)) = s0 * y;
-          for (atb::BlitzIndexT x = 0; x < _cache(direction).extent(1); ++x)
-          {
-            srcPosPx(dims(1)) = s1 * x;
-            float val = data->interpolator().get(*data, srcPosPx);
-            float rawVal = val;
-            val = (val - channel->displayMin()) / valueScale;
-            if (val < 0.0f) val = 0.0f;
-            if (val > 1.0f) val = 1.0f;
-            if (channel->gamma() != 1.0)
-                val = channel->gammaLUT(static_cast<int>(val * 65535.0f));
-            _cache(direction)(y, x) = channelColor * val;
-            if (channel->showExposureProblems())
-            {
-              if (rawVal <= channel->displayMin())
-                  _cache(direction)(y, x) = underFlowColor;
-              if (rawVal >= channel->displayMax())
-                  _cache(direction)(y, x) = overFlowColor;          
-            }
-          }
+          srcPosPx(dims(1)) = s1 * (x * step) * levelScale + levelShift;
+          slice(y, x) = data->interpolator().get(levelData, srcPosPx);
         }
       }
-      else
-      {
-        // Scaled copy with subpixel translation
+    }
+    else
+    {
+      // Scaled copy with subpixel translation
 #ifdef DEBUG
-        std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache("
-                  << direction << "): Scaling and translation detected: "
-                  << "scaling = " << scaling << ", translation = "
-                  << translation << std::endl;
+      std::cerr << "DataChannelSpecsOrthoViewRenderer::sampleSlice("
+                << direction << "): Scaling and translation detected: "
+                << "scaling = " << scaling << ", translation = "
+                << translation << std::endl;
 #endif        
-        double zUm =
-            (scaling(direction) * viewPosUm(direction) +
-             translation(direction)) / dataElSizeUm(direction);
+      double zPx =
+          (scaling(direction) * key.positionUm + translation(direction)) /
+          dataElSizeUm(direction);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (atb::BlitzIndexT y = 0; y < _cache(direction).extent(0); ++y)
+      for (atb::BlitzIndexT y = 0; y < slice.extent(0); ++y)
+      {
+        if (abort != NULL && *abort) continue;
+        blitz::TinyVector<double,3> srcPosPx;
+        srcPosPx(direction) = zPx;
+        srcPosPx(dims(0)) =
+            (scaling(dims(0)) *
+             (y * step * modelElSizeUm(dims(0)) + key.lowerBoundUm(dims(0))) +
+             translation(dims(0))) / dataElSizeUm(dims(0)) * levelScale +
+            levelShift;
+        for (atb::BlitzIndexT x = 0; x < slice.extent(1); ++x)
         {
-          blitz::TinyVector<double,3> srcPosPx;
-          srcPosPx(direction) = zUm;
-          srcPosPx(dims(0)) =
-              (scaling(dims(0)) *
-               (y * modelElSizeUm(dims(0)) + channelLbUm(dims(0))) +
-               translation(dims(0))) / dataElSizeUm(dims(0));
-          for (atb::BlitzIndexT x = 0; x < _cache(direction).extent(1); ++x)
-          {
-            srcPosPx(dims(1)) =
-                (scaling(dims(1)) *
-                 (x * modelElSizeUm(dims(1)) + channelLbUm(dims(1))) +
-                 translation(dims(1))) / dataElSizeUm(dims(1));
-            float val = data->interpolator().get(*data, srcPosPx);
-            float rawVal = val;
-            val = (val - channel->displayMin()) / valueScale;
-            if (val < 0.0f) val = 0.0f;
-            if (val > 1.0f) val = 1.0f;
-            if (channel->gamma() != 1.0)
-                val = channel->gammaLUT(static_cast<int>(val * 65535.0f));
-            _cache(direction)(y, x) = channelColor * val;
-            if (channel->showExposureProblems())
-            {
-              if (rawVal <= channel->displayMin())
-                  _cache(direction)(y, x) = underFlowColor;
-              if (rawVal >= channel->displayMax())
-                  _cache(direction)(y, x) = overFlowColor;          
-            }
-          }
-        }        
-      }
+          srcPosPx(dims(1)) =
+              (scaling(dims(1)) *
+               (x * step * modelElSizeUm(dims(1)) +
+                key.lowerBoundUm(dims(1))) +
+               translation(dims(1))) / dataElSizeUm(dims(1)) * levelScale +
+              levelShift;
+          slice(y, x) = data->interpolator().get(levelData, srcPosPx);
+        }
+      }        
     }
-    else
-    {
-      // Slanted plane copy
+  }
+  else
+  {
+    // Slanted plane copy, the pyramid is axis aligned in data space and
+    // cannot be used here, so only the sample grid gets coarser
 #ifdef DEBUG
-      std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache("
-                << direction << "): General transform detected"
-                << std::endl;
+    std::cerr << "DataChannelSpecsOrthoViewRenderer::sampleSlice("
+              << direction << "): General transform detected"
+              << std::endl;
 #endif
-      double zUm = viewPosUm(direction);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-      for (ptrdiff_t i = 0;
-           i < static_cast<ptrdiff_t>(_cache(direction).size()); ++i)
-      {
-        blitz::TinyVector<atb::BlitzIndexT,2> pos(
-            i / _cache(direction).extent(1), i % _cache(direction).extent(1));
-        blitz::TinyVector<double,3> posUm;
-        posUm(dims(0)) = pos(0) * modelElSizeUm(dims(0)) + channelLbUm(dims(0));
-        posUm(dims(1)) = pos(1) * modelElSizeUm(dims(1)) + channelLbUm(dims(1));
-        posUm(direction) = zUm;
-        float val = data->valueAt(posUm);
-        float outVal = val;
-        outVal = (outVal - channel->displayMin()) / valueScale;
-        if (outVal < 0.0f) outVal = 0.0f;
-        if (outVal > 1.0f) outVal = 1.0f;
-        if (channel->gamma() != 1.0)
-            outVal = channel->gammaLUT(static_cast<int>(outVal * 65535.0f));
-        _cache(direction).data()[i] = channelColor * outVal;
-        if (channel->showExposureProblems())
-        {
-          if (val <= channel->displayMin())
-              _cache(direction).data()[i] = underFlowColor;
-          if (val >= channel->displayMax())
-              _cache(direction).data()[i] = overFlowColor;          
-        }
-      }
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(slice.size()); ++i)
+    {
+      if (abort != NULL && *abort) continue;
+      blitz::TinyVector<atb::BlitzIndexT,2> pos(
+          i / slice.extent(1), i % slice.extent(1));
+      blitz::TinyVector<double,3> posUm;
+      posUm(dims(0)) =
+          pos(0) * step * modelElSizeUm(dims(0)) + key.lowerBoundUm(dims(0));
+      posUm(dims(1)) =
+          pos(1) * step * modelElSizeUm(dims(1)) + key.lowerBoundUm(dims(1));
+      posUm(direction) = key.positionUm;
+      slice.data()[i] = data->valueAt(posUm);
     }
   }
-  else std::memset(_cache(direction).data(), 0,
-                   _cache(direction).size() * 3 * sizeof(float));
+}
+
+void DataChannelSpecsOrthoViewRenderer::_samplePagedSlice(
+    int direction, SliceKey const &key, blitz::Array<float,2> &slice) const
+{
+  DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(p_channel);
+  PagedDataArray const *data = channel->pagedData();
+  blitz::TinyVector<int,2> const &dims = key.dims;
+  atb::BlitzIndexT step = atb::BlitzIndexT(1) << key.level;
+
+  if (isDirectCopy(key, data->elementSizeUm()))
+  {
+    // Only the bricks intersecting the slice are read, sub-sampled to the
+    // requested level
+    atb::BlitzIndexT z = static_cast<atb::BlitzIndexT>(
+        std::floor((key.positionUm + key.transformation(direction, 3)) /
+                   data->elementSizeUm()(direction) + 0.5));
+    data->readSlice(direction, z, dims, step, slice);
+    return;
+  }
+
+  // Nearest neighbor sampling through the brick cache. This is serialized
+  // by the PagedDataArray, so no OpenMP here.
+  for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(slice.size()); ++i)
+  {
+    blitz::TinyVector<atb::BlitzIndexT,2> pos(
+        i / slice.extent(1), i % slice.extent(1));
+    blitz::TinyVector<double,3> posUm;
+    posUm(dims(0)) =
+        pos(0) * step * key.modelElementSizeUm(dims(0)) +
+        key.lowerBoundUm(dims(0));
+    posUm(dims(1)) =
+        pos(1) * step * key.modelElementSizeUm(dims(1)) +
+        key.lowerBoundUm(dims(1));
+    posUm(direction) = key.positionUm;
+    slice.data()[i] = data->valueAt(posUm);
+  }
+}
+
+void DataChannelSpecsOrthoViewRenderer::abortSliceSampling() const
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    p_samplingThread[d]->abort();
+    _pendingSliceKey[d] = SliceKey();
+  }
+}
+
+void DataChannelSpecsOrthoViewRenderer::updateCache(int direction) const
+{
+  if (!cacheUpdatesEnabled()) return;
+#ifdef DEBUG
+  std::cerr << "DataChannelSpecsOrthoViewRenderer::updateCache(" << direction
+            << ")" << std::endl;
+#endif
+
+  DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(p_channel);
+  SliceKey key(_sliceKey(direction));
+
+  // Only re-sample if anything but the color mapping changed and the
+  // requested slice is not already being refined in the background
+  if (!(key == _rawSliceKey[direction]) &&
+      !(key == _pendingSliceKey[direction]))
+  {
+    p_samplingThread[direction]->abort();
+    _pendingSliceKey[direction] = SliceKey();
+
+    blitz::Array<float,3> levelData;
+    levelData.reference(channel->mipLevel(direction, key.level));
+
+    // Paged channels are always sampled synchronously, because HDF5 must
+    // not be accessed concurrently
+
+    atb::BlitzIndexT step = atb::BlitzIndexT(1) << key.level;
+    size_t nSamples =
+        static_cast<size_t>((key.shapePx(key.dims(0)) + step - 1) / step) *
+        static_cast<size_t>((key.shapePx(key.dims(1)) + step - 1) / step);
+    SliceKey previewKey(key);
+    previewKey.level = std::min(key.level + PreviewLevelOffset, MaxMipLevel);
+    if (nSamples >= MinProgressiveSamples && !channel->isPaged() &&
+        previewKey.level > key.level &&
+        !isDirectCopy(key, channel->elementSizeUm()))
+    {
+      // Show a coarse preview immediately and refine it in the background
+      blitz::Array<float,3> previewData;
+      previewData.reference(channel->mipLevel(direction, previewKey.level));
+      sampleSlice(direction, previewKey, previewData, _rawSlice(direction));
+      _rawSliceKey[direction] = previewKey;
+      _pendingSliceKey[direction] = key;
+      p_samplingThread[direction]->sample(key, levelData);
+    }
+    else
+    {
+      sampleSlice(direction, key, levelData, _rawSlice(direction));
+      _rawSliceKey[direction] = key;
+    }
+  }
+
+  _applyColormap(direction);
 
   emit cacheUpdated(this, direction);
   p_view->update();
 }
 
+void DataChannelSpecsOrthoViewRenderer::finishSliceRefinement(int direction)
+{
+  SliceSamplingThread *thread = p_samplingThread[direction];
+
+  // Results of outdated samplings are ignored
+  if (thread->isRunning() || !(thread->key() == _pendingSliceKey[direction]))
+      return;
+  _rawSlice(direction).reference(thread->slice());
+  _rawSliceKey[direction] = _pendingSliceKey[direction];
+  _pendingSliceKey[direction] = SliceKey();
+  if (!cacheUpdatesEnabled()) return;
+
+  _applyColormap(direction);
+
+  emit cacheUpdated(this, direction);
+  p_view->update();
+}
+
+DataChannelSpecsOrthoViewRenderer::SliceKey
+DataChannelSpecsOrthoViewRenderer::_sliceKey(int direction) const
+{
+  OrthoViewWidget *view = static_cast<OrthoViewWidget*>(p_view);
+  DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(p_channel);
+  MultiChannelModel *model = channel->model();
+
+  SliceKey key;
+  key.dataRevision = channel->dataRevision();
+  key.dims = view->orthoViewPlane(direction)->dimensions();
+  key.positionUm = view->positionUm()(direction);
+  key.transformation = channel->transformation();
+  key.lowerBoundUm = channel->lowerBoundUm();
+  key.upperBoundUm = channel->upperBoundUm();
+  key.modelElementSizeUm = model->elementSizeUm();
+  key.offsetPx = cacheOffsetPx();
+  key.shapePx = cacheShapePx();
+
+  // Use the coarsest pyramid level that still provides at least one sample
+  // per screen pixel in both plane dimensions
+  double screenPxPerCachePx = view->zoom() *
+      std::max(key.modelElementSizeUm(key.dims(0)),
+               key.modelElementSizeUm(key.dims(1))) /
+      key.modelElementSizeUm(2);
+  key.level = 0;
+  while (key.level < MaxMipLevel &&
+         screenPxPerCachePx * static_cast<double>(1 << (key.level + 1)) <= 1.0)
+      ++key.level;
+  return key;
+}
+
+void DataChannelSpecsOrthoViewRenderer::_applyColormap(int direction) const
+{
+  OrthoViewWidget *view = static_cast<OrthoViewWidget*>(p_view);
+  blitz::TinyVector<int,2> dims(view->orthoViewPlane(direction)->dimensions());
+  blitz::TinyVector<atb::BlitzIndexT,3> shapePx(cacheShapePx());
+  _cache(direction).resize(shapePx(dims(0)), shapePx(dims(1)));
+
+  blitz::Array<float,2> const &raw = _rawSlice(direction);
+  int level = _rawSliceKey[direction].level;
+  if (raw.size() == 0 || level < 0)
+  {
+    std::memset(_cache(direction).data(), 0,
+                _cache(direction).size() * 3 * sizeof(float));
+    return;
+  }
+
+  DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(p_channel);
+  float alpha = channel->alpha();
+  blitz::TinyVector<float,3> channelColor(alpha * channel->color());
+  blitz::TinyVector<float,3> underFlowColor(0.0f, 0.0f, alpha);
+  blitz::TinyVector<float,3> overFlowColor(alpha, 0.0f, 0.0f);
+  float displayMin = channel->displayMin();
+  float displayMax = channel->displayMax();
+  float valueScale = displayMax - displayMin;
+  bool applyGamma = (channel->gamma() != 1.0);
+  bool showExposureProblems = channel->showExposureProblems();
+
+  // Constant array... not so good for normalization
+  if (valueScale == 0.0f) valueScale = 1.0f;
+
+  atb::BlitzIndexT yMax = raw.extent(0) - 1;
+  atb::BlitzIndexT xMax = raw.extent(1) - 1;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (atb::BlitzIndexT y = 0; y < _cache(direction).extent(0); ++y)
+  {
+    atb::BlitzIndexT ySrc = std::min(y >> level, yMax);
+    for (atb::BlitzIndexT x = 0; x < _cache(direction).extent(1); ++x)
+    {
+      float rawVal = raw(ySrc, std::min(x >> level, xMax));
+      if (rawVal != rawVal)
+      {
+        _cache(direction)(y, x) = blitz::TinyVector<float,3>(0.0f);
+        continue;
+      }
+      float val = (rawVal - displayMin) / valueScale;
+      if (val < 0.0f) val = 0.0f;
+      if (val > 1.0f) val = 1.0f;
+      if (applyGamma)
+          val = channel->gammaLUT(static_cast<int>(val * 65535.0f));
+      _cache(direction)(y, x) = channelColor * val;
+      if (showExposureProblems)
+      {
+        if (rawVal <= displayMin) _cache(direction)(y, x) = underFlowColor;
+        if (rawVal >= displayMax) _cache(direction)(y, x) = overFlowColor;
+      }
+    }
+  }
+}
+
 #endif
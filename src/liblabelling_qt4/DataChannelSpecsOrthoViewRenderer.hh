@@ -35,6 +35,7 @@
 
 class DataChannelSpecs;
 class OrthoViewWidget;
+class SliceSamplingThread;
 
 class DataChannelSpecsOrthoViewRenderer : public ChannelSpecsOrthoViewRenderer
 {
@@ -42,7 +43,31 @@ class DataChannelSpecsOrthoViewRenderer : public ChannelSpecsOrthoViewRenderer
 Q_OBJECT
 
 public:
-  
+
+/*======================================================================*/
+/*!
+ *   All parameters that influence the raw (not yet color mapped) samples
+ *   of a slice. If two keys compare equal, the corresponding raw slices
+ *   are identical, so that changes of the display range, gamma, color or
+ *   alpha only require to re-apply the color mapping.
+ */
+/*======================================================================*/
+  struct SliceKey
+  {
+    SliceKey();
+    bool operator==(SliceKey const &key) const;
+
+    // The pyramid level, -1 marks an invalid key
+    int level;
+    unsigned int dataRevision;
+    blitz::TinyVector<int,2> dims;
+    double positionUm;
+    blitz::TinyMatrix<double,4,4> transformation;
+    blitz::TinyVector<double,3> lowerBoundUm, upperBoundUm;
+    blitz::TinyVector<double,3> modelElementSizeUm;
+    blitz::TinyVector<atb::BlitzIndexT,3> offsetPx, shapePx;
+  };
+
   DataChannelSpecsOrthoViewRenderer(
       DataChannelSpecs* channel, OrthoViewWidget* view);
   ~DataChannelSpecsOrthoViewRenderer();
@@ -59,16 +84,64 @@ public:
   blitz::TinyVector<atb::BlitzIndexT,3> cacheOffsetPx() const;
   blitz::TinyVector<atb::BlitzIndexT,3> cacheShapePx() const;
   blitz::Array<blitz::TinyVector<float,3>,2> const &cache(int direction) const;
-                                                 
+
+/*======================================================================*/
+/*!
+ *   Sample the raw values of the slice described by the given key from the
+ *   given pyramid level. The slice is sampled on a grid that is coarser
+ *   than the cache by the factor 2^key.level. Positions outside the channel
+ *   are set to NaN. The output Array always gets freshly allocated memory,
+ *   so that it can be safely handed over between threads.
+ *
+ *   \param direction The orthoview direction of the slice
+ *   \param key       The slice parameters
+ *   \param levelData The pyramid level matching key.level as returned by
+ *     DataChannelSpecs::mipLevel()
+ *   \param slice     The raw slice values are written to this Array
+ *   \param abort     If given, sampling stops as soon as the pointee is set
+ *     to true. The slice content is undefined in this case.
+ */
+/*======================================================================*/
+  void sampleSlice(
+      int direction, SliceKey const &key,
+      blitz::Array<float,3> const &levelData, blitz::Array<float,2> &slice,
+      bool const volatile *abort = NULL) const;
+
+/*======================================================================*/
+/*!
+ *   Stop all running background slice refinements and wait for them to
+ *   finish. This must be called before the underlying data are deleted.
+ */
+/*======================================================================*/
+  void abortSliceSampling() const;
+
 public slots:
   
   virtual void updateCache(int direction) const;
 
+private slots:
+
+  void finishSliceRefinement(int direction);
+
 private:
-  
+
+  SliceKey _sliceKey(int direction) const;
+  void _samplePagedSlice(
+      int direction, SliceKey const &key, blitz::Array<float,2> &slice) const;
+  void _applyColormap(int direction) const;
+
   mutable blitz::TinyVector<blitz::Array<blitz::TinyVector<float,3>,2>,3>
   _cache;
 
+  // The raw slice samples the cache was computed from and the parameters
+  // they were sampled with
+  mutable blitz::TinyVector<blitz::Array<float,2>,3> _rawSlice;
+  mutable SliceKey _rawSliceKey[3];
+
+  // The parameters of the running background refinements
+  mutable SliceKey _pendingSliceKey[3];
+  SliceSamplingThread *p_samplingThread[3];
+
 };
 
 #endif
@@ -44,6 +44,7 @@
 #include "MultiChannelModel.hh"
 
 #include "DataChannelSpecs.hh"
+#include "PagedDataArray.hh"
 #include "RGBChannelSpecs.hh"
 #include "VisualizationChannelSpecs.hh"
 #include "AnnotationChannelSpecs.hh"
@@ -53,6 +54,48 @@
 
 #include <libBlitzHdf5/BlitzHdf5Light.hh>
 
+// 3-D data channels exceeding this size after conversion to float are not
+// loaded into memory but paged from the file on demand
+static const double PagedDataChannelMinSizeBytes = 1024.0 * 1024.0 * 1024.0;
+
+/*-----------------------------------------------------------------------
+ *  Paged channels keep their source file open read-only, which makes
+ *  HDF5 refuse to open it for writing. This guard detaches the files of
+ *  all paged channels of the model for its lifetime. Channels that were
+ *  loaded into memory meanwhile stay detached.
+ *-----------------------------------------------------------------------*/
+class PagedFilesDetacher
+{
+
+public:
+
+  explicit PagedFilesDetacher(MultiChannelModel *model)
+  {
+    for (std::vector<ChannelSpecs*>::const_iterator it =
+             model->begin(); it != model->end(); ++it)
+    {
+      if ((*it)->channelType() != ChannelSpecs::Data) continue;
+      DataChannelSpecs *channel = static_cast<DataChannelSpecs*>(*it);
+      if (!channel->isPaged()) continue;
+      channel->pagedData()->detachFile();
+      _detached.push_back(std::make_pair(channel, channel->pagedData()));
+    }
+  }
+
+  ~PagedFilesDetacher()
+  {
+    for (size_t i = 0; i < _detached.size(); ++i)
+        if (_detached[i].first->pagedData() == _detached[i].second)
+            _detached[i].second->attachFile();
+  }
+
+private:
+
+  std::vector< std::pair<DataChannelSpecs*,PagedDataArray const*> >
+  _detached;
+
+};
+
 /*-----------------------------------------------------------------------
  * Generic ChannelMetaData
  *-----------------------------------------------------------------------*/
@@ -848,6 +891,7 @@ HDF5DataIO::RetVal HDF5DataIO::run()
   }
   case Save :
   {
+    PagedFilesDetacher detacher(p_model);
     try
     {
       BlitzH5File outFile(_fileName, BlitzH5File::WriteOrNew);
@@ -1368,8 +1412,25 @@ HDF5DataIO::RetVal HDF5DataIO::readChannel(const DataChannelMetaData& metaData)
   atb::Array<float,3>* data = new atb::Array<float,3>();
   try
   {
+    std::vector<hsize_t> dsShape;
+    {
+      BlitzH5File inFile(_fileName);
+      dsShape = inFile.getDatasetShape(metaData.channelName);
+    }
+    if (dsShape.size() == 3 &&
+        static_cast<double>(dsShape[0]) * static_cast<double>(dsShape[1]) *
+        static_cast<double>(dsShape[2]) * sizeof(float) >=
+        PagedDataChannelMinSizeBytes)
+    {
+      delete data;
+      PagedDataArray *pagedData =
+          new PagedDataArray(_fileName, metaData.channelName);
+      DataChannelSpecs* specs = p_model->addDataChannel(pagedData);
+      _setMetaData(specs, metaData);
+      return Ok;
+    }
+
     BlitzH5File inFile(_fileName);
-    std::vector<hsize_t> dsShape(inFile.getDatasetShape(metaData.channelName));
     if (dsShape.size() == 2)
     {
       atb::Array<float,2> tmp;
@@ -1397,16 +1458,7 @@ HDF5DataIO::RetVal HDF5DataIO::readChannel(const DataChannelMetaData& metaData)
 
     DataChannelSpecs* specs = p_model->addDataChannel(data);
     if (specs == NULL) throw BlitzH5Error();
-    specs->setUpdatesEnabled(false);
-    specs->setName(metaData.channelName);
-    specs->setAlpha(metaData.alpha);
-    specs->setColor(metaData.color);
-    specs->setGamma(metaData.gamma);
-    specs->setDisplayRange(metaData.displayMin, metaData.displayMax);
-    specs->setShowExposureProblems(metaData.showExposureProblems);
-    specs->setVisible(metaData.visible);
-    specs->setUpdatesEnabled(true);
-    specs->update();
+    _setMetaData(specs, metaData);
   }
   catch (BlitzH5Error&)
   {
@@ -1416,6 +1468,21 @@ HDF5DataIO::RetVal HDF5DataIO::readChannel(const DataChannelMetaData& metaData)
   return Ok;
 }
 
+void HDF5DataIO::_setMetaData(
+    DataChannelSpecs *specs, DataChannelMetaData const &metaData)
+{
+  specs->setUpdatesEnabled(false);
+  specs->setName(metaData.channelName);
+  specs->setAlpha(metaData.alpha);
+  specs->setColor(metaData.color);
+  specs->setGamma(metaData.gamma);
+  specs->setDisplayRange(metaData.displayMin, metaData.displayMax);
+  specs->setShowExposureProblems(metaData.showExposureProblems);
+  specs->setVisible(metaData.visible);
+  specs->setUpdatesEnabled(true);
+  specs->update();
+}
+
 HDF5DataIO::RetVal HDF5DataIO::readChannel(const RGBChannelMetaData& metaData)
 {
   p_progress->updateProgressMessage(
@@ -231,6 +231,10 @@ private:
   RetVal readChannel(const IRoCSChannelMetaData& metaData);
   RetVal readChannel(const IRoCSSCTChannelMetaData& metaData);
 
+  // Apply the display settings stored in the meta data to the given channel
+  void _setMetaData(
+      DataChannelSpecs *specs, DataChannelMetaData const &metaData);
+
   template<typename DataT>
   void writeVisualizationChannelAs(
       VisualizationChannelSpecs *channel, std::string const &fileName);
@@ -263,6 +263,7 @@ void Marker::setRelativePositionUm(const blitz::TinyVector<double,3>& pos)
   _needsFeatureUpdate = true;
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
     if (p_channel->model() != NULL)
@@ -904,6 +905,10 @@ void Marker::setUpdatesEnabled(bool enable)
 
 void Marker::update()
 {
+  // Keep the channel's spatial index in sync, even if rendering updates are
+  // currently disabled
+  if (p_channel != NULL) p_channel->updateMarkerIndex(this);
+
   if (!_updatesEnabled) return;
   
   for (std::map<ViewWidget*, MarkerRenderer*>::iterator it =
@@ -456,8 +456,8 @@ public slots:
 /*! 
  *   Explicitely trigger a cache update for all associated renderers.
  *   This is only necessary if updates were disabled and after all changes
- *   the cache has to be updated. If updates are disabled a call to this
- *   function is a noop.
+ *   the cache has to be updated. If updates are disabled only the spatial
+ *   marker index of the associated channel is updated.
  */
 /*======================================================================*/
   void update();
@@ -0,0 +1,328 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "MarkerSpatialIndex.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "Marker.hh"
+
+// Markers whose padded bounding box covers more grid cells than this are
+// not registered in the grid but only in the slabs
+static const ptrdiff_t MaxCellsPerMarker = 512;
+
+bool MarkerSpatialIndex::CellIndexLess::operator()(
+    blitz::TinyVector<ptrdiff_t,3> const &a,
+    blitz::TinyVector<ptrdiff_t,3> const &b) const
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    if (a(d) < b(d)) return true;
+    if (a(d) > b(d)) return false;
+  }
+  return false;
+}
+
+MarkerSpatialIndex::MarkerSpatialIndex(double cellSizeUm, double marginUm)
+        : _cellSizeUm(cellSizeUm), _marginUm(marginUm),
+          _lowerCellBound(std::numeric_limits<ptrdiff_t>::max()),
+          _upperCellBound(std::numeric_limits<ptrdiff_t>::min())
+{}
+
+MarkerSpatialIndex::~MarkerSpatialIndex()
+{}
+
+void MarkerSpatialIndex::clear()
+{
+  _cells.clear();
+  for (int d = 0; d < 3; ++d) _slabs[d].clear();
+  _ranges.clear();
+  _oversized.clear();
+  _lowerCellBound = std::numeric_limits<ptrdiff_t>::max();
+  _upperCellBound = std::numeric_limits<ptrdiff_t>::min();
+}
+
+size_t MarkerSpatialIndex::size() const
+{
+  return _ranges.size();
+}
+
+bool MarkerSpatialIndex::contains(Marker const *marker) const
+{
+  return _ranges.find(const_cast<Marker*>(marker)) != _ranges.end();
+}
+
+void MarkerSpatialIndex::insert(Marker *marker)
+{
+  if (marker == NULL) return;
+  if (contains(marker))
+  {
+    update(marker);
+    return;
+  }
+  CellRange range(_cellRange(marker));
+  _register(marker, range);
+  _ranges[marker] = range;
+}
+
+void MarkerSpatialIndex::remove(Marker *marker)
+{
+  std::map<Marker*,CellRange>::iterator it = _ranges.find(marker);
+  if (it == _ranges.end()) return;
+  _unregister(marker, it->second);
+  _ranges.erase(it);
+}
+
+void MarkerSpatialIndex::update(Marker *marker)
+{
+  std::map<Marker*,CellRange>::iterator it = _ranges.find(marker);
+  if (it == _ranges.end()) return;
+  CellRange range(_cellRange(marker));
+  if (blitz::all(range.lowerBound == it->second.lowerBound &&
+                 range.upperBound == it->second.upperBound)) return;
+  _unregister(marker, it->second);
+  _register(marker, range);
+  it->second = range;
+}
+
+Marker *MarkerSpatialIndex::closestMarker(
+    blitz::TinyVector<double,3> const &positionUm, bool intersecting) const
+{
+  if (_ranges.size() == 0) return NULL;
+
+  blitz::TinyVector<ptrdiff_t,3> c;
+  for (int d = 0; d < 3; ++d) c(d) = _cellIndex(positionUm(d));
+
+  Marker *res = NULL;
+  double minSqDistance = std::numeric_limits<double>::infinity();
+
+  // Oversized markers are not in the grid, check them explicitly
+  for (std::vector<Marker*>::const_iterator it = _oversized.begin();
+       it != _oversized.end(); ++it)
+  {
+    if (intersecting && !(*it)->occupiesPositionUm(positionUm)) continue;
+    double sqDistance = blitz::dot(
+        positionUm - (*it)->positionUm(), positionUm - (*it)->positionUm());
+    if (sqDistance < minSqDistance)
+    {
+      minSqDistance = sqDistance;
+      res = *it;
+    }
+  }
+
+  // Every marker occupying the position has been registered in the cell
+  // containing it
+  if (intersecting)
+  {
+    CellMap::const_iterator cellIt = _cells.find(c);
+    if (cellIt == _cells.end()) return res;
+    for (std::vector<Marker*>::const_iterator it = cellIt->second.begin();
+         it != cellIt->second.end(); ++it)
+    {
+      if (!(*it)->occupiesPositionUm(positionUm)) continue;
+      double sqDistance = blitz::dot(
+          positionUm - (*it)->positionUm(), positionUm - (*it)->positionUm());
+      if (sqDistance < minSqDistance)
+      {
+        minSqDistance = sqDistance;
+        res = *it;
+      }
+    }
+    return res;
+  }
+
+  if (_cells.size() == 0) return res;
+
+  // Search shells of growing Chebyshev radius around the query cell. After
+  // shell k all marker centers closer than k * cellSize have been seen.
+  ptrdiff_t maxRadius = 0;
+  for (int d = 0; d < 3; ++d)
+  {
+    maxRadius = std::max(maxRadius, c(d) - _lowerCellBound(d));
+    maxRadius = std::max(maxRadius, _upperCellBound(d) - c(d));
+  }
+  size_t nVisited = 0;
+  for (ptrdiff_t k = 0; k <= maxRadius; ++k)
+  {
+    blitz::TinyVector<ptrdiff_t,3> p;
+    for (p(0) = std::max(c(0) - k, _lowerCellBound(0));
+         p(0) <= std::min(c(0) + k, _upperCellBound(0)); ++p(0))
+    {
+      for (p(1) = std::max(c(1) - k, _lowerCellBound(1));
+           p(1) <= std::min(c(1) + k, _upperCellBound(1)); ++p(1))
+      {
+        for (p(2) = std::max(c(2) - k, _lowerCellBound(2));
+             p(2) <= std::min(c(2) + k, _upperCellBound(2)); ++p(2))
+        {
+          if (std::abs(p(0) - c(0)) != k && std::abs(p(1) - c(1)) != k &&
+              std::abs(p(2) - c(2)) != k) continue;
+          ++nVisited;
+          CellMap::const_iterator cellIt = _cells.find(p);
+          if (cellIt == _cells.end()) continue;
+          for (std::vector<Marker*>::const_iterator it =
+                   cellIt->second.begin(); it != cellIt->second.end(); ++it)
+          {
+            double sqDistance = blitz::dot(
+                positionUm - (*it)->positionUm(),
+                positionUm - (*it)->positionUm());
+            if (sqDistance < minSqDistance)
+            {
+              minSqDistance = sqDistance;
+              res = *it;
+            }
+          }
+        }
+      }
+    }
+    if (res != NULL && minSqDistance <= blitz::pow2(k * _cellSizeUm)) break;
+
+    // The grid is too sparse for the shell search, a linear scan is cheaper
+    if (nVisited > _ranges.size())
+    {
+      for (std::map<Marker*,CellRange>::const_iterator it = _ranges.begin();
+           it != _ranges.end(); ++it)
+      {
+        double sqDistance = blitz::dot(
+            positionUm - it->first->positionUm(),
+            positionUm - it->first->positionUm());
+        if (sqDistance < minSqDistance)
+        {
+          minSqDistance = sqDistance;
+          res = it->first;
+        }
+      }
+      break;
+    }
+  }
+  return res;
+}
+
+void MarkerSpatialIndex::markersIntersectingPlane(
+    int dimension, double positionUm, double marginUm,
+    std::vector<Marker*> &markers) const
+{
+  SlabMap const &slabs = _slabs[dimension];
+  SlabMap::const_iterator it = slabs.lower_bound(
+      _cellIndex(positionUm - marginUm));
+  SlabMap::const_iterator end = slabs.upper_bound(
+      _cellIndex(positionUm + marginUm));
+  if (it == end) return;
+
+  std::vector<Marker*> candidates;
+  for (; it != end; ++it)
+      candidates.insert(
+          candidates.end(), it->second.begin(), it->second.end());
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(
+      std::unique(candidates.begin(), candidates.end()), candidates.end());
+  markers.insert(markers.end(), candidates.begin(), candidates.end());
+}
+
+ptrdiff_t MarkerSpatialIndex::_cellIndex(double positionUm) const
+{
+  return static_cast<ptrdiff_t>(std::floor(positionUm / _cellSizeUm));
+}
+
+MarkerSpatialIndex::CellRange MarkerSpatialIndex::_cellRange(
+    Marker const *marker) const
+{
+  blitz::TinyVector<double,3> lbUm(marker->boundingBoxLowerBoundUm());
+  blitz::TinyVector<double,3> ubUm(marker->boundingBoxUpperBoundUm());
+  CellRange range;
+  ptrdiff_t nCells = 1;
+  for (int d = 0; d < 3; ++d)
+  {
+    range.lowerBound(d) = _cellIndex(lbUm(d) - _marginUm);
+    range.upperBound(d) = _cellIndex(ubUm(d) + _marginUm);
+    nCells *= range.upperBound(d) - range.lowerBound(d) + 1;
+  }
+  range.oversized = (nCells > MaxCellsPerMarker);
+  return range;
+}
+
+void MarkerSpatialIndex::_register(Marker *marker, CellRange const &range)
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    for (ptrdiff_t i = range.lowerBound(d); i <= range.upperBound(d); ++i)
+        _slabs[d][i].push_back(marker);
+  }
+  if (range.oversized)
+  {
+    _oversized.push_back(marker);
+    return;
+  }
+  blitz::TinyVector<ptrdiff_t,3> p;
+  for (p(0) = range.lowerBound(0); p(0) <= range.upperBound(0); ++p(0))
+      for (p(1) = range.lowerBound(1); p(1) <= range.upperBound(1); ++p(1))
+          for (p(2) = range.lowerBound(2); p(2) <= range.upperBound(2);
+               ++p(2)) _cells[p].push_back(marker);
+  for (int d = 0; d < 3; ++d)
+  {
+    _lowerCellBound(d) = std::min(_lowerCellBound(d), range.lowerBound(d));
+    _upperCellBound(d) = std::max(_upperCellBound(d), range.upperBound(d));
+  }
+}
+
+void MarkerSpatialIndex::_unregister(Marker *marker, CellRange const &range)
+{
+  for (int d = 0; d < 3; ++d)
+  {
+    for (ptrdiff_t i = range.lowerBound(d); i <= range.upperBound(d); ++i)
+    {
+      SlabMap::iterator it = _slabs[d].find(i);
+      if (it == _slabs[d].end()) continue;
+      it->second.erase(
+          std::remove(it->second.begin(), it->second.end(), marker),
+          it->second.end());
+      if (it->second.size() == 0) _slabs[d].erase(it);
+    }
+  }
+  if (range.oversized)
+  {
+    _oversized.erase(
+        std::remove(_oversized.begin(), _oversized.end(), marker),
+        _oversized.end());
+    return;
+  }
+  blitz::TinyVector<ptrdiff_t,3> p;
+  for (p(0) = range.lowerBound(0); p(0) <= range.upperBound(0); ++p(0))
+  {
+    for (p(1) = range.lowerBound(1); p(1) <= range.upperBound(1); ++p(1))
+    {
+      for (p(2) = range.lowerBound(2); p(2) <= range.upperBound(2); ++p(2))
+      {
+        CellMap::iterator it = _cells.find(p);
+        if (it == _cells.end()) continue;
+        it->second.erase(
+            std::remove(it->second.begin(), it->second.end(), marker),
+            it->second.end());
+        if (it->second.size() == 0) _cells.erase(it);
+      }
+    }
+  }
+}
@@ -0,0 +1,205 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef MARKERSPATIALINDEX_HH
+#define MARKERSPATIALINDEX_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <blitz/array.h>
+
+#include <map>
+#include <vector>
+
+class Marker;
+
+/*======================================================================*/
+/*!
+ *  \class MarkerSpatialIndex MarkerSpatialIndex.hh "MarkerSpatialIndex.hh"
+ *  \brief The MarkerSpatialIndex class is an incrementally maintained
+ *    uniform grid over the micrometer bounding boxes of a set of markers.
+ *
+ *  Every marker is registered in all grid cells its (margin-padded)
+ *  bounding box overlaps. Additionally every marker is registered in one
+ *  slab list per dimension, so that all markers intersecting an axis
+ *  aligned plane can be retrieved without touching the remaining markers.
+ *  Whenever the position or the extent of a marker changes update() must
+ *  be called to re-register it; this is cheap if the covered cells did not
+ *  change.
+ *
+ *  The index only stores pointers and never owns the markers.
+ */
+/*======================================================================*/
+class MarkerSpatialIndex
+{
+
+public:
+
+/*======================================================================*/
+/*!
+ *   Constructor.
+ *
+ *   \param cellSizeUm The edge length of the cubic grid cells in micrometers
+ *   \param marginUm   The bounding boxes of all markers are padded by this
+ *     margin before they are registered. It must be at least as large as
+ *     the picking tolerance of Marker::occupiesPositionUm().
+ */
+/*======================================================================*/
+  MarkerSpatialIndex(double cellSizeUm = 10.0, double marginUm = 5.0);
+  ~MarkerSpatialIndex();
+
+/*======================================================================*/
+/*!
+ *   Remove all markers from the index.
+ */
+/*======================================================================*/
+  void clear();
+
+/*======================================================================*/
+/*!
+ *   Get the number of markers currently registered in the index.
+ *
+ *   \return The number of indexed markers
+ */
+/*======================================================================*/
+  size_t size() const;
+
+/*======================================================================*/
+/*!
+ *   Check whether the given marker is registered in the index.
+ *
+ *   \param marker The marker to search
+ *
+ *   \return true if the marker is indexed, false otherwise
+ */
+/*======================================================================*/
+  bool contains(Marker const *marker) const;
+
+/*======================================================================*/
+/*!
+ *   Register the given marker with its current bounding box. If the marker
+ *   is already indexed this is equivalent to update().
+ *
+ *   \param marker The marker to add
+ */
+/*======================================================================*/
+  void insert(Marker *marker);
+
+/*======================================================================*/
+/*!
+ *   Unregister the given marker. If the marker is not indexed, this is a
+ *   noop.
+ *
+ *   \param marker The marker to remove
+ */
+/*======================================================================*/
+  void remove(Marker *marker);
+
+/*======================================================================*/
+/*!
+ *   Re-register the given marker after its position or extent changed.
+ *   Unknown markers are ignored.
+ *
+ *   \param marker The marker to update
+ */
+/*======================================================================*/
+  void update(Marker *marker);
+
+/*======================================================================*/
+/*!
+ *   Get the marker whose center is closest to the given position.
+ *
+ *   \param positionUm   The query position in micrometers
+ *   \param intersecting If true, only markers occupying the given position
+ *     are considered
+ *
+ *   \return The closest marker or NULL if no (intersecting) marker exists
+ */
+/*======================================================================*/
+  Marker *closestMarker(
+      blitz::TinyVector<double,3> const &positionUm,
+      bool intersecting = false) const;
+
+/*======================================================================*/
+/*!
+ *   Get all markers whose bounding box, padded by the index margin and the
+ *   given additional margin, intersects the plane orthogonal to the given
+ *   dimension at the given position. The resulting list contains every
+ *   marker at most once, additional markers close to the plane may be
+ *   reported.
+ *
+ *   \param dimension  The dimension orthogonal to the plane
+ *   \param positionUm The position of the plane along dimension in
+ *     micrometers
+ *   \param marginUm   Additional tolerance in micrometers, e.g. the
+ *     distance from the plane up to which markers are still drawn
+ *   \param markers    The markers intersecting the plane are appended
+ *     to this vector
+ */
+/*======================================================================*/
+  void markersIntersectingPlane(
+      int dimension, double positionUm, double marginUm,
+      std::vector<Marker*> &markers) const;
+
+private:
+
+  struct CellIndexLess
+  {
+    bool operator()(blitz::TinyVector<ptrdiff_t,3> const &a,
+                    blitz::TinyVector<ptrdiff_t,3> const &b) const;
+  };
+
+  struct CellRange
+  {
+    blitz::TinyVector<ptrdiff_t,3> lowerBound, upperBound;
+    bool oversized;
+  };
+
+  typedef std::map<
+      blitz::TinyVector<ptrdiff_t,3>,std::vector<Marker*>,CellIndexLess>
+  CellMap;
+  typedef std::map< ptrdiff_t,std::vector<Marker*> > SlabMap;
+
+  ptrdiff_t _cellIndex(double positionUm) const;
+  CellRange _cellRange(Marker const *marker) const;
+  void _register(Marker *marker, CellRange const &range);
+  void _unregister(Marker *marker, CellRange const &range);
+
+  double _cellSizeUm, _marginUm;
+
+  CellMap _cells;
+  SlabMap _slabs[3];
+  std::map<Marker*,CellRange> _ranges;
+
+  // Markers covering too many cells are only registered in the slabs and
+  // checked explicitly by point queries
+  std::vector<Marker*> _oversized;
+
+  blitz::TinyVector<ptrdiff_t,3> _lowerCellBound, _upperCellBound;
+
+};
+
+#endif
@@ -39,6 +39,7 @@
 #include "ChannelSelectionControlElement.hh"
 
 #include "DataChannelSpecs.hh"
+#include "PagedDataArray.hh"
 #include "RGBChannelSpecs.hh"
 #include "VisualizationChannelSpecs.hh"
 #include "AnnotationChannelSpecs.hh"
@@ -329,6 +330,16 @@ DataChannelSpecs* MultiChannelModel::addDataChannel(
   return specs;
 }
   
+DataChannelSpecs* MultiChannelModel::addDataChannel(PagedDataArray *channel) 
+{
+  DataChannelSpecs* specs = new DataChannelSpecs(channel, this);
+  addChannelSpecs(specs);
+  std::cout << "Added new paged data channel with shape " << channel->shape()
+            << " vx and element size " << channel->elementSizeUm() << " um/vx"
+            << std::endl;
+  return specs;
+}
+  
 RGBChannelSpecs* MultiChannelModel::addRGBChannel(
     atb::Array<blitz::TinyVector<float,3>,3>* channel) 
 {
@@ -41,6 +41,7 @@
 
 class QWidget;
 class QComboBox;
+class PagedDataArray;
 class QStackedWidget;
 class QLineEdit;
 class QToolButton;
@@ -80,6 +81,7 @@ public:
   QWidget* infoWidget() const;
 
   DataChannelSpecs* addDataChannel(atb::Array<float,3>* channel);
+  DataChannelSpecs* addDataChannel(PagedDataArray* channel);
   RGBChannelSpecs* addRGBChannel(
       atb::Array<blitz::TinyVector<float,3>,3>* channel);
   VisualizationChannelSpecs *addVisualizationChannel(
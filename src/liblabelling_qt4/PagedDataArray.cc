@@ -0,0 +1,596 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "PagedDataArray.hh"
+
+#include <QtCore/QMutexLocker>
+
+#include <libBlitzHdf5/BlitzHdf5Light.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <list>
+#include <map>
+
+const size_t PagedDataArray::DefaultMaxCacheSizeBytes = 512 * 1024 * 1024;
+
+// Brick extent used for datasets without (reasonably sized) chunks
+static const atb::BlitzIndexT DefaultBrickExtent = 64;
+
+// Chunks smaller than this are merged into larger bricks to keep the
+// number of HDF5 reads per slice low
+static const atb::BlitzIndexT MinBrickExtent = 16;
+
+/*-----------------------------------------------------------------------
+ *  Type independent interface of the brick cache
+ *-----------------------------------------------------------------------*/
+
+class PagedDataArray::BrickStore
+{
+
+public:
+
+  BrickStore(
+      std::string const &dataset,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &shape,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &brickShape,
+      size_t maxSizeBytes)
+          : _dataset(dataset), _shape(shape),
+            _brickShape(brickShape), _maxSizeBytes(maxSizeBytes),
+            _sizeBytes(0)
+  {}
+
+  virtual ~BrickStore()
+  {}
+
+  virtual float value(
+      PagedDataArray const &array,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &pos) = 0;
+
+  virtual void readSlice(
+      PagedDataArray const &array, int direction, atb::BlitzIndexT index,
+      blitz::TinyVector<int,2> const &dims, atb::BlitzIndexT step,
+      blitz::Array<float,2> &slice) = 0;
+
+  virtual void clear() = 0;
+
+  size_t sizeBytes() const
+  {
+    return _sizeBytes;
+  }
+
+  size_t maxSizeBytes() const
+  {
+    return _maxSizeBytes;
+  }
+
+  virtual void setMaxSizeBytes(size_t maxSizeBytes) = 0;
+
+protected:
+
+  // The file is only opened when a brick has to be read
+  static BlitzH5File const &_fileOf(PagedDataArray const &array)
+  {
+    return array._file();
+  }
+
+  std::string _dataset;
+  blitz::TinyVector<atb::BlitzIndexT,3> _shape, _brickShape;
+  size_t _maxSizeBytes, _sizeBytes;
+
+};
+
+/*-----------------------------------------------------------------------
+ *  Brick cache storing the bricks in the native file type
+ *-----------------------------------------------------------------------*/
+
+template<typename NativeT>
+class TypedBrickStore : public PagedDataArray::BrickStore
+{
+
+public:
+
+  TypedBrickStore(
+      std::string const &dataset,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &shape,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &brickShape,
+      size_t maxSizeBytes)
+          : PagedDataArray::BrickStore(
+              dataset, shape, brickShape, maxSizeBytes)
+  {}
+
+  ~TypedBrickStore()
+  {}
+
+  float value(
+      PagedDataArray const &array,
+      blitz::TinyVector<atb::BlitzIndexT,3> const &pos)
+  {
+    BrickIndex b(pos / _brickShape);
+    BrickIndex offset(pos - b * _brickShape);
+    blitz::Array<NativeT,3> const &brickData = _brick(array, b);
+    return static_cast<float>(brickData(offset));
+  }
+
+  void readSlice(
+      PagedDataArray const &array, int direction, atb::BlitzIndexT index,
+      blitz::TinyVector<int,2> const &dims, atb::BlitzIndexT step,
+      blitz::Array<float,2> &slice)
+  {
+    // Only the slice extent covered by the dataset is read
+    atb::BlitzIndexT yEnd = std::min(
+        static_cast<atb::BlitzIndexT>(slice.extent(0)),
+        (_shape(dims(0)) + step - 1) / step);
+    atb::BlitzIndexT xEnd = std::min(
+        static_cast<atb::BlitzIndexT>(slice.extent(1)),
+        (_shape(dims(1)) + step - 1) / step);
+    if (yEnd <= 0 || xEnd <= 0) return;
+
+    BrickIndex b;
+    b(direction) = index / _brickShape(direction);
+    atb::BlitzIndexT nBricks0 =
+        ((yEnd - 1) * step) / _brickShape(dims(0)) + 1;
+    atb::BlitzIndexT nBricks1 =
+        ((xEnd - 1) * step) / _brickShape(dims(1)) + 1;
+    for (b(dims(0)) = 0; b(dims(0)) < nBricks0; ++b(dims(0)))
+    {
+      // Output rows whose source voxel lies within this brick
+      atb::BlitzIndexT lb0 = b(dims(0)) * _brickShape(dims(0));
+      atb::BlitzIndexT yFrom = (lb0 + step - 1) / step;
+      atb::BlitzIndexT yTo = std::min(
+          yEnd, (lb0 + _brickShape(dims(0)) + step - 1) / step);
+      if (yFrom >= yTo) continue;
+      for (b(dims(1)) = 0; b(dims(1)) < nBricks1; ++b(dims(1)))
+      {
+        atb::BlitzIndexT lb1 = b(dims(1)) * _brickShape(dims(1));
+        atb::BlitzIndexT xFrom = (lb1 + step - 1) / step;
+        atb::BlitzIndexT xTo = std::min(
+            xEnd, (lb1 + _brickShape(dims(1)) + step - 1) / step);
+        if (xFrom >= xTo) continue;
+
+        blitz::Array<NativeT,3> const &brickData = _brick(array, b);
+        blitz::TinyVector<atb::BlitzIndexT,3> pos;
+        pos(direction) = index - b(direction) * _brickShape(direction);
+        for (atb::BlitzIndexT y = yFrom; y < yTo; ++y)
+        {
+          pos(dims(0)) = y * step - lb0;
+          for (atb::BlitzIndexT x = xFrom; x < xTo; ++x)
+          {
+            pos(dims(1)) = x * step - lb1;
+            slice(y, x) = static_cast<float>(brickData(pos));
+          }
+        }
+      }
+    }
+  }
+
+  void clear()
+  {
+    _bricks.clear();
+    _lru.clear();
+    _sizeBytes = 0;
+  }
+
+  void setMaxSizeBytes(size_t maxSizeBytes)
+  {
+    _maxSizeBytes = maxSizeBytes;
+    _evict();
+  }
+
+private:
+
+  typedef blitz::TinyVector<atb::BlitzIndexT,3> BrickIndex;
+
+  struct BrickIndexLess
+  {
+    bool operator()(BrickIndex const &a, BrickIndex const &b) const
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        if (a(d) < b(d)) return true;
+        if (a(d) > b(d)) return false;
+      }
+      return false;
+    }
+  };
+
+  struct Brick
+  {
+    blitz::Array<NativeT,3> data;
+    typename std::list<BrickIndex>::iterator lruPosition;
+  };
+
+  typedef std::map<BrickIndex,Brick,BrickIndexLess> BrickMap;
+
+  blitz::Array<NativeT,3> const &_brick(
+      PagedDataArray const &array, BrickIndex const &b)
+  {
+    typename BrickMap::iterator it = _bricks.find(b);
+    if (it != _bricks.end())
+    {
+      // Move to the front of the LRU list
+      _lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+      return it->second.data;
+    }
+
+    blitz::TinyVector<atb::BlitzIndexT,3> lb(b * _brickShape);
+    blitz::TinyVector<atb::BlitzIndexT,3> extent;
+    for (int d = 0; d < 3; ++d)
+        extent(d) = std::min(_brickShape(d), _shape(d) - lb(d));
+    Brick brick;
+    brick.data.resize(extent);
+    _fileOf(array).readHyperslab(
+        brick.data, _dataset, blitz::TinyVector<hsize_t,3>(lb));
+    _lru.push_front(b);
+    brick.lruPosition = _lru.begin();
+    it = _bricks.insert(std::make_pair(b, brick)).first;
+    _sizeBytes += brick.data.size() * sizeof(NativeT);
+    _evict();
+    return it->second.data;
+  }
+
+  // Drop least recently used bricks until the cache fits its budget. The
+  // most recently used brick is always kept.
+  void _evict()
+  {
+    while (_sizeBytes > _maxSizeBytes && _lru.size() > 1)
+    {
+      typename BrickMap::iterator it = _bricks.find(_lru.back());
+      _sizeBytes -= it->second.data.size() * sizeof(NativeT);
+      _bricks.erase(it);
+      _lru.pop_back();
+    }
+  }
+
+  BrickMap _bricks;
+  std::list<BrickIndex> _lru;
+
+};
+
+/*-----------------------------------------------------------------------
+ *  PagedDataArray
+ *-----------------------------------------------------------------------*/
+
+PagedDataArray::PagedDataArray(
+    std::string const &fileName, std::string const &dataset,
+    size_t maxCacheSizeBytes)
+        : _fileName(fileName), _dataset(dataset), p_file(NULL),
+          _detached(false), p_store(NULL),
+          _shape(0), _brickShape(DefaultBrickExtent), _elementSizeUm(1.0),
+          _transformation(atb::traits< blitz::TinyMatrix<double,4,4> >::one)
+{
+  p_file = new BlitzH5File(fileName);
+  try
+  {
+    std::vector<hsize_t> dsShape(p_file->getDatasetShape(dataset));
+    if (dsShape.size() != 3)
+        throw BlitzH5Error()
+            << "Cannot page " << dsShape.size() << "-D dataset '"
+            << dataset << "'. Only 3-D datasets are supported.";
+    for (int d = 0; d < 3; ++d)
+        _shape(d) = static_cast<atb::BlitzIndexT>(dsShape[d]);
+
+    // Align bricks to the HDF5 chunks, so that every brick read decodes
+    // every chunk only once. Small chunks are merged.
+    std::vector<hsize_t> chunkShape(p_file->getDatasetChunkShape(dataset));
+    if (chunkShape.size() == 3)
+    {
+      for (int d = 0; d < 3; ++d)
+      {
+        atb::BlitzIndexT chunkExtent =
+            static_cast<atb::BlitzIndexT>(chunkShape[d]);
+        _brickShape(d) = chunkExtent *
+            ((MinBrickExtent + chunkExtent - 1) / chunkExtent);
+      }
+    }
+    for (int d = 0; d < 3; ++d)
+        _brickShape(d) = std::max(
+            atb::BlitzIndexT(1), std::min(_brickShape(d), _shape(d)));
+
+    try
+    {
+      p_file->readAttribute(_elementSizeUm, "element_size_um", dataset);
+    }
+    catch (BlitzH5Error &)
+    {
+      std::cerr << "Warning: Could not read element_size_um. Assuming unit "
+                << "element size" << std::endl;
+      _elementSizeUm = 1.0;
+    }
+    try
+    {
+      p_file->readAttribute(_transformation, "transformation", dataset);
+    }
+    catch (BlitzH5Error &)
+    {
+      std::cerr << "Warning: Could not read '" << fileName << ":" << dataset
+                << "/transformation'. Assuming identity transformation"
+                << std::endl;
+    }
+
+    hid_t datasetTypeId = p_file->getDatasetType(dataset);
+    if (H5Tequal(datasetTypeId, H5T_NATIVE_UCHAR))
+        p_store = new TypedBrickStore<unsigned char>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_CHAR) ||
+             H5Tequal(datasetTypeId, H5T_NATIVE_SCHAR))
+        p_store = new TypedBrickStore<char>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_USHORT))
+        p_store = new TypedBrickStore<unsigned short>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_SHORT))
+        p_store = new TypedBrickStore<short>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_UINT))
+        p_store = new TypedBrickStore<unsigned int>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_INT))
+        p_store = new TypedBrickStore<int>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else if (H5Tequal(datasetTypeId, H5T_NATIVE_DOUBLE))
+        p_store = new TypedBrickStore<double>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    else
+        p_store = new TypedBrickStore<float>(
+            dataset, _shape, _brickShape, maxCacheSizeBytes);
+    H5Tclose(datasetTypeId);
+  }
+  catch (BlitzH5Error &)
+  {
+    delete p_file;
+    throw;
+  }
+}
+
+PagedDataArray::~PagedDataArray()
+{
+  delete p_store;
+  delete p_file;
+}
+
+std::string const &PagedDataArray::fileName() const
+{
+  return _fileName;
+}
+
+std::string const &PagedDataArray::dataset() const
+{
+  return _dataset;
+}
+
+blitz::TinyVector<atb::BlitzIndexT,3> const &PagedDataArray::shape() const
+{
+  return _shape;
+}
+
+blitz::TinyVector<atb::BlitzIndexT,3> const
+&PagedDataArray::brickShape() const
+{
+  return _brickShape;
+}
+
+blitz::TinyVector<double,3> const &PagedDataArray::elementSizeUm() const
+{
+  return _elementSizeUm;
+}
+
+blitz::TinyMatrix<double,4,4> const &PagedDataArray::transformation() const
+{
+  return _transformation;
+}
+
+void PagedDataArray::setTransformation(
+    blitz::TinyMatrix<double,4,4> const &transformation)
+{
+  QMutexLocker lock(&_mutex);
+  _transformation = transformation;
+}
+
+blitz::TinyVector<double,3> PagedDataArray::lowerBoundUm() const
+{
+  blitz::TinyMatrix<double,4,4> inverse(atb::invert(_transformation));
+  blitz::TinyVector<double,3> lb(std::numeric_limits<double>::infinity());
+  for (int d = 0; d < 8; ++d)
+  {
+    blitz::TinyVector<double,4> cornerPosUm;
+    int tmp = d;
+    for (int d2 = 2; d2 >= 0; --d2)
+    {
+      cornerPosUm(d2) = ((tmp % 2) * _shape(d2) - 0.5) * _elementSizeUm(d2);
+      tmp /= 2;
+    }
+    cornerPosUm(3) = 1.0;
+    cornerPosUm = inverse * cornerPosUm;
+    cornerPosUm /= cornerPosUm(3);
+    for (int d2 = 0; d2 < 3; ++d2)
+        if (cornerPosUm(d2) < lb(d2)) lb(d2) = cornerPosUm(d2);
+  }
+  return lb;
+}
+
+blitz::TinyVector<double,3> PagedDataArray::upperBoundUm() const
+{
+  blitz::TinyMatrix<double,4,4> inverse(atb::invert(_transformation));
+  blitz::TinyVector<double,3> ub(-std::numeric_limits<double>::infinity());
+  for (int d = 0; d < 8; ++d)
+  {
+    blitz::TinyVector<double,4> cornerPosUm;
+    int tmp = d;
+    for (int d2 = 2; d2 >= 0; --d2)
+    {
+      cornerPosUm(d2) = ((tmp % 2) * _shape(d2) - 0.5) * _elementSizeUm(d2);
+      tmp /= 2;
+    }
+    cornerPosUm(3) = 1.0;
+    cornerPosUm = inverse * cornerPosUm;
+    cornerPosUm /= cornerPosUm(3);
+    for (int d2 = 0; d2 < 3; ++d2)
+        if (cornerPosUm(d2) > ub(d2)) ub(d2) = cornerPosUm(d2);
+  }
+  return ub;
+}
+
+size_t PagedDataArray::maxCacheSizeBytes() const
+{
+  QMutexLocker lock(&_mutex);
+  return p_store->maxSizeBytes();
+}
+
+void PagedDataArray::setMaxCacheSizeBytes(size_t maxCacheSizeBytes)
+{
+  QMutexLocker lock(&_mutex);
+  p_store->setMaxSizeBytes(maxCacheSizeBytes);
+}
+
+size_t PagedDataArray::cacheSizeBytes() const
+{
+  QMutexLocker lock(&_mutex);
+  return p_store->sizeBytes();
+}
+
+void PagedDataArray::clearCache()
+{
+  QMutexLocker lock(&_mutex);
+  p_store->clear();
+}
+
+void PagedDataArray::detachFile() const
+{
+  QMutexLocker lock(&_mutex);
+  _detached = true;
+  delete p_file;
+  p_file = NULL;
+}
+
+void PagedDataArray::attachFile() const
+{
+  QMutexLocker lock(&_mutex);
+  _detached = false;
+}
+
+float PagedDataArray::operator()(
+    blitz::TinyVector<atb::BlitzIndexT,3> const &pos) const
+{
+  if (blitz::any(pos < 0 || pos >= _shape)) return 0.0f;
+  QMutexLocker lock(&_mutex);
+  float value = p_store->value(*this, pos);
+  _closeIfDetached();
+  return value;
+}
+
+float PagedDataArray::valueAt(
+    blitz::TinyVector<double,3> const &positionUm) const
+{
+  blitz::TinyVector<double,4> pos;
+  for (int d = 0; d < 3; ++d) pos(d) = positionUm(d);
+  pos(3) = 1.0;
+  pos = _transformation * pos;
+  blitz::TinyVector<atb::BlitzIndexT,3> p;
+  for (int d = 0; d < 3; ++d)
+      p(d) = static_cast<atb::BlitzIndexT>(
+          std::floor(pos(d) / pos(3) / _elementSizeUm(d) + 0.5));
+  return (*this)(p);
+}
+
+void PagedDataArray::readSlice(
+    int direction, atb::BlitzIndexT index,
+    blitz::TinyVector<int,2> const &dims, atb::BlitzIndexT step,
+    blitz::Array<float,2> &slice) const
+{
+  if (index < 0 || index >= _shape(direction) || step < 1) return;
+  QMutexLocker lock(&_mutex);
+  p_store->readSlice(*this, direction, index, dims, step, slice);
+  _closeIfDetached();
+}
+
+void PagedDataArray::valueRange(
+    float &minValue, float &maxValue, iRoCS::ProgressReporter *pr) const
+{
+  QMutexLocker lock(&_mutex);
+  minValue = std::numeric_limits<float>::infinity();
+  maxValue = -std::numeric_limits<float>::infinity();
+  int pStart = (pr != NULL) ? pr->taskProgressMin() : 0;
+  int pScale = (pr != NULL) ? (pr->taskProgressMax() - pStart) : 0;
+  for (atb::BlitzIndexT z = 0; z < _shape(0); z += _brickShape(0))
+  {
+    if (pr != NULL && !pr->updateProgress(
+            pStart + static_cast<int>(
+                static_cast<double>(pScale) * z / _shape(0))))
+    {
+      _closeIfDetached();
+      return;
+    }
+    blitz::Array<float,3> slab(
+        std::min(_brickShape(0), _shape(0) - z), _shape(1), _shape(2));
+    _file().readHyperslab(
+        slab, _dataset, blitz::TinyVector<hsize_t,3>(z, 0, 0));
+    minValue = std::min(minValue, blitz::min(slab));
+    maxValue = std::max(maxValue, blitz::max(slab));
+  }
+  _closeIfDetached();
+  if (pr != NULL) pr->updateProgress(pStart + pScale);
+}
+
+void PagedDataArray::load(
+    atb::Array<float,3> &data, iRoCS::ProgressReporter *pr) const
+{
+  QMutexLocker lock(&_mutex);
+  data.resize(_shape);
+  data.setElementSizeUm(_elementSizeUm);
+  data.setTransformation(_transformation);
+  int pStart = (pr != NULL) ? pr->taskProgressMin() : 0;
+  int pScale = (pr != NULL) ? (pr->taskProgressMax() - pStart) : 0;
+  for (atb::BlitzIndexT z = 0; z < _shape(0); z += _brickShape(0))
+  {
+    if (pr != NULL && !pr->updateProgress(
+            pStart + static_cast<int>(
+                static_cast<double>(pScale) * z / _shape(0))))
+    {
+      _closeIfDetached();
+      return;
+    }
+    blitz::Array<float,3> slab(
+        data(blitz::Range(z, std::min(z + _brickShape(0), _shape(0)) - 1),
+             blitz::Range::all(), blitz::Range::all()));
+    _file().readHyperslab(
+        slab, _dataset, blitz::TinyVector<hsize_t,3>(z, 0, 0));
+  }
+  _closeIfDetached();
+  if (pr != NULL) pr->updateProgress(pStart + pScale);
+}
+
+BlitzH5File const &PagedDataArray::_file() const
+{
+  if (p_file == NULL) p_file = new BlitzH5File(_fileName);
+  return *p_file;
+}
+
+void PagedDataArray::_closeIfDetached() const
+{
+  if (!_detached) return;
+  delete p_file;
+  p_file = NULL;
+}
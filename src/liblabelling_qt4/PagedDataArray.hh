@@ -0,0 +1,253 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef PAGEDDATAARRAY_HH
+#define PAGEDDATAARRAY_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <QtCore/QMutex>
+
+#include <libArrayToolbox/Array.hh>
+
+#include <string>
+
+class BlitzH5File;
+
+/*======================================================================*/
+/*!
+ *  \class PagedDataArray PagedDataArray.hh "PagedDataArray.hh"
+ *  \brief The PagedDataArray class provides read access to a 3-D HDF5
+ *    dataset without loading it into memory.
+ *
+ *  The dataset is split into bricks, that are aligned to the HDF5 chunks
+ *  if possible. Bricks are read on demand using hyperslab reads and kept
+ *  in their native file type in a least recently used cache of bounded
+ *  size. Values are converted to float on access. This allows browsing
+ *  datasets that are larger than the main memory, or that would exceed it
+ *  after conversion to float.
+ *
+ *  All methods are thread safe, but since the HDF5 library itself is not,
+ *  accesses should be issued from the GUI thread only.
+ */
+/*======================================================================*/
+class PagedDataArray
+{
+
+public:
+
+  class BrickStore;
+
+  static const size_t DefaultMaxCacheSizeBytes;
+
+/*======================================================================*/
+/*!
+ *   Constructor. Opens the given dataset and reads its meta data. The
+ *   file stays open read-only until detachFile() is called or the
+ *   PagedDataArray is destroyed.
+ *
+ *   \param fileName          The HDF5 file name
+ *   \param dataset           The 3-D dataset to page
+ *   \param maxCacheSizeBytes The maximum memory used for cached bricks
+ *
+ *   \exception BlitzH5Error if the dataset cannot be opened or is not 3-D
+ */
+/*======================================================================*/
+  PagedDataArray(
+      std::string const &fileName, std::string const &dataset,
+      size_t maxCacheSizeBytes = DefaultMaxCacheSizeBytes);
+  ~PagedDataArray();
+
+  std::string const &fileName() const;
+  std::string const &dataset() const;
+
+  blitz::TinyVector<atb::BlitzIndexT,3> const &shape() const;
+  blitz::TinyVector<atb::BlitzIndexT,3> const &brickShape() const;
+  blitz::TinyVector<double,3> const &elementSizeUm() const;
+
+  blitz::TinyMatrix<double,4,4> const &transformation() const;
+  void setTransformation(blitz::TinyMatrix<double,4,4> const &transformation);
+
+/*======================================================================*/
+/*!
+ *   Get the lower bound of the axis aligned bounding box of the
+ *   transformed dataset in micrometers. This is computed exactly like
+ *   atb::Array::lowerBoundUm().
+ *
+ *   \return The lower bounding box corner in micrometers
+ */
+/*======================================================================*/
+  blitz::TinyVector<double,3> lowerBoundUm() const;
+
+/*======================================================================*/
+/*!
+ *   Get the upper bound of the axis aligned bounding box of the
+ *   transformed dataset in micrometers. This is computed exactly like
+ *   atb::Array::upperBoundUm().
+ *
+ *   \return The upper bounding box corner in micrometers
+ */
+/*======================================================================*/
+  blitz::TinyVector<double,3> upperBoundUm() const;
+
+  size_t maxCacheSizeBytes() const;
+  void setMaxCacheSizeBytes(size_t maxCacheSizeBytes);
+
+/*======================================================================*/
+/*!
+ *   Get the memory currently occupied by cached bricks.
+ *
+ *   \return The cache size in bytes
+ */
+/*======================================================================*/
+  size_t cacheSizeBytes() const;
+
+/*======================================================================*/
+/*!
+ *   Drop all cached bricks.
+ */
+/*======================================================================*/
+  void clearCache();
+
+/*======================================================================*/
+/*!
+ *   Close the read-only handle to the HDF5 file until attachFile() is
+ *   called. HDF5 refuses to open a file for writing while it is still
+ *   open read-only, so this must be called before writing to the paged
+ *   file. Cached bricks stay available. Accesses that need to read from
+ *   the file in between open it only for the duration of the read.
+ */
+/*======================================================================*/
+  void detachFile() const;
+
+/*======================================================================*/
+/*!
+ *   Keep the HDF5 file open between reads again after detachFile(). The
+ *   file is reopened on the next access that needs to read from it.
+ */
+/*======================================================================*/
+  void attachFile() const;
+
+/*======================================================================*/
+/*!
+ *   Get the value at the given voxel position. Positions outside the
+ *   dataset yield zero.
+ *
+ *   \param pos The voxel position
+ *
+ *   \return The value at the given position
+ */
+/*======================================================================*/
+  float operator()(blitz::TinyVector<atb::BlitzIndexT,3> const &pos) const;
+
+/*======================================================================*/
+/*!
+ *   Get the value at the given world position after applying the
+ *   transformation. The nearest voxel is returned, positions outside the
+ *   dataset yield zero.
+ *
+ *   \param positionUm The position in micrometers
+ *
+ *   \return The value of the voxel closest to the given position
+ */
+/*======================================================================*/
+  float valueAt(blitz::TinyVector<double,3> const &positionUm) const;
+
+/*======================================================================*/
+/*!
+ *   Read a sub-sampled axis aligned slice. Only the bricks intersecting
+ *   the slice are read. Element (y, x) of the output slice receives the
+ *   voxel with coordinates step * y along dims(0) and step * x along
+ *   dims(1). Slice elements beyond the dataset are left untouched.
+ *
+ *   \param direction The dimension orthogonal to the slice
+ *   \param index     The slice index along direction
+ *   \param dims      The dataset dimensions corresponding to the slice
+ *     rows and columns
+ *   \param step      The sub-sampling step in voxels
+ *   \param slice     The output slice, it must already have its final
+ *     shape
+ */
+/*======================================================================*/
+  void readSlice(
+      int direction, atb::BlitzIndexT index,
+      blitz::TinyVector<int,2> const &dims, atb::BlitzIndexT step,
+      blitz::Array<float,2> &slice) const;
+
+/*======================================================================*/
+/*!
+ *   Compute the value range of the dataset. The data are streamed slab
+ *   by slab and do not pollute the brick cache.
+ *
+ *   \param minValue The minimum value is written to this variable
+ *   \param maxValue The maximum value is written to this variable
+ *   \param pr       If given, progress is reported via this
+ *     ProgressReporter
+ */
+/*======================================================================*/
+  void valueRange(
+      float &minValue, float &maxValue,
+      iRoCS::ProgressReporter *pr = NULL) const;
+
+/*======================================================================*/
+/*!
+ *   Load the complete dataset including element size and transformation
+ *   into the given Array.
+ *
+ *   \param data The Array to load the data into
+ *   \param pr   If given, progress is reported via this ProgressReporter
+ */
+/*======================================================================*/
+  void load(
+      atb::Array<float,3> &data, iRoCS::ProgressReporter *pr = NULL) const;
+
+private:
+
+  PagedDataArray(PagedDataArray const &);
+  PagedDataArray &operator=(PagedDataArray const &);
+
+  // Get the open file, reopen it if it was closed. Must be called with
+  // _mutex held.
+  BlitzH5File const &_file() const;
+
+  // Close the file again after a read if it is detached. Must be called
+  // with _mutex held.
+  void _closeIfDetached() const;
+
+  std::string _fileName, _dataset;
+  mutable BlitzH5File *p_file;
+  mutable bool _detached;
+  BrickStore *p_store;
+
+  blitz::TinyVector<atb::BlitzIndexT,3> _shape, _brickShape;
+  blitz::TinyVector<double,3> _elementSizeUm;
+  blitz::TinyMatrix<double,4,4> _transformation;
+
+  mutable QMutex _mutex;
+
+};
+
+#endif
@@ -44,6 +44,11 @@
 
 // #include <blitz/tinyvec-et.h>
 
+#include <algorithm>
+
+// Number of slice contours kept per direction
+static const size_t MaxCachedContours = 16;
+
 SHSurfaceMarkerPresetWidget::SHSurfaceMarkerPresetWidget(
     AnnotationChannelSpecs* channel, QWidget* parent)
         : SphereMarkerPresetWidget(channel, parent)
@@ -84,14 +89,16 @@ void SHSurfaceMarkerControlWidget::toggleReadOnly()
 
 
 SHSurfaceMarker::SHSurfaceMarker(AnnotationChannelSpecs* channel)
-        : SphereMarker(channel), _coefficients(), _surface()
+        : SphereMarker(channel), _coefficients(), _surface(),
+          _triangleIntervalsUpToDate(false)
 {}
 
 SHSurfaceMarker::SHSurfaceMarker(
     blitz::TinyVector<double,3> const& position,
     double radius, segmentation::FrequencyArray const &coefficients,
     AnnotationChannelSpecs* channel)
-        : SphereMarker(position, radius, channel), _coefficients(), _surface()
+        : SphereMarker(position, radius, channel), _coefficients(), _surface(),
+          _triangleIntervalsUpToDate(false)
 {
   if (coefficients.size() != 0)
   {
@@ -103,7 +110,8 @@ SHSurfaceMarker::SHSurfaceMarker(
 }
 
 SHSurfaceMarker::SHSurfaceMarker(const SHSurfaceMarker& marker)
-        : SphereMarker(marker), _coefficients(), _surface(marker._surface)
+        : SphereMarker(marker), _coefficients(), _surface(marker._surface),
+          _triangleIntervalsUpToDate(false)
 {
   if (marker._coefficients.size() != 0)
   {
@@ -124,6 +132,7 @@ SHSurfaceMarker &SHSurfaceMarker::operator=(const SHSurfaceMarker& marker)
       std::memcpy(_coefficients.data(), marker._coefficients.data(),
                   _coefficients.size() * sizeof(std::complex<double>));
   _surface = marker._surface;
+  _triangleIntervalsUpToDate = false;
   return *this;
 }
 
@@ -176,14 +185,19 @@ void SHSurfaceMarker::setCoefficients(
       _coefficients.resize(coefficients.size());
   std::memcpy(_coefficients.data(), coefficients.data(),
               _coefficients.size() * sizeof(std::complex<double>));
+  _updateTriangles();
+  _boundingBoxUpToDate = false;
   if (p_channel != NULL)
   {
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
-    if (p_channel->model() != NULL) p_channel->model()->setModified(true);
+    if (p_channel->model() != NULL)
+    {
+      p_channel->model()->setModified(true);
+      update();
+    }
   }
-  _updateTriangles();
-  _boundingBoxUpToDate = false;
 }
 
 atb::SurfaceGeometry const &SHSurfaceMarker::geometry() const
@@ -217,6 +231,84 @@ std::vector<atb::SurfaceGeometry::IndexT> const
   return _surface.indices();
 }
 
+std::vector<SHSurfaceMarker::ContourSegment> const
+&SHSurfaceMarker::sliceContourUm(int direction, double offsetUm) const
+{
+  if (!_triangleIntervalsUpToDate) _updateTriangleIntervals();
+
+  std::map< double,std::vector<ContourSegment> > &contours =
+      _contours[direction];
+  std::list<double> &usage = _contourUsage[direction];
+  std::map< double,std::vector<ContourSegment> >::iterator cIt =
+      contours.find(offsetUm);
+  if (cIt != contours.end())
+  {
+    usage.remove(offsetUm);
+    usage.push_front(offsetUm);
+    return cIt->second;
+  }
+
+  // Drop the least recently used contour
+  if (contours.size() >= MaxCachedContours)
+  {
+    contours.erase(usage.back());
+    usage.pop_back();
+  }
+  usage.push_front(offsetUm);
+  std::vector<ContourSegment> &contour = contours[offsetUm];
+
+  std::vector<atb::SurfaceGeometry::VertexT> const &V = _surface.vertices();
+  std::vector<atb::SurfaceGeometry::IndexT> const &I = _surface.indices();
+  std::vector<TriangleInterval> const &intervals =
+      _triangleIntervals[direction];
+
+  // No triangle is longer than _maxTriangleExtentUm along direction, so all
+  // candidates start at most that far below the plane
+  std::vector<TriangleInterval>::const_iterator it = std::lower_bound(
+      intervals.begin(), intervals.end(),
+      offsetUm - _maxTriangleExtentUm[direction], TriangleIntervalLess());
+  for (; it != intervals.end() && it->lowerBoundUm <= offsetUm; ++it)
+  {
+    if (it->upperBoundUm < offsetUm) continue;
+
+    blitz::TinyVector<blitz::TinyVector<double,3>,3> tri;
+    for (int i = 0; i < 3; ++i)
+    {
+      atb::SurfaceGeometry::VertexT const &v = V[I[3 * it->triangle + i]];
+      tri(i) = blitz::TinyVector<double,3>(v(0), v(1), v(2));
+    }
+
+    ContourSegment segment;
+    int nPoints = 0;
+    for (int edge = 0; edge < 3 && nPoints < 2; ++edge)
+    {
+      blitz::TinyVector<double,3> const &p1 = tri(edge);
+      blitz::TinyVector<double,3> const &p2 = tri((edge + 1) % 3);
+
+      // Parallel or in-plane
+      if (p1(direction) == p2(direction))
+      {
+        if (p1(direction) != offsetUm) continue;
+        segment(0) = p1;
+        segment(1) = p2;
+        nPoints = 2;
+        break;
+      }
+
+      double alpha =
+          (offsetUm - p1(direction)) / (p2(direction) - p1(direction));
+      if (alpha < 0 || alpha > 1) continue;
+
+      blitz::TinyVector<double,3> p(p1 + alpha * (p2 - p1));
+      if (nPoints > 0 && blitz::all(p == segment(0))) continue;
+      segment(nPoints) = p;
+      nPoints++;
+    }
+    if (nPoints == 2) contour.push_back(segment);
+  }
+  return contour;
+}
+
 void SHSurfaceMarker::save(
     AnnotationChannelSpecs const *channel, BlitzH5File &outFile,
     std::string const & group, iRoCS::ProgressReporter *pr)
@@ -426,6 +518,7 @@ void SHSurfaceMarker::_updateTriangles() const
   std::vector<atb::SurfaceGeometry::IndexT> &I = _surface.indices();
 
   _boundingBoxUpToDate = false;
+  _triangleIntervalsUpToDate = false;
 
   if (_coefficients.size() == 0)
   {
@@ -530,6 +623,56 @@ void SHSurfaceMarker::_updateTriangles() const
   _surface.computeDefaultNormals();
 }
 
+bool SHSurfaceMarker::TriangleIntervalLess::operator()(
+    TriangleInterval const &a, TriangleInterval const &b) const
+{
+  return a.lowerBoundUm < b.lowerBoundUm;
+}
+
+bool SHSurfaceMarker::TriangleIntervalLess::operator()(
+    TriangleInterval const &a, double b) const
+{
+  return a.lowerBoundUm < b;
+}
+
+bool SHSurfaceMarker::TriangleIntervalLess::operator()(
+    double a, TriangleInterval const &b) const
+{
+  return a < b.lowerBoundUm;
+}
+
+void SHSurfaceMarker::_updateTriangleIntervals() const
+{
+  std::vector<atb::SurfaceGeometry::VertexT> const &V = vertices();
+  std::vector<atb::SurfaceGeometry::IndexT> const &I = indices();
+  size_t nTriangles = I.size() / 3;
+  for (int d = 0; d < 3; ++d)
+  {
+    _contours[d].clear();
+    _contourUsage[d].clear();
+    _maxTriangleExtentUm[d] = 0.0;
+    _triangleIntervals[d].resize(nTriangles);
+    for (size_t t = 0; t < nTriangles; ++t)
+    {
+      TriangleInterval &interval = _triangleIntervals[d][t];
+      interval.triangle = t;
+      interval.lowerBoundUm = interval.upperBoundUm = V[I[3 * t]](d);
+      for (int i = 1; i < 3; ++i)
+      {
+        double x = V[I[3 * t + i]](d);
+        if (x < interval.lowerBoundUm) interval.lowerBoundUm = x;
+        if (x > interval.upperBoundUm) interval.upperBoundUm = x;
+      }
+      _maxTriangleExtentUm[d] = std::max(
+          _maxTriangleExtentUm[d],
+          interval.upperBoundUm - interval.lowerBoundUm);
+    }
+    std::sort(_triangleIntervals[d].begin(), _triangleIntervals[d].end(),
+              TriangleIntervalLess());
+  }
+  _triangleIntervalsUpToDate = true;
+}
+
 void SHSurfaceMarker::_updateBoundingBox() const
 {
   if (_coefficients.size() == 0) SphereMarker::_updateBoundingBox();
@@ -34,6 +34,10 @@
 #include <libsegmentation/SH_tools.hh>
 #include <libArrayToolbox/SurfaceGeometry.hh>
 
+#include <list>
+#include <map>
+#include <vector>
+
 class SHSurfaceMarkerPresetWidget : public SphereMarkerPresetWidget
 {
   
@@ -81,6 +85,14 @@ class SHSurfaceMarker : public SphereMarker
 
 public:
   
+/*======================================================================*/
+/*!
+ *   A line segment of a slice contour. Both end points are given in
+ *   micrometers relative to the marker position.
+ */
+/*======================================================================*/
+  typedef blitz::TinyVector<blitz::TinyVector<double,3>,2> ContourSegment;
+
   SHSurfaceMarker(AnnotationChannelSpecs *channel = NULL);
   SHSurfaceMarker(
       blitz::TinyVector<double,3> const& position,
@@ -107,6 +119,25 @@ public:
   std::vector<atb::SurfaceGeometry::NormalT> const &normals() const;
   std::vector<atb::SurfaceGeometry::IndexT> const &indices() const;
 
+/*======================================================================*/
+/*!
+ *   Get the intersection of the marker surface with the axis-aligned plane
+ *   at the given offset from the marker center. Only triangles whose
+ *   extent along the plane normal contains the offset are visited, using a
+ *   per-direction table of triangle intervals sorted by their lower bound.
+ *   The resulting contours are cached for the most recently requested
+ *   slices. Tables and cache are discarded when the surface changes.
+ *
+ *   \param direction The dimension orthogonal to the plane
+ *   \param offsetUm  The plane position relative to the marker position
+ *     along direction in micrometers
+ *
+ *   \return The contour segments relative to the marker position
+ */
+/*======================================================================*/
+  std::vector<ContourSegment> const &sliceContourUm(
+      int direction, double offsetUm) const;
+
   static void save(
       AnnotationChannelSpecs const *channel,
       BlitzH5File &outFile, std::string const &group,
@@ -127,12 +158,34 @@ public:
 
 private:
 
+  struct TriangleInterval
+  {
+    double lowerBoundUm, upperBoundUm;
+    size_t triangle;
+  };
+
+  struct TriangleIntervalLess
+  {
+    bool operator()(TriangleInterval const &a, TriangleInterval const &b)
+        const;
+    bool operator()(TriangleInterval const &a, double b) const;
+    bool operator()(double a, TriangleInterval const &b) const;
+  };
+
   void _updateTriangles() const;
   void _updateBoundingBox() const;
+  void _updateTriangleIntervals() const;
 
   segmentation::FrequencyArray _coefficients;
   mutable atb::SurfaceGeometry _surface;
 
+  mutable bool _triangleIntervalsUpToDate;
+  mutable std::vector<TriangleInterval> _triangleIntervals[3];
+  mutable double _maxTriangleExtentUm[3];
+  mutable std::map< double,std::vector<ContourSegment> > _contours[3];
+  // Offsets of the cached contours, most recently used first
+  mutable std::list<double> _contourUsage[3];
+
 };
 
 #endif
@@ -274,66 +274,33 @@ void SHSurfaceMarkerOrthoViewRenderer::render(
       svgStream.writeAttribute(
           "id", (viewId + "-" + marker->id() + ": segmentation").c_str());
       
-      // For each triangle check for intersection with current slice
-      QPointF p[2];
-      for (size_t t = 0; t < marker->indices().size(); t += 3)
+      blitz::TinyVector<double,3> markerPosUm(marker->positionUm());
+      std::vector<SHSurfaceMarker::ContourSegment> const &contour =
+          marker->sliceContourUm(
+              _orthogonalDimension,
+              view->positionUm()(_orthogonalDimension) -
+              markerPosUm(_orthogonalDimension));
+      for (size_t i = 0; i < contour.size(); ++i)
       {
-        blitz::TinyVector<blitz::TinyVector<double,3>,3> tri(
-            (*marker).vertices()[(*marker).indices()[3 * t]] +
-            (*marker).positionUm(),
-            (*marker).vertices()[(*marker).indices()[3 * t + 1]] +
-            (*marker).positionUm(),
-            (*marker).vertices()[(*marker).indices()[3 * t + 2]] +
-            (*marker).positionUm());
-        
-        int nPoints = 0;
-        for (int edge = 0; edge < 3; ++edge)
-        {
-          blitz::TinyVector<double,2> pos(
-              intersectLineNPlane(
-                  tri(edge), tri((edge + 1) % 3), _orthogonalDimension,
-                  view->positionUm()(_orthogonalDimension)));
-          
-          if (blitz::all(pos == std::numeric_limits<double>::infinity()))
-              continue;
-          
-          if (pos(0) == 0.0 && pos(1) ==
-              std::numeric_limits<double>::infinity())
-          {
-            p[0].setX((tri(edge)(dimensions(1)) -
-                       lowerBoundUm(dimensions(1))) * um2PxFactor);
-            p[0].setY((tri(edge)(dimensions(0)) -
-                       lowerBoundUm(dimensions(0))) * um2PxFactor);
-            p[1].setX((tri((edge + 1) % 3)(dimensions(1)) -
-                       lowerBoundUm(dimensions(1))) * um2PxFactor);
-            p[1].setY((tri((edge + 1) % 3)(dimensions(0)) -
-                       lowerBoundUm(dimensions(0))) * um2PxFactor);
-            nPoints = 2;
-            break;
-          }
-          
-          p[nPoints].setX((pos(1) - lowerBoundUm(dimensions(1))) *
-                          um2PxFactor);
-          p[nPoints].setY((pos(0) - lowerBoundUm(dimensions(0))) *
-                          um2PxFactor);
-          if (nPoints > 0 && p[nPoints].rx() == p[0].rx() &&
-              p[nPoints].ry() == p[0].ry()) continue;
-          nPoints++;
-        }
-        if (nPoints == 2)
-        {
-          svgStream.writeEmptyElement("path");
-          svgStream.writeAttribute(
-              "d", "M" + QString::number(p[0].x()) + " " +
-              QString::number(p[0].y()) + " L" + QString::number(p[1].x()) +
-              " " + QString::number(p[1].y()));
-          svgStream.writeAttribute(
-              "style",
-              ("stroke:" + markerColor + ";stroke-width:0.5pt").c_str());
-        }
+        blitz::TinyVector<double,3> p1(contour[i](0) + markerPosUm);
+        blitz::TinyVector<double,3> p2(contour[i](1) + markerPosUm);
+        svgStream.writeEmptyElement("path");
+        svgStream.writeAttribute(
+            "d", "M" +
+            QString::number((p1(dimensions(1)) - lowerBoundUm(dimensions(1))) *
+                            um2PxFactor) + " " +
+            QString::number((p1(dimensions(0)) - lowerBoundUm(dimensions(0))) *
+                            um2PxFactor) + " L" +
+            QString::number((p2(dimensions(1)) - lowerBoundUm(dimensions(1))) *
+                            um2PxFactor) + " " +
+            QString::number((p2(dimensions(0)) - lowerBoundUm(dimensions(0))) *
+                            um2PxFactor));
+        svgStream.writeAttribute(
+            "style",
+            ("stroke:" + markerColor + ";stroke-width:0.5pt").c_str());
       }
+      svgStream.writeEndElement(); // g id="segmentation"
     }
-    svgStream.writeEndElement(); // g id="segmentation"
   }
   
   if (marker->bw() == 0 || (marker->bw() != 0 && view->showHelperLines()))
@@ -505,48 +472,21 @@ void SHSurfaceMarkerOrthoViewRenderer::updateCache(int direction) const
         marker->boundingBoxUpperBoundUm()(direction) >=
         view->positionUm()(direction))
     {
-      // For each triangle check for intersection with current slice
-      QPointF p[2];
-      for (size_t t = 0; t < marker->indices().size(); t += 3)
+      blitz::TinyVector<double,3> markerPosUm(marker->positionUm());
+      std::vector<SHSurfaceMarker::ContourSegment> const &contour =
+          marker->sliceContourUm(
+              direction,
+              view->positionUm()(direction) - markerPosUm(direction));
+      for (size_t i = 0; i < contour.size(); ++i)
       {
-        blitz::TinyVector<blitz::TinyVector<double,3>,3> tri(
-            (*marker).vertices()[(*marker).indices()[t]] +
-            (*marker).positionUm(),
-            (*marker).vertices()[(*marker).indices()[t + 1]] +
-            (*marker).positionUm(),
-            (*marker).vertices()[(*marker).indices()[t + 2]] +
-            (*marker).positionUm());
-        
-        int nPoints = 0;
-        for (int edge = 0; edge < 3; ++edge)
-        {
-          blitz::TinyVector<double,2> pos(
-              intersectLineNPlane(
-                  tri(edge), tri((edge + 1) % 3), direction,
-                  view->positionUm()(direction)));
-          
-          if (blitz::all(pos == std::numeric_limits<double>::infinity()))
-              continue;
-          
-          if (pos(0) == 0.0 &&
-              pos(1) == std::numeric_limits<double>::infinity())
-          {
-            p[0].setX(view->um2Px(tri(edge)(dims(1)), dims(1)));
-            p[0].setY(view->um2Px(tri(edge)(dims(0)), dims(0)));
-            p[1].setX(view->um2Px(tri((edge + 1) % 3)(dims(1)), dims(1)));
-            p[1].setY(view->um2Px(tri((edge + 1) % 3)(dims(0)), dims(0)));
-            nPoints = 2;
-            break;
-          }
-          
-          p[nPoints].setX(view->um2Px(pos(1), dims(1)));
-          p[nPoints].setY(view->um2Px(pos(0), dims(0)));
-          if (nPoints > 0 && p[nPoints].rx() == p[0].rx() &&
-              p[nPoints].ry() == p[0].ry()) continue;
-          nPoints++;
-        }
-        if (nPoints == 2)
-            cache->lines().push_back(blitz::TinyVector<QPointF,2>(p[0], p[1]));
+        blitz::TinyVector<double,3> p1(contour[i](0) + markerPosUm);
+        blitz::TinyVector<double,3> p2(contour[i](1) + markerPosUm);
+        cache->lines().push_back(
+            blitz::TinyVector<QPointF,2>(
+                QPointF(view->um2Px(p1(dims(1)), dims(1)),
+                        view->um2Px(p1(dims(0)), dims(0))),
+                QPointF(view->um2Px(p2(dims(1)), dims(1)),
+                        view->um2Px(p2(dims(0)), dims(0)))));
       }
     }
   }
@@ -0,0 +1,82 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#include "SliceSamplingThread.hh"
+
+SliceSamplingThread::SliceSamplingThread(
+    DataChannelSpecsOrthoViewRenderer const *renderer, int direction,
+    QObject *parent)
+        : QThread(parent), p_renderer(renderer), _direction(direction),
+          _abort(false)
+{
+  // finished() is emitted after run() returned, so the result is complete
+  // and isRunning() is false when the renderer fetches it
+  connect(this, SIGNAL(finished()), SLOT(_emitSliceSampled()));
+}
+
+SliceSamplingThread::~SliceSamplingThread()
+{
+  abort();
+}
+
+void SliceSamplingThread::sample(
+    DataChannelSpecsOrthoViewRenderer::SliceKey const &key,
+    blitz::Array<float,3> const &levelData)
+{
+  abort();
+  _key = key;
+  _levelData.reference(levelData);
+  _slice.free();
+  _abort = false;
+  start(QThread::LowPriority);
+}
+
+void SliceSamplingThread::abort()
+{
+  if (!isRunning()) return;
+  _abort = true;
+  wait();
+  _key = DataChannelSpecsOrthoViewRenderer::SliceKey();
+}
+
+DataChannelSpecsOrthoViewRenderer::SliceKey const
+&SliceSamplingThread::key() const
+{
+  return _key;
+}
+
+blitz::Array<float,2> const &SliceSamplingThread::slice() const
+{
+  return _slice;
+}
+
+void SliceSamplingThread::run()
+{
+  p_renderer->sampleSlice(_direction, _key, _levelData, _slice, &_abort);
+}
+
+void SliceSamplingThread::_emitSliceSampled()
+{
+  if (!_abort && !isRunning()) emit sliceSampled(_direction);
+}
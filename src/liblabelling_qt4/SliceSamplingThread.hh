@@ -0,0 +1,107 @@
+/**************************************************************************
+ *
+ * This file belongs to the iRoCS Toolbox.
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ * 
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+#ifndef SLICESAMPLINGTHREAD_HH
+#define SLICESAMPLINGTHREAD_HH
+
+#ifdef HAVE_CONFIG_H
+#include <config.hh>
+#endif
+
+#include <QtCore/QThread>
+
+#include "DataChannelSpecsOrthoViewRenderer.hh"
+
+/*======================================================================*/
+/*!
+ *  \class SliceSamplingThread SliceSamplingThread.hh "SliceSamplingThread.hh"
+ *  \brief The SliceSamplingThread class samples one raw slice of a
+ *    DataChannelSpecsOrthoViewRenderer in the background.
+ *
+ *  The renderer shows a coarse preview while this thread computes the
+ *  slice at the requested pyramid level. When the thread has finished,
+ *  sliceSampled() is emitted in the GUI thread and the renderer fetches
+ *  the result via slice(). The thread
+ *  keeps its own reference to the pyramid level, so the channel may drop
+ *  its pyramid while sampling is in progress.
+ */
+/*======================================================================*/
+class SliceSamplingThread : public QThread
+{
+
+  Q_OBJECT
+
+public:
+
+  SliceSamplingThread(
+      DataChannelSpecsOrthoViewRenderer const *renderer, int direction,
+      QObject *parent = NULL);
+  ~SliceSamplingThread();
+
+/*======================================================================*/
+/*!
+ *   Start sampling the slice with the given key. A running sampling is
+ *   aborted first. Must be called from the GUI thread.
+ *
+ *   \param key       The slice parameters
+ *   \param levelData The pyramid level matching key.level
+ */
+/*======================================================================*/
+  void sample(
+      DataChannelSpecsOrthoViewRenderer::SliceKey const &key,
+      blitz::Array<float,3> const &levelData);
+
+/*======================================================================*/
+/*!
+ *   Abort a running sampling and wait until the thread finished. The
+ *   result of an aborted sampling is discarded.
+ */
+/*======================================================================*/
+  void abort();
+
+  DataChannelSpecsOrthoViewRenderer::SliceKey const &key() const;
+  blitz::Array<float,2> const &slice() const;
+
+  void run();
+
+signals:
+
+  void sliceSampled(int direction);
+
+private slots:
+
+  void _emitSliceSampled();
+
+private:
+
+  DataChannelSpecsOrthoViewRenderer const *p_renderer;
+  int _direction;
+  DataChannelSpecsOrthoViewRenderer::SliceKey _key;
+  blitz::Array<float,3> _levelData;
+  blitz::Array<float,2> _slice;
+  volatile bool _abort;
+
+};
+
+#endif
@@ -179,12 +179,16 @@ void SphereMarker::setRadiusUm(const double radius)
   if (_radiusUm == radius) return;
   _radiusUm = radius;
   _boundingBoxUpToDate = false;
-  if (p_channel != NULL && p_channel->model() != NULL)
+  if (p_channel != NULL)
   {
-    p_channel->model()->setModified(true);
+    p_channel->updateMarkerIndex(this);
     if (selected() && p_channel->markerControlWidget() != NULL)
         p_channel->markerControlWidget()->setValues(this);
-    update();
+    if (p_channel->model() != NULL)
+    {
+      p_channel->model()->setModified(true);
+      update();
+    }
   }
 }
 
@@ -167,8 +167,11 @@ void SurfaceMarker::setVertices(
 {
   _surface.vertices() = vertices;
   _boundingBoxUpToDate = false;
-  if (p_channel != NULL && p_channel->model() != NULL)
-      p_channel->model()->setModified(true);
+  if (p_channel != NULL)
+  {
+    p_channel->updateMarkerIndex(this);
+    if (p_channel->model() != NULL) p_channel->model()->setModified(true);
+  }
 }
 
 void SurfaceMarker::setNormals(
@@ -184,8 +187,11 @@ void SurfaceMarker::setIndices(
 {
   _surface.indices() = indices;
   _boundingBoxUpToDate = false;
-  if (p_channel != NULL && p_channel->model() != NULL)
-      p_channel->model()->setModified(true);
+  if (p_channel != NULL)
+  {
+    p_channel->updateMarkerIndex(this);
+    if (p_channel->model() != NULL) p_channel->model()->setModified(true);
+  }
 }
 
 void SurfaceMarker::save(
@@ -84,6 +84,13 @@ ConvertMasksToMarkersParameters::ConvertMasksToMarkersParameters(
   p_smoothingSigmaPxControl->setSingleStep(0.1);
   parameterLayout->addWidget(p_smoothingSigmaPxControl);
 
+  QStringList smStrings;
+  smStrings << tr("Swept volume") << tr("Quadric error");
+  p_simplificationMethodControlElement = new StringSelectionControlElement(
+      tr("Simplification:"), smStrings);
+  p_simplificationMethodControlElement->setValue("Swept volume");
+  parameterLayout->addWidget(p_simplificationMethodControlElement);
+
   p_simplifyToleranceUm3Control = new DoubleControlElement(
       tr("Simplify tolerance [um^3]"), 0.0);
   p_simplifyToleranceUm3Control->setRange(
@@ -91,6 +98,13 @@ ConvertMasksToMarkersParameters::ConvertMasksToMarkersParameters(
   p_simplifyToleranceUm3Control->setSingleStep(0.01);
   parameterLayout->addWidget(p_simplifyToleranceUm3Control);
 
+  p_maximumQuadricErrorUm2Control = new DoubleControlElement(
+      tr("Maximum quadric error [um^2]"), 0.0);
+  p_maximumQuadricErrorUm2Control->setRange(
+      0.0, std::numeric_limits<double>::infinity());
+  p_maximumQuadricErrorUm2Control->setSingleStep(0.01);
+  parameterLayout->addWidget(p_maximumQuadricErrorUm2Control);
+
   parameterPanel->setLayout(parameterLayout);
   mainLayout->addWidget(parameterPanel);
 
@@ -153,11 +167,28 @@ double ConvertMasksToMarkersParameters::smoothingSigmaPx() const
   return p_smoothingSigmaPxControl->value();
 }
 
+ConvertMasksToMarkersParameters::SimplificationMethod
+ConvertMasksToMarkersParameters::simplificationMethod() const
+{
+  switch (p_simplificationMethodControlElement->value())
+  {
+  case 1:
+    return QuadricError;
+  default:
+    return SweptVolume;
+  }
+}
+
 double ConvertMasksToMarkersParameters::simplifyToleranceUm3() const
 {
   return p_simplifyToleranceUm3Control->value();
 }
 
+double ConvertMasksToMarkersParameters::maximumQuadricErrorUm2() const
+{
+  return p_maximumQuadricErrorUm2Control->value();
+}
+
 void ConvertMasksToMarkersParameters::checkAndAccept()
 {
   try
@@ -48,6 +48,8 @@ class ConvertMasksToMarkersParameters : public QDialog
 
   public:
 
+  enum SimplificationMethod { SweptVolume, QuadricError };
+
   ConvertMasksToMarkersParameters(LabellingMainWidget* mainWidget,
                                   QWidget* parent = 0, Qt::WindowFlags f = 0);
   ~ConvertMasksToMarkersParameters();
@@ -59,7 +61,9 @@ class ConvertMasksToMarkersParameters : public QDialog
   double minimumSizePx() const;
   double maximumSizePx() const;
   double smoothingSigmaPx() const;
+  SimplificationMethod simplificationMethod() const;
   double simplifyToleranceUm3() const;
+  double maximumQuadricErrorUm2() const;
 
 protected slots:
 
@@ -75,7 +79,9 @@ private:
   StringSelectionControlElement* p_markerTypeControlElement;
   DoubleRangeControlElement *p_volumeRangePxControl;
   DoubleControlElement *p_smoothingSigmaPxControl;
+  StringSelectionControlElement *p_simplificationMethodControlElement;
   DoubleControlElement *p_simplifyToleranceUm3Control;
+  DoubleControlElement *p_maximumQuadricErrorUm2Control;
 
   friend class PluginConvertMasksToMarkers;
 
@@ -43,6 +43,41 @@
 #include <libArrayToolbox/ATBDataSynthesis.hh>
 #include <libArrayToolbox/TypeTraits.hh>
 
+// Simplify the given segment surface according to the dialog settings and
+// add it as marker to the channel. The surface vertices are given relative
+// to offsetUm.
+static void addSegmentMarker(
+    atb::SurfaceGeometry &surface, ConvertMasksToMarkersParameters *dialog,
+    AnnotationChannelSpecs *markerChannel, int label,
+    blitz::TinyVector<double,3> const &positionUm, double volumeUm3,
+    blitz::TinyVector<double,3> const &offsetUm)
+{
+  if (dialog->simplificationMethod() ==
+      ConvertMasksToMarkersParameters::QuadricError)
+      atb::MarchingCubes::simplifyMeshQuadric(
+          surface, dialog->maximumQuadricErrorUm2());
+  else
+      atb::MarchingCubes::simplifyMesh(
+          surface, dialog->simplifyToleranceUm3());
+  surface.computeDefaultNormals();
+
+  SurfaceMarker *marker;
+  if (markerChannel->markerType() == Marker::Surface)
+      marker = new SurfaceMarker(positionUm, &surface);
+  else marker = new CellMarker(positionUm, &surface);
+  marker->setLabel(label);
+  if (marker->inherits(Marker::Cell))
+      static_cast<CellMarker*>(marker)->setVolumeUm3(volumeUm3);
+
+  for (size_t j = 0; j < marker->vertices().size(); ++j)
+      marker->vertices()[j] +=
+          blitz::TinyVector<float,3>(offsetUm - positionUm);
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+  markerChannel->addMarker(marker);
+}
+
 ConvertMasksToMarkersWorker::ConvertMasksToMarkersWorker(
     ConvertMasksToMarkersParameters* dialog, LabellingMainWidget* mainWidget,
     AnnotationChannelSpecs* markerChannel,
@@ -154,6 +189,68 @@ void ConvertMasksToMarkersWorker::run()
       positionUm(i) /= static_cast<double>(volumePx(i));
 
   std::cout << "Extracting surfaces of all components" << std::endl;
+
+  // Without smoothing the segment masks are the indicator functions of the
+  // labels, so all segments are meshed in one pass. Segments outside the
+  // size range are removed from the label Array beforehand.
+  if (p_dialog->smoothingSigmaPx() <= 0.0)
+  {
+    if (p_progress != NULL && !p_progress->updateProgressMessage(
+            tr("Generating markers").toStdString())) return;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(labels.size()); ++j)
+    {
+      atb::BlitzIndexT seg = labels.data()[j] - 1;
+      if (seg >= 0 && (volumePx(seg) < p_dialog->minimumSizePx() ||
+                       volumePx(seg) > p_dialog->maximumSizePx()))
+          labels.data()[j] = 0;
+    }
+
+    std::map<atb::BlitzIndexT,atb::SurfaceGeometry> surfaces;
+    atb::MarchingCubes::triangulateLabels(labels, elSize, surfaces);
+    if (p_progress != NULL && !p_progress->updateProgress(55)) return;
+
+    std::vector<atb::BlitzIndexT> segments;
+    for (std::map<atb::BlitzIndexT,atb::SurfaceGeometry>::const_iterator it =
+             surfaces.begin(); it != surfaces.end(); ++it)
+        segments.push_back(it->first);
+    std::vector<atb::SurfaceGeometry*> segmentSurfaces;
+    for (size_t j = 0; j < segments.size(); ++j)
+        segmentSurfaces.push_back(&surfaces[segments[j]]);
+
+    int nDone = 0;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ptrdiff_t j = 0; j < static_cast<ptrdiff_t>(segments.size()); ++j)
+    {
+      if (p_progress != NULL)
+      {
+        if (p_progress->isAborted()) continue;
+        int progress;
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+          progress = ++nDone;
+        }
+        p_progress->updateProgress(
+            static_cast<int>(45.0 * static_cast<double>(progress) /
+                             static_cast<double>(segments.size()) + 55.0));
+      }
+      if (segmentSurfaces[j]->vertices().size() == 0) continue;
+      atb::BlitzIndexT i = segments[j] - 1;
+      addSegmentMarker(
+          *segmentSurfaces[j], p_dialog, p_markerChannel, label(i),
+          positionUm(i),
+          static_cast<double>(volumePx(i)) * blitz::product(elSize),
+          blitz::TinyVector<double,3>(0.0));
+    }
+    return;
+  }
+
   int currentSegment = 1;
 #ifdef _OPENMP
 #pragma omp parallel for
@@ -220,31 +317,10 @@ void ConvertMasksToMarkersWorker::run()
     if (surface.vertices().size() == 0 ||
         (p_progress != NULL && p_progress->isAborted())) continue;
 
-    // Simplify surface
-    atb::MarchingCubes::simplifyMesh(surface, p_dialog->simplifyToleranceUm3());
-    surface.computeDefaultNormals();
-    if (p_progress != NULL && p_progress->isAborted()) continue;
-
-    // Prepare marker
-    SurfaceMarker *marker;
-    if (p_markerChannel->markerType() == Marker::Surface)
-        marker = new SurfaceMarker(positionUm(i), &surface);
-    else marker = new CellMarker(positionUm(i), &surface);
-    marker->setLabel(label(i));
-    if (marker->inherits(Marker::Cell))
-    {
-      static_cast<CellMarker*>(marker)->setVolumeUm3(
-          static_cast<double>(volumePx(i)) * blitz::product(elSize));
-    }
-
-    for (size_t j = 0; j < marker->vertices().size(); ++j)
-        marker->vertices()[j] += blitz::TinyVector<float,3>(
-            blitz::TinyVector<double,3>(lb(i) - 1) *
-            elSize - positionUm(i));
-#ifdef _OPENMP
-#pragma omp critical
-#endif
-    p_markerChannel->addMarker(marker);
+    addSegmentMarker(
+        surface, p_dialog, p_markerChannel, label(i), positionUm(i),
+        static_cast<double>(volumePx(i)) * blitz::product(elSize),
+        blitz::TinyVector<double,3>(lb(i) - 1) * elSize);
   }
 }
 
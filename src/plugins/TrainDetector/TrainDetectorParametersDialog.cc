@@ -51,6 +51,9 @@ TrainDetectorParametersDialog::TrainDetectorParametersDialog(
   trainFileListHeader->setText(1, tr("Data channel"));
   trainFileListHeader->setText(2, tr("Annotation Channel"));
   trainFileListHeader->setText(3, tr("Cache file"));
+  trainFileListHeader->setToolTip(
+      3, tr("Only the scaled data is read from and written to the cache "
+            "file, the features are evaluated at the sample positions"));
   p_trainFileList->setHeaderItem(trainFileListHeader);
   p_trainFileList->setSelectionMode(QAbstractItemView::NoSelection);
   parameterLayout->addWidget(p_trainFileList);
@@ -64,6 +67,13 @@ TrainDetectorParametersDialog::TrainDetectorParametersDialog(
       new StringControlElement(tr("Feature Group:"), "/features");
   parameterLayout->addWidget(p_featureGroupControlElement);
 
+  p_sampleFileNameControlElement = new FileNameSelectionControlElement(
+      tr("Sample File:"), "", false, "HDF5 (*.h5)");
+  p_sampleFileNameControlElement->setToolTip(
+      tr("If given, the extracted training samples are stored to this file "
+         "and reused when training is restarted"));
+  parameterLayout->addWidget(p_sampleFileNameControlElement);
+
   QStringList options;
   options << iRoCS::Features::normalizationTypeToString(
       iRoCS::Features::None).c_str()
@@ -110,6 +120,12 @@ TrainDetectorParametersDialog::TrainDetectorParametersDialog(
   p_gammaControlElement = new DoubleControlElement(tr("gamma:"), 0.01);
   p_gammaControlElement->setRange(0.0, std::numeric_limits<double>::infinity());
   kernelParameterGroupLayout->addWidget(p_gammaControlElement);
+  p_cascadeRecallControlElement = new DoubleControlElement(
+      tr("Cascade recall:"), 0.995);
+  p_cascadeRecallControlElement->setRange(0.0, 1.0);
+  p_cascadeRecallControlElement->setSingleStep(0.001);
+  p_cascadeRecallControlElement->setSpecialValueText(tr("No cascade"));
+  kernelParameterGroupLayout->addWidget(p_cascadeRecallControlElement);
   parameterLayout->addWidget(kernelParameterGroup);
 
   parameterPanel->setLayout(parameterLayout);
@@ -136,6 +152,9 @@ TrainDetectorParametersDialog::TrainDetectorParametersDialog(
       settings.value("iRoCSPipeline/TrainDetector/nInRootSamples", 0).toInt());
   p_nOutRootSamplesControlElement->setValue(
       settings.value("iRoCSPipeline/TrainDetector/nOutRootSamples", 0).toInt());
+  p_sampleFileNameControlElement->setValue(
+      settings.value("iRoCSPipeline/TrainDetector/sampleFileName",
+                     "").toString().toStdString());
   p_modelFileNameControlElement->setValue(
       settings.value("iRoCSPipeline/DetectorModel",
                      "detector_model.h5").toString().toStdString());
@@ -151,8 +170,16 @@ TrainDetectorParametersDialog::TrainDetectorParametersDialog(
       settings.value("iRoCSPipeline/TrainDetector/cost", 10.0).toDouble());
   p_gammaControlElement->setValue(
       settings.value("iRoCSPipeline/TrainDetector/gamma", 0.01).toDouble());  
+  p_cascadeRecallControlElement->setValue(
+      settings.value(
+          "iRoCSPipeline/TrainDetector/cascadeRecall", 0.995).toDouble());
 
   setLayout(mainLayout);
+
+  std::cout << "Plugin runs with memory limit of "
+            << p_mainWidget->memoryLimit() / 1024 / 1024 << " MB"
+            << std::endl;
+  setMemoryLimit(p_mainWidget->memoryLimit());
 }
 
 TrainDetectorParametersDialog::~TrainDetectorParametersDialog()
@@ -218,6 +245,16 @@ std::string TrainDetectorParametersDialog::modelFileName() const
   return p_modelFileNameControlElement->value();
 }
 
+void TrainDetectorParametersDialog::setSampleFileName(std::string const &name)
+{
+  p_sampleFileNameControlElement->setValue(name);
+}
+
+std::string TrainDetectorParametersDialog::sampleFileName() const
+{
+  return p_sampleFileNameControlElement->value();
+}
+
 void TrainDetectorParametersDialog::setSdFeatureNormalization(
     iRoCS::Features::NormalizationType normType)
 {
@@ -264,6 +301,16 @@ double TrainDetectorParametersDialog::gamma() const
   return p_gammaControlElement->value();
 }
 
+void TrainDetectorParametersDialog::setCascadeRecall(double recall)
+{
+  p_cascadeRecallControlElement->setValue(recall);
+}
+
+double TrainDetectorParametersDialog::cascadeRecall() const
+{
+  return p_cascadeRecallControlElement->value();
+}
+
 void TrainDetectorParametersDialog::checkAndAccept()
 {
   // Check input files
@@ -361,6 +408,8 @@ void TrainDetectorParametersDialog::checkAndAccept()
       "iRoCSPipeline/TrainDetector/nInRootSamples", nInRootSamples());
   settings.setValue(
       "iRoCSPipeline/TrainDetector/nOutRootSamples", nOutRootSamples());
+  settings.setValue(
+      "iRoCSPipeline/TrainDetector/sampleFileName", sampleFileName().c_str());
   settings.setValue("iRoCSPipeline/DetectorModel", modelFileName().c_str());
   settings.setValue(
       "iRoCSPipeline/TrainDetector/sdNormalization",
@@ -370,6 +419,8 @@ void TrainDetectorParametersDialog::checkAndAccept()
       int(houghFeatureNormalization()));  
   settings.setValue("iRoCSPipeline/TrainDetector/cost", cost());
   settings.setValue("iRoCSPipeline/TrainDetector/gamma", gamma());  
+  settings.setValue(
+      "iRoCSPipeline/TrainDetector/cascadeRecall", cascadeRecall());
 
   accept();
 }
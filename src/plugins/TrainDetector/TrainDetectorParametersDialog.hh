@@ -73,6 +73,9 @@ public:
   void setModelFileName(std::string const &name);
   std::string modelFileName() const;
 
+  void setSampleFileName(std::string const &name);
+  std::string sampleFileName() const;
+
   void setSdFeatureNormalization(iRoCS::Features::NormalizationType normType);
   iRoCS::Features::NormalizationType sdFeatureNormalization() const;
 
@@ -86,6 +89,9 @@ public:
   void setGamma(double gamma);
   double gamma() const;
 
+  void setCascadeRecall(double recall);
+  double cascadeRecall() const;
+
 private slots:
   
   void checkAndAccept();
@@ -101,11 +107,13 @@ private:
   QGroupBox* p_randomSamplesGroup;
   IntControlElement* p_nInRootSamplesControlElement;
   IntControlElement* p_nOutRootSamplesControlElement;
+  FileNameSelectionControlElement* p_sampleFileNameControlElement;
   FileNameSelectionControlElement* p_modelFileNameControlElement;
   StringSelectionControlElement *p_sdNormalizationControl;
   StringSelectionControlElement *p_houghNormalizationControl;
   DoubleControlElement* p_costControlElement;
   DoubleControlElement* p_gammaControlElement;
+  DoubleControlElement* p_cascadeRecallControlElement;
   
 };
 
@@ -30,6 +30,7 @@
 #include <libBlitzHdf5/BlitzHdf5Light.hh>
 
 #include <libArrayToolbox/Normalization.hh>
+#include <libArrayToolbox/SeparableResampler.hh>
 #include <libArrayToolbox/algo/lParallel.hh>
 
 #include <libIRoCS/AttachIRoCSSCTToCellSegmentationWorker.hh>
@@ -300,7 +301,7 @@ int main(int argc, char *argv[])
       {
         pr.updateProgressMessage(
             "Rescaling image data to processing resolution");
-        data.rescale(r->elementSizeUm());
+        data.rescale(r->elementSizeUm(), atb::LinearRK);
       }
       if (blitz::any(data.shape() != r->shape()))
       {
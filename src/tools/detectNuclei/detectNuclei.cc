@@ -31,6 +31,9 @@
 
 #include <libProgressReporter/ProgressReporterStream.hh>
 
+#include <libBaseFunctions/BaseTrace.hh>
+#include <libBaseFunctions/BaseEnvironment.hh>
+
 class CmdLineVersionError: public CmdLineError {};
 class CmdLineLicenseError: public CmdLineError {};
 
@@ -72,6 +75,22 @@ int main(int argc, char **argv)
       "the feature vectors is restricted to the given amount. This leads to "
       "chunked classification and feature recomputation for each chunk.");
 
+  CmdArgSwitch noCascade(
+      0, "noCascade", "If this flag is given the early-reject stage of the "
+      "detector model (if any) is not used and all voxels are classified "
+      "using the full SVM.");
+  CmdArgType<int> nValidationSamples(
+      0, "cascadeValidationSamples", "<non-negative integer>",
+      "The number of voxels rejected by the cascade stage that are "
+      "additionally classified using the full SVM to estimate the recall "
+      "loss of the cascade.");
+  nValidationSamples.setDefaultValue(1000);
+  CmdArgType<std::string> traceFileName(
+      0, "trace", "<json file>", "If given, the time spent in the processing "
+      "stages is recorded. A summary table is printed after detection and "
+      "the full trace is written to the given file in Chrome trace event "
+      "format (view with chrome://tracing or https://ui.perfetto.dev).");
+
   CmdLine cmd(argv[0], "Nucleus detector");
   cmd.description("Detect cell nuclei in an hdf5 dataset of an Arabidopsis "
                   "root tip");
@@ -88,6 +107,9 @@ int main(int argc, char **argv)
     cmd.append(&modelFileName);
     cmd.append(&outFileName);
     cmd.append(&memoryLimit);
+    cmd.append(&noCascade);
+    cmd.append(&nValidationSamples);
+    cmd.append(&traceFileName);
     
     ArgvIter argvIter(--argc, ++argv);
     cmd.parse(argvIter);
@@ -95,35 +117,13 @@ int main(int argc, char **argv)
     size_t mem = 0;
     if (memoryLimit.given())
     {
-      if (memoryLimit.value().find_last_of("0123456789") ==
-          memoryLimit.value().size() - 1)
-          mem = atoi(memoryLimit.value().c_str());
-      else
-      {
-        mem = atoi(memoryLimit.value().substr(
-                       0, memoryLimit.value().size() - 1).c_str());
-        char unit = memoryLimit.value()[memoryLimit.value().size() - 1];
-        switch(unit){
-        case 'k' :
-        case 'K' :
-          mem *= 1024;
-          break;
-        case 'm' :
-        case 'M' :
-          mem *= 1024 * 1024;
-          break;
-        case 'g' :
-        case 'G' :
-          mem *= 1024 * 1024 * 1024;
-          break;
-        default :
-          break;
-        }
-      }
+      mem = BaseEnvironment::ParseMemorySize(memoryLimit.value());
     }
 
     iRoCS::ProgressReporterStream pr(std::cout, 0, 0, 100, "\r ");
 
+    if (traceFileName.given()) BaseTrace::Enable();
+
     /*---------------------------------------------------------------------
      *  Load data channel
      *---------------------------------------------------------------------*/
@@ -150,8 +150,19 @@ int main(int argc, char **argv)
      *  Run detector
      *---------------------------------------------------------------------*/
     iRoCS::detectNuclei(
-        data, nuclei, modelFileName.value(), mem, cacheFileName.value(), &pr);
+        data, nuclei, modelFileName.value(), mem, cacheFileName.value(), &pr,
+        !noCascade.given(), nValidationSamples.value());
     if (pr.isAborted()) return -1;
+
+    if (traceFileName.given())
+    {
+      BaseTrace::Enable(false);
+      std::cout << std::endl;
+      BaseTrace::WriteSummary(std::cout);
+      if (!BaseTrace::WriteChromeTrace(traceFileName.value()))
+          std::cerr << "Could not write trace to '" << traceFileName.value()
+                    << "'" << std::endl;
+    }
     
     /*---------------------------------------------------------------------
      *  Save Annotation channel
@@ -79,6 +79,11 @@ int main(int argc, char **argv)
       "The standard deviation of the post-smoothing filter in micrometers. "
       "This filter collects the responses in the filter area.");
   postSmoothingSigmaUm.setDefaultValue(0.0);
+  CmdArgSwitch useScaleSpace(
+      0, "useScaleSpace", "Compute pre- and post-smoothing with the shared "
+      "kernels of a Gaussian scale space. Its kernels are normalized and "
+      "truncated at seven standard deviations, so results differ slightly "
+      "from the default Gaussian filter.");
   CmdArgType<double> minMagnitude(
       0, "minMagnitude", "<double>",
       "Only gradients with magnitude above this threshold may cast votes. The "
@@ -118,6 +123,7 @@ int main(int argc, char **argv)
     cmd.append(&rStepUm);
     cmd.append(&preSmoothingSigmaUm);
     cmd.append(&postSmoothingSigmaUm);
+    cmd.append(&useScaleSpace);
     cmd.append(&minMagnitude);
     cmd.append(&invertGradients);
     cmd.append(&gamma);
@@ -167,7 +173,7 @@ int main(int argc, char **argv)
         blitz::TinyVector<double,2>(rMinUm.value(), rMaxUm.value()),
         rStepUm.value(), preSmoothingSigmaUm.value(),
         postSmoothingSigmaUm.value(), minMagnitude.value(),
-        invertGradients.given(), gamma.value(), &pr);
+        invertGradients.given(), gamma.value(), &pr, useScaleSpace.given());
     if (pr.isAborted()) return -1;
     
     /*---------------------------------------------------------------------
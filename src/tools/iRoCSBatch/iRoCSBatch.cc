@@ -0,0 +1,886 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2015 Thorsten Falk
+ *
+ *        Image Analysis Lab, University of Freiburg, Germany
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+ *
+ **************************************************************************/
+
+/*
+ * iRoCSBatch processes jobs dropped into a spool directory. Running the
+ * tools in one long-lived process keeps the SVM models (SVMModelRegistry),
+ * the FFTW wisdom and plans and the OpenMP thread pool warm between jobs.
+ *
+ * Spool layout:
+ *
+ *   <spool>/incoming/<name>.job  Job descriptions waiting to be processed
+ *   <spool>/running/<name>.job   Jobs currently processed. The progress is
+ *                                written to <name>.log. Creating
+ *                                <name>.cancel aborts the job.
+ *   <spool>/done/<name>.{job,log}   Successfully finished jobs
+ *   <spool>/failed/<name>.{job,log} Failed or cancelled jobs
+ *   <spool>/stop                 Finish running jobs and quit
+ *
+ * A job description contains one "key = value" pair per line. Lines
+ * starting with '#' are ignored. The key "tool" selects one of
+ * detectNuclei, labelEpidermis, assignLayers, attachIRoCS or segmentCells,
+ * "input" is the hdf5 file to process. All other keys are the long
+ * option names of the corresponding command line tool, switches take the
+ * values true/false. Additionally "memory" overrides the memory estimate
+ * used for scheduling.
+ *
+ * To move a job into the spool atomically, write it to a temporary name
+ * not ending in ".job" within incoming/ and rename it afterwards.
+ */
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <libcmdline/CmdLine.hh>
+#include <libcmdline/ArgvIter.hh>
+
+#include <libIRoCS/DetectNucleiWorker.hh>
+#include <libIRoCS/EpidermisLabellingWorker.hh>
+#include <libIRoCS/LayerAssignmentWorker.hh>
+#include <libIRoCS/AttachIRoCSWorker.hh>
+#include <libIRoCS/RootSegmentationWorker.hh>
+
+#include <libArrayToolbox/iRoCS.hh>
+#include <libArrayToolbox/ATBTiming.hh>
+
+#include <libBlitzFFTW/BlitzFFTW.hh>
+
+#include <libProgressReporter/ProgressReporterStream.hh>
+
+#include <libBaseFunctions/BaseFile.hh>
+#include <libBaseFunctions/BaseEnvironment.hh>
+
+class CmdLineVersionError: public CmdLineError {};
+class CmdLineLicenseError: public CmdLineError {};
+
+struct BatchJob
+{
+  std::string name;
+  std::map<std::string,std::string> parameters;
+  size_t memory;
+};
+
+// Memory estimates of queued jobs by job file name together with the
+// modification time of the job file they were computed for
+typedef std::map<std::string,std::pair<time_t,size_t> > MemoryEstimateCache;
+
+/*======================================================================*/
+/*!
+ *   Progress reporter writing to the job log. It aborts the job as soon
+ *   as a cancel file appears and keeps the error message of
+ *   abortWithError() for the job summary.
+ */
+/*======================================================================*/
+class SpoolProgressReporter : public iRoCS::ProgressReporterStream
+{
+
+public:
+
+  SpoolProgressReporter(std::ostream &os, std::string const &cancelFileName)
+          : iRoCS::ProgressReporterStream(os, 0, 0, 100, "\n "),
+            _log(os), _cancelFileName(cancelFileName)
+  {}
+
+  ~SpoolProgressReporter()
+  {}
+
+  void abortWithError(std::string const &msg)
+  {
+#ifdef _OPENMP
+#pragma omp critical (_ABORTED_IS_CURRENTLY_UPDATING_)
+#endif
+    {
+      _errorMessage = msg;
+      _log << std::endl << "Error: " << msg << std::endl;
+    }
+    setAborted(true);
+  }
+
+  bool updateProgress(int progress)
+  {
+    // Only check for the cancel file when the progress changes, progress
+    // updates may be issued per voxel
+    if (progress != this->progress() && BaseFile::Exists(_cancelFileName))
+        abort();
+    return iRoCS::ProgressReporterStream::updateProgress(progress);
+  }
+
+  std::string const &errorMessage() const
+  {
+    return _errorMessage;
+  }
+
+private:
+
+  std::ostream &_log;
+  std::string _cancelFileName;
+  std::string _errorMessage;
+
+};
+
+static void sleepMs(int ms)
+{
+#if defined(_WIN32) || defined(_WIN64)
+  Sleep(ms);
+#else
+  usleep(1000 * ms);
+#endif
+}
+
+static std::string trim(std::string const &s)
+{
+  size_t start = s.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos) return "";
+  size_t end = s.find_last_not_of(" \t\r\n");
+  return s.substr(start, end - start + 1);
+}
+
+static bool endsWith(std::string const &s, std::string const &suffix)
+{
+  return s.size() >= suffix.size() &&
+      s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string prettyMemory(size_t bytes)
+{
+  std::stringstream out;
+  out.precision(3);
+  if (bytes >= static_cast<size_t>(1024 * 1024 * 1024))
+      out << static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0) << " GB";
+  else out << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MB";
+  return out.str();
+}
+
+static std::string parameter(
+    BatchJob const &job, std::string const &key,
+    std::string const &defaultValue = "")
+{
+  std::map<std::string,std::string>::const_iterator it =
+      job.parameters.find(key);
+  return (it != job.parameters.end()) ? it->second : defaultValue;
+}
+
+static bool switchParameter(BatchJob const &job, std::string const &key)
+{
+  std::string value = parameter(job, key, "false");
+  return value == "true" || value == "yes" || value == "on" || value == "1";
+}
+
+static double doubleParameter(
+    BatchJob const &job, std::string const &key, double defaultValue)
+{
+  std::string value = parameter(job, key);
+  return value.empty() ? defaultValue : atof(value.c_str());
+}
+
+static int intParameter(
+    BatchJob const &job, std::string const &key, int defaultValue)
+{
+  std::string value = parameter(job, key);
+  return value.empty() ? defaultValue : atoi(value.c_str());
+}
+
+/*======================================================================*/
+/*!
+ *   Read and validate a job description. Throws std::runtime_error if
+ *   the job cannot be processed.
+ */
+/*======================================================================*/
+static void readJob(std::string const &fileName, BatchJob &job)
+{
+  std::ifstream in(fileName.c_str());
+  if (!in.good())
+      throw std::runtime_error("Could not open '" + fileName + "'");
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(in, line))
+  {
+    ++lineNumber;
+    line = trim(line);
+    if (line.empty() || line[0] == '#') continue;
+    size_t separator = line.find('=');
+    if (separator == std::string::npos)
+    {
+      std::stringstream msg;
+      msg << fileName << ":" << lineNumber << ": Expected 'key = value'";
+      throw std::runtime_error(msg.str());
+    }
+    job.parameters[trim(line.substr(0, separator))] =
+        trim(line.substr(separator + 1));
+  }
+
+  // Keys allowed for all tools
+  std::set<std::string> allowed;
+  allowed.insert("tool");
+  allowed.insert("input");
+  allowed.insert("outfile");
+  allowed.insert("memory");
+  allowed.insert("nuclei");
+
+  std::string tool = parameter(job, "tool");
+  if (tool == "detectNuclei" || tool == "labelEpidermis" ||
+      tool == "assignLayers")
+  {
+    allowed.insert("dataset");
+    allowed.insert("model");
+    allowed.insert("cache");
+    if (tool == "detectNuclei")
+    {
+      allowed.insert("memoryLimit");
+      allowed.insert("noCascade");
+      allowed.insert("cascadeValidationSamples");
+    }
+    else
+    {
+      allowed.insert("outgroup");
+      allowed.insert("forceFeatureComputation");
+    }
+    if (tool == "assignLayers")
+    {
+      allowed.insert("axis");
+      allowed.insert("updateMitoses");
+      allowed.insert("cacheCoordinates");
+    }
+  }
+  else if (tool == "attachIRoCS")
+  {
+    allowed.insert("qc");
+    allowed.insert("axis");
+    allowed.insert("nIterations");
+    allowed.insert("kappa");
+    allowed.insert("lambda");
+    allowed.insert("mu");
+    allowed.insert("tau");
+    allowed.insert("searchRadius_um");
+  }
+  else if (tool == "segmentCells")
+  {
+    allowed.insert("dataset");
+    allowed.insert("outDataset");
+    allowed.insert("debugfile");
+    allowed.insert("processingElementSizeUm");
+    allowed.insert("useScaleSpace");
+    allowed.insert("normalizationType");
+    allowed.insert("gamma");
+    allowed.insert("medianWidthPx");
+    allowed.insert("varianceNormalizationSigmaUm");
+    allowed.insert("epsilon");
+    allowed.insert("applyDiffusion");
+    allowed.insert("kappa");
+    allowed.insert("tau");
+    allowed.insert("zCompensationFactor");
+    allowed.insert("nDiffusionIterations");
+    allowed.insert("hessianSigmaUm");
+    allowed.insert("edgeThreshold");
+    allowed.insert("boundaryThicknessPx");
+    allowed.insert("minimumCellVolumeUm3");
+  }
+  else throw std::runtime_error("Unknown tool '" + tool + "'");
+
+  for (std::map<std::string,std::string>::const_iterator it =
+           job.parameters.begin(); it != job.parameters.end(); ++it)
+  {
+    if (allowed.find(it->first) == allowed.end())
+        throw std::runtime_error(
+            "Parameter '" + it->first + "' is not supported by " + tool);
+  }
+  if (parameter(job, "input").empty())
+      throw std::runtime_error("No input file given");
+  if (tool == "segmentCells")
+  {
+    if (parameter(job, "dataset").empty())
+        throw std::runtime_error(tool + " needs a dataset");
+    int normalizationType = intParameter(job, "normalizationType", 2);
+    if (normalizationType < 0 || normalizationType > 3)
+        throw std::runtime_error(
+            "'normalizationType' must be one of 0, 1, 2, 3");
+  }
+  else if (tool != "attachIRoCS" &&
+           (parameter(job, "dataset").empty() ||
+            parameter(job, "model").empty()))
+      throw std::runtime_error(tool + " needs a dataset and a model");
+}
+
+/*======================================================================*/
+/*!
+ *   Rough peak memory estimate of a job for scheduling. The voxelwise
+ *   tools hold the raw data plus feature volumes of the same size, the
+ *   axis fit only works on the nucleus list. The cell segmentation keeps
+ *   the Hessian, the diffusion tensor and the watershed state, rescaling
+ *   to a finer processing element size is not accounted for.
+ */
+/*======================================================================*/
+static size_t estimateMemory(BatchJob const &job)
+{
+  if (!parameter(job, "memory").empty())
+      return BaseEnvironment::ParseMemorySize(parameter(job, "memory"));
+
+  std::string tool = parameter(job, "tool");
+  if (tool == "attachIRoCS") return 256 * 1024 * 1024;
+
+  BlitzH5File inFile(parameter(job, "input"));
+  std::vector<hsize_t> shape(inFile.getDatasetShape(parameter(job, "dataset")));
+  size_t volumeBytes = sizeof(double);
+  for (size_t d = 0; d < shape.size(); ++d)
+      volumeBytes *= static_cast<size_t>(shape[d]);
+  if (tool == "detectNuclei")
+  {
+    if (!parameter(job, "memoryLimit").empty())
+        return 4 * volumeBytes +
+            BaseEnvironment::ParseMemorySize(parameter(job, "memoryLimit"));
+    return 16 * volumeBytes;
+  }
+  if (tool == "segmentCells") return 16 * volumeBytes;
+  return 8 * volumeBytes;
+}
+
+static void runJob(BatchJob const &job, SpoolProgressReporter &pr)
+{
+  std::string tool = parameter(job, "tool");
+  std::string inFileName = parameter(job, "input");
+  std::string outFileName = parameter(job, "outfile", inFileName);
+  std::string annotationName =
+      parameter(job, "nuclei", "/annotation/detector");
+
+  if (tool == "attachIRoCS")
+  {
+    std::string qcName = parameter(job, "qc", "/annotation/qc");
+    std::string axisName = parameter(job, "axis", "/annotation/axis");
+    pr.updateProgressMessage(
+        "Loading '" + inFileName + ":" + annotationName + "'");
+    std::vector<atb::Nucleus> nuclei;
+    atb::Nucleus::loadList(nuclei, inFileName, annotationName);
+    pr.updateProgressMessage("Loading '" + inFileName + ":" + qcName + "'");
+    std::vector<atb::Nucleus> qcMarkers;
+    atb::Nucleus::loadList(qcMarkers, inFileName, qcName);
+    if (qcMarkers.size() == 0)
+        throw std::runtime_error(
+            "No QC marker found in '" + inFileName + ":" + qcName + "'");
+    atb::IRoCS rct(&pr);
+    iRoCS::attachIRoCS(
+        rct, nuclei, qcMarkers[0].positionUm(),
+        doubleParameter(job, "kappa", 1.0),
+        doubleParameter(job, "lambda", 0.0), doubleParameter(job, "mu", 0.0),
+        doubleParameter(job, "searchRadius_um", -1.0),
+        intParameter(job, "nIterations", 1000000),
+        doubleParameter(job, "tau", 0.1), &pr);
+    if (pr.isAborted()) return;
+    pr.updateProgressMessage("Saving '" + outFileName + ":" + axisName + "'");
+    rct.save(outFileName, axisName);
+    pr.updateProgressMessage(
+        "Saving '" + inFileName + ":" + annotationName + "'");
+    atb::Nucleus::saveList(nuclei, inFileName, annotationName);
+    return;
+  }
+
+  std::string datasetName = parameter(job, "dataset");
+  atb::Array<double,3> data;
+  pr.updateProgressMessage(
+      "Loading '" + inFileName + ":" + datasetName + "'");
+  data.load(inFileName, datasetName, &pr);
+
+  if (tool == "segmentCells")
+  {
+    std::string outDatasetName =
+        parameter(job, "outDataset", "/segmentation/cellularMasks");
+    atb::Array<int,3> segmentation;
+    iRoCS::segmentCells(
+        data, segmentation, doubleParameter(job, "gamma", 1.0),
+        intParameter(job, "normalizationType", 2),
+        intParameter(job, "medianWidthPx", 0),
+        doubleParameter(job, "processingElementSizeUm", 0.0),
+        doubleParameter(job, "varianceNormalizationSigmaUm", 20.0),
+        doubleParameter(job, "epsilon", 1.0),
+        static_cast<float>(doubleParameter(job, "hessianSigmaUm", 0.0)),
+        switchParameter(job, "applyDiffusion"),
+        intParameter(job, "nDiffusionIterations", 10),
+        static_cast<float>(doubleParameter(job, "zCompensationFactor", 1.0)),
+        doubleParameter(job, "kappa", 0.2),
+        static_cast<float>(doubleParameter(job, "tau", 0.0625)),
+        static_cast<float>(doubleParameter(job, "edgeThreshold", -0.2)),
+        static_cast<float>(doubleParameter(job, "minimumCellVolumeUm3", 60.0)),
+        intParameter(job, "boundaryThicknessPx", 0),
+        parameter(job, "debugfile"), &pr,
+        switchParameter(job, "useScaleSpace"));
+    if (pr.isAborted()) return;
+    pr.updateProgressMessage(
+        "Saving '" + outFileName + ":" + outDatasetName + "'");
+    segmentation.save(outFileName, outDatasetName, 1, &pr);
+    return;
+  }
+
+  std::vector<atb::Nucleus> nuclei;
+  if (tool == "detectNuclei")
+  {
+    size_t mem = parameter(job, "memoryLimit").empty() ?
+        0 : BaseEnvironment::ParseMemorySize(parameter(job, "memoryLimit"));
+    iRoCS::detectNuclei(
+        data, nuclei, parameter(job, "model"), mem, parameter(job, "cache"),
+        &pr, !switchParameter(job, "noCascade"),
+        intParameter(job, "cascadeValidationSamples", 1000));
+    if (pr.isAborted()) return;
+    pr.updateProgressMessage(
+        "Saving '" + outFileName + ":" + annotationName + "'");
+    atb::Nucleus::saveList(nuclei, outFileName, annotationName);
+    return;
+  }
+
+  pr.updateProgressMessage(
+      "Loading '" + inFileName + ":" + annotationName + "'");
+  atb::Nucleus::loadList(nuclei, inFileName, annotationName);
+  if (tool == "labelEpidermis")
+  {
+    iRoCS::labelEpidermis(
+        data, nuclei, parameter(job, "model"), parameter(job, "cache"),
+        switchParameter(job, "forceFeatureComputation"), &pr);
+  }
+  else
+  {
+    std::string axisName = parameter(job, "axis", "/annotation/axis");
+    pr.updateProgressMessage("Loading '" + inFileName + ":" + axisName + "'");
+    atb::IRoCS rct;
+    rct.load(inFileName, axisName);
+    pr.updateProgressMessage("Starting layer assignment");
+    iRoCS::assignLayers(
+        data, nuclei, rct, parameter(job, "model"), parameter(job, "cache"),
+        switchParameter(job, "updateMitoses"),
+        switchParameter(job, "cacheCoordinates"),
+        switchParameter(job, "forceFeatureComputation"), &pr);
+  }
+  if (pr.isAborted()) return;
+  std::string outGroup = parameter(job, "outgroup", annotationName);
+  pr.updateProgressMessage("Saving '" + outFileName + ":" + outGroup + "'");
+  atb::Nucleus::saveList(nuclei, outFileName, outGroup);
+}
+
+static void report(std::string const &message)
+{
+#ifdef _OPENMP
+#pragma omp critical (iRoCSBatchConsole)
+#endif
+  std::cout << atb::MyDateTime::prettyDate() << "  " << message << std::endl;
+}
+
+/*======================================================================*/
+/*!
+ *   Move a job that could not be started to failed/ and record the
+ *   reason in its log.
+ */
+/*======================================================================*/
+static void rejectJob(
+    std::string const &spool, std::string const &name,
+    std::string const &reason)
+{
+  BaseFile::Move(spool + "/incoming/" + name + ".job",
+                 spool + "/failed/" + name + ".job");
+  std::string logFileName(spool + "/failed/" + name + ".log");
+  std::ofstream log(logFileName.c_str());
+  log << "Error: " << reason << std::endl;
+  report("Rejected " + name + ": " + reason);
+}
+
+enum ClaimResult { JobClaimed, NoJobFits, QueueEmpty };
+
+/*======================================================================*/
+/*!
+ *   Claim the first queued job that fits into the remaining memory
+ *   budget by moving it to running/. Smaller jobs further down the queue
+ *   may overtake a job that does not fit. If nothing runs, the first job
+ *   is started regardless of its estimate, otherwise it would never run.
+ *   Estimates are kept in the given cache until the job leaves the queue
+ *   or its job file changes, so waiting jobs are not re-examined on every
+ *   poll. Must be called within the iRoCSBatchQueue critical section.
+ */
+/*======================================================================*/
+static ClaimResult claimJob(
+    std::string const &spool, size_t memoryBudget, size_t memoryInUse,
+    int nRunning, MemoryEstimateCache &estimates, BatchJob &job)
+{
+  std::vector<std::string> files;
+  BaseFile::ListDir(spool + "/incoming", files, "*.job");
+  std::sort(files.begin(), files.end());
+  bool pending = false;
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    if (!endsWith(files[i], ".job")) continue;
+    std::string name = BaseFile::BaseName(files[i]);
+    name = name.substr(0, name.size() - 4);
+
+    BatchJob candidate;
+    candidate.name = name;
+    time_t modified = BaseFile::ModificationTime(files[i]);
+    try
+    {
+      readJob(files[i], candidate);
+      MemoryEstimateCache::const_iterator it = estimates.find(files[i]);
+      if (it != estimates.end() && it->second.first == modified)
+          candidate.memory = it->second.second;
+      else
+      {
+        candidate.memory = estimateMemory(candidate);
+        estimates[files[i]] = std::make_pair(modified, candidate.memory);
+      }
+    }
+    catch (std::exception &e)
+    {
+      estimates.erase(files[i]);
+      rejectJob(spool, name, e.what());
+      continue;
+    }
+
+    pending = true;
+    if (nRunning > 0 && memoryBudget > 0 &&
+        memoryInUse + candidate.memory > memoryBudget) continue;
+
+    estimates.erase(files[i]);
+    // Another daemon on the same spool may have been faster
+    if (!BaseFile::Move(files[i], spool + "/running/" + name + ".job"))
+        continue;
+    job = candidate;
+    return JobClaimed;
+  }
+  return pending ? NoJobFits : QueueEmpty;
+}
+
+/*======================================================================*/
+/*!
+ *   Move jobs that were left in running/ by a previous service instance
+ *   that did not shut down cleanly to failed/. They are not requeued,
+ *   because the job itself may have brought the service down.
+ */
+/*======================================================================*/
+static void recoverInterruptedJobs(std::string const &spool)
+{
+  std::vector<std::string> files;
+  BaseFile::ListDir(spool + "/running", files, "*.job");
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    if (!endsWith(files[i], ".job")) continue;
+    std::string name = BaseFile::BaseName(files[i]);
+    name = name.substr(0, name.size() - 4);
+    std::string running(spool + "/running/" + name);
+    std::string target(spool + "/failed/" + name);
+    if (!BaseFile::Move(running + ".job", target + ".job")) continue;
+    if (BaseFile::Exists(running + ".log"))
+        BaseFile::Move(running + ".log", target + ".log");
+    BaseFile::Remove(running + ".cancel");
+    std::ofstream log((target + ".log").c_str(), std::ios::app);
+    log << std::endl << "Interrupted: The batch service terminated while "
+        << "the job was running" << std::endl;
+    report("Recovered interrupted job " + name);
+  }
+}
+
+static void processJob(std::string const &spool, BatchJob const &job)
+{
+  std::string running(spool + "/running/" + job.name);
+  std::string logFileName(running + ".log");
+  std::ofstream log(logFileName.c_str());
+  log << "Job '" << job.name << "' started " << atb::MyDateTime::prettyDate()
+      << std::endl;
+  for (std::map<std::string,std::string>::const_iterator it =
+           job.parameters.begin(); it != job.parameters.end(); ++it)
+      log << "  " << it->first << " = " << it->second << std::endl;
+
+  report("Started " + job.name + " (" + parameter(job, "tool") + ", " +
+         prettyMemory(job.memory) + ")");
+
+  SpoolProgressReporter pr(log, running + ".cancel");
+  long long startTime = atb::MyDateTime::time_us();
+  std::string error;
+  try
+  {
+    runJob(job, pr);
+    if (pr.isAborted())
+        error = pr.errorMessage().empty() ? "Cancelled" : pr.errorMessage();
+  }
+  catch (std::exception &e)
+  {
+    error = e.what();
+  }
+  catch (...)
+  {
+    error = "Unknown error";
+  }
+
+  // Keep the plans computed for this job for later processes
+#ifdef _OPENMP
+#pragma omp critical (fftwplan)
+#endif
+  {
+    BlitzFFTW<double>::instance()->saveWisdom();
+    BlitzFFTW<float>::instance()->saveWisdom();
+  }
+
+  std::string elapsed(
+      atb::MyDateTime::prettyTime(atb::MyDateTime::time_us() - startTime));
+  std::string target;
+  if (error.empty())
+  {
+    log << std::endl << "Finished after " << elapsed << std::endl;
+    target = spool + "/done/" + job.name;
+    report("Finished " + job.name + " after " + elapsed);
+  }
+  else
+  {
+    log << std::endl << "Failed after " << elapsed << ": " << error
+        << std::endl;
+    target = spool + "/failed/" + job.name;
+    report("Failed " + job.name + ": " + error);
+  }
+  log.close();
+
+  BaseFile::Move(running + ".job", target + ".job");
+  BaseFile::Move(logFileName, target + ".log");
+  BaseFile::Remove(running + ".cancel");
+}
+
+int main(int argc, char **argv)
+{
+  CmdArgThrow<CmdLineVersionError> versionArg(
+      0, "version", "Display version information.");
+  CmdArgThrow<CmdLineLicenseError> licenseArg(
+      0, "license", "Display licensing information.");
+
+  CmdArgType<std::string> spoolDirName(
+      "<spool directory>",
+      "The directory to watch for job descriptions. The subdirectories "
+      "incoming, running, done and failed are created if necessary. Jobs are "
+      "submitted by moving a job file with extension .job into incoming.",
+      CmdArg::isREQ);
+  CmdArgType<int> nJobs(
+      'j', "jobs", "<positive integer>", "The maximum number of jobs to "
+      "process concurrently. The available threads are distributed evenly "
+      "among the jobs. Concurrent jobs require a thread-safe HDF5 library, "
+      "otherwise jobs are processed one after the other.");
+  nJobs.setDefaultValue(1);
+  CmdArgType<std::string> memoryLimit(
+      0, "memoryLimit", "[0-9]+[kKmMgG]*", "If given, jobs are only started "
+      "if the sum of the estimated memory requirements of all running jobs "
+      "stays below the given amount. A single job is always started, even "
+      "if it exceeds the limit.");
+  CmdArgType<int> pollInterval(
+      0, "pollInterval", "<milliseconds>", "The interval in which the spool "
+      "directory is checked for new jobs.");
+  pollInterval.setDefaultValue(2000);
+  CmdArgSwitch noRecovery(
+      0, "noRecovery", "Do not move jobs left in running/ by a terminated "
+      "service to failed/ at startup. Use this switch if several services "
+      "share the spool directory.");
+  CmdArgSwitch once(
+      0, "once", "Process all queued jobs and quit instead of waiting for "
+      "new jobs.");
+
+  CmdLine cmd(argv[0], "iRoCS batch service");
+  cmd.description("Process detectNuclei, labelEpidermis, assignLayers, "
+                  "attachIRoCS and segmentCells jobs from a spool directory "
+                  "within a single long-running process");
+
+  try
+  {
+    cmd.append(&versionArg);
+    cmd.append(&licenseArg);
+
+    cmd.append(&spoolDirName);
+    cmd.append(&nJobs);
+    cmd.append(&memoryLimit);
+    cmd.append(&pollInterval);
+    cmd.append(&noRecovery);
+    cmd.append(&once);
+
+    ArgvIter argvIter(--argc, ++argv);
+    cmd.parse(argvIter);
+
+    std::string spool(spoolDirName.value());
+    char const *subdirs[] = { "incoming", "running", "done", "failed" };
+    for (int i = 0; i < 4; ++i)
+    {
+      std::string dirName(spool + "/" + subdirs[i]);
+      if (!BaseFile::IsDirectory(dirName) &&
+          !BaseFile::DirectoryCreate(dirName))
+      {
+        std::cerr << "Could not create '" << dirName << "'" << std::endl;
+        exit(-2);
+      }
+    }
+
+    if (!noRecovery.given()) recoverInterruptedJobs(spool);
+
+    size_t memoryBudget = memoryLimit.given() ?
+        BaseEnvironment::ParseMemorySize(memoryLimit.value()) : 0;
+    int nSlots = std::max(1, nJobs.value());
+#ifndef H5_HAVE_THREADSAFE
+    if (nSlots > 1)
+    {
+      std::cerr << "The HDF5 library is not thread-safe, jobs will be "
+                << "processed sequentially" << std::endl;
+      nSlots = 1;
+    }
+#endif
+    int nThreadsPerJob = 1;
+#ifdef _OPENMP
+    nThreadsPerJob = std::max(1, omp_get_max_threads() / nSlots);
+    omp_set_max_active_levels(2);
+#else
+    nSlots = 1;
+#endif
+
+    // Load the FFTW wisdom once for the lifetime of the service
+    BlitzFFTW<double>::instance();
+    BlitzFFTW<float>::instance();
+
+    std::stringstream startMsg;
+    startMsg << "Watching '" << spool << "' with " << nSlots << " job slot(s) "
+             << "of " << nThreadsPerJob << " thread(s)";
+    if (memoryBudget > 0)
+        startMsg << ", memory limit " << prettyMemory(memoryBudget);
+    report(startMsg.str());
+
+    MemoryEstimateCache estimates;
+    size_t memoryInUse = 0;
+    int nRunning = 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nSlots)
+#endif
+    {
+#ifdef _OPENMP
+      omp_set_num_threads(nThreadsPerJob);
+#endif
+      while (true)
+      {
+        BatchJob job;
+        ClaimResult result = QueueEmpty;
+        bool quit = false;
+#ifdef _OPENMP
+#pragma omp critical (iRoCSBatchQueue)
+#endif
+        {
+          if (BaseFile::Exists(spool + "/stop")) quit = true;
+          else
+          {
+            result = claimJob(
+                spool, memoryBudget, memoryInUse, nRunning, estimates, job);
+            if (result == JobClaimed)
+            {
+              memoryInUse += job.memory;
+              ++nRunning;
+            }
+            else quit = once.given() && result == QueueEmpty;
+          }
+        }
+        if (quit) break;
+        if (result != JobClaimed)
+        {
+          sleepMs(pollInterval.value());
+          continue;
+        }
+
+        processJob(spool, job);
+
+#ifdef _OPENMP
+#pragma omp critical (iRoCSBatchQueue)
+#endif
+        {
+          memoryInUse -= job.memory;
+          --nRunning;
+        }
+      }
+    }
+
+    if (BaseFile::Exists(spool + "/stop")) BaseFile::Remove(spool + "/stop");
+    report("Stopped");
+  }
+  catch (CmdLineUsageError &e)
+  {
+    cmd.usage();
+    exit(-1);
+  }
+  catch (CmdLineVersionError e)
+  {
+    std::cout << PACKAGE_STRING << std::endl;
+    exit(0);
+  }
+  catch (CmdLineLicenseError e)
+  {
+    std::cout << PACKAGE_STRING << std::endl << std::endl
+              << "URL: " << PACKAGE_URL << std::endl << std::endl
+              << "Copyright (C) 2012-2015 Thorsten Falk ("
+              << PACKAGE_BUGREPORT << ")" << std::endl << std::endl
+              << "Address:" << std::endl
+              << "   Image Analysis Lab" << std::endl
+              << "   Albert-Ludwigs-Universitaet" << std::endl
+              << "   Georges-Koehler-Allee Geb. 52" << std::endl
+              << "   79110 Freiburg" << std::endl
+              << "   Germany" << std::endl << std::endl
+              << "This program is free software: you can redistribute it and/or"
+              << std::endl
+              << "modify it under the terms of the GNU General Public License"
+              << std::endl
+              << "Version 3 as published by the Free Software Foundation."
+              << std::endl << std::endl
+              << "This program is distributed in the hope that it will be "
+              << "useful," << std::endl
+              << "but WITHOUT ANY WARRANTY; without even the implied warranty "
+              << "of " << std::endl
+              << "MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the "
+              << std::endl
+              << "GNU General Public License for more details."
+              << std::endl << std::endl
+              << "You should have received a copy of the GNU General Public "
+              << "License" << std::endl
+              << "along with this program. If not, see " << std::endl
+              << "<http://www.gnu.org/licenses/>." << std::endl;
+    exit(0);
+  }
+  catch (CmdLineUsageHTMLError &e)
+  {
+    cmd.usageHTML(std::cout);
+    exit(-1);
+  }
+  catch (CmdLineUsageXMLError &e)
+  {
+    cmd.usageXML(std::cout);
+    exit(-1);
+  }
+  catch (CmdLineSyntaxError &e)
+  {
+    cmd.error() << e.str() << std::endl;
+    cmd.usage(std::cerr);
+    exit(-2);
+  }
+}
@@ -68,6 +68,11 @@ int main(int argc, char *argv[])
       "will be rescaled to cubic voxels with an edge length of the shortest "
       "edge length of the original dataset (maximum size increase).");
   processingElementSizeUm.setDefaultValue(0.0);
+  CmdArgSwitch useScaleSpace(
+      0, "useScaleSpace", "Compute all Gaussian smoothing steps with the "
+      "shared kernels of a Gaussian scale space. Its kernels are normalized "
+      "and truncated at seven standard deviations, so results differ "
+      "slightly from the default Gaussian filter.");
 
   // Pre-processing
   CmdArgType<int> normalizationType(
@@ -158,6 +163,7 @@ int main(int argc, char *argv[])
     cmd.append(&outDatasetName);
     cmd.append(&debugFileName);
     cmd.append(&processingElementSizeUm);
+    cmd.append(&useScaleSpace);
 
     cmd.append(&normalizationType);
     cmd.append(&gamma);
@@ -205,6 +211,8 @@ int main(int argc, char *argv[])
                   std::string("<none>")) << std::endl;
     std::cout << "processingElementSizeUm = " << processingElementSizeUm.value()
               << std::endl;
+    std::cout << "useScaleSpace = "
+              << (useScaleSpace.given() ? "<yes>" : "<no>") << std::endl;
 
     std::cout << "normalizationType = " << normalizationType.value()
               << std::endl;
@@ -261,7 +269,7 @@ int main(int argc, char *argv[])
         applyDiffusion.given(), nDiffusionIterations.value(),
         zCompensationFactor.value(), kappa.value(), tau.value(),
         edgeThreshold.value(), minimumVolumeUm3.value(),
-        boundaryThicknessPx.value(), debugFile, &pr);
+        boundaryThicknessPx.value(), debugFile, &pr, useScaleSpace.given());
 
     pr.updateProgressMessage(
         "Saving segmentation result to '" + ofName + ":" +
@@ -30,6 +30,8 @@
 
 #include <libIRoCS/AssignLayersToCellSegmentationWorker.hh>
 
+#include <libBaseFunctions/BaseEnvironment.hh>
+
 class CmdLineVersionError: public CmdLineError {};
 class CmdLineLicenseError: public CmdLineError {};
 
@@ -133,6 +135,12 @@ int main(int argc, char **argv)
       "The largest label used for training", CmdArg::isPOSVALREQ);
   labelRangeHigh.setDefaultValue(7);
 
+  CmdArgType<std::string> memoryLimit(
+      0, "memoryLimit", "[0-9]+[kKmMgG]*", "If given, the segmentations of "
+      "the input files are only processed concurrently as long as they fit "
+      "into the given amount of RAM. This is only used if '--computeFeatures' "
+      "is given.");
+
   CmdLine cmd(argv[0], "Random Forest cell shape -> class training");
 
   try
@@ -154,6 +162,7 @@ int main(int argc, char **argv)
     cmd.append(&labelDsName);
     cmd.append(&labelRangeLow);
     cmd.append(&labelRangeHigh);
+    cmd.append(&memoryLimit);
     cmd.description("Train a random forest on features extracted from "
                     "manually annotated cellular root segmentations");
     /*---------------------------------------------------------------------
@@ -229,6 +238,14 @@ int main(int argc, char **argv)
       std::cout << std::endl;
     }
 
+    ptrdiff_t mem = 0;
+    if (memoryLimit.given())
+    {
+      mem = static_cast<ptrdiff_t>(
+          BaseEnvironment::ParseMemorySize(memoryLimit.value()));
+      std::cout << "memoryLimit = " << memoryLimit.value() << std::endl;
+    }
+
     iRoCS::ProgressReporterStream pr(std::cout, 0, 0, 100, "\r   ");
     pr.setTaskProgressMin(0);
     pr.setTaskProgressMax(100);    
@@ -239,7 +256,7 @@ int main(int argc, char **argv)
         featureGroup.value(), featureDsNames, labelFileNames,
         labelDsName.value(), blitz::TinyVector<int,2>(
             labelRangeLow.value(), labelRangeHigh.value()),
-        computeFeaturesOnTheFly.given(), backgroundLabel.value(), &pr);
+        computeFeaturesOnTheFly.given(), backgroundLabel.value(), &pr, mem);
   }
   catch (CmdLineUsageError &e)
   {
@@ -0,0 +1,170 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/AnisotropicDiffusionFilter.hh>
+
+// Untiled reference implementation iterating over the full volume
+static void referenceDiffusion(
+    blitz::Array<double,3> const &data,
+    blitz::TinyVector<double,3> const &elementSizeUm,
+    double kappa, double sigmaUm, double tau, double zCorrection,
+    int nIterations, int hessianUpdateStepWidth,
+    blitz::Array<double,3> &result)
+{
+  blitz::Array<double,3> in(data.shape()), out(data.shape());
+  in = data;
+  blitz::Array<blitz::TinyVector<double,6>,3> D(data.shape());
+  for (int iter = 1; iter <= nIterations; ++iter)
+  {
+    if ((iter - 1) % hessianUpdateStepWidth == 0)
+    {
+      blitz::Array<double,3> tmp(in.shape());
+      atb::GaussianFilter<double,3> smoothingFilter(atb::RepeatBT);
+      smoothingFilter.setStandardDeviationUm(sigmaUm);
+      smoothingFilter.apply(in, elementSizeUm, tmp);
+      atb::CentralHessianUTFilter<double,3>(atb::MirrorBT).apply(
+          tmp, elementSizeUm, D);
+
+      double varSum = 0.0;
+      for (size_t i = 0; i < D.size(); ++i)
+      {
+        blitz::TinyMatrix<double,3,3> m;
+        int k = 0;
+        for (int r = 0; r < 3; ++r)
+            for (int c = r; c < 3; ++c, ++k)
+                m(r, c) = m(c, r) = D.data()[i](k);
+        blitz::TinyVector<double,3> lambda;
+        atb::eigenvalueDecompositionRealSymmetric(m, lambda, atb::Ascending);
+        varSum += blitz::pow2(lambda(0));
+      }
+      double stddevInv = 1.0 / std::sqrt(varSum / D.size());
+
+      for (size_t i = 0; i < D.size(); ++i)
+      {
+        blitz::TinyMatrix<double,3,3> m;
+        int k = 0;
+        for (int r = 0; r < 3; ++r)
+            for (int c = r; c < 3; ++c, ++k)
+                m(r, c) = m(c, r) = D.data()[i](k);
+        blitz::TinyVector<double,3> eVals;
+        atb::eigenvalueDecompositionRealSymmetric(m, eVals, atb::Ascending);
+        blitz::TinyMatrix<double,3,3> eVecs;
+        atb::computeEigenvectors(m, eVecs, eVals);
+        eVals *= stddevInv;
+        D.data()[i] = 0.0;
+        for (int d = 0; d < 3; ++d)
+        {
+          double factor =
+              eVals(d) - zCorrection * std::abs(eVecs(0, d)) * kappa;
+          factor = std::exp(
+              -blitz::pow2(
+                  ((factor < -100.0) ? -100.0 :
+                   ((factor > 0.0) ? 0.0 : factor)) / kappa));
+          k = 0;
+          for (int r = 0; r < 3; ++r)
+              for (int c = r; c < 3; ++c, ++k)
+                  D.data()[i](k) += factor * eVecs(r, d) * eVecs(c, d);
+        }
+      }
+    }
+
+    for (ptrdiff_t i = 0; i < static_cast<ptrdiff_t>(in.size()); ++i)
+    {
+      ptrdiff_t tmp = i;
+      blitz::TinyVector<atb::BlitzIndexT,3> pos;
+      for (int d = 2; d >= 0; --d)
+      {
+        pos(d) = tmp % in.extent(d);
+        tmp /= in.extent(d);
+      }
+      double du = 0.0;
+      int k = 1;
+      for (int r = 0; r < 3; ++r, ++k)
+      {
+        for (int c = r + 1; c < 3; ++c, ++k)
+        {
+          if (pos(r) > 0 && pos(r) < in.extent(r) - 1 &&
+              pos(c) > 0 && pos(c) < in.extent(c) - 1)
+          {
+            du +=
+                (D.data()[i - D.stride(r)](k) + D.data()[i - D.stride(c)](k)) *
+                in.data()[i - D.stride(r) - D.stride(c)] +
+                (D.data()[i + D.stride(r)](k) + D.data()[i + D.stride(c)](k)) *
+                in.data()[i + D.stride(r) + D.stride(c)] -
+                (D.data()[i + D.stride(r)](k) + D.data()[i - D.stride(c)](k)) *
+                in.data()[i + D.stride(r) - D.stride(c)] -
+                (D.data()[i - D.stride(r)](k) + D.data()[i + D.stride(c)](k)) *
+                in.data()[i - D.stride(r) + D.stride(c)];
+          }
+        }
+      }
+      du *= 0.5;
+      double di = 0.0;
+      k = 0;
+      for (int r = 0; r < 3; k += 3 - r, ++r)
+      {
+        if (pos(r) > 0 && pos(r) < in.extent(r) - 1)
+        {
+          du += (D.data()[i - D.stride(r)](k) + D.data()[i](k)) *
+              in.data()[i - D.stride(r)] +
+              (D.data()[i + D.stride(r)](k) + D.data()[i](k)) *
+              in.data()[i + D.stride(r)];
+          di -= D.data()[i - D.stride(r)](k) + 2.0 * D.data()[i](k) +
+              D.data()[i + D.stride(r)](k);
+        }
+        else
+        {
+          ptrdiff_t offs = (pos(r) == 0) ? D.stride(r) : -D.stride(r);
+          du += 2.0 * (D.data()[i + offs](k) + D.data()[i](k)) *
+              in.data()[i + offs];
+          di -= 2.0 * (D.data()[i + offs](k) + D.data()[i](k));
+        }
+      }
+      du *= 0.5 * tau;
+      di = 1.0 - 0.5 * tau * di;
+      di = (std::abs(di) < 1e-35) ? 1e-35 : di;
+      out.data()[i] = (in.data()[i] + du) / di;
+    }
+    blitz::Array<double,3> swap(in);
+    in.reference(out);
+    out.reference(swap);
+  }
+  result.resize(data.shape());
+  result = in;
+}
+
+static void testTiledMatchesReference(bool singlePrecision, double tolerance)
+{
+  // The first extent exceeds one tile to exercise the halo exchange, the
+  // number of iterations is no multiple of the Hessian update step width
+  blitz::TinyVector<double,3> elementSizeUm(2.0, 1.0, 1.0);
+  blitz::Array<double,3> data(40, 37, 11);
+  for (size_t i = 0; i < data.size(); ++i)
+      data.data()[i] =
+          static_cast<double>(std::rand()) / static_cast<double>(RAND_MAX);
+
+  blitz::Array<double,3> expected;
+  referenceDiffusion(data, elementSizeUm, 0.2, 1.5, 0.0625, 0.5, 7, 3,
+                     expected);
+
+  atb::AnisotropicDiffusionFilter<double,3> filter(
+      0.2, 1.5, 0.0625, 0.5, 7, 3);
+  filter.setSinglePrecision(singlePrecision);
+  LMBUNIT_ASSERT_EQUAL(filter.singlePrecision(), singlePrecision);
+  blitz::Array<double,3> filtered;
+  filter.apply(data, elementSizeUm, filtered);
+
+  LMBUNIT_ASSERT(blitz::all(filtered.shape() == data.shape()));
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(blitz::abs(filtered - expected)), 0.0, tolerance);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testTiledMatchesReference(false, 1e-10));
+  LMBUNIT_RUN_TEST(testTiledMatchesReference(true, 1e-3));
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,219 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/CentralDerivativesFilter.hh>
+#include <libArrayToolbox/CentralHessianUTFilter.hh>
+#include <libArrayToolbox/LaplacianFilter.hh>
+
+#include <cmath>
+#include <algorithm>
+
+typedef atb::CentralDerivativesFilter<double,3> DerivativesFilter;
+
+// Anisotropic test volume whose derivatives differ in every direction and
+// do not vanish at the borders
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(9, 11, 13),
+      blitz::TinyVector<double,3>(2.0, 1.0, 1.5));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = std::sin(0.5 * z + 1.3 * y) * std::cos(0.7 * x) +
+                  0.1 * z * y - 0.05 * x * x +
+                  0.3 * ((z + 2 * y + 3 * x) % 5);
+  return data;
+}
+
+struct VisitCounter
+{
+  VisitCounter(blitz::Array<int,3> &visits, blitz::Array<double,3> &laplacian)
+          : visits(visits), laplacian(laplacian)
+  {}
+
+  void operator()(
+      blitz::TinyVector<ptrdiff_t,3> const &pos,
+      DerivativesFilter::GradientT const &,
+      DerivativesFilter::HessianT const &, double laplacian)
+  {
+    visits(pos) += 1;
+    this->laplacian(pos) = laplacian;
+  }
+
+  blitz::Array<int,3> &visits;
+  blitz::Array<double,3> &laplacian;
+};
+
+static void testSecondOrderMatchesSeparateFilters(atb::BoundaryTreatmentType bt)
+{
+  atb::Array<double,3> data(testData());
+
+  atb::Array<blitz::TinyVector<double,3>,3> gradient;
+  atb::Array<blitz::TinyVector<double,6>,3> hessian;
+  atb::Array<double,3> laplacian;
+  DerivativesFilter(bt, 0.5).apply(data, &gradient, &hessian, &laplacian);
+
+  atb::Array<blitz::TinyVector<double,3>,3> expectedGradient;
+  atb::CentralGradientFilter<double,3>(bt, 0.5).apply(data, expectedGradient);
+  atb::Array<blitz::TinyVector<double,6>,3> expectedHessian;
+  atb::CentralHessianUTFilter<double,3>(bt, 0.5).apply(data, expectedHessian);
+  atb::Array<double,3> expectedLaplacian;
+  atb::LaplacianFilter<double,3>(bt, 0.5).apply(data, expectedLaplacian);
+
+  double maxError = 0.0;
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    for (int d = 0; d < 3; ++d)
+        maxError = std::max(
+            maxError, std::abs(gradient.dataFirst()[i](d) -
+                               expectedGradient.dataFirst()[i](d)));
+    for (int d = 0; d < 6; ++d)
+        maxError = std::max(
+            maxError, std::abs(hessian.dataFirst()[i](d) -
+                               expectedHessian.dataFirst()[i](d)));
+    maxError = std::max(
+        maxError, std::abs(laplacian.dataFirst()[i] -
+                           expectedLaplacian.dataFirst()[i]));
+  }
+  LMBUNIT_ASSERT_EQUAL_DELTA(maxError, 0.0, 1e-10);
+}
+
+static void testFourthOrderMatchesSeparateFilters(
+    atb::BoundaryTreatmentType bt)
+{
+  atb::Array<double,3> data(testData());
+
+  atb::Array<blitz::TinyVector<double,6>,3> hessian;
+  atb::Array<double,3> laplacian;
+  DerivativesFilter(
+      atb::CentralGradientFilter<double,3>::FourthOrder, bt, 0.5).apply(
+          data, NULL, &hessian, &laplacian);
+
+  atb::Array<blitz::TinyVector<double,6>,3> expectedHessian;
+  atb::CentralHessianUTFilter<double,3>(
+      atb::CentralGradientFilter<double,3>::FourthOrder, bt, 0.5).apply(
+          data, expectedHessian);
+  atb::Array<double,3> expectedLaplacian;
+  atb::LaplacianFilter<double,3>(
+      atb::LaplacianFilter<double,3>::FourthOrder, bt, 0.5).apply(
+          data, expectedLaplacian);
+
+  // Only the unmixed second derivatives are compared, the fourth order
+  // CentralGradientFilter is normalized differently
+  double maxError = 0.0;
+  for (size_t i = 0; i < data.size(); ++i)
+  {
+    maxError = std::max(
+        maxError, std::abs(hessian.dataFirst()[i](0) -
+                           expectedHessian.dataFirst()[i](0)));
+    maxError = std::max(
+        maxError, std::abs(hessian.dataFirst()[i](3) -
+                           expectedHessian.dataFirst()[i](3)));
+    maxError = std::max(
+        maxError, std::abs(hessian.dataFirst()[i](5) -
+                           expectedHessian.dataFirst()[i](5)));
+    maxError = std::max(
+        maxError, std::abs(laplacian.dataFirst()[i] -
+                           expectedLaplacian.dataFirst()[i]));
+  }
+  LMBUNIT_ASSERT_EQUAL_DELTA(maxError, 0.0, 1e-10);
+}
+
+// The fourth order central differences of first and unmixed second
+// derivatives are exact for polynomials up to degree four. Mixed second
+// derivatives are compositions of exact first derivatives.
+static void testFourthOrderIsExactForCubicPolynomials()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(9, 11, 13),
+      blitz::TinyVector<double,3>(2.0, 1.0, 1.5));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+  {
+    for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+    {
+      for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+      {
+        double u = 2.0 * z, v = y, w = 1.5 * x;
+        data(z, y, x) = 0.01 * u * u * u - 0.02 * u * u * v +
+            0.03 * u * v * w + 0.015 * v * v * v - 0.01 * v * w * w +
+            0.02 * w * w * w + 0.1 * u - 0.2 * w;
+      }
+    }
+  }
+
+  atb::Array<blitz::TinyVector<double,3>,3> gradient;
+  atb::Array<blitz::TinyVector<double,6>,3> hessian;
+  atb::Array<double,3> laplacian;
+  DerivativesFilter(
+      atb::CentralGradientFilter<double,3>::FourthOrder, atb::MirrorBT).apply(
+          data, &gradient, &hessian, &laplacian);
+
+  // Compare where the stencils do not reach the boundary
+  double maxError = 0.0;
+  for (atb::BlitzIndexT z = 2; z < data.extent(0) - 2; ++z)
+  {
+    for (atb::BlitzIndexT y = 2; y < data.extent(1) - 2; ++y)
+    {
+      for (atb::BlitzIndexT x = 2; x < data.extent(2) - 2; ++x)
+      {
+        double u = 2.0 * z, v = y, w = 1.5 * x;
+        blitz::TinyVector<double,3> expectedGradient(
+            0.03 * u * u - 0.04 * u * v + 0.03 * v * w + 0.1,
+            -0.02 * u * u + 0.03 * u * w + 0.045 * v * v - 0.01 * w * w,
+            0.03 * u * v - 0.02 * v * w + 0.06 * w * w - 0.2);
+        blitz::TinyVector<double,6> expectedHessian(
+            0.06 * u - 0.04 * v, -0.04 * u + 0.03 * w, 0.03 * v,
+            0.09 * v, 0.03 * u - 0.02 * w, -0.02 * v + 0.12 * w);
+        for (int d = 0; d < 3; ++d)
+            maxError = std::max(
+                maxError, std::abs(gradient(z, y, x)(d) -
+                                   expectedGradient(d)));
+        for (int d = 0; d < 6; ++d)
+            maxError = std::max(
+                maxError, std::abs(hessian(z, y, x)(d) -
+                                   expectedHessian(d)));
+        maxError = std::max(
+            maxError, std::abs(
+                laplacian(z, y, x) - expectedHessian(0) -
+                expectedHessian(3) - expectedHessian(5)));
+      }
+    }
+  }
+  LMBUNIT_ASSERT_EQUAL_DELTA(maxError, 0.0, 1e-9);
+}
+
+static void testCallbackVisitsEveryVoxelOnce()
+{
+  atb::Array<double,3> data(testData());
+  blitz::Array<int,3> visits(data.shape());
+  visits = 0;
+  blitz::Array<double,3> laplacian(data.shape());
+  VisitCounter counter(visits, laplacian);
+  DerivativesFilter filter(atb::MirrorBT);
+  filter.apply(
+      data, data.elementSizeUm(), DerivativesFilter::Laplacian, counter);
+
+  atb::Array<double,3> expectedLaplacian;
+  filter.apply(data, expectedLaplacian);
+
+  LMBUNIT_ASSERT(blitz::all(visits == 1));
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(blitz::abs(laplacian - expectedLaplacian)), 0.0, 1e-12);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testSecondOrderMatchesSeparateFilters(atb::ValueBT));
+  LMBUNIT_RUN_TEST(testSecondOrderMatchesSeparateFilters(atb::CyclicBT));
+  LMBUNIT_RUN_TEST(testSecondOrderMatchesSeparateFilters(atb::RepeatBT));
+  LMBUNIT_RUN_TEST(testSecondOrderMatchesSeparateFilters(atb::MirrorBT));
+  LMBUNIT_RUN_TEST(testFourthOrderMatchesSeparateFilters(atb::ValueBT));
+  LMBUNIT_RUN_TEST(testFourthOrderMatchesSeparateFilters(atb::MirrorBT));
+  LMBUNIT_RUN_TEST(testFourthOrderIsExactForCubicPolynomials());
+  LMBUNIT_RUN_TEST(testCallbackVisitsEveryVoxelOnce());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
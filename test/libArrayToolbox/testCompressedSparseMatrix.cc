@@ -0,0 +1,118 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/CompressedSparseMatrix.hh>
+
+#include <cstdlib>
+
+// Random integer entries keep all products exact
+static void randomMatrix(
+    int nRows, int nColumns, int nTriplets, blitz::Array<double,2> &dense,
+    atb::CompressedSparseMatrixBuilder<double> &builder)
+{
+  dense.resize(nRows, nColumns);
+  dense = 0.0;
+  for (int i = 0; i < nTriplets; ++i)
+  {
+    int r = std::rand() % nRows;
+    int c = std::rand() % nColumns;
+    double value = static_cast<double>(std::rand() % 7 - 3);
+    dense(r, c) += value;
+    builder.add(r, c, value);
+  }
+}
+
+static bool isSorted(atb::CompressedSparseMatrix<double> const &m)
+{
+  for (size_t r = 0; r < m.nRows(); ++r)
+      for (size_t k = m.rowPointers()[r] + 1; k < m.rowPointers()[r + 1]; ++k)
+          if (m.columnIndices()[k] <= m.columnIndices()[k - 1]) return false;
+  return true;
+}
+
+static void testBuilder()
+{
+  blitz::Array<double,2> dense;
+  atb::CompressedSparseMatrixBuilder<double> builder(57, 43);
+  randomMatrix(57, 43, 400, dense, builder);
+  LMBUNIT_ASSERT_EQUAL(builder.nTriplets(), 400);
+
+  atb::CompressedSparseMatrix<double> m;
+  builder.build(m);
+  LMBUNIT_ASSERT_EQUAL(m.nRows(), 57);
+  LMBUNIT_ASSERT_EQUAL(m.nColumns(), 43);
+  LMBUNIT_ASSERT_EQUAL(
+      m.nNonZeroEntries(),
+      static_cast<size_t>(blitz::count(dense != 0.0)));
+  LMBUNIT_ASSERT(isSorted(m));
+  LMBUNIT_ASSERT_EQUAL(blitz::max(blitz::abs(m.toBlitz() - dense)), 0.0);
+
+  atb::CompressedSparseMatrix<double> t(m.transpose());
+  LMBUNIT_ASSERT_EQUAL(t.nRows(), 43);
+  LMBUNIT_ASSERT(isSorted(t));
+  for (int r = 0; r < dense.extent(0); ++r)
+      for (int c = 0; c < dense.extent(1); ++c)
+          LMBUNIT_ASSERT_EQUAL(t(c, r), dense(r, c));
+
+  // Round trip through the map based SparseMatrix
+  atb::CompressedSparseMatrix<double> converted(m.toSparseMatrix());
+  LMBUNIT_ASSERT(converted.rowPointers() == m.rowPointers());
+  LMBUNIT_ASSERT(converted.columnIndices() == m.columnIndices());
+  LMBUNIT_ASSERT(converted.values() == m.values());
+
+  bool caught = false;
+  try
+  {
+    builder.add(57, 0, 1.0);
+  }
+  catch (atb::SparseMatrixError &)
+  {
+    caught = true;
+  }
+  LMBUNIT_ASSERT(caught);
+}
+
+static void testProducts()
+{
+  blitz::Array<double,2> denseA, denseB;
+  atb::CompressedSparseMatrixBuilder<double> builderA(300, 200);
+  atb::CompressedSparseMatrixBuilder<double> builderB(200, 250);
+  randomMatrix(300, 200, 3000, denseA, builderA);
+  randomMatrix(200, 250, 2000, denseB, builderB);
+  atb::CompressedSparseMatrix<double> A, B;
+  builderA.build(A);
+  builderB.build(B);
+
+  blitz::Array<double,1> x(200);
+  for (int i = 0; i < x.extent(0); ++i) x(i) = static_cast<double>(i % 13);
+  blitz::Array<double,1> y(A * x);
+  LMBUNIT_ASSERT_EQUAL(y.extent(0), 300);
+  for (int r = 0; r < denseA.extent(0); ++r)
+      LMBUNIT_ASSERT_EQUAL(
+          y(r), blitz::sum(denseA(r, blitz::Range::all()) * x));
+
+  blitz::Array<double,1> z;
+  A.multiplyTransposed(y, z);
+  blitz::Array<double,1> zT(A.transpose() * y);
+  LMBUNIT_ASSERT_EQUAL(blitz::max(blitz::abs(z - zT)), 0.0);
+
+  atb::CompressedSparseMatrix<double> C(A * B);
+  LMBUNIT_ASSERT_EQUAL(C.nRows(), 300);
+  LMBUNIT_ASSERT_EQUAL(C.nColumns(), 250);
+  LMBUNIT_ASSERT(isSorted(C));
+  for (int r = 0; r < denseA.extent(0); ++r)
+      for (int c = 0; c < denseB.extent(1); ++c)
+          LMBUNIT_ASSERT_EQUAL(
+              C(r, c), blitz::sum(denseA(r, blitz::Range::all()) *
+                                  denseB(blitz::Range::all(), c)));
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testBuilder());
+  LMBUNIT_RUN_TEST(testProducts());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
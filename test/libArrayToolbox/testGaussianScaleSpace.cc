@@ -0,0 +1,101 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/GaussianScaleSpace.hh>
+
+#include <cmath>
+
+// Data only varying along the last dimension, so that the boundary
+// treatment along the other dimensions does not influence the results
+static atb::Array<double,3> lineData(atb::BlitzIndexT length, bool ramp)
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(3, 4, length),
+      blitz::TinyVector<double,3>(2.0, 1.0, 1.0));
+  for (atb::BlitzIndexT x = 0; x < length; ++x)
+  {
+    double value = ramp ? 0.25 * static_cast<double>(x) :
+        0.5 + 0.3 * std::sin(0.7 * x) + 0.2 * std::cos(2.3 * x) +
+        0.1 * static_cast<double>((7 * x) % 5);
+    data(blitz::Range::all(), blitz::Range::all(), x) = value;
+  }
+  return data;
+}
+
+static void testIncrementalScalesMatchDirectSmoothing()
+{
+  atb::Array<double,3> data(lineData(128, false));
+  atb::GaussianScaleSpace<double,3> scaleSpace(atb::RepeatBT);
+  scaleSpace.setData(data);
+  LMBUNIT_ASSERT_EQUAL_DELTA(scaleSpace.parentScaleUm(4.0), 2.0, 1e-12);
+  LMBUNIT_ASSERT_EQUAL_DELTA(scaleSpace.parentScaleUm(1.5), 0.0, 1e-12);
+
+  blitz::Array<double,3> incremental;
+  scaleSpace.scale(4.0, incremental);
+  LMBUNIT_ASSERT(scaleSpace.hasScale(2.0));
+
+  atb::Array<double,3> direct;
+  scaleSpace.smooth(data, 4.0, direct);
+
+  blitz::Range interior(50, 77);
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(
+          blitz::abs(
+              incremental(blitz::Range::all(), blitz::Range::all(), interior) -
+              direct(blitz::Range::all(), blitz::Range::all(), interior))),
+      0.0, 1e-6);
+}
+
+static void testReleaseOtherScales()
+{
+  atb::Array<double,3> data(lineData(32, false));
+  atb::GaussianScaleSpace<double,3> scaleSpace(atb::RepeatBT);
+  scaleSpace.setData(data);
+
+  blitz::Array<double,3> smoothed;
+  scaleSpace.scale(4.0, smoothed);
+  scaleSpace.releaseOtherScales(4.0);
+  LMBUNIT_ASSERT(scaleSpace.hasScale(4.0));
+  LMBUNIT_ASSERT(!scaleSpace.hasScale(2.0));
+  LMBUNIT_ASSERT(!scaleSpace.hasScale(1.0));
+
+  // Coarser scales are derived from the inserted scale
+  blitz::Array<double,3> inserted(data.shape());
+  inserted = 1.0;
+  scaleSpace.clear();
+  scaleSpace.insertScale(4.0, inserted);
+  scaleSpace.scale(8.0, smoothed);
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(blitz::abs(smoothed - 1.0)), 0.0, 1e-10);
+}
+
+static void testDownsampledScalesPreserveLinearData()
+{
+  atb::Array<double,3> data(lineData(256, true));
+  atb::GaussianScaleSpace<double,3> scaleSpace(atb::RepeatBT);
+  scaleSpace.setMaxDownsamplingLevel(2);
+  scaleSpace.setData(data);
+
+  blitz::Array<double,3> smoothed;
+  scaleSpace.scale(8.0, smoothed);
+  LMBUNIT_ASSERT(blitz::all(smoothed.shape() == data.shape()));
+
+  blitz::Range interior(100, 155);
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(
+          blitz::abs(
+              smoothed(blitz::Range::all(), blitz::Range::all(), interior) -
+              data(blitz::Range::all(), blitz::Range::all(), interior))),
+      0.0, 1e-8);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testIncrementalScalesMatchDirectSmoothing());
+  LMBUNIT_RUN_TEST(testReleaseOtherScales());
+  LMBUNIT_RUN_TEST(testDownsampledScalesPreserveLinearData());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,113 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/iRoCS.hh>
+#include <libArrayToolbox/ATBLinAlg.hh>
+
+#include <cmath>
+
+// Points on a tube of radius 25um around a circular arc of radius 300um
+// in the (z,y) plane. The arc parameter t runs from 0 (start) to 1 (end),
+// values outside this range continue the circle beyond the root ends.
+static blitz::TinyVector<double,3> tubePosition(
+    double t, double radiusUm, double phi)
+{
+  double const arcRadiusUm = 300.0, arcAngle = 0.6;
+  double a = arcAngle * t;
+  blitz::TinyVector<double,3> center(
+      100.0 + arcRadiusUm * std::sin(a),
+      100.0 + arcRadiusUm * (1.0 - std::cos(a)), 100.0);
+  blitz::TinyVector<double,3> normal(-std::sin(a), std::cos(a), 0.0);
+  blitz::TinyVector<double,3> binormal(0.0, 0.0, 1.0);
+  return center + radiusUm * (std::cos(phi) * normal +
+                              std::sin(phi) * binormal);
+}
+
+static void fitCurvedAxis(atb::IRoCS &rct)
+{
+  std::vector< blitz::TinyVector<double,3> > markersUm;
+  for (int i = 0; i <= 60; ++i)
+      for (int j = 0; j < 12; ++j)
+          markersUm.push_back(
+              tubePosition(i / 60.0, 25.0, 2.0 * M_PI * (j + 0.5 * (i % 2)) /
+                           12.0));
+  rct.fit(tubePosition(0.0, 0.0, 0.0), markersUm, 1.0, 0.0, 0.0, 200);
+}
+
+// The iRoCS coordinates as they were computed before the axis projection
+// used the precomputed sample hierarchy: polynomial root finding for the
+// closest axis position and direct integration of the arc length
+static blitz::TinyVector<double,3> referenceCoordinates(
+    atb::IRoCS const &rct, blitz::TinyVector<double,3> const &pos)
+{
+  blitz::TinyVector<double,3> res;
+  double uOpt;
+  res(1) = atb::extendedDistance(rct.axisSpline(), pos, uOpt);
+  res(0) = rct.axisSpline().extendedCurveIntegral(rct.uQC(), uOpt);
+  blitz::TinyVector<double,3> nPos(
+      atb::homogeneousToEuclidean(
+          atb::mvMult(rct.inverseNormalizationTransformation(),
+                      atb::euclideanToHomogeneous(pos))));
+  blitz::TinyVector<double,3> axisPos(
+      atb::homogeneousToEuclidean(
+          atb::mvMult(rct.inverseNormalizationTransformation(),
+                      atb::euclideanToHomogeneous(
+                          rct.getAxisPosition(uOpt)))));
+  res(2) = std::atan2(nPos(2) - axisPos(2), nPos(1) - axisPos(1));
+  return res;
+}
+
+// Query positions along the whole axis and up to a quarter of the axis
+// length beyond both of its ends, off the axis by 5 to 15um
+static std::vector< blitz::TinyVector<double,3> > queryPositionsUm()
+{
+  std::vector< blitz::TinyVector<double,3> > positionsUm;
+  for (int i = -10; i <= 50; ++i)
+      positionsUm.push_back(
+          tubePosition(i / 40.0, 5.0 + (i + 10) % 11, 0.37 * (i + 10)));
+  return positionsUm;
+}
+
+static void assertSameCoordinates(
+    blitz::TinyVector<double,3> const &coords,
+    blitz::TinyVector<double,3> const &expected)
+{
+  LMBUNIT_ASSERT_EQUAL_DELTA(coords(0), expected(0), 1e-2);
+  LMBUNIT_ASSERT_EQUAL_DELTA(coords(1), expected(1), 1e-3);
+  double dPhi = std::fmod(std::abs(coords(2) - expected(2)), 2.0 * M_PI);
+  LMBUNIT_ASSERT_EQUAL_DELTA(std::min(dPhi, 2.0 * M_PI - dPhi), 0.0, 1e-3);
+}
+
+static void testGetCoordinatesMatchesReference()
+{
+  atb::IRoCS rct;
+  fitCurvedAxis(rct);
+  std::vector< blitz::TinyVector<double,3> > positionsUm(queryPositionsUm());
+  for (size_t i = 0; i < positionsUm.size(); ++i)
+      assertSameCoordinates(
+          rct.getCoordinates(positionsUm[i]),
+          referenceCoordinates(rct, positionsUm[i]));
+}
+
+static void testBatchedGetCoordinatesMatchesSingle()
+{
+  atb::IRoCS rct;
+  fitCurvedAxis(rct);
+  std::vector< blitz::TinyVector<double,3> > positionsUm(queryPositionsUm());
+  std::vector< blitz::TinyVector<double,3> > coordinates;
+  rct.getCoordinates(positionsUm, coordinates);
+  LMBUNIT_ASSERT_EQUAL(coordinates.size(), positionsUm.size());
+  for (size_t i = 0; i < positionsUm.size(); ++i)
+      assertSameCoordinates(
+          coordinates[i], rct.getCoordinates(positionsUm[i]));
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testGetCoordinatesMatchesReference());
+  LMBUNIT_RUN_TEST(testBatchedGetCoordinatesMatchesSingle());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
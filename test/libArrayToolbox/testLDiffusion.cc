@@ -0,0 +1,67 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/algo/ldiffusion.hh>
+
+// Line by line reference using the scalar Thomas solver
+static void referenceAOS(
+    blitz::Array<double,3> const &u, blitz::Array<double,3> &g,
+    blitz::Array<double,3> &uNew, double deltaT)
+{
+  uNew = 0.0;
+  for (int dim = 0; dim < 3; ++dim)
+  {
+    int N = u.extent(dim);
+    std::vector<double> alpha(N), beta(N), gamma(N), L(N), M(N), R(N),
+        out(N);
+    blitz::TinyVector<int,3> pos(0);
+    int a = (dim == 0) ? 1 : 0;
+    int b = (dim == 2) ? 1 : 2;
+    for (pos(a) = 0; pos(a) < u.extent(a); ++pos(a))
+    {
+      for (pos(b) = 0; pos(b) < u.extent(b); ++pos(b))
+      {
+        blitz::Array<double,1> gLine(N), line(N);
+        blitz::TinyVector<int,3> p(pos);
+        for (p(dim) = 0; p(dim) < N; ++p(dim))
+        {
+          gLine(p(dim)) = g(p);
+          line(p(dim)) = u(p);
+        }
+        get1DAOS_blitz(gLine, deltaT, N, 3, &alpha[0], &beta[0], &gamma[0],
+                       &L[0], &M[0], &R[0]);
+        tridiagonal_Thomas_solution_blitz(
+            &L[0], &M[0], &R[0], line, &out[0], N);
+        for (p(dim) = 0; p(dim) < N; ++p(dim)) uNew(p) += out[p(dim)];
+      }
+    }
+  }
+}
+
+static void testBatchedAOSMatchesReference()
+{
+  blitz::Array<double,3> u(7, 13, 11), g(7, 13, 11);
+  for (size_t i = 0; i < u.size(); ++i)
+  {
+    u.data()[i] =
+        static_cast<double>(std::rand()) / static_cast<double>(RAND_MAX);
+    g.data()[i] =
+        static_cast<double>(std::rand()) / static_cast<double>(RAND_MAX);
+  }
+
+  blitz::Array<double,3> expected(u.shape()), result(u.shape());
+  referenceAOS(u, g, expected, 0.5);
+  AOS_3D_blitz(u, g, result, 0.5);
+
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(blitz::abs(result - expected)), 0.0, 1e-12);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testBatchedAOSMatchesReference());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
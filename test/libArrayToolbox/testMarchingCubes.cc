@@ -0,0 +1,202 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/MarchingCubes.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+// Every edge of a closed mesh is shared by exactly two triangles
+static bool isClosed(atb::SurfaceGeometry const &surface)
+{
+  std::vector<atb::SurfaceGeometry::IndexT> const &I = surface.indices();
+  std::map<std::pair<size_t,size_t>,int> edgeCount;
+  for (size_t i = 0; i < I.size(); i += 3)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      size_t a = I[i + j], b = I[i + (j + 1) % 3];
+      edgeCount[std::make_pair(std::min(a, b), std::max(a, b))]++;
+    }
+  }
+  for (std::map<std::pair<size_t,size_t>,int>::const_iterator it =
+           edgeCount.begin(); it != edgeCount.end(); ++it)
+      if (it->second != 2) return false;
+
+  // Sphere topology
+  return static_cast<ptrdiff_t>(surface.vertices().size()) -
+      static_cast<ptrdiff_t>(edgeCount.size()) +
+      static_cast<ptrdiff_t>(I.size() / 3) == 2;
+}
+
+static blitz::TinyVector<double,3> const sphereCenterUm(29.3, 31.7, 20.1);
+static double const sphereRadiusUm = 12.55;
+
+static void triangulateSphere(atb::SurfaceGeometry &surface)
+{
+  // Large enough to span several slabs and blocks, most blocks are empty
+  blitz::TinyVector<double,3> elementSizeUm(2.0, 1.0, 1.0);
+  blitz::Array<float,3> data(30, 70, 45);
+  for (int z = 0; z < data.extent(0); ++z)
+      for (int y = 0; y < data.extent(1); ++y)
+          for (int x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = static_cast<float>(
+                  std::sqrt(
+                      blitz::pow2(z * elementSizeUm(0) - sphereCenterUm(0)) +
+                      blitz::pow2(y * elementSizeUm(1) - sphereCenterUm(1)) +
+                      blitz::pow2(x * elementSizeUm(2) - sphereCenterUm(2))) -
+                  sphereRadiusUm);
+  atb::MarchingCubes::triangulate(data, elementSizeUm, surface, 0.0);
+}
+
+static double maximumRadiusDeviation(atb::SurfaceGeometry const &surface)
+{
+  double maxDeviation = 0.0;
+  for (size_t i = 0; i < surface.vertices().size(); ++i)
+  {
+    blitz::TinyVector<double,3> d(surface.vertices()[i]);
+    d -= sphereCenterUm;
+    maxDeviation = std::max(
+        maxDeviation, std::abs(std::sqrt(blitz::dot(d, d)) - sphereRadiusUm));
+  }
+  return maxDeviation;
+}
+
+static void testSphereIsClosed()
+{
+  atb::SurfaceGeometry surface;
+  triangulateSphere(surface);
+  LMBUNIT_ASSERT(surface.indices().size() > 0);
+  LMBUNIT_ASSERT_EQUAL(surface.normals().size(), surface.vertices().size());
+  LMBUNIT_ASSERT(isClosed(surface));
+  LMBUNIT_ASSERT_EQUAL_DELTA(maximumRadiusDeviation(surface), 0.0, 0.1);
+}
+
+static void testQuadricSimplification()
+{
+  atb::SurfaceGeometry surface;
+  triangulateSphere(surface);
+  size_t nTriangles = surface.indices().size() / 3;
+
+  // Simplification to a triangle count keeps the topology
+  atb::SurfaceGeometry simplified(surface);
+  atb::MarchingCubes::simplifyMeshQuadric(simplified, 0.0, nTriangles / 10);
+  LMBUNIT_ASSERT(simplified.indices().size() / 3 <= nTriangles / 10);
+  LMBUNIT_ASSERT(isClosed(simplified));
+  LMBUNIT_ASSERT_EQUAL_DELTA(maximumRadiusDeviation(simplified), 0.0, 0.5);
+
+  // An error bound removes fewer triangles and deviates less
+  atb::SurfaceGeometry bounded(surface);
+  atb::MarchingCubes::simplifyMeshQuadric(bounded, 0.001);
+  LMBUNIT_ASSERT(bounded.indices().size() < surface.indices().size());
+  LMBUNIT_ASSERT(bounded.indices().size() > simplified.indices().size());
+  LMBUNIT_ASSERT(isClosed(bounded));
+  LMBUNIT_ASSERT_EQUAL_DELTA(maximumRadiusDeviation(bounded), 0.0, 0.15);
+
+  // The swept volume tolerance of simplifyMesh() works on the same engine
+  atb::SurfaceGeometry swept(surface);
+  atb::MarchingCubes::simplifyMesh(swept, 1.0);
+  LMBUNIT_ASSERT(swept.indices().size() < surface.indices().size());
+  LMBUNIT_ASSERT(isClosed(swept));
+}
+
+// All vertex positions of the surface are pairwise different
+static bool hasUniqueVertices(atb::SurfaceGeometry const &surface)
+{
+  std::vector< std::pair<float,std::pair<float,float> > > positions;
+  for (size_t i = 0; i < surface.vertices().size(); ++i)
+      positions.push_back(
+          std::make_pair(
+              surface.vertices()[i](0),
+              std::make_pair(
+                  surface.vertices()[i](1), surface.vertices()[i](2))));
+  std::sort(positions.begin(), positions.end());
+  return std::adjacent_find(positions.begin(), positions.end()) ==
+      positions.end();
+}
+
+static void testCubeCornerVerticesAreShared()
+{
+  // The iso surface of a box with integer corners runs through the grid
+  // points, where the vertices of all edges meeting at a point coincide
+  blitz::Array<float,3> data(12, 12, 12);
+  for (int z = 0; z < data.extent(0); ++z)
+      for (int y = 0; y < data.extent(1); ++y)
+          for (int x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = static_cast<float>(
+                  std::max(std::abs(z - 5), std::max(std::abs(y - 6),
+                                                     std::abs(x - 5))) - 3);
+  atb::SurfaceGeometry surface;
+  atb::MarchingCubes::triangulate(
+      data, blitz::TinyVector<double,3>(1.0), surface, 0.0);
+  LMBUNIT_ASSERT(surface.indices().size() > 0);
+  LMBUNIT_ASSERT(hasUniqueVertices(surface));
+  for (size_t i = 0; i < surface.vertices().size(); ++i)
+      for (int d = 0; d < 3; ++d)
+          LMBUNIT_ASSERT_EQUAL(
+              surface.vertices()[i](d), std::floor(surface.vertices()[i](d)));
+}
+
+static void testNearlyCoincidentVerticesAreMerged()
+{
+  // Two triangles sharing an edge, whose vertices are stored twice with a
+  // tiny offset
+  atb::SurfaceGeometry surface;
+  std::vector<atb::SurfaceGeometry::VertexT> &V = surface.vertices();
+  V.push_back(atb::SurfaceGeometry::VertexT(0.0f, 0.0f, 0.0f));
+  V.push_back(atb::SurfaceGeometry::VertexT(1.0e-3f, 0.0f, 0.0f));
+  V.push_back(atb::SurfaceGeometry::VertexT(0.0f, 1.0e-3f, 0.0f));
+  V.push_back(atb::SurfaceGeometry::VertexT(1.0e-3f, 1.0e-14f, 0.0f));
+  V.push_back(atb::SurfaceGeometry::VertexT(1.0e-14f, 1.0e-3f, 0.0f));
+  V.push_back(atb::SurfaceGeometry::VertexT(1.0e-3f, 1.0e-3f, 0.0f));
+  unsigned int const indices[] = { 0, 1, 2, 3, 5, 4 };
+  surface.indices().assign(indices, indices + 6);
+
+  atb::MarchingCubes::simplifyMesh(surface, 0.0);
+  LMBUNIT_ASSERT_EQUAL(surface.vertices().size(), 4u);
+  LMBUNIT_ASSERT_EQUAL(surface.normals().size(), 4u);
+  LMBUNIT_ASSERT_EQUAL(surface.indices().size(), 6u);
+  LMBUNIT_ASSERT_EQUAL(surface.indices()[3], surface.indices()[1]);
+  LMBUNIT_ASSERT_EQUAL(surface.indices()[5], surface.indices()[2]);
+}
+
+static void testLabelSurfaces()
+{
+  blitz::TinyVector<double,3> elementSizeUm(1.0, 0.5, 0.5);
+  blitz::Array<int,3> labels(20, 20, 20);
+  labels = 0;
+  labels(blitz::Range(2, 6), blitz::Range(3, 9), blitz::Range(4, 12)) = 3;
+  labels(blitz::Range(10, 19), blitz::Range(10, 15), blitz::Range(0, 5)) = 7;
+
+  std::map<int,atb::SurfaceGeometry> surfaces;
+  atb::MarchingCubes::triangulateLabels(labels, elementSizeUm, surfaces);
+  LMBUNIT_ASSERT_EQUAL(surfaces.size(), 2u);
+  LMBUNIT_ASSERT(surfaces.find(3) != surfaces.end());
+  LMBUNIT_ASSERT(surfaces.find(7) != surfaces.end());
+
+  // The iso surface passes half way between the label and its outside,
+  // also where the label touches the array border
+  std::vector<atb::SurfaceGeometry::VertexT> const &V3 =
+      surfaces[3].vertices();
+  blitz::TinyVector<double,3> lb(1.5, 1.25, 1.75), ub(6.5, 4.75, 6.25);
+  for (size_t i = 0; i < V3.size(); ++i)
+      for (int d = 0; d < 3; ++d)
+          LMBUNIT_ASSERT(V3[i](d) >= lb(d) - 1e-5 && V3[i](d) <= ub(d) + 1e-5);
+  LMBUNIT_ASSERT(isClosed(surfaces[3]));
+  LMBUNIT_ASSERT(isClosed(surfaces[7]));
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testSphereIsClosed());
+  LMBUNIT_RUN_TEST(testQuadricSimplification());
+  LMBUNIT_RUN_TEST(testCubeCornerVerticesAreShared());
+  LMBUNIT_RUN_TEST(testNearlyCoincidentVerticesAreMerged());
+  LMBUNIT_RUN_TEST(testLabelSurfaces());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,124 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/algo/lmorph.hh>
+
+// The former priority queue flooding of the seeded morphWatershed variant
+template<typename VoxelT>
+static void referenceWatershed(
+    blitz::Array<VoxelT,3> &I, blitz::Array<int,3> &label, int conn)
+{
+  typedef blitz::TinyVector<int,3> PosT;
+  typedef orderedPrioritizedNode<PosT,double> Node;
+  std::priority_queue<Node> pqueue;
+  blitz::Array<bool,3> S(label.shape());
+  S = where(label != 0, true, false);
+  long int count = 0;
+  Walker3D walker(label.shape(), conn);
+  for (blitz::Array<int,3>::iterator it = label.begin(); it != label.end();
+       ++it)
+  {
+    if (*it == 0) continue;
+    VoxelT v = -I(it.position());
+    PosT q;
+    walker.setLocation(it.position());
+    while (walker.getNextNeighbor(q))
+    {
+      if (label(q) == 0 && !S(q))
+      {
+        S(q) = true;
+        pqueue.push(Node(q, std::min(-I(q), v), count++));
+      }
+    }
+  }
+  while (!pqueue.empty())
+  {
+    PosT q;
+    PosT p = pqueue.top().m_value;
+    VoxelT v = pqueue.top().m_priority;
+    pqueue.pop();
+    int ll = 0;
+    bool isWatershed = false;
+    walker.setLocation(p);
+    while (walker.getNextNeighbor(q))
+    {
+      if (label(q) == 0 || isWatershed) continue;
+      if (ll != 0 && label(q) != ll) isWatershed = true;
+      else ll = label(q);
+    }
+    if (isWatershed) continue;
+    label(p) = ll;
+    walker.setLocation(p);
+    while (walker.getNextNeighbor(q))
+    {
+      if (!S(q))
+      {
+        S(q) = true;
+        pqueue.push(Node(q, std::min(-I(q), v), count++));
+      }
+    }
+  }
+}
+
+template<typename VoxelT>
+static void initialize(
+    blitz::Array<VoxelT,3> &data, blitz::Array<int,3> &seeds, int nLevels)
+{
+  for (size_t i = 0; i < data.size(); ++i)
+      data.data()[i] = (nLevels > 0) ?
+          static_cast<VoxelT>(std::rand() % nLevels - nLevels / 2) :
+          static_cast<VoxelT>(
+              static_cast<double>(std::rand()) / RAND_MAX - 0.5);
+  seeds = 0;
+  for (int l = 1; l <= 40; ++l) seeds.data()[std::rand() % seeds.size()] = l;
+}
+
+template<typename VoxelT>
+static void testMatchesReference(int nLevels, int conn)
+{
+  blitz::Array<VoxelT,3> data(23, 19, 17);
+  blitz::Array<int,3> label(data.shape()), expected(data.shape());
+  initialize(data, label, nLevels);
+  expected = label;
+  referenceWatershed(data, expected, conn);
+  morphWatershed(data, label, conn);
+  LMBUNIT_ASSERT(blitz::all(label == expected));
+}
+
+static void testBlockedSeparatesRegions()
+{
+  blitz::Array<float,3> data(40, 19, 17);
+  blitz::Array<int,3> seeds(data.shape()), label(data.shape());
+  initialize(data, seeds, 0);
+  label = seeds;
+  morphWatershed(data, label, 26, 4, 3);
+
+  // Seeds are kept and no two regions touch without watershed in between
+  LMBUNIT_ASSERT(blitz::all(seeds == 0 || label == seeds));
+  int nTouching = 0;
+  Walker3D walker(label.shape(), 26);
+  for (blitz::Array<int,3>::iterator it = label.begin(); it != label.end();
+       ++it)
+  {
+    if (*it == 0 || seeds(it.position()) != 0) continue;
+    blitz::TinyVector<int,3> q;
+    walker.setLocation(it.position());
+    while (walker.getNextNeighbor(q))
+        if (label(q) != 0 && label(q) != *it) ++nTouching;
+  }
+  LMBUNIT_ASSERT_EQUAL(nTouching, 0);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testMatchesReference<int>(7, 26));
+  LMBUNIT_RUN_TEST(testMatchesReference<int>(7, 6));
+  LMBUNIT_RUN_TEST(testMatchesReference<int>(1000000, 18));
+  LMBUNIT_RUN_TEST(testMatchesReference<float>(0, 26));
+  LMBUNIT_RUN_TEST(testMatchesReference<double>(0, 6));
+  LMBUNIT_RUN_TEST(testBlockedSeparatesRegions());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
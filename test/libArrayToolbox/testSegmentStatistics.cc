@@ -0,0 +1,114 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/SegmentStatistics.hh>
+#include <libArrayToolbox/algo/lrootShapeAnalysis.hh>
+
+// Three boxes separated by one voxel wide boundaries of label 0. Label 1
+// fills the remaining volume and touches all boxes.
+static blitz::Array<int,3> testLabels()
+{
+  blitz::Array<int,3> L(20, 17, 23);
+  L = 1;
+  L(blitz::Range(3, 10), blitz::Range(3, 12), blitz::Range(3, 9)) = 0;
+  L(blitz::Range(4, 9), blitz::Range(4, 11), blitz::Range(4, 8)) = 2;
+  L(blitz::Range(3, 10), blitz::Range(3, 12), blitz::Range(10, 17)) = 0;
+  L(blitz::Range(4, 9), blitz::Range(4, 11), blitz::Range(10, 16)) = 3;
+  L(blitz::Range(12, 19), blitz::Range(0, 5), blitz::Range(0, 5)) = 4;
+  return L;
+}
+
+static void testMomentsAndBounds()
+{
+  blitz::Array<int,3> L(testLabels());
+  atb::SegmentStatistics stats;
+  LMBUNIT_ASSERT(stats.compute(L));
+  LMBUNIT_ASSERT_EQUAL(stats.minLabel(), 0);
+  LMBUNIT_ASSERT_EQUAL(stats.maxLabel(), 4);
+
+  blitz::TinyVector<double,3> elementSizeUm(2.0, 1.0, 0.5);
+  blitz::Array<blitz::TinyVector<double,3>,1> centers;
+  blitz::Array<double,1> volumes;
+  centerAndVolume(L, centers, volumes, -1, elementSizeUm);
+  for (int label = 1; label <= 4; ++label)
+  {
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        static_cast<double>(stats.segment(label).nVoxels),
+        volumes(label - 1) / blitz::product(elementSizeUm), 1e-10);
+    for (int d = 0; d < 3; ++d)
+        LMBUNIT_ASSERT_EQUAL_DELTA(
+            stats.centerUm(label, elementSizeUm)(d),
+            centers(label - 1)(d), 1e-10);
+  }
+
+  LMBUNIT_ASSERT(stats.segment(1).touchesBorder);
+  LMBUNIT_ASSERT(!stats.segment(2).touchesBorder);
+  LMBUNIT_ASSERT(!stats.segment(3).touchesBorder);
+  LMBUNIT_ASSERT(stats.segment(4).touchesBorder);
+
+  LMBUNIT_ASSERT(
+      blitz::all(stats.segment(2).lowerBound ==
+                 blitz::TinyVector<atb::BlitzIndexT,3>(4, 4, 4)));
+  LMBUNIT_ASSERT(
+      blitz::all(stats.segment(2).upperBound ==
+                 blitz::TinyVector<atb::BlitzIndexT,3>(9, 11, 8)));
+
+  // Surface of a 6 x 8 x 5 box
+  LMBUNIT_ASSERT_EQUAL(
+      stats.segment(2).nSurfaceVoxels, 6 * 8 * 5 - 4 * 6 * 3);
+}
+
+static void testNeighbors()
+{
+  blitz::Array<int,3> L(testLabels());
+  atb::SegmentStatistics stats;
+  stats.compute(L);
+
+  // Segment 3 touches the boundary of segment 2 directly, segment 4 only
+  // touches segment 1
+  std::vector<int> const &nb1 = stats.neighbors(1);
+  LMBUNIT_ASSERT_EQUAL(nb1.size(), 2);
+  LMBUNIT_ASSERT_EQUAL(nb1[0], 2);
+  LMBUNIT_ASSERT_EQUAL(nb1[1], 3);
+  std::vector<int> const &nb2 = stats.neighbors(2);
+  LMBUNIT_ASSERT_EQUAL(nb2.size(), 2);
+  LMBUNIT_ASSERT_EQUAL(nb2[0], 1);
+  LMBUNIT_ASSERT_EQUAL(nb2[1], 3);
+  LMBUNIT_ASSERT_EQUAL(stats.neighbors(4).size(), 0);
+}
+
+static void testRunLengthVoxelAccess()
+{
+  blitz::Array<int,3> L(testLabels());
+  atb::SegmentStatistics stats;
+  stats.compute(L);
+
+  for (int label = 1; label <= 4; ++label)
+  {
+    ptrdiff_t index = 0;
+    bool ok = true;
+    for (atb::BlitzIndexT z = 0; z < L.extent(0); ++z)
+        for (atb::BlitzIndexT y = 0; y < L.extent(1); ++y)
+            for (atb::BlitzIndexT x = 0; x < L.extent(2); ++x)
+                if (L(z, y, x) == label)
+                    ok &= blitz::all(
+                        stats.voxel(label, index++) ==
+                        blitz::TinyVector<atb::BlitzIndexT,3>(z, y, x));
+    LMBUNIT_ASSERT(ok);
+    LMBUNIT_ASSERT_EQUAL(index, stats.segment(label).nVoxels);
+  }
+
+  // Boxes are convex
+  LMBUNIT_ASSERT_EQUAL_DELTA(stats.convexity(L, 2, 1000), 1.0, 1e-10);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testMomentsAndBounds());
+  LMBUNIT_RUN_TEST(testNeighbors());
+  LMBUNIT_RUN_TEST(testRunLengthVoxelAccess());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
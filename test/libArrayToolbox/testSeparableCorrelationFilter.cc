@@ -0,0 +1,106 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/SeparableCorrelationFilter.hh>
+
+// Correlate the rows of data with the asymmetric kernel 1, 2, ..., m by
+// brute force. Out-of-Array reads are clamped for RepeatBT and zero
+// for ValueBT.
+static blitz::Array<double,2> correlateRows(
+    blitz::Array<double,2> const &data, blitz::Array<double,1> const &kernel,
+    atb::BoundaryTreatmentType bt)
+{
+  ptrdiff_t n = data.extent(1);
+  ptrdiff_t m = kernel.extent(0);
+  blitz::Array<double,2> res(data.shape());
+  for (ptrdiff_t r = 0; r < data.extent(0); ++r)
+  {
+    for (ptrdiff_t i = 0; i < n; ++i)
+    {
+      res(r, i) = 0.0;
+      for (ptrdiff_t j = 0; j < m; ++j)
+      {
+        ptrdiff_t idx = i + j - m / 2;
+        if (idx < 0 || idx >= n)
+        {
+          if (bt == atb::ValueBT) continue;
+          idx = (idx < 0) ? 0 : n - 1;
+        }
+        res(r, i) += kernel(j) * data(r, idx);
+      }
+    }
+  }
+  return res;
+}
+
+static void testKernelLongerThanData(atb::BoundaryTreatmentType bt)
+{
+  blitz::Array<double,1> kernel(7);
+  for (int j = 0; j < 7; ++j) kernel(j) = j + 1.0;
+  blitz::TinyVector<double,2> elSize(1.0);
+
+  // Lines of length 4 take the naive path, lines of length 9 the regular
+  // one. Both must agree with the brute force correlation.
+  for (int n = 4; n <= 9; n += 5)
+  {
+    blitz::Array<double,2> data(3, n);
+    for (int r = 0; r < 3; ++r)
+        for (int i = 0; i < n; ++i) data(r, i) = (r + 1) * (i * i - 2 * i + 3);
+
+    atb::SeparableCorrelationFilter<double,2> filter(bt);
+    filter.setKernelForDim(&kernel, 1);
+    blitz::Array<double,2> res;
+    filter.apply(data, elSize, res);
+
+    blitz::Array<double,2> expected(correlateRows(data, kernel, bt));
+    LMBUNIT_ASSERT(blitz::all(res.shape() == expected.shape()));
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        blitz::max(blitz::abs(res - expected)), 0.0, 1e-10);
+  }
+}
+
+static void testCropBTKernelLongerThanData()
+{
+  blitz::Array<double,1> kernel(7);
+  for (int j = 0; j < 7; ++j) kernel(j) = j + 1.0;
+  double kernelSum = blitz::sum(kernel);
+
+  blitz::Array<double,2> data(2, 4);
+  for (int r = 0; r < 2; ++r)
+      for (int i = 0; i < 4; ++i) data(r, i) = (r + 1) * (i * i - 2 * i + 3);
+
+  atb::SeparableCorrelationFilter<double,2> filter(atb::CropBT);
+  filter.setKernelForDim(&kernel, 1);
+  blitz::Array<double,2> res;
+  filter.apply(data, blitz::TinyVector<double,2>(1.0), res);
+
+  // The weighted sum over the data covered by the kernel, renormalized to
+  // the full kernel weight
+  for (int r = 0; r < 2; ++r)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      double sum = 0.0, weight = 0.0;
+      for (int j = 0; j < 7; ++j)
+      {
+        int idx = i + j - 3;
+        if (idx < 0 || idx >= 4) continue;
+        sum += kernel(j) * data(r, idx);
+        weight += kernel(j);
+      }
+      LMBUNIT_ASSERT_EQUAL_DELTA(
+          res(r, i), sum * kernelSum / weight, 1e-10);
+    }
+  }
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testKernelLongerThanData(atb::ValueBT));
+  LMBUNIT_RUN_TEST(testKernelLongerThanData(atb::RepeatBT));
+  LMBUNIT_RUN_TEST(testCropBTKernelLongerThanData());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,93 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/SeparableResampler.hh>
+
+#include <cmath>
+
+// Anisotropic test volume with non-zero values at all borders
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(12, 17, 9),
+      blitz::TinyVector<double,3>(2.0, 1.0, 1.5));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = std::cos(0.8 * z - 0.3 * y) +
+                  0.5 * std::sin(1.1 * x + 0.7 * y) +
+                  0.2 * ((2 * z + 3 * y + 5 * x) % 3);
+  return data;
+}
+
+static void testLinearUpscalingMatchesRescale()
+{
+  blitz::TinyVector<double,3> target(0.5, 0.5, 0.5);
+  atb::Array<double,3> expected(testData());
+  blitz::TinyVector<atb::BlitzIndexT,3> inShape(expected.shape());
+  blitz::TinyVector<double,3> scales(expected.elementSizeUm() / target);
+  atb::Array<double,3> data(inShape, expected.elementSizeUm());
+  data = expected;
+
+  expected.rescale(target);
+  atb::SeparableResampler<double,3>(atb::LinearRK).apply(data, target);
+
+  LMBUNIT_ASSERT(blitz::all(data.shape() == expected.shape()));
+  LMBUNIT_ASSERT(blitz::all(data.elementSizeUm() == target));
+
+  // Array::rescale() uses zero padding, compare where no padding is needed
+  blitz::TinyVector<atb::BlitzIndexT,3> ub;
+  for (int d = 0; d < 3; ++d)
+      ub(d) = static_cast<atb::BlitzIndexT>(
+          std::floor((inShape(d) - 1) * scales(d)));
+  blitz::RectDomain<3> inner(blitz::TinyVector<atb::BlitzIndexT,3>(0), ub);
+  double maxError = blitz::max(blitz::abs(data(inner) - expected(inner)));
+  LMBUNIT_ASSERT_EQUAL_DELTA(maxError, 0.0, 1e-10);
+}
+
+static void testRescaleWithKernelMatchesRepeatInterpolation()
+{
+  blitz::TinyVector<double,3> target(0.5, 0.5, 0.5);
+  atb::Array<double,3> expected(testData());
+  expected.setInterpolator(atb::LinearInterpolator<double,3>(atb::RepeatBT));
+  atb::Array<double,3> data(expected.shape(), expected.elementSizeUm());
+  data = expected;
+
+  expected.rescale(target);
+  data.rescale(target, atb::LinearRK);
+
+  LMBUNIT_ASSERT(blitz::all(data.shape() == expected.shape()));
+  LMBUNIT_ASSERT(blitz::all(data.elementSizeUm() == target));
+  LMBUNIT_ASSERT_EQUAL_DELTA(
+      blitz::max(blitz::abs(data - expected)), 0.0, 1e-10);
+}
+
+static void testDownscalingPreservesConstant(atb::ResamplingKernelType kernel)
+{
+  atb::Array<float,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(20, 31, 16),
+      blitz::TinyVector<double,3>(1.0, 0.3, 0.5));
+  data = 3.0f;
+  blitz::TinyVector<double,3> target(1.0, 1.0, 1.0);
+  atb::SeparableResampler<float,3>(kernel).apply(data, target);
+
+  LMBUNIT_ASSERT_EQUAL(data.extent(0), 20);
+  LMBUNIT_ASSERT_EQUAL(data.extent(1), 9);
+  LMBUNIT_ASSERT_EQUAL(data.extent(2), 8);
+  LMBUNIT_ASSERT(blitz::all(data.elementSizeUm() == target));
+  LMBUNIT_ASSERT_EQUAL_DELTA(blitz::min(data), 3.0f, 1e-5f);
+  LMBUNIT_ASSERT_EQUAL_DELTA(blitz::max(data), 3.0f, 1e-5f);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testLinearUpscalingMatchesRescale());
+  LMBUNIT_RUN_TEST(testRescaleWithKernelMatchesRepeatInterpolation());
+  LMBUNIT_RUN_TEST(testDownscalingPreservesConstant(atb::LinearRK));
+  LMBUNIT_RUN_TEST(testDownscalingPreservesConstant(atb::CubicRK));
+  LMBUNIT_RUN_TEST(testDownscalingPreservesConstant(atb::BSplineRK));
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,73 @@
+#include "lmbunit.hh"
+
+#include <libArrayToolbox/SphericalTensor.hh>
+
+#include <cmath>
+
+// Smooth waves, a blob and a high frequency pattern, so that all bands
+// carry energy
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(19, 14, 11),
+      blitz::TinyVector<double,3>(1.0));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = std::sin(0.9 * z + 0.4 * x) * std::cos(0.6 * y) +
+                  std::exp(-0.2 * ((z - 7) * (z - 7) + (y - 5) * (y - 5) +
+                                   (x - 6) * (x - 6))) +
+                  0.25 * ((3 * z + 5 * y + 7 * x) % 4);
+  return data;
+}
+
+template<typename ComputeT>
+static void testSTderivSlabwise(double tolerance)
+{
+  int const maxBand = 3;
+  atb::Array<double,3> data(testData());
+
+  std::map<atb::SDMagFeatureIndex,atb::Array<double,3>*> expected;
+  atb::STderiv(data, expected, 1.0, 0, maxBand);
+
+  // Slabs of the minimum thickness of twice the halo with a partial last
+  // slab, and a budget too small for any slab, which must not change the
+  // result either
+  atb::BlitzIndexT border = maxBand + 1;
+  size_t bytesPerPlane = 2 * (maxBand + 1) * sizeof(std::complex<ComputeT>) *
+      (data.extent(1) + 2 * border) * (data.extent(2) + 2 * border);
+  size_t const budgets[] = { 4 * border * bytesPerPlane, 1 };
+  for (int i = 0; i < 2; ++i)
+  {
+    std::map<atb::SDMagFeatureIndex,atb::Array<double,3> > result;
+    atb::STderivSlabwise<ComputeT>(
+        data, result, 1.0, 0, maxBand, budgets[i]);
+
+    for (int l = 1; l <= maxBand; ++l)
+    {
+      atb::SDMagFeatureIndex index(1.0, 0, l);
+      LMBUNIT_ASSERT(result.find(index) != result.end());
+      LMBUNIT_ASSERT(blitz::all(result[index].shape() == data.shape()));
+      double maxError = blitz::max(
+          blitz::abs(result[index] - *expected[index]));
+      LMBUNIT_DEBUG_STREAM << "band " << l << ": max error = " << maxError
+                           << std::endl;
+      LMBUNIT_ASSERT_EQUAL_DELTA(
+          maxError, 0.0, tolerance * blitz::max(*expected[index]));
+    }
+  }
+
+  for (std::map<atb::SDMagFeatureIndex,atb::Array<double,3>*>::iterator it =
+           expected.begin(); it != expected.end(); ++it) delete it->second;
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testSTderivSlabwise<double>(1e-10));
+  LMBUNIT_RUN_TEST(testSTderivSlabwise<float>(1e-4));
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
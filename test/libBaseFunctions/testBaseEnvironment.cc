@@ -23,6 +23,18 @@ static void testHostName()
   BaseEnvironment::HostName();
 }
 
+static void testParseMemorySize()
+{
+  LMBUNIT_ASSERT_EQUAL(BaseEnvironment::ParseMemorySize(""), 0u);
+  LMBUNIT_ASSERT_EQUAL(BaseEnvironment::ParseMemorySize("1000"), 1000u);
+  LMBUNIT_ASSERT_EQUAL(BaseEnvironment::ParseMemorySize("3k"), 3u * 1024u);
+  LMBUNIT_ASSERT_EQUAL(
+      BaseEnvironment::ParseMemorySize("512M"), 512u * 1024u * 1024u);
+  LMBUNIT_ASSERT_EQUAL(
+      BaseEnvironment::ParseMemorySize("2g"),
+      static_cast<size_t>(2) * 1024 * 1024 * 1024);
+}
+
 int main(int, char**)
 {
   LMBUNIT_WRITE_HEADER();
@@ -31,6 +43,7 @@ int main(int, char**)
   LMBUNIT_RUN_TEST(testTempDirectory());
   LMBUNIT_RUN_TEST(testUserAppDataDirectory());
   LMBUNIT_RUN_TEST(testHostName());
+  LMBUNIT_RUN_TEST(testParseMemorySize());
 
   LMBUNIT_WRITE_STATISTICS();
   return _nFails;
@@ -1,6 +1,7 @@
 #include "lmbunit.hh"
 
 #include <fstream>
+#include <ctime>
 
 #include <libBaseFunctions/BaseFile.hh>
 
@@ -318,6 +319,31 @@ static void testDirectoryStructure()
           TOP_BUILD_DIR "/test/libBaseFunctions/renamed"));
 }
 
+static void testModificationTime()
+{
+  time_t before = time(NULL);
+  try
+  {
+    std::ofstream outFile(
+        TOP_BUILD_DIR "/test/libBaseFunctions/mtime.txt",
+        std::ios::trunc);
+    outFile << "Test";
+  }
+  catch (std::exception &e)
+  {
+    LMBUNIT_WRITE_FAILURE(std::string("Caught std::exception: ") + e.what());
+  }
+  time_t mtime = BaseFile::ModificationTime(
+      TOP_BUILD_DIR "/test/libBaseFunctions/mtime.txt");
+  LMBUNIT_ASSERT(mtime + 1 >= before);
+  LMBUNIT_ASSERT(mtime <= time(NULL));
+  LMBUNIT_ASSERT(
+      BaseFile::Remove(TOP_BUILD_DIR "/test/libBaseFunctions/mtime.txt"));
+  LMBUNIT_ASSERT(
+      BaseFile::ModificationTime(
+          TOP_BUILD_DIR "/test/libBaseFunctions/mtime.txt") == -1);
+}
+
 static void testBeautifyFilePath()
 {
   std::string somePath = "../some/./complicated///path";
@@ -332,6 +358,7 @@ int main(int, char**)
   LMBUNIT_RUN_TEST(testBaseName());
   LMBUNIT_RUN_TEST(testDirName());
   LMBUNIT_RUN_TEST(testDirectoryStructure());
+  LMBUNIT_RUN_TEST(testModificationTime());
   LMBUNIT_RUN_TEST(testBeautifyFilePath());
 
   LMBUNIT_WRITE_STATISTICS();
@@ -0,0 +1,103 @@
+#include "lmbunit.hh"
+
+#include <libBaseFunctions/BaseTrace.hh>
+
+#include <sstream>
+
+template<typename T>
+class TracedType
+{};
+
+static void testDisabled()
+{
+  BaseTrace::Enable(false);
+  BaseTrace::Clear();
+  {
+    BaseTraceRegion trace("disabled");
+  }
+  std::ostringstream summary;
+  BaseTrace::WriteSummary(summary);
+  LMBUNIT_ASSERT(summary.str().find("disabled") == std::string::npos);
+}
+
+static void testSummary()
+{
+  BaseTrace::Clear();
+  BaseTrace::Enable();
+  {
+    BaseTraceRegion outer("outer");
+    for (int i = 0; i < 3; ++i)
+    {
+      BaseTraceRegion inner("inner");
+    }
+    TracedType<int> t;
+    BaseTraceRegion typed(typeid(t));
+  }
+  BaseTrace::Enable(false);
+
+  std::ostringstream summary;
+  BaseTrace::WriteSummary(summary);
+  std::string s = summary.str();
+  LMBUNIT_ASSERT(s.find("\nouter ") != std::string::npos);
+  LMBUNIT_ASSERT(s.find("\n  inner ") != std::string::npos);
+#ifdef __GNUG__
+  LMBUNIT_ASSERT(s.find("\n  TracedType<int> ") != std::string::npos);
+#endif
+  size_t pos = s.find("\n  inner ");
+  std::istringstream row(s.substr(pos + 9));
+  int calls = 0;
+  row >> calls;
+  LMBUNIT_ASSERT_EQUAL(calls, 3);
+}
+
+static void testRingBuffer()
+{
+  size_t capacity = BaseTrace::BufferCapacity();
+  BaseTrace::SetBufferCapacity(4);
+  BaseTrace::Clear();
+  BaseTrace::Enable();
+  for (int i = 0; i < 10; ++i)
+  {
+    BaseTraceRegion trace("region");
+  }
+  BaseTrace::Enable(false);
+
+  std::ostringstream summary;
+  BaseTrace::WriteSummary(summary);
+  LMBUNIT_ASSERT(summary.str().find("6 regions were dropped") !=
+                 std::string::npos);
+
+  BaseTrace::SetBufferCapacity(capacity);
+  BaseTrace::Clear();
+}
+
+static void testChromeTrace()
+{
+  BaseTrace::Clear();
+  BaseTrace::Enable();
+  {
+    BaseTraceRegion trace("quoted \"name\"");
+  }
+  BaseTrace::Enable(false);
+
+  std::ostringstream json;
+  BaseTrace::WriteChromeTrace(json);
+  std::string s = json.str();
+  LMBUNIT_ASSERT(s.find("{\"traceEvents\":[") == 0);
+  LMBUNIT_ASSERT(s.find("\"name\":\"quoted \\\"name\\\"\"") !=
+                 std::string::npos);
+  LMBUNIT_ASSERT(s.find("\"ph\":\"X\"") != std::string::npos);
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testDisabled());
+  LMBUNIT_RUN_TEST(testSummary());
+  LMBUNIT_RUN_TEST(testRingBuffer());
+  LMBUNIT_RUN_TEST(testChromeTrace());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
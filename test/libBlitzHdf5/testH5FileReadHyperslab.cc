@@ -0,0 +1,118 @@
+#include "lmbunit.hh"
+
+#include <libBlitzHdf5/BlitzHdf5Light.hh>
+
+static void testReadHyperslab()
+{
+  blitz::Array<unsigned short,3> data(5, 6, 7);
+  for (size_t i = 0; i < data.size(); ++i)
+      data.dataFirst()[i] = static_cast<unsigned short>(i);
+  try
+  {
+    BlitzH5File outFile("testH5FileReadHyperslab.h5", BlitzH5File::Replace);
+    outFile.writeDataset(data, "/data");
+  }
+  catch (BlitzH5Error &e)
+  {
+    LMBUNIT_WRITE_FAILURE(
+        std::string("Caught BlitzH5Error during write: ") + e.what());
+  }
+
+  try
+  {
+    BlitzH5File inFile("testH5FileReadHyperslab.h5");
+    blitz::Array<float,3> block(2, 3, 4);
+    inFile.readHyperslab(
+        block, "/data", blitz::TinyVector<hsize_t,3>(3, 1, 2));
+    for (int z = 0; z < block.extent(0); ++z)
+        for (int y = 0; y < block.extent(1); ++y)
+            for (int x = 0; x < block.extent(2); ++x)
+                LMBUNIT_ASSERT_EQUAL(
+                    block(z, y, x),
+                    static_cast<float>(data(z + 3, y + 1, x + 2)));
+  }
+  catch (BlitzH5Error &e)
+  {
+    LMBUNIT_WRITE_FAILURE(
+        std::string("Caught BlitzH5Error during read: ") + e.what());
+  }
+}
+
+static void testReadHyperslabOutOfRange()
+{
+  blitz::Array<float,3> data(2, 3, 4);
+  data = 1.0f;
+  try
+  {
+    BlitzH5File outFile(
+        "testH5FileReadHyperslabOutOfRange.h5", BlitzH5File::Replace);
+    outFile.writeDataset(data, "/data");
+  }
+  catch (BlitzH5Error &e)
+  {
+    LMBUNIT_WRITE_FAILURE(
+        std::string("Caught BlitzH5Error during write: ") + e.what());
+  }
+
+  BlitzH5File inFile("testH5FileReadHyperslabOutOfRange.h5");
+  bool caught = false;
+  try
+  {
+    blitz::Array<float,3> block(2, 2, 2);
+    inFile.readHyperslab(
+        block, "/data", blitz::TinyVector<hsize_t,3>(1, 0, 0));
+  }
+  catch (BlitzH5Error &)
+  {
+    caught = true;
+  }
+  LMBUNIT_ASSERT(caught);
+
+  caught = false;
+  try
+  {
+    blitz::Array<float,2> slice(2, 2);
+    inFile.readHyperslab(slice, "/data", blitz::TinyVector<hsize_t,2>(0, 0));
+  }
+  catch (BlitzH5Error &)
+  {
+    caught = true;
+  }
+  LMBUNIT_ASSERT(caught);
+}
+
+static void testDatasetChunkShape()
+{
+  blitz::Array<float,3> data(2, 3, 4);
+  data = 0.0f;
+  try
+  {
+    BlitzH5File outFile(
+        "testH5FileDatasetChunkShape.h5", BlitzH5File::Replace);
+    outFile.writeDataset(data, "/chunked");
+    outFile.writeDataset(1.0f, "/scalar");
+  }
+  catch (BlitzH5Error &e)
+  {
+    LMBUNIT_WRITE_FAILURE(
+        std::string("Caught BlitzH5Error during write: ") + e.what());
+  }
+
+  BlitzH5File inFile("testH5FileDatasetChunkShape.h5");
+  std::vector<hsize_t> chunkShape(inFile.getDatasetChunkShape("/chunked"));
+  LMBUNIT_ASSERT_EQUAL(chunkShape.size(), static_cast<size_t>(3));
+  LMBUNIT_ASSERT_EQUAL(
+      inFile.getDatasetChunkShape("/scalar").size(), static_cast<size_t>(0));
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testReadHyperslab());
+  LMBUNIT_RUN_TEST(testReadHyperslabOutOfRange());
+  LMBUNIT_RUN_TEST(testDatasetChunkShape());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
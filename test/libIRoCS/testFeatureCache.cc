@@ -0,0 +1,187 @@
+#include "lmbunit.hh"
+
+#include <libIRoCS/iRoCSFeatures.hh>
+#include <libIRoCS/FeatureCache.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static std::string const sdGroup("/features/SDmag/");
+
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(12, 11, 9),
+      blitz::TinyVector<double,3>(1.0));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = std::sin(0.7 * z) * std::cos(0.45 * y) +
+                  0.3 * std::cos(1.3 * x + 0.2 * z);
+  return data;
+}
+
+static atb::Array<double,3> constantArray(
+    atb::Array<double,3> const &like, double value)
+{
+  atb::Array<double,3> res(like.shape(), like.elementSizeUm());
+  std::fill(res.data(), res.data() + res.size(), value);
+  return res;
+}
+
+static std::string dsName(double sigma, int laplace, int band)
+{
+  iRoCS::Features features;
+  return sdGroup + features.sdFeatureName(
+      atb::SDMagFeatureIndex(sigma, laplace, band));
+}
+
+static std::string storedKey(
+    std::string const &cacheFileName, std::string const &ds)
+{
+  BlitzH5File inFile(cacheFileName);
+  if (!inFile.existsAttribute(iRoCS::FeatureCache::keyAttribute, ds))
+      return "";
+  std::string key;
+  inFile.readAttribute(key, iRoCS::FeatureCache::keyAttribute, ds);
+  return key;
+}
+
+// Computes the Gaussian, its Laplacian and the first band of the
+// Gaussian into a fresh cache file and returns their stored keys
+static void computeKeys(
+    atb::Array<double,3> const &data, double sigma,
+    std::string const &cacheFileName, std::string *keys)
+{
+  std::remove(cacheFileName.c_str());
+  iRoCS::Features features;
+  features.addFeatureToGroup(
+      sdGroup, features.sdFeatureName(atb::SDMagFeatureIndex(sigma, 0, 0)));
+  features.sdFeature(
+      data, atb::SDMagFeatureIndex(sigma, 1, 0), 2, cacheFileName);
+  features.sdFeature(
+      data, atb::SDMagFeatureIndex(sigma, 0, 1), 2, cacheFileName);
+  keys[0] = storedKey(cacheFileName, dsName(sigma, 0, 0));
+  keys[1] = storedKey(cacheFileName, dsName(sigma, 1, 0));
+  keys[2] = storedKey(cacheFileName, dsName(sigma, 0, 1));
+  std::remove(cacheFileName.c_str());
+}
+
+static void testStoredKeyIsReused()
+{
+  std::string cacheFileName("/tmp/testFeatureCacheReuse.h5");
+  atb::Array<double,3> data(testData());
+  std::string keys[3], keysAgain[3];
+  computeKeys(data, 2.0, cacheFileName, keys);
+  computeKeys(data, 2.0, cacheFileName, keysAgain);
+  for (int i = 0; i < 3; ++i)
+  {
+    LMBUNIT_ASSERT(keys[i] != "");
+    LMBUNIT_ASSERT_EQUAL(keysAgain[i], keys[i]);
+  }
+
+  // An entry carrying the expected key is loaded, not recomputed
+  atb::Array<double,3> marker(constantArray(data, 42.0));
+  iRoCS::FeatureCache::save(marker, cacheFileName, dsName(2.0, 0, 0), keys[0]);
+  {
+    iRoCS::Features features;
+    features.addFeatureToGroup(
+        sdGroup, features.sdFeatureName(atb::SDMagFeatureIndex(2.0, 0, 0)));
+    atb::Array<double,3> &fea = features.sdFeature(
+        data, atb::SDMagFeatureIndex(2.0, 0, 0), 2, cacheFileName);
+    LMBUNIT_ASSERT(blitz::all(fea.shape() == data.shape()));
+    LMBUNIT_ASSERT_EQUAL(blitz::min(fea), 42.0);
+    LMBUNIT_ASSERT_EQUAL(blitz::max(fea), 42.0);
+  }
+  std::remove(cacheFileName.c_str());
+}
+
+static void testKeysFollowInputs()
+{
+  std::string cacheFileName("/tmp/testFeatureCacheKeys.h5");
+  atb::Array<double,3> data(testData());
+  std::string keys[3];
+  computeKeys(data, 2.0, cacheFileName, keys);
+  LMBUNIT_ASSERT(keys[0] != keys[1]);
+  LMBUNIT_ASSERT(keys[0] != keys[2]);
+  LMBUNIT_ASSERT(keys[1] != keys[2]);
+
+  std::string changed[3];
+
+  atb::Array<double,3> modified(testData());
+  modified(5, 4, 3) += 1e-6;
+  computeKeys(modified, 2.0, cacheFileName, changed);
+  for (int i = 0; i < 3; ++i) LMBUNIT_ASSERT(changed[i] != keys[i]);
+
+  atb::Array<double,3> rescaled(testData());
+  rescaled.setElementSizeUm(blitz::TinyVector<double,3>(1.0, 1.0, 1.25));
+  computeKeys(rescaled, 2.0, cacheFileName, changed);
+  for (int i = 0; i < 3; ++i) LMBUNIT_ASSERT(changed[i] != keys[i]);
+
+  computeKeys(data, 4.0, cacheFileName, changed);
+  for (int i = 0; i < 3; ++i) LMBUNIT_ASSERT(changed[i] != keys[i]);
+}
+
+static void testStaleEntryIsRecomputed()
+{
+  std::string cacheFileName("/tmp/testFeatureCacheStale.h5");
+  atb::Array<double,3> data(testData());
+  std::string keys[3];
+  computeKeys(data, 2.0, cacheFileName, keys);
+  std::string ds(dsName(2.0, 0, 0));
+
+  atb::Array<double,3> expected;
+  {
+    iRoCS::Features features;
+    features.addFeatureToGroup(
+        sdGroup, features.sdFeatureName(atb::SDMagFeatureIndex(2.0, 0, 0)));
+    atb::Array<double,3> &fea = features.sdFeature(
+        data, atb::SDMagFeatureIndex(2.0, 0, 0), 2, "");
+    expected.resize(fea.shape());
+    expected = fea;
+  }
+
+  atb::Array<double,3> marker(constantArray(data, 42.0));
+  for (int trial = 0; trial < 2; ++trial)
+  {
+    std::remove(cacheFileName.c_str());
+    if (trial == 0) marker.save(cacheFileName, ds); // Entry without key
+    else iRoCS::FeatureCache::save(
+        marker, cacheFileName, ds, "0123456789abcdef"); // Mismatched key
+
+    atb::Array<double,3> loaded;
+    LMBUNIT_ASSERT(
+        !iRoCS::FeatureCache::load(loaded, cacheFileName, ds, keys[0]));
+    LMBUNIT_ASSERT(!iRoCS::FeatureCache::isValid(cacheFileName, ds, keys[0]));
+
+    iRoCS::Features features;
+    features.addFeatureToGroup(
+        sdGroup, features.sdFeatureName(atb::SDMagFeatureIndex(2.0, 0, 0)));
+    atb::Array<double,3> &fea = features.sdFeature(
+        data, atb::SDMagFeatureIndex(2.0, 0, 0), 2, cacheFileName);
+    LMBUNIT_ASSERT(blitz::all(fea.shape() == expected.shape()));
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        blitz::max(blitz::abs(fea - expected)), 0.0, 1e-12);
+
+    // The recomputed feature replaced the stale entry
+    LMBUNIT_ASSERT_EQUAL(storedKey(cacheFileName, ds), keys[0]);
+    LMBUNIT_ASSERT(
+        iRoCS::FeatureCache::load(loaded, cacheFileName, ds, keys[0]));
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        blitz::max(blitz::abs(loaded - expected)), 0.0, 1e-12);
+  }
+  std::remove(cacheFileName.c_str());
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testStoredKeyIsReused());
+  LMBUNIT_RUN_TEST(testKeysFollowInputs());
+  LMBUNIT_RUN_TEST(testStaleEntryIsRecomputed());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,95 @@
+#include "lmbunit.hh"
+
+#include <libIRoCS/iRoCSFeatures.hh>
+
+#include <cmath>
+
+// Smooth test volume with one even and two odd extents, so that both the
+// kernel-longer-than-data and the regular correlation paths are taken
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(21, 18, 15),
+      blitz::TinyVector<double,3>(1.0));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = std::sin(0.7 * z) * std::cos(0.45 * y) +
+                  0.3 * std::cos(1.3 * x + 0.2 * z) +
+                  std::exp(-0.1 * ((z - 8) * (z - 8) + (y - 11) * (y - 11) +
+                                   (x - 5) * (x - 5)));
+  return data;
+}
+
+static void testSDGaussianKernelDropsZeroTails()
+{
+  atb::BlitzIndexT extent = 101;
+  blitz::Array<double,1> full(2 * (extent / 2) + 1);
+  atb::gaussian(
+      full, blitz::TinyVector<double,1>(1.0),
+      blitz::TinyVector<double,1>(1.0), atb::NORESIZE);
+
+  blitz::Array<double,1> kernel;
+  iRoCS::Features::sdGaussianKernel(1.0, extent, kernel);
+  LMBUNIT_ASSERT(kernel.extent(0) % 2 == 1);
+  LMBUNIT_ASSERT(kernel.extent(0) < full.extent(0));
+
+  atb::BlitzIndexT skip = (full.extent(0) - kernel.extent(0)) / 2;
+  for (atb::BlitzIndexT i = 0; i < full.extent(0); ++i)
+  {
+    if (i < skip || i >= skip + kernel.extent(0))
+    {
+      LMBUNIT_ASSERT_EQUAL(full(i), 0.0);
+    }
+    else
+    {
+      LMBUNIT_ASSERT_EQUAL(kernel(i - skip), full(i));
+    }
+  }
+}
+
+static void testSDFeatureMatchesDirectSmoothing()
+{
+  atb::Array<double,3> data(testData());
+  iRoCS::Features features;
+  double const scales[] = { 1.0, 2.0, 8.0 };
+  for (int s = 0; s < 3; ++s)
+      features.addFeatureToGroup(
+          "/features/SDmag", features.sdFeatureName(
+              atb::SDMagFeatureIndex(scales[s], 0, 0)));
+
+  for (int s = 0; s < 3; ++s)
+  {
+    // The smoothing of the SD features before the exact zero tails of the
+    // kernels were dropped
+    atb::SeparableConvolutionFilter<double,3> filter(atb::RepeatBT);
+    std::vector< blitz::Array<double,1> > kernels(3);
+    for (int dim = 0; dim < 3; ++dim)
+    {
+      kernels[dim].resize(2 * (data.extent(dim) / 2) + 1);
+      atb::gaussian(
+          kernels[dim], blitz::TinyVector<double,1>(scales[s]),
+          blitz::TinyVector<double,1>(1.0), atb::NORESIZE);
+      filter.setKernelForDim(&kernels[dim], dim);
+    }
+    atb::Array<double,3> expected;
+    filter.apply(features.dataScaled(data, ""), expected);
+
+    atb::Array<double,3> &fea = features.sdFeature(
+        data, atb::SDMagFeatureIndex(scales[s], 0, 0), 2, "");
+    LMBUNIT_ASSERT(blitz::all(fea.shape() == expected.shape()));
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        blitz::max(blitz::abs(fea - expected)), 0.0, 1e-12);
+  }
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testSDGaussianKernelDropsZeroTails());
+  LMBUNIT_RUN_TEST(testSDFeatureMatchesDirectSmoothing());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
@@ -0,0 +1,131 @@
+#include "lmbunit.hh"
+
+#include <libIRoCS/iRoCSFeatures.hh>
+#include <libIRoCS/PointSampledFeatures.hh>
+#include <libArrayToolbox/Interpolator.hh>
+
+#include <cmath>
+
+// Two blobs on a smooth background, one of them touching the border
+static atb::Array<double,3> testData()
+{
+  atb::Array<double,3> data(
+      blitz::TinyVector<atb::BlitzIndexT,3>(24, 22, 19),
+      blitz::TinyVector<double,3>(1.0));
+  for (atb::BlitzIndexT z = 0; z < data.extent(0); ++z)
+      for (atb::BlitzIndexT y = 0; y < data.extent(1); ++y)
+          for (atb::BlitzIndexT x = 0; x < data.extent(2); ++x)
+              data(z, y, x) = 0.1 * std::sin(0.3 * z + 0.2 * y) +
+                  std::exp(-0.15 * ((z - 11) * (z - 11) + (y - 9) * (y - 9) +
+                                    (x - 8) * (x - 8))) +
+                  0.7 * std::exp(-0.25 * (z * z + (y - 20) * (y - 20) +
+                                          (x - 17) * (x - 17)));
+  return data;
+}
+
+// Query positions inside the volume, at the border, and within the last
+// interpolation cell of each dimension
+static std::vector< blitz::TinyVector<double,3> > testPositionsUm()
+{
+  std::vector< blitz::TinyVector<double,3> > positionsUm;
+  positionsUm.push_back(blitz::TinyVector<double,3>(11.0, 9.0, 8.0));
+  positionsUm.push_back(blitz::TinyVector<double,3>(10.3, 12.6, 4.8));
+  positionsUm.push_back(blitz::TinyVector<double,3>(0.0, 0.0, 0.0));
+  positionsUm.push_back(blitz::TinyVector<double,3>(0.4, 20.7, 17.5));
+  positionsUm.push_back(blitz::TinyVector<double,3>(22.6, 21.0, 18.0));
+  positionsUm.push_back(blitz::TinyVector<double,3>(23.0, 0.3, 9.2));
+  positionsUm.push_back(blitz::TinyVector<double,3>(5.5, 21.4, 0.2));
+  return positionsUm;
+}
+
+static void testSDFeaturesMatchInterpolatedSDFeatures()
+{
+  atb::Array<double,3> data(testData());
+  std::vector< blitz::TinyVector<double,3> > positionsUm(testPositionsUm());
+  int const bandMax = 2;
+
+  iRoCS::Features features;
+  double const scales[] = { 1.0, 2.0, 8.0 };
+  for (int s = 0; s < 3; ++s)
+      for (int l = 0; l <= bandMax / 2; ++l)
+          for (int b = 0; b <= bandMax - 2 * l; ++b)
+              features.addFeatureToGroup(
+                  "/features/SDmag", features.sdFeatureName(
+                      atb::SDMagFeatureIndex(scales[s], l, b)));
+
+  iRoCS::PointSampledFeatures sampler(
+      features.dataScaled(data, ""), positionsUm);
+  atb::LinearInterpolator<double,3> ip(atb::ValueBT);
+  for (int s = 0; s < 3; ++s)
+  {
+    std::map< atb::SDMagFeatureIndex, std::vector<double> > values;
+    sampler.computeSDFeatures(scales[s], bandMax, values);
+    for (int l = 0; l <= bandMax / 2; ++l)
+    {
+      for (int b = 0; b <= bandMax - 2 * l; ++b)
+      {
+        atb::SDMagFeatureIndex index(scales[s], l, b);
+        LMBUNIT_ASSERT(values.find(index) != values.end());
+        LMBUNIT_ASSERT_EQUAL(values[index].size(), positionsUm.size());
+        atb::Array<double,3> &fea =
+            features.sdFeature(data, index, bandMax - 2 * l, "");
+        for (size_t i = 0; i < positionsUm.size(); ++i)
+        {
+          blitz::TinyVector<double,3> pos(
+              positionsUm[i] / features.elementSizeUm());
+          double expected = ip.get(fea, pos);
+          LMBUNIT_ASSERT_EQUAL_DELTA(
+              values[index][i], expected, 1e-8 * (1.0 + std::abs(expected)));
+        }
+      }
+    }
+  }
+}
+
+static void testHoughFeaturesMatchInterpolatedHoughFeatures()
+{
+  atb::Array<double,3> data(testData());
+  std::vector< blitz::TinyVector<double,3> > positionsUm(testPositionsUm());
+
+  iRoCS::Features features;
+  features.addFeatureToGroup(
+      "/features/SDmag",
+      features.sdFeatureName(atb::SDMagFeatureIndex(1.0, 0, 0)));
+  for (int i = iRoCS::Features::PositiveMagnitude;
+       i <= iRoCS::Features::NegativeRadius; ++i)
+      features.addFeatureToGroup(
+          "/features/hough", features.houghFeatureName(i));
+
+  iRoCS::PointSampledFeatures sampler(
+      features.dataScaled(data, ""), positionsUm);
+  std::map< int, std::vector<double> > values;
+  sampler.computeHoughFeatures(values);
+
+  atb::LinearInterpolator<double,3> ip(atb::ValueBT);
+  for (int i = iRoCS::Features::PositiveMagnitude;
+       i <= iRoCS::Features::NegativeRadius; ++i)
+  {
+    LMBUNIT_ASSERT(values.find(i) != values.end());
+    LMBUNIT_ASSERT_EQUAL(values[i].size(), positionsUm.size());
+    atb::Array<double,3> &fea = features.houghFeature(data, i, "");
+    for (size_t j = 0; j < positionsUm.size(); ++j)
+    {
+      blitz::TinyVector<double,3> pos(
+          positionsUm[j] / features.elementSizeUm());
+      double expected = ip.get(fea, pos);
+      LMBUNIT_ASSERT_EQUAL_DELTA(
+          values[i][j], expected, 1e-8 * (1.0 + std::abs(expected)));
+    }
+  }
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testSDFeaturesMatchInterpolatedSDFeatures());
+  LMBUNIT_RUN_TEST(testHoughFeaturesMatchInterpolatedHoughFeatures());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}
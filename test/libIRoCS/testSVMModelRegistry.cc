@@ -0,0 +1,152 @@
+#include "lmbunit.hh"
+
+#include <libIRoCS/SVMModelRegistry.hh>
+
+#include <libsvmtl/StDataHdf5.hh>
+#include <libsvmtl/MultiClassSVMOneVsOne.hh>
+#include <libsvmtl/TwoClassSVMc.hh>
+#include <libsvmtl/Kernel_RBF.hh>
+#include <libsvmtl/Model.hh>
+#include <libsvmtl/DirectAccessor.hh>
+
+#include <cmath>
+#include <cstdio>
+
+static svt::BasicFV featureVector(
+    double label, double f0, double f1, double f2)
+{
+  svt::BasicFV fv;
+  fv.resize(3);
+  fv.setLabel(label);
+  fv[0] = f0;
+  fv[1] = f1;
+  fv[2] = f2;
+  return fv;
+}
+
+// Points on a grid, labelled by the sector of the (f0,f1) plane they lie
+// in. With nClasses == 2 the classes are not linearly separable.
+static std::vector<svt::BasicFV> featureVectors(
+    int nClasses, double offset, double const *labels)
+{
+  std::vector<svt::BasicFV> fvs;
+  for (int i = 0; i < 7; ++i)
+  {
+    for (int j = 0; j < 7; ++j)
+    {
+      double f0 = -1.5 + 0.5 * i + offset, f1 = -1.5 + 0.5 * j - offset;
+      double angle = std::atan2(f1, f0) + M_PI;
+      int c = static_cast<int>(angle / (2.0 * M_PI) * 2 * nClasses) %
+          nClasses;
+      fvs.push_back(featureVector(labels[c], f0, f1, 0.1 * (i - j)));
+    }
+  }
+  return fvs;
+}
+
+static void testTwoClassMatchesSvmtl()
+{
+  double const labels[] = { -1.0, 1.0 };
+  std::vector<svt::BasicFV> trainVectors(featureVectors(2, 0.0, labels));
+  svt::adjustUniqueIDs(trainVectors);
+  std::string modelFileName("/tmp/testSVMModelRegistryTwoClass.h5");
+  {
+    svt::Model<svt::BasicFV> model;
+    svt::TwoClassSVMc<svt::Kernel_RBF> svm;
+    svm.kernel().setGamma(0.8);
+    svm.setCost(10);
+    svm.updateKernelCache(
+        trainVectors.begin(), trainVectors.end(), svt::DirectAccessor());
+    svm.train(trainVectors.begin(), trainVectors.end(), model);
+    svt::StDataHdf5 modelMap(modelFileName.c_str(), H5F_ACC_TRUNC);
+    svm.saveParameters(modelMap);
+    model.saveParameters(modelMap);
+  }
+
+  // The svmtl classification of the model as stored in the file
+  svt::Model<svt::BasicFV> model;
+  svt::TwoClassSVMc<svt::Kernel_RBF> svm;
+  {
+    svt::StDataHdf5 modelMap(modelFileName.c_str());
+    modelMap.setExceptionFlag(true);
+    model.loadParameters(modelMap);
+    svm.loadParameters(modelMap);
+  }
+  iRoCS::CompactSVMModel compact;
+  compact.loadTwoClass(modelFileName);
+  std::remove(modelFileName.c_str());
+
+  LMBUNIT_ASSERT(!compact.isMultiClass());
+  LMBUNIT_ASSERT_EQUAL(compact.nSupportVectors(), model.size());
+
+  std::vector<svt::BasicFV> testVectors(featureVectors(2, 0.2, labels));
+  std::vector<double> kernel;
+  for (size_t i = 0; i < testVectors.size(); ++i)
+  {
+    double expected = svm.classify(testVectors[i], model);
+    LMBUNIT_ASSERT_EQUAL_DELTA(
+        compact.classify(testVectors[i]), expected,
+        1e-10 * (1.0 + std::abs(expected)));
+    LMBUNIT_ASSERT_EQUAL(
+        compact.classify(testVectors[i], kernel),
+        compact.classify(testVectors[i]));
+  }
+}
+
+static void testMultiClassMatchesSvmtl()
+{
+  double const labels[] = { 2.0, 5.0, 7.0, 3.0 };
+  std::vector<svt::BasicFV> trainVectors(featureVectors(4, 0.0, labels));
+  svt::adjustUniqueIDs(trainVectors);
+  std::string modelFileName("/tmp/testSVMModelRegistryMultiClass.h5");
+  {
+    svt::Model_MC_OneVsOne< svt::Model<svt::BasicFV> > model;
+    svt::MultiClassSVMOneVsOne< svt::TwoClassSVMc<svt::Kernel_RBF> > svm;
+    svm.twoClassSVM().kernel().setGamma(0.8);
+    svm.twoClassSVM().setCost(10);
+    svm.updateKernelCache(
+        trainVectors.begin(), trainVectors.end(), svt::DirectAccessor());
+    svm.train(trainVectors.begin(), trainVectors.end(), model);
+    svt::StDataHdf5 modelMap(modelFileName.c_str(), H5F_ACC_TRUNC);
+    svm.saveParameters(modelMap);
+    model.saveParameters(modelMap);
+  }
+
+  svt::Model_MC_OneVsOne< svt::Model<svt::BasicFV> > model;
+  svt::MultiClassSVMOneVsOne< svt::TwoClassSVMc<svt::Kernel_RBF> > svm;
+  {
+    svt::StDataHdf5 modelMap(modelFileName.c_str());
+    modelMap.setExceptionFlag(true);
+    model.loadParameters(modelMap);
+    svm.loadParameters(modelMap);
+  }
+  iRoCS::CompactSVMModel compact;
+  compact.loadMultiClass(modelFileName);
+  std::remove(modelFileName.c_str());
+
+  LMBUNIT_ASSERT(compact.isMultiClass());
+  LMBUNIT_ASSERT_EQUAL(
+      compact.nSupportVectors(), model.collectedSupportVectors().size());
+
+  std::vector<svt::BasicFV> testVectors(featureVectors(4, 0.2, labels));
+  std::vector<double> kernel;
+  for (size_t i = 0; i < testVectors.size(); ++i)
+  {
+    double expected = model.classIndexToLabel(
+        svm.predictClassIndex(testVectors[i], model));
+    LMBUNIT_ASSERT_EQUAL(svm.classify(testVectors[i], model), expected);
+    LMBUNIT_ASSERT_EQUAL(compact.classify(testVectors[i]), expected);
+    LMBUNIT_ASSERT_EQUAL(compact.classify(testVectors[i], kernel), expected);
+  }
+}
+
+int main(int, char**)
+{
+  LMBUNIT_WRITE_HEADER();
+
+  LMBUNIT_RUN_TEST(testTwoClassMatchesSvmtl());
+  LMBUNIT_RUN_TEST(testMultiClassMatchesSvmtl());
+
+  LMBUNIT_WRITE_STATISTICS();
+  return _nFails;
+}